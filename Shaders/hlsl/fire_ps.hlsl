@@ -33,7 +33,7 @@ cbuffer lightCBuffer : register(b2) {
 cbuffer sceneCBuffer : register(b3) {
 	float4				windDir;
 	float				Time;
-	float				grassHeight;
+	float				grassShellHeight; // Height between grass shells (see grass_vs.hlsl)
 };
 
 
@@ -12,6 +12,11 @@
 cbuffer modelCBuffer : register(b0) {
 	float4x4			worldMatrix;
 	float4x4			worldITMatrix; // Correctly transform normals to world space
+	float4				posScale;
+	float4				posOffset;
+	float4				matDiffuse;
+	float4				matSpecular;
+	float4				texRect; // Texture coordinate scale (xy) and offset (zw) in the sprite atlas
 };
 cbuffer cameraCbuffer : register(b1) {
 	float4x4			viewMatrix;
@@ -28,7 +33,7 @@ cbuffer lightCBuffer : register(b2) {
 cbuffer sceneCBuffer : register(b3) {
 	float4				windDir;
 	float				Time;
-	float				grassHeight;
+	float				grassShellHeight; // Height between grass shells (see grass_vs.hlsl)
 };
 
 
@@ -89,7 +94,7 @@ vertexOutputPacket main(vertexInputPacket vin) {
 	vout.posH = mul(float4(pos, 1.0f), VP);
 
 	//calculate texture coordinates
-	vout.texCoord = float2((vin.posL.x + 1)*0.5, (vin.posL.y + 1)*0.5);
+	vout.texCoord = float2((vin.posL.x + 1)*0.5, (vin.posL.y + 1)*0.5) * texRect.xy + texRect.zw;
 	return vout;
 
 }
@@ -33,7 +33,7 @@ cbuffer cameraCBuffer : register(b1) {
 cbuffer sceneCBuffer : register(b3) {
 	float4				windDir;
 	float				Timer;
-	float				grassHeight;
+	float				grassShellHeight; // Height between grass shells (see grass_vs.hlsl)
 };
 
 
@@ -17,6 +17,7 @@ struct vertexInputPacket {
 	float3				pos			: POSITION;
 	float3				posL		: LPOS;
 	float4				colour		: COLOR;
+	float4				texRect		: TEXRECT; // Texture coordinate scale (xy) and offset (zw) in the sprite atlas
 };
 
 
@@ -62,7 +63,7 @@ vertexOutputPacket main(vertexInputPacket inputVertex) {
 	// Transform to homogeneous clip space.
 	outputVertex.colour = inputVertex.colour;
 	outputVertex.posH = pos;// 
-	outputVertex.texCoord = float2((inputVertex.posL.x + 1)*0.5, (inputVertex.posL.y + 1)*0.5);
+	outputVertex.texCoord = float2((inputVertex.posL.x + 1)*0.5, (inputVertex.posL.y + 1)*0.5) * inputVertex.texRect.xy + inputVertex.texRect.zw;
 
 
 
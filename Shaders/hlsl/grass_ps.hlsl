@@ -36,7 +36,7 @@ cbuffer lightCBuffer : register(b2) {
 cbuffer sceneCBuffer : register(b3) {
 	float4				windDir;
 	float				Time;
-	float				grassHeight;
+	float				grassShellHeight; // Height between grass shells - shell i is drawn i steps above the terrain
 };
 
 //
@@ -65,6 +65,8 @@ struct FragmentInputPacket {
 	float4				matDiffuse		: DIFFUSE; // a represents alpha.
 	float4				matSpecular		: SPECULAR; // a represents specular power. 
 	float2				texCoord		: TEXCOORD;
+	// Height of the shell above the terrain (0 for the ground)
+	nointerpolation float	grassHeight	: GRASSHEIGHT;
 	float4				posH			: SV_POSITION;
 };
 
@@ -86,6 +88,7 @@ FragmentOutputPacket main(FragmentInputPacket v) {
 	float maxGrassDist = 5.0f;
 	float grassFadeRange = 20.f;
 	float distance = length(eyePos.xyz - v.posW);
+	float grassHeight = v.grassHeight;
 
 	if (grassHeight > 0.0)
 	{
@@ -3,6 +3,8 @@
 // Grass effect - Modified a fur technique
 //
 
+// The shells are drawn as instances of the terrain in one draw.  Shell n (SV_InstanceID) is extruded n * grassShellHeight above the terrain - shell 0 is the ground.
+
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
 
@@ -29,7 +31,7 @@ cbuffer lightCBuffer : register(b2) {
 cbuffer sceneCBuffer : register(b3) {
 	float4						windDir;
 	float						Time;
-	float						grassHeight;
+	float						grassShellHeight; // Height between grass shells - shell i is drawn i steps above the terrain
 };
 
 
@@ -44,6 +46,7 @@ struct vertexInputPacket {
 	float4				matDiffuse	: DIFFUSE; // a represents alpha.
 	float4				matSpecular	: SPECULAR;  // a represents specular power. 
 	float2				texCoord	: TEXCOORD;
+	uint				shell		: SV_InstanceID;
 };
 
 
@@ -57,6 +60,8 @@ struct vertexOutputPacket {
 	float4				matDiffuse		: DIFFUSE;
 	float4				matSpecular		: SPECULAR;
 	float2				texCoord		: TEXCOORD;
+	// Height of the shell above the terrain
+	nointerpolation float	grassHeight	: GRASSHEIGHT;
 	float4				posH			: SV_POSITION;
 };
 //-----------------------------------------------------------------
@@ -64,6 +69,7 @@ struct vertexOutputPacket {
 //-----------------------------------------------------------------
 vertexOutputPacket main(vertexInputPacket inputVertex) {
 	float grassScaleFactor = 1.0;
+	float grassHeight = grassShellHeight * inputVertex.shell;
 	vertexOutputPacket outputVertex;
 	float4x4 WVP = mul(worldMatrix, mul(viewMatrix, projMatrix));
 	// Lighting is calculated in world space.
@@ -75,6 +81,7 @@ vertexOutputPacket main(vertexInputPacket inputVertex) {
 	outputVertex.matSpecular = inputVertex.matSpecular;
 	// .. and texture coordinates.
 	outputVertex.texCoord = inputVertex.texCoord;
+	outputVertex.grassHeight = grassHeight;
 	// Finally transform/project pos to screen/clip space posH
 	float3 pos = inputVertex.pos;
 		pos.y += grassHeight*grassScaleFactor;
@@ -49,7 +49,7 @@ cbuffer lightCBuffer : register(b2) {
 cbuffer sceneCBuffer : register(b3) {
 	float4						windDir;
 	float						Time;
-	float						grassHeight;
+	float						grassShellHeight; // Height between grass shells (see grass_vs.hlsl)
 };
 
 //-----------------------------------------------------------------
@@ -98,11 +98,11 @@ FragmentOutputPacket main(FragmentInputPacket IN) {
 	float KWater =			1.0f;
 	float HDRMultiplier =	0;
 
-	// Sum normal maps
-	float4 t0 = gNormMap.Sample(gNormalLinearSam, IN.bumpUV0)*2.0 - 1.0;
-	float4 t1 = gNormMap.Sample(gNormalLinearSam, IN.bumpUV1)*2.0 - 1.0;
-	float4 t2 = gNormMap.Sample(gNormalLinearSam, IN.bumpUV2)*2.0 - 1.0;
-	float3 Nt = t0.xyz + t1.xyz + t2.xyz;
+	// Sum normal maps - z is reconstructed from x and y so two channel (BC5) normal maps can be used
+	float2 t0 = gNormMap.Sample(gNormalLinearSam, IN.bumpUV0).xy*2.0 - 1.0;
+	float2 t1 = gNormMap.Sample(gNormalLinearSam, IN.bumpUV1).xy*2.0 - 1.0;
+	float2 t2 = gNormMap.Sample(gNormalLinearSam, IN.bumpUV2).xy*2.0 - 1.0;
+	float3 Nt = float3(t0, sqrt(saturate(1.0 - dot(t0, t0)))) + float3(t1, sqrt(saturate(1.0 - dot(t1, t1)))) + float3(t2, sqrt(saturate(1.0 - dot(t2, t2))));
 
 	// Transform normals from texture space to world coordinates
 	// Add Code Here (Reconstruct float3X3 tangent to world matrix)
@@ -3,6 +3,13 @@
 // Model a simple light
 //
 
+// Permutation axes: TEXTURE_COLOUR
+// TEXTURE_COLOUR takes the base colour from the texture alone instead of the material colour times the texture (foliage).  Variants are compiled from ShaderPermutation.h.
+
+#ifndef TEXTURE_COLOUR
+#define TEXTURE_COLOUR 0
+#endif
+
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
 
@@ -73,13 +80,13 @@ SamplerState linearSampler : register(s0);
 FragmentOutputPacket main(FragmentInputPacket v) { 
 
 	FragmentOutputPacket outputFragment;
-	bool useTexture = true; //Change this parameter to true to render using texture and vertex colour
 
 	float3 N = normalize(v.normalW);
-	float4 baseColour = v.matDiffuse;
-	
-	if (useTexture)
-		baseColour = baseColour * diffuseTexture.Sample(linearSampler, v.texCoord);
+#if TEXTURE_COLOUR
+	float4 baseColour = diffuseTexture.Sample(linearSampler, v.texCoord);
+#else
+	float4 baseColour = v.matDiffuse * diffuseTexture.Sample(linearSampler, v.texCoord);
+#endif
 		//Initialise returned colour to ambient component
 	float3 colour = baseColour.xyz* lightAmbient;
 	// Calculate the lambertian term (essentially the brightness of the surface point based on the dot product of the normal vector with the vector pointing from v to the light source's location)
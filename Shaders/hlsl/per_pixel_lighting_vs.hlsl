@@ -1,4 +1,17 @@
 
+//
+// Quantised model vertex shader
+//
+
+// Permutation axes: WIND_ANIMATION INSTANCED
+// WIND_ANIMATION sways the vertices with the scene wind (trees).  INSTANCED reads the world matrices from per-instance vertex data (see InstancedModel) instead of the model cbuffer.  Variants are compiled from ShaderPermutation.h.
+
+#ifndef WIND_ANIMATION
+#define WIND_ANIMATION 0
+#endif
+#ifndef INSTANCED
+#define INSTANCED 0
+#endif
 
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
@@ -8,8 +21,12 @@
 //-----------------------------------------------------------------
 
 cbuffer modelCBuffer : register(b0) {
-	float4x4			worldMatrix;
+	float4x4			worldMatrix; // Unused by instanced draws
 	float4x4			worldITMatrix; // Correctly transform normals to world space
+	float4				posScale; // Dequantise model space position = pos * posScale + posOffset
+	float4				posOffset;
+	float4				matDiffuse; // a represents alpha.
+	float4				matSpecular; // a represents specular power.
 };
 cbuffer cameraCbuffer : register(b1) {
 	float4x4			viewMatrix;
@@ -22,6 +39,13 @@ cbuffer lightCBuffer : register(b2) {
 	float4				lightDiffuse;
 	float4				lightSpecular;
 };
+#if WIND_ANIMATION
+cbuffer sceneCBuffer : register(b3) {
+	float4						windDir;
+	float						Time;
+	float						grassShellHeight; // Height between grass shells (see grass_vs.hlsl)
+};
+#endif
 
 
 //-----------------------------------------------------------------
@@ -29,11 +53,20 @@ cbuffer lightCBuffer : register(b2) {
 //-----------------------------------------------------------------
 struct vertexInputPacket {
 
-	float3				pos			: POSITION;
-	float3				normal		: NORMAL;
-	float4				matDiffuse	: DIFFUSE; // a represents alpha.
-	float4				matSpecular	: SPECULAR;  // a represents specular power. 
+	float4				pos			: POSITION; // UNORM relative to model AABB
+	float2				normal		: NORMAL; // Octahedral encoded
 	float2				texCoord	: TEXCOORD;
+#if INSTANCED
+	// Rows of the instance world matrix and its inverse transpose
+	float4				world0		: WORLD0;
+	float4				world1		: WORLD1;
+	float4				world2		: WORLD2;
+	float4				world3		: WORLD3;
+	float4				worldIT0	: WORLDIT0;
+	float4				worldIT1	: WORLDIT1;
+	float4				worldIT2	: WORLDIT2;
+	float4				worldIT3	: WORLDIT3;
+#endif
 };
 
 
@@ -51,27 +84,58 @@ struct vertexOutputPacket {
 };
 
 
+//-----------------------------------------------------------------
+// Vertex decode
+//-----------------------------------------------------------------
+
+// Unpack octahedral encoded normal
+float3 octahedralDecode(float2 e) {
+
+	float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += (n.xy >= 0.0) ? -t : t;
+	return normalize(n);
+}
+
 //-----------------------------------------------------------------
 // Vertex Shader
 //-----------------------------------------------------------------
 vertexOutputPacket main(vertexInputPacket inputVertex) {
 
-	float4x4 WVP = mul(worldMatrix, mul(viewMatrix,projMatrix));
+#if INSTANCED
+	float4x4 world = float4x4(inputVertex.world0, inputVertex.world1, inputVertex.world2, inputVertex.world3);
+	float4x4 worldIT = float4x4(inputVertex.worldIT0, inputVertex.worldIT1, inputVertex.worldIT2, inputVertex.worldIT3);
+#else
+	float4x4 world = worldMatrix;
+	float4x4 worldIT = worldITMatrix;
+#endif
+
+	float4x4 WVP = mul(world, mul(viewMatrix,projMatrix));
 	
 	vertexOutputPacket outputVertex;
 
+	// Decode quantised vertex
+	float3 pos = inputVertex.pos.xyz * posScale.xyz + posOffset.xyz;
+	float3 normal = octahedralDecode(inputVertex.normal);
+
+#if WIND_ANIMATION
+	float k = pow(pos.y / 2, 3);
+	float3 gWindDir = float3(sin(Time) * 0.05, 0, 0);
+	pos = pos + gWindDir * k;
+#endif
+
 	// Lighting is calculated in world space.
 	//Add Code Here(Transform vertex position to world coordinates)
-	outputVertex.posW = mul(float4(inputVertex.pos, 1.0f), worldMatrix);
+	outputVertex.posW = mul(float4(pos, 1.0f), world).xyz;
 	// Transform normals to world space with gWorldIT.
-	outputVertex.normalW = mul(float4(inputVertex.normal, 1.0f), worldITMatrix).xyz;
-	// Pass through material properties
-	outputVertex.matDiffuse = inputVertex.matDiffuse;
-	outputVertex.matSpecular = inputVertex.matSpecular;
+	outputVertex.normalW = mul(float4(normal, 1.0f), worldIT).xyz;
+	// Material properties are per-draw constants
+	outputVertex.matDiffuse = matDiffuse;
+	outputVertex.matSpecular = matSpecular;
 	// .. and texture coordinates.
 	outputVertex.texCoord = inputVertex.texCoord;
 	// Finally transform/project pos to screen/clip space posH
-	outputVertex.posH = mul(float4(inputVertex.pos, 1.0f), WVP);
+	outputVertex.posH = mul(float4(pos, 1.0f), WVP);
 
 	return outputVertex;
 }
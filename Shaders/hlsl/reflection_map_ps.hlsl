@@ -3,6 +3,16 @@
 // Model a simple light
 //
 
+// Permutation axes: DIFFUSE_MAP SPECULAR_MAP
+// DIFFUSE_MAP modulates the base colour by diffMap and SPECULAR_MAP the reflection by specMap.  Variants are compiled from ShaderPermutation.h.
+
+#ifndef DIFFUSE_MAP
+#define DIFFUSE_MAP 0
+#endif
+#ifndef SPECULAR_MAP
+#define SPECULAR_MAP 0
+#endif
+
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
 
@@ -80,14 +90,13 @@ FragmentOutputPacket main(FragmentInputPacket v) {
 	///////// PARAMETERS Could be added to CBUFFER //////////////////
 	float FresnelBias = 0.1;//0.3;
 	float FresnelExp = 0.5;//4;
-	bool useSpecMap = false;
-	bool useDiffMap = false;
 
 	float3 N = normalize(v.normalW);
 	float4 baseColour = v.matDiffuse;
 
-	if (useDiffMap)
-		baseColour *= diffMap.Sample(linearSampler, v.texCoord);
+#if DIFFUSE_MAP
+	baseColour *= diffMap.Sample(linearSampler, v.texCoord);
+#endif
 
 	//Initialise returned colour to ambient component
 	float3 finalColour = baseColour.xyz* lightAmbient;
@@ -103,8 +112,9 @@ FragmentOutputPacket main(FragmentInputPacket v) {
 	// Add reflection
 	float specFactor = v.matSpecular.a;
 
-	if (useSpecMap>0.0)
-		specFactor *= specMap.Sample(linearSampler, v.texCoord).r;
+#if SPECULAR_MAP
+	specFactor *= specMap.Sample(linearSampler, v.texCoord).r;
+#endif
 
 	float3 eyeDir = normalize(eyePos - v.posW);
 
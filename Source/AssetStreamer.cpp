@@ -0,0 +1,550 @@
+
+#include "stdafx.h"
+#include "AssetStreamer.h"
+#include <MeshAsset.h>
+#include <MeshCache.h>
+#include <MappedFile.h>
+#include <Texture.h>
+#include <MipGenerator.h>
+#include <wincodec.h>
+#include <algorithm>
+#include <memory>
+#include <cfloat>
+#include <cwctype>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+using namespace DirectX;
+
+
+// Priority added to objects outside the view so they load after every visible object
+static const float outsideViewPriority = 1.0e6f;
+
+// Caller waiting on a request - duplicate mesh requests share one Request with a Waiter each
+struct Waiter {
+	uint32_t								id;
+	AssetStreamer::PriorityFunction			priority;
+	AssetStreamer::MeshCallback				onMesh;
+	AssetStreamer::TextureCallback			onTexture;
+};
+
+struct AssetStreamer::Request {
+
+	bool									isMesh;
+	std::wstring							filename;
+	unsigned int							importFlags;
+	std::vector<Waiter>						waiters;
+	float									priority;
+
+	// Decoded on a worker thread
+	HRESULT									hr = E_PENDING;
+	unique_ptr<MeshAsset::DecodedMesh>		mesh;
+	unique_ptr<MappedFile>					ddsFile; // dds files are uploaded straight from the mapping
+	std::vector<ImageData>					mips; // RGBA8 mip chain for WIC formats
+	size_t									decodedBytes = 0;
+	gu_seconds								decodeTime = 0.0;
+};
+
+
+AssetStreamer::AssetStreamer(ID3D11Device *_device, MeshCache *_meshCache, size_t _uploadBudget, unsigned int numThreads) : device(_device), meshCache(_meshCache), uploadBudget(_uploadBudget) {
+
+	XMStoreFloat4x4(&viewMatrix, XMMatrixIdentity());
+	XMStoreFloat4x4(&projMatrix, XMMatrixIdentity());
+
+	createPlaceholders();
+
+	// Leave a core for the main (render) thread
+	if (numThreads == 0) {
+
+		unsigned int hardwareThreads = thread::hardware_concurrency();
+		numThreads = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < numThreads; ++i)
+		workers.push_back(thread(&AssetStreamer::workerMain, this));
+}
+
+
+AssetStreamer::~AssetStreamer() {
+
+	{
+		lock_guard<mutex> lock(queueLock);
+		stopping = true;
+	}
+
+	workAvailable.notify_all();
+
+	for (thread& worker : workers)
+		worker.join();
+
+	// Discard pending requests without calling back - their owners may already be destroyed
+	for (Request *request : waiting)
+		delete request;
+	for (Request *request : decoded)
+		delete request;
+
+	if (placeholderMesh)
+		placeholderMesh->release();
+
+	if (placeholderTexture)
+		placeholderTexture->Release();
+}
+
+
+// Unit cube (centred on the origin) and a mid grey texture
+void AssetStreamer::createPlaceholders() {
+
+	MeshAsset::DecodedMesh decoded;
+	MeshData& meshData = decoded.meshData;
+
+	static const float faceNormals[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	static const float corners[4][2] = { { -1, -1 }, { -1, 1 }, { 1, 1 }, { 1, -1 } };
+
+	for (uint32_t face = 0; face < 6; ++face) {
+
+		XMVECTOR n = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(faceNormals[face]));
+		XMVECTOR up = (face == 2 || face == 3) ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+		XMVECTOR right = XMVector3Cross(up, n);
+
+		uint32_t base = (uint32_t)meshData.vertices.size();
+
+		for (int c = 0; c < 4; ++c) {
+
+			MeshVertex v;
+			XMVECTOR pos = XMVectorScale(XMVectorAdd(n, XMVectorAdd(XMVectorScale(right, corners[c][0]), XMVectorScale(up, corners[c][1]))), 0.5f);
+
+			XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(v.pos), pos);
+			XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(v.normal), n);
+			v.texCoord[0] = 0.5f * (corners[c][0] + 1.0f);
+			v.texCoord[1] = 0.5f * (1.0f - corners[c][1]);
+			meshData.vertices.push_back(v);
+		}
+
+		// Clockwise front faces
+		uint32_t quad[] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+		meshData.indices.insert(meshData.indices.end(), quad, quad + 6);
+	}
+
+	meshData.lods.resize(1);
+	meshData.lods[0].error = 0.0f;
+	meshData.lods[0].subMeshes.push_back({ 0, (uint32_t)meshData.vertices.size(), 0, (uint32_t)meshData.indices.size() });
+
+	decoded.dequantisation = quantiseMesh(meshData, decoded.vertices, &decoded.quantisationError);
+	MeshAsset::computeBounds(decoded);
+
+	placeholderMesh = new MeshAsset(device, L"placeholder", decoded);
+
+	// 2x2 grey texture
+	const uint32_t grey[4] = { 0xff808080, 0xff808080, 0xff808080, 0xff808080 };
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D11_TEXTURE2D_DESC));
+	texDesc.Width = 2;
+	texDesc.Height = 2;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA texData = { grey, 2 * sizeof(uint32_t), 0 };
+
+	ID3D11Texture2D *texture = nullptr;
+
+	if (device && SUCCEEDED(device->CreateTexture2D(&texDesc, &texData, &texture))) {
+
+		device->CreateShaderResourceView(texture, nullptr, &placeholderTexture);
+		texture->Release();
+	}
+}
+
+
+AssetStreamer::Request *AssetStreamer::findPendingMesh(const wstring& filename, unsigned int importFlags) {
+
+	for (vector<Request*> *queue : { &waiting, &decoding, &decoded })
+		for (Request *request : *queue)
+			if (request->isMesh && request->importFlags == importFlags && 0 == _wcsicmp(request->filename.c_str(), filename.c_str()))
+				return request;
+
+	return nullptr;
+}
+
+
+uint32_t AssetStreamer::requestMesh(const wstring& filename, unsigned int importFlags, PriorityFunction priority, MeshCallback onReady) {
+
+	// Already resident - share the cached asset
+	if (meshCache) {
+
+		MeshAsset *asset = meshCache->find(filename, importFlags);
+
+		if (asset) {
+
+			onReady(asset);
+			return 0;
+		}
+	}
+
+	lock_guard<mutex> lock(queueLock);
+
+	uint32_t id = nextId++;
+
+	Request *request = findPendingMesh(filename, importFlags);
+
+	if (request) {
+
+		request->waiters.push_back({ id, priority, onReady, nullptr });
+		return id;
+	}
+
+	request = new Request();
+	request->isMesh = true;
+	request->filename = filename;
+	request->importFlags = importFlags;
+	request->waiters.push_back({ id, priority, onReady, nullptr });
+	request->priority = evaluatePriority(request);
+
+	waiting.push_back(request);
+	workAvailable.notify_one();
+
+	return id;
+}
+
+
+uint32_t AssetStreamer::requestTexture(const wstring& filename, PriorityFunction priority, TextureCallback onReady) {
+
+	lock_guard<mutex> lock(queueLock);
+
+	uint32_t id = nextId++;
+
+	Request *request = new Request();
+	request->isMesh = false;
+	request->filename = filename;
+	request->importFlags = 0;
+	request->waiters.push_back({ id, priority, nullptr, onReady });
+	request->priority = evaluatePriority(request);
+
+	waiting.push_back(request);
+	workAvailable.notify_one();
+
+	return id;
+}
+
+
+void AssetStreamer::cancel(uint32_t requestId) {
+
+	if (requestId == 0)
+		return;
+
+	lock_guard<mutex> lock(queueLock);
+
+	for (vector<Request*> *queue : { &waiting, &decoding, &decoded })
+		for (Request *request : *queue) {
+
+			auto it = find_if(request->waiters.begin(), request->waiters.end(), [=](const Waiter& w) { return w.id == requestId; });
+
+			if (it == request->waiters.end())
+				continue;
+
+			request->waiters.erase(it);
+
+			// Requests that have not started decoding are dropped when nobody is waiting on them
+			if (request->waiters.empty() && queue == &waiting) {
+
+				waiting.erase(find(waiting.begin(), waiting.end(), request));
+				delete request;
+			}
+
+			return;
+		}
+}
+
+
+void AssetStreamer::setView(FXMMATRIX view, CXMMATRIX proj) {
+
+	XMStoreFloat4x4(&viewMatrix, view);
+	XMStoreFloat4x4(&projMatrix, proj);
+}
+
+
+float AssetStreamer::viewPriority(FXMMATRIX worldMatrix) {
+
+	// Object origin in view space
+	XMVECTOR pos = XMVector3Transform(XMVectorSetW(worldMatrix.r[3], 1.0f), XMLoadFloat4x4(&viewMatrix));
+	float distance = XMVectorGetX(XMVector3Length(pos));
+
+	// The frustum is widened by 50% so objects whose origin is just off screen are treated as visible
+	XMVECTOR clip = XMVector4Transform(XMVectorSetW(pos, 1.0f), XMLoadFloat4x4(&projMatrix));
+	float w = XMVectorGetW(clip) * 1.5f;
+	bool visible = w > 0.0f && fabsf(XMVectorGetX(clip)) <= w && fabsf(XMVectorGetY(clip)) <= w;
+
+	return visible ? distance : distance + outsideViewPriority;
+}
+
+
+// Smallest priority of every caller waiting on the request
+float AssetStreamer::evaluatePriority(Request *request) {
+
+	float priority = FLT_MAX;
+
+	for (const Waiter& waiter : request->waiters) {
+
+		float waiterPriority = waiter.priority ? waiter.priority() : 0.0f;
+		priority = min(priority, waiterPriority);
+	}
+
+	return priority;
+}
+
+
+void AssetStreamer::workerMain() {
+
+	// WIC is used from the worker threads so each has its own factory in the multithreaded apartment
+	HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	IWICImagingFactory *wicFactory = nullptr;
+	CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&wicFactory));
+
+	unique_lock<mutex> lock(queueLock);
+
+	while (true) {
+
+		workAvailable.wait(lock, [this]() { return stopping || !waiting.empty(); });
+
+		if (stopping)
+			break;
+
+		// Highest priority (smallest value) first - priorities are refreshed by update()
+		auto next = min_element(waiting.begin(), waiting.end(), [](Request *a, Request *b) { return a->priority < b->priority; });
+		Request *request = *next;
+		waiting.erase(next);
+		decoding.push_back(request);
+
+		lock.unlock();
+		decode(request, wicFactory);
+		lock.lock();
+
+		decoding.erase(find(decoding.begin(), decoding.end(), request));
+		decoded.push_back(request);
+		bytesInFlight += request->decodedBytes;
+	}
+
+	lock.unlock();
+
+	if (wicFactory)
+		wicFactory->Release();
+
+	if (SUCCEEDED(comResult))
+		CoUninitialize();
+}
+
+
+// Worker thread - CPU side loading only, no Direct3D calls
+void AssetStreamer::decode(Request *request, void *wicFactory) {
+
+	gu_time_index startTime = CGDClock::ActualTime();
+
+	if (request->isMesh) {
+
+		request->mesh.reset(new MeshAsset::DecodedMesh());
+		request->hr = MeshAsset::decode(request->filename, request->importFlags, *request->mesh);
+		request->decodedBytes = SUCCEEDED(request->hr) ? request->mesh->getUploadBytes() : 0;
+	}
+	else {
+
+		wstring ext = (request->filename.length() >= 4) ? request->filename.substr(request->filename.length() - 4) : wstring();
+
+		for (wchar_t& c : ext)
+			c = towlower(c);
+
+		if (0 == ext.compare(L".dds")) {
+
+			// DDS data is already in its GPU layout so it is mapped rather than read
+			request->ddsFile.reset(new MappedFile(string(request->filename.begin(), request->filename.end())));
+			request->hr = request->ddsFile->isValid() ? S_OK : E_FAIL;
+			request->decodedBytes = request->ddsFile->getSize();
+		}
+		else if (0 == ext.compare(L".bmp") || 0 == ext.compare(L".jpg") || 0 == ext.compare(L".png") || 0 == ext.compare(L".tif")) {
+
+			ImageData image;
+			request->hr = Texture::decodeWICImage(static_cast<IWICImagingFactory*>(wicFactory), request->filename, image);
+
+			// Mips are generated on this worker thread (other workers decode other requests in parallel)
+			if (SUCCEEDED(request->hr))
+				request->mips = generateMipChain(image, getDefaultMipOptions(string(request->filename.begin(), request->filename.end())));
+
+			for (const ImageData& mip : request->mips)
+				request->decodedBytes += mip.getSizeBytes();
+		}
+		else
+			request->hr = E_INVALIDARG;
+	}
+
+	request->decodeTime = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - startTime);
+}
+
+
+void AssetStreamer::update() {
+
+	gu_time_index startTime = CGDClock::ActualTime();
+
+	vector<Request*> commitList;
+	size_t commitBytes = 0;
+
+	{
+		lock_guard<mutex> lock(queueLock);
+
+		for (Request *request : waiting)
+			request->priority = evaluatePriority(request);
+
+		for (Request *request : decoded)
+			request->priority = evaluatePriority(request);
+
+		// Lowest priority at the front so the highest priority requests are taken from the back
+		sort(decoded.begin(), decoded.end(), [](Request *a, Request *b) { return a->priority > b->priority; });
+
+		while (!decoded.empty() && (commitList.empty() || commitBytes + decoded.back()->decodedBytes <= uploadBudget)) {
+
+			Request *request = decoded.back();
+			decoded.pop_back();
+
+			commitBytes += request->decodedBytes;
+			bytesInFlight -= request->decodedBytes;
+			commitList.push_back(request);
+		}
+	}
+
+	// Create GPU resources and call back outside the lock so workers are not blocked
+	for (Request *request : commitList) {
+
+		commit(request);
+		delete request;
+	}
+
+	stats.committedLastFrame = (uint32_t)commitList.size();
+	stats.bytesCommittedLastFrame = commitBytes;
+	stats.commitMsLastFrame = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - startTime) * 1000.0;
+	stats.maxCommitMs = max(stats.maxCommitMs, stats.commitMsLastFrame);
+}
+
+
+// Main thread - upload a decoded request and call its waiters
+void AssetStreamer::commit(Request *request) {
+
+	gu_time_index startTime = CGDClock::ActualTime();
+
+	if (request->isMesh) {
+
+		MeshAsset *asset = nullptr;
+
+		if (SUCCEEDED(request->hr)) {
+
+			asset = new MeshAsset(device, request->filename, *request->mesh);
+
+			if (!asset->isValid()) {
+
+				asset->release();
+				asset = nullptr;
+			}
+		}
+
+		if (asset && meshCache)
+			meshCache->insert(request->filename, request->importFlags, asset, request->decodeTime + CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - startTime));
+
+		// Each waiter adopts its own reference, then the creator's reference is released
+		for (Waiter& waiter : request->waiters) {
+
+			if (asset)
+				asset->retain();
+
+			waiter.onMesh(asset);
+		}
+
+		if (asset) {
+
+			asset->release();
+			stats.totalCommitted++;
+		}
+		else {
+
+			wcout << L"AssetStreamer: cannot load model " << request->filename << endl;
+			stats.totalFailed++;
+		}
+	}
+	else {
+
+		ID3D11Texture2D *texture = nullptr;
+		ID3D11ShaderResourceView *SRV = nullptr;
+		HRESULT hr = request->hr;
+
+		if (SUCCEEDED(hr) && request->ddsFile) {
+
+			hr = Texture::createDDSTexture(device, request->ddsFile->getData(), request->ddsFile->getSize(), &texture, &SRV);
+
+			// The driver has its own copy once the texture is created
+			request->ddsFile.reset();
+		}
+		else if (SUCCEEDED(hr)) {
+
+			hr = Texture::createTexture(device, request->mips, &texture, &SRV);
+		}
+
+		Texture *result = nullptr;
+
+		if (SUCCEEDED(hr)) {
+
+			result = new Texture(texture, SRV);
+			stats.totalCommitted++;
+		}
+		else {
+
+			if (texture)
+				texture->Release();
+			if (SRV)
+				SRV->Release();
+
+			wcout << L"AssetStreamer: cannot load texture " << request->filename << endl;
+			stats.totalFailed++;
+		}
+
+		if (!request->waiters.empty())
+			request->waiters[0].onTexture(result);
+		else if (result)
+			delete result;
+	}
+}
+
+
+bool AssetStreamer::isIdle() {
+
+	lock_guard<mutex> lock(queueLock);
+
+	return waiting.empty() && decoding.empty() && decoded.empty();
+}
+
+
+StreamingStats AssetStreamer::getStats() {
+
+	lock_guard<mutex> lock(queueLock);
+
+	StreamingStats result = stats;
+
+	result.queueDepth = (uint32_t)waiting.size();
+	result.decoding = (uint32_t)decoding.size();
+	result.readyToCommit = (uint32_t)decoded.size();
+	result.bytesInFlight = bytesInFlight;
+
+	return result;
+}
+
+
+void AssetStreamer::reportStats() {
+
+	StreamingStats s = getStats();
+
+	cout << "AssetStreamer: " << workers.size() << " worker threads, " << s.totalCommitted << " assets committed, " << s.totalFailed << " failed" << endl;
+	cout << "AssetStreamer: queue depth = " << s.queueDepth << ", decoding = " << s.decoding << ", ready = " << s.readyToCommit << ", bytes in flight = " << s.bytesInFlight / 1024 << " KB" << endl;
+	cout << "AssetStreamer: last frame committed " << s.committedLastFrame << " assets (" << s.bytesCommittedLastFrame / 1024 << " KB) in " << fixed << setprecision(3) << s.commitMsLastFrame << "ms, max commit time = " << s.maxCommitMs << "ms per frame" << endl;
+	cout.unsetf(ios::floatfield);
+}
@@ -0,0 +1,129 @@
+
+//
+// AssetStreamer.h
+//
+
+// Asynchronous, prioritised loading of model geometry and textures.  Requests are decoded on background threads - model import, LOD generation and quantisation for meshes (see MeshAsset::decode), WIC decode to RGBA8 with a generated mip chain or a memory mapped file for textures - and committed to the GPU on the main thread by update() within a per-frame upload budget so large assets do not stall a frame.  Until its asset is committed a Model renders the placeholder mesh and texture.
+// Each request has a priority function that is re-evaluated by update() while the request is waiting - smaller values are decoded and committed first.  viewPriority() ranks objects by distance from the camera with everything outside the view loaded after every visible object.
+// Completion callbacks are always called on the main thread from update() (or from requestMesh if the geometry is already in the MeshCache).  Objects that are destroyed while their request is pending must cancel() it.
+
+#pragma once
+#include <d3d11_2.h>
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <CGDClock.h>
+
+class MeshAsset;
+class MeshCache;
+class Texture;
+
+
+// Streaming statistics - queue state is sampled when getStats() is called, commit figures are for the last update()
+struct StreamingStats {
+	uint32_t							queueDepth; // Requests waiting to be decoded
+	uint32_t							decoding; // Requests being decoded by a worker thread
+	uint32_t							readyToCommit; // Decoded requests waiting for upload budget
+	size_t								bytesInFlight; // Decoded data held in CPU memory until it is committed
+	uint32_t							committedLastFrame;
+	size_t								bytesCommittedLastFrame;
+	double								commitMsLastFrame; // Main thread time spent creating GPU resources in the last update()
+	double								maxCommitMs; // Longest update() so far
+	uint32_t							totalCommitted;
+	uint32_t							totalFailed;
+};
+
+
+class AssetStreamer {
+
+public:
+
+	typedef std::function<float()>				PriorityFunction;
+
+	// The callee adopts one reference to the asset (see MeshAsset::release) - nullptr if the model could not be loaded
+	typedef std::function<void(MeshAsset*)>		MeshCallback;
+
+	// The callee owns the Texture - nullptr if the texture could not be loaded
+	typedef std::function<void(Texture*)>		TextureCallback;
+
+	// Default per-frame upload budget - at least one decoded asset is committed per update() regardless of size
+	static const size_t					defaultUploadBudget = 8 * 1024 * 1024;
+
+private:
+
+	struct Request;
+
+	ID3D11Device						*device = nullptr;
+	MeshCache							*meshCache = nullptr;
+	size_t								uploadBudget;
+
+	// Placeholders rendered until a request is committed
+	MeshAsset							*placeholderMesh = nullptr;
+	ID3D11ShaderResourceView			*placeholderTexture = nullptr;
+
+	// Camera used by viewPriority()
+	DirectX::XMFLOAT4X4					viewMatrix;
+	DirectX::XMFLOAT4X4					projMatrix;
+
+	// Request queues - guarded by queueLock
+	std::mutex							queueLock;
+	std::condition_variable				workAvailable;
+	std::vector<Request*>				waiting;
+	std::vector<Request*>				decoding;
+	std::vector<Request*>				decoded;
+	size_t								bytesInFlight = 0;
+	uint32_t							nextId = 1;
+	bool								stopping = false;
+
+	std::vector<std::thread>			workers;
+
+	StreamingStats						stats = {};
+
+	void workerMain();
+	void decode(Request *request, void *wicFactory);
+	void commit(Request *request);
+	void createPlaceholders();
+	static float evaluatePriority(Request *request);
+	Request *findPendingMesh(const std::wstring& filename, unsigned int importFlags);
+
+public:
+
+	// numThreads = 0 uses one less than the number of hardware threads (at least one).  If a MeshCache is given streamed geometry is shared with (and added to) the cache.
+	AssetStreamer(ID3D11Device *device, MeshCache *meshCache = nullptr, size_t uploadBudget = defaultUploadBudget, unsigned int numThreads = 0);
+
+	// Stops the worker threads.  Pending requests are discarded without calling their callbacks.
+	~AssetStreamer();
+
+	// Queue the model file for streaming.  Requests for a file that is already pending are merged.  Returns a request id for cancel() or 0 if onReady was called immediately because the geometry is already resident.
+	uint32_t requestMesh(const std::wstring& filename, unsigned int importFlags, PriorityFunction priority, MeshCallback onReady);
+
+	// Queue a bmp, jpg, png, tif or dds texture for streaming.  Returns a request id for cancel().
+	uint32_t requestTexture(const std::wstring& filename, PriorityFunction priority, TextureCallback onReady);
+
+	// Remove the callback and priority function of a pending request.  Decoded geometry is still added to the MeshCache.
+	void cancel(uint32_t requestId);
+
+	// Camera used by viewPriority() - call each frame before update()
+	void setView(DirectX::FXMMATRIX view, DirectX::CXMMATRIX proj);
+
+	// Priority of an object with the given world matrix - distance from the camera, or distance plus a large constant if the object origin is outside the (widened) view frustum
+	float viewPriority(DirectX::FXMMATRIX worldMatrix);
+
+	// Re-evaluate priorities and commit decoded assets (highest priority first) until the upload budget for this frame is used.  Call once per frame on the main thread.
+	void update();
+
+	// Return true if there are no pending requests
+	bool isIdle();
+
+	StreamingStats getStats();
+	void reportStats();
+
+	MeshAsset *getPlaceholderMesh() { return placeholderMesh; };
+	ID3D11ShaderResourceView *getPlaceholderTexture() { return placeholderTexture; };
+	void setUploadBudget(size_t budget) { uploadBudget = budget; };
+};
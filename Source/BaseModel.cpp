@@ -1,6 +1,7 @@
 
 #include "stdafx.h"
 #include <BaseModel.h>
+#include <StateCache.h>
 
 BaseModel::BaseModel(ID3D11Device *device, Effect *_effect, Material *_materials[], int _numMaterials, ID3D11ShaderResourceView **_textures, int _numTextures) {
 
@@ -26,6 +27,10 @@ void BaseModel::initCBuffer(ID3D11Device *device){
 	// Fill out cBufferModelCPU
 	cBufferModelCPU->worldMatrix = XMMatrixIdentity();
 	cBufferModelCPU->worldITMatrix = XMMatrixIdentity();
+	cBufferModelCPU->posScale = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.0f);
+	cBufferModelCPU->posOffset = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	cBufferModelCPU->texRect = XMFLOAT4(1.0f, 1.0f, 0.0f, 0.0f);
+	updateMaterialCBuffer();
 
 	// Create GPU resource memory copy of cBufferBasic
 	// fill out description (Note if we want to update the CBuffer we need  D3D11_CPU_ACCESS_WRITE)
@@ -48,9 +53,52 @@ void BaseModel::setWorldMatrix(XMMATRIX _worldMatrix){
 	cBufferModelCPU->worldMatrix = _worldMatrix;
 	XMVECTOR det=XMMatrixDeterminant(_worldMatrix);
 	cBufferModelCPU->worldITMatrix = XMMatrixInverse(&det, XMMatrixTranspose(_worldMatrix));
+	worldBoundsDirty = true;
+	boundsVersion++;
 }
 
-void BaseModel::update(ID3D11DeviceContext *context) {
+void BaseModel::setTextureRect(const float scaleOffset[4]) {
+	cBufferModelCPU->texRect = XMFLOAT4(scaleOffset[0], scaleOffset[1], scaleOffset[2], scaleOffset[3]);
+}
+
+void BaseModel::setLocalBounds(const Bounds& bounds) {
+	localBounds = bounds;
+	worldBoundsDirty = true;
+	boundsVersion++;
+}
+
+const Bounds& BaseModel::getWorldBounds() {
+
+	if (worldBoundsDirty) {
+
+		XMFLOAT4X4 worldMatrix;
+		XMStoreFloat4x4(&worldMatrix, cBufferModelCPU->worldMatrix);
+		worldBounds = transformBounds(localBounds, &worldMatrix.m[0][0]);
+		worldBoundsDirty = false;
+	}
+
+	return worldBounds;
+}
+
+void BaseModel::setDequantisation(const QuantisationParams& params) {
+	cBufferModelCPU->posScale = XMFLOAT4(params.posScale[0], params.posScale[1], params.posScale[2], 0.0f);
+	cBufferModelCPU->posOffset = XMFLOAT4(params.posOffset[0], params.posOffset[1], params.posOffset[2], 0.0f);
+}
+
+// Material colours are per-draw constants - quantised vertices do not store them
+void BaseModel::updateMaterialCBuffer() {
+
+	if (!cBufferModelCPU)
+		return;
+
+	Material defaultMaterial;
+	Material *material = (numMaterials != 0) ? materials[0] : &defaultMaterial;
+
+	XMStoreFloat4(&cBufferModelCPU->matDiffuse, XMLoadColor(&material->getColour()->diffuse));
+	XMStoreFloat4(&cBufferModelCPU->matSpecular, XMLoadColor(&material->getColour()->specular));
+}
+
+void BaseModel::update(StateTrackingContext *context) {
 	mapCbuffer(context, cBufferModelCPU, cBufferModelGPU, sizeof(CBufferModel));
 	context->PSSetConstantBuffers(0, 1, &cBufferModelGPU);
 	context->VSSetConstantBuffers(0, 1, &cBufferModelGPU);
@@ -67,11 +115,17 @@ void BaseModel::createDefaultLinearSampler(ID3D11Device *device){
 	linearDesc.AddressV = D3D11_TEXTURE_ADDRESS_MIRROR;
 	linearDesc.AddressW = D3D11_TEXTURE_ADDRESS_MIRROR;
 	linearDesc.MinLOD = 0.0f;
-	linearDesc.MaxLOD = 0.0f;
+	linearDesc.MaxLOD = D3D11_FLOAT32_MAX; // Use the full mip chain
 	linearDesc.MipLODBias = 0.0f;
 	linearDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 
-	device->CreateSamplerState(&linearDesc, &sampler);
+	// Models share the sampler through the state cache of their effect
+	StateCache *stateCache = effect ? effect->getStateCache() : nullptr;
+
+	if (stateCache)
+		sampler = stateCache->getSamplerState(linearDesc);
+	else
+		device->CreateSamplerState(&linearDesc, &sampler);
 }
 
 void BaseModel::setTextures(ID3D11ShaderResourceView *_textures[], int _numTextures){
@@ -94,6 +148,7 @@ void BaseModel::setMaterials(Material *_materials[], int _numMaterials) {
 	materials[0] = _materials[0];
 	for (int i = 0; i < numMaterials; i++)
 		materials[i] = _materials[i];
+	updateMaterialCBuffer();
 };
 
 
@@ -106,6 +161,9 @@ BaseModel::~BaseModel() {
 	if (cBufferModelGPU)
 		cBufferModelGPU->Release();
 
+	if (sampler)
+		sampler->Release();
+
 	
 
 }
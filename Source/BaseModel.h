@@ -5,6 +5,8 @@
 #include <Effect.h>
 #include <Material.h>
 #include <Texture.h>
+#include <MeshQuantiser.h>
+#include <Bounds.h>
 
 #define MAX_TEXTURES 8
 #define MAX_MATERIALS 8
@@ -27,6 +29,15 @@ protected:
 	CBufferModel* cBufferModelCPU = nullptr;
 	ID3D11Buffer *cBufferModelGPU = nullptr;
 
+	// Model space bounds set when the geometry is created or loaded and the world space bounds derived from them.  World bounds are only recalculated by getWorldBounds() after the world matrix or local bounds change.
+	Bounds						localBounds = emptyBounds();
+	Bounds						worldBounds = emptyBounds();
+	bool						worldBoundsDirty = false;
+	uint32_t					boundsVersion = 0; // Incremented whenever the world bounds may change
+
+	// Copy materials[0] colours to the model cbuffer
+	void updateMaterialCBuffer();
+
 public:
 
 	BaseModel(ID3D11Device *device, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView *_textures[] = nullptr, int _numTextures = 0);
@@ -34,19 +45,32 @@ public:
 	
 	~BaseModel();
 
-	virtual void render(ID3D11DeviceContext *context) = 0;
+	virtual void render(StateTrackingContext *context) = 0;
 	virtual HRESULT init(ID3D11Device *device) = 0;
-	void update(ID3D11DeviceContext *context);
+	void update(StateTrackingContext *context);
 
 	void setTextures(ID3D11ShaderResourceView *_texures[], int _numTextures = 1);
 	void setMaterials(Material *_materials[], int _numMaterials = 1); 
 	ID3D11ShaderResourceView* getTexture(int textureIndex=0){ return textures[textureIndex];};
+	ID3D11ShaderResourceView *const *getTextures() { return textures; };
+	int getNumTextures() { return numTextures; };
 	Material * getMaterial(int materialIndex = 0) {return materials[materialIndex];};
 	void setEffect(Effect *_effect){ effect = _effect;};// effect must have the same input layout as the model
 	int getEffect(Effect *_effect){ _effect = effect;};
+	Effect *getEffect() { return effect; };
 	void initCBuffer(ID3D11Device *device);
 	void createDefaultLinearSampler(ID3D11Device *device);
 	void setWorldMatrix(XMMATRIX _worldMatrix);
+	void setDequantisation(const QuantisationParams& params);
+	// Sample the model's texture from a rectangle of an atlas (see AtlasEntry::scaleOffset).  Used by shaders that declare texRect in modelCBuffer.
+	void setTextureRect(const float scaleOffset[4]);
 	XMMATRIX getWorldMatrix(){ return cBufferModelCPU->worldMatrix; };
 
+	// Bounds of the geometry (including any displacement applied by the vertex shader) - empty until the geometry is created
+	void setLocalBounds(const Bounds& bounds);
+	const Bounds& getLocalBounds() { return localBounds; };
+	const Bounds& getWorldBounds();
+	// Compare with an earlier version to find models that may have moved (see Scene::cullScene)
+	uint32_t getBoundsVersion() const { return boundsVersion; };
+
 };
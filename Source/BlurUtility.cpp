@@ -4,42 +4,28 @@
 #include <Quad.h>
 #include <Effect.h>
 #include <VertexStructures.h>
+#include <ShaderLibrary.h>
+#include <StateCache.h>
 
-BlurUtility::BlurUtility(ID3D11Device *deviceIn, ID3D11DeviceContext *contextIn, int _blurWidth, int _blurHeight)
+BlurUtility::BlurUtility(ID3D11Device *deviceIn, StateTrackingContext *contextIn, ShaderLibrary *shaderLibrary, StateCache *stateCache, int _blurWidth, int _blurHeight)
 {
 	device = deviceIn;
 	context = contextIn;
 	
 	initCBuffer(device, _blurWidth, _blurHeight);
 	setupBlurRenderTargets(deviceIn, _blurWidth,  _blurHeight);
-	char *tmpShaderBytecode = nullptr;
-
-	ID3D11InputLayout	*screenQuadVSInputLayout = nullptr;
-	SIZE_T shaderBytes = LoadShader("Shaders\\cso\\screen_quad_vs.cso", &tmpShaderBytecode);
-	device->CreateVertexShader(tmpShaderBytecode, shaderBytes, NULL, &screenQuadVS);
-	device->CreateInputLayout(basicVertexDesc, ARRAYSIZE(basicVertexDesc), tmpShaderBytecode, shaderBytes, &screenQuadVSInputLayout);
-	free(tmpShaderBytecode);
-	screenQuad = new Quad(device, screenQuadVSInputLayout);
-	shaderBytes=LoadShader("Shaders\\cso\\per_pixel_lighting_vs.cso", &tmpShaderBytecode);
-	device->CreateVertexShader(tmpShaderBytecode, shaderBytes, NULL, &perPixelLightingVS);
-	free(tmpShaderBytecode);
-	shaderBytes = LoadShader("Shaders\\cso\\convolve_u_ps.cso", &tmpShaderBytecode);
-	device->CreatePixelShader(tmpShaderBytecode, shaderBytes, NULL, &horizontalBlurPS);
-	free(tmpShaderBytecode);
-	shaderBytes = LoadShader("Shaders\\cso\\convolve_v_ps.cso", &tmpShaderBytecode);
-	device->CreatePixelShader(tmpShaderBytecode, shaderBytes, NULL, &verticalBlurPS);
-	free(tmpShaderBytecode);
-	shaderBytes = LoadShader("Shaders\\cso\\emissive_ps.cso", &tmpShaderBytecode);
-	device->CreatePixelShader(tmpShaderBytecode, shaderBytes, NULL, &emissivePS);
-	free(tmpShaderBytecode);
-	shaderBytes = LoadShader("Shaders\\cso\\copy_ps.cso", &tmpShaderBytecode);
-	device->CreatePixelShader(tmpShaderBytecode, shaderBytes, NULL, &textureCopyPS);
-	free(tmpShaderBytecode);
-	shaderBytes = LoadShader("Shaders\\cso\\copy_depth_ps.cso", &tmpShaderBytecode);
-	device->CreatePixelShader(tmpShaderBytecode, shaderBytes, NULL, &depthCopyPS);
-	free(tmpShaderBytecode);
+
+	// Shaders shared with the scene effects (per_pixel_lighting_vs and basic_colour_vs / ps)
+	screenQuadVS = shaderLibrary->getVertexShader("Shaders\\cso\\screen_quad_vs.cso");
+	screenQuad = new Quad(device, shaderLibrary->getInputLayout("Shaders\\cso\\screen_quad_vs.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc)));
+	perPixelLightingVS = shaderLibrary->getVertexShader(ShaderLibrary::getVariantFilename(modelVertexShader, VertexShaderType));
+	horizontalBlurPS = shaderLibrary->getPixelShader("Shaders\\cso\\convolve_u_ps.cso");
+	verticalBlurPS = shaderLibrary->getPixelShader("Shaders\\cso\\convolve_v_ps.cso");
+	emissivePS = shaderLibrary->getPixelShader("Shaders\\cso\\emissive_ps.cso");
+	textureCopyPS = shaderLibrary->getPixelShader("Shaders\\cso\\copy_ps.cso");
+	depthCopyPS = shaderLibrary->getPixelShader("Shaders\\cso\\copy_depth_ps.cso");
 	
-	defaultEffect = new Effect(device, "Shaders\\cso\\basic_colour_vs.cso", "Shaders\\cso\\basic_colour_ps.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc));
+	defaultEffect = new Effect(device, "Shaders\\cso\\basic_colour_vs.cso", "Shaders\\cso\\basic_colour_ps.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc), shaderLibrary, stateCache);
 	
 	D3D11_BLEND_DESC blendDesc;
 	defaultEffect->getBlendState()->GetDesc(&blendDesc);//the effect is initialised with the default blend state
@@ -48,7 +34,7 @@ BlurUtility::BlurUtility(ID3D11Device *deviceIn, ID3D11DeviceContext *contextIn,
 	blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
 	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
 	blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-	device->CreateBlendState(&blendDesc, &alphaOnBlendState);
+	alphaOnBlendState = stateCache->getBlendState(blendDesc);
 
 
 	// If textures are used a sampler is required for the pixel shader to sample the texture
@@ -65,7 +51,7 @@ BlurUtility::BlurUtility(ID3D11Device *deviceIn, ID3D11DeviceContext *contextIn,
 	linearDesc.MipLODBias = 0.0f;
 	linearDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 
-	device->CreateSamplerState(&linearDesc, &sampler);
+	sampler = stateCache->getSamplerState(linearDesc);
 
 }
 void BlurUtility::initCBuffer(ID3D11Device *device, int _blurWidth, int _blurHeight) {
@@ -94,7 +80,7 @@ void BlurUtility::initCBuffer(ID3D11Device *device, int _blurWidth, int _blurHei
 		&cBufferTextSizeGPU);
 }
 
-void BlurUtility::updateTextSize(ID3D11DeviceContext *context) {
+void BlurUtility::updateTextSize(StateTrackingContext *context) {
 	mapCbuffer(context, cBufferTextSizeCPU, cBufferTextSizeGPU, sizeof(CBufferTextSize));
 	context->PSSetConstantBuffers(0, 1, &cBufferTextSizeGPU);
 	context->VSSetConstantBuffers(0, 1, &cBufferTextSizeGPU);
@@ -338,6 +324,8 @@ BlurUtility::~BlurUtility()
 		depthStencilViewBlur->Release();
 	if (alphaOnBlendState)
 		alphaOnBlendState->Release();
+	if (sampler)
+		sampler->Release();
 	if (screenQuadVS)
 		screenQuadVS->Release();
 	if (emissivePS)
@@ -5,6 +5,8 @@
 class Model;
 class Quad;
 class Effect;
+class ShaderLibrary;
+class StateCache;
 class BlurUtility
 {
 	D3D11_VIEWPORT							offScreenViewport;
@@ -15,7 +17,7 @@ class BlurUtility
 	ID3D11ShaderResourceView				*intermedSRV = nullptr;
 	ID3D11RenderTargetView					*intermedRTV = nullptr;
 	ID3D11DepthStencilView					*depthStencilViewBlur = nullptr;
-	ID3D11DeviceContext						*context = nullptr;
+	StateTrackingContext					*context = nullptr;
 	ID3D11Device							*device = nullptr;
 	Quad									*screenQuad = nullptr;
 
@@ -33,9 +35,9 @@ class BlurUtility
 	ID3D11Buffer *cBufferTextSizeGPU = nullptr;
 	ID3D11SamplerState			*sampler = nullptr;
 	void initCBuffer(ID3D11Device *device, int _blurWidth, int _blurHeight);
-	void updateTextSize(ID3D11DeviceContext *context);
+	void updateTextSize(StateTrackingContext *context);
 public:
-	BlurUtility(ID3D11Device *deviceIn, ID3D11DeviceContext *contextIn, int blurWidth = 512, int blurHeight = 512);
+	BlurUtility(ID3D11Device *deviceIn, StateTrackingContext *contextIn, ShaderLibrary *shaderLibrary, StateCache *stateCache, int blurWidth = 512, int blurHeight = 512);
 	HRESULT setupBlurRenderTargets(ID3D11Device *deviceIn, int _blurWidth, int _blurHeight);
 	void blurModel(Model*orb, ID3D11ShaderResourceView	*depthSRV);
 	~BlurUtility();
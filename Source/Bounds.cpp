@@ -0,0 +1,389 @@
+
+#include "Bounds.h"
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BOUNDS_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+
+Bounds emptyBounds() {
+
+	Bounds bounds;
+
+	for (int i = 0; i < 3; ++i) {
+
+		bounds.boxCentre[i] = 0.0f;
+		bounds.boxExtents[i] = -1.0f;
+		bounds.sphereCentre[i] = 0.0f;
+	}
+
+	bounds.sphereRadius = -1.0f;
+
+	return bounds;
+}
+
+
+// Box from min / max corners with the sphere centred on the box (the radius is set by the caller)
+static Bounds boundsFromMinMax(const float minPos[3], const float maxPos[3]) {
+
+	Bounds bounds;
+
+	for (int i = 0; i < 3; ++i) {
+
+		bounds.boxCentre[i] = 0.5f * (minPos[i] + maxPos[i]);
+		bounds.boxExtents[i] = 0.5f * (maxPos[i] - minPos[i]);
+		bounds.sphereCentre[i] = bounds.boxCentre[i];
+	}
+
+	bounds.sphereRadius = 0.0f;
+
+	return bounds;
+}
+
+
+Bounds computeBoundsScalar(const float *positions, size_t count, size_t stride) {
+
+	if (count == 0)
+		return emptyBounds();
+
+	const uint8_t *p = reinterpret_cast<const uint8_t*>(positions);
+
+	float minPos[3] = { positions[0], positions[1], positions[2] };
+	float maxPos[3] = { positions[0], positions[1], positions[2] };
+
+	for (size_t i = 1; i < count; ++i) {
+
+		const float *pos = reinterpret_cast<const float*>(p + i * stride);
+
+		for (int j = 0; j < 3; ++j) {
+
+			minPos[j] = min(minPos[j], pos[j]);
+			maxPos[j] = max(maxPos[j], pos[j]);
+		}
+	}
+
+	Bounds bounds = boundsFromMinMax(minPos, maxPos);
+
+	float maxDistSq = 0.0f;
+
+	for (size_t i = 0; i < count; ++i) {
+
+		const float *pos = reinterpret_cast<const float*>(p + i * stride);
+
+		float dx = pos[0] - bounds.sphereCentre[0];
+		float dy = pos[1] - bounds.sphereCentre[1];
+		float dz = pos[2] - bounds.sphereCentre[2];
+
+		maxDistSq = max(maxDistSq, (dx * dx + dy * dy) + dz * dz);
+	}
+
+	bounds.sphereRadius = sqrtf(maxDistSq);
+
+	return bounds;
+}
+
+
+static Bounds transformBoundsScalar(const Bounds& local, const float m[16]) {
+
+	if (local.isEmpty())
+		return local;
+
+	Bounds world;
+
+	for (int i = 0; i < 3; ++i) {
+
+		world.boxCentre[i] = local.boxCentre[0] * m[i] + local.boxCentre[1] * m[4 + i] + local.boxCentre[2] * m[8 + i] + m[12 + i];
+		world.boxExtents[i] = local.boxExtents[0] * fabsf(m[i]) + local.boxExtents[1] * fabsf(m[4 + i]) + local.boxExtents[2] * fabsf(m[8 + i]);
+		world.sphereCentre[i] = local.sphereCentre[0] * m[i] + local.sphereCentre[1] * m[4 + i] + local.sphereCentre[2] * m[8 + i] + m[12 + i];
+	}
+
+	float scaleSq = 0.0f;
+
+	for (int row = 0; row < 3; ++row)
+		scaleSq = max(scaleSq, m[row * 4] * m[row * 4] + m[row * 4 + 1] * m[row * 4 + 1] + m[row * 4 + 2] * m[row * 4 + 2]);
+
+	world.sphereRadius = local.sphereRadius * sqrtf(scaleSq);
+
+	return world;
+}
+
+
+#ifdef BOUNDS_SSE
+
+// Load x, y, z (w is undefined).  The 4th float is only read when it is known to be inside the vertex.
+static inline __m128 load3(const float *p, bool readW) {
+
+	return readW ? _mm_loadu_ps(p) : _mm_setr_ps(p[0], p[1], p[2], 0.0f);
+}
+
+static inline void store3(float *p, __m128 v) {
+
+	float result[4];
+	_mm_storeu_ps(result, v);
+	memcpy(p, result, 3 * sizeof(float));
+}
+
+static inline __m128 splat(__m128 v, int i) {
+
+	switch (i) {
+	case 0: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0));
+	case 1: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+	default: return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2));
+	}
+}
+
+// (x * x + y * y) + z * z in every lane
+static inline __m128 dot3(__m128 v) {
+
+	__m128 sq = _mm_mul_ps(v, v);
+	return _mm_add_ps(_mm_add_ps(splat(sq, 0), splat(sq, 1)), splat(sq, 2));
+}
+
+
+static Bounds computeBoundsSSE(const float *positions, size_t count, size_t stride) {
+
+	if (count == 0)
+		return emptyBounds();
+
+	const uint8_t *p = reinterpret_cast<const uint8_t*>(positions);
+
+	// Every vertex can be loaded with 4 floats if the stride leaves room, otherwise the last vertex is loaded on its own
+	bool wideStride = stride >= 4 * sizeof(float);
+	size_t numWide = wideStride ? count : count - 1;
+
+	__m128 first = load3(positions, wideStride || count > 1);
+	__m128 min0 = first, max0 = first, min1 = first, max1 = first;
+
+	// Two independent min / max chains
+	size_t i = 1;
+
+	for (; i + 1 < numWide; i += 2) {
+
+		__m128 a = _mm_loadu_ps(reinterpret_cast<const float*>(p + i * stride));
+		__m128 b = _mm_loadu_ps(reinterpret_cast<const float*>(p + (i + 1) * stride));
+
+		min0 = _mm_min_ps(min0, a);
+		max0 = _mm_max_ps(max0, a);
+		min1 = _mm_min_ps(min1, b);
+		max1 = _mm_max_ps(max1, b);
+	}
+
+	for (; i < count; ++i) {
+
+		__m128 a = load3(reinterpret_cast<const float*>(p + i * stride), i < numWide);
+
+		min0 = _mm_min_ps(min0, a);
+		max0 = _mm_max_ps(max0, a);
+	}
+
+	float minPos[3], maxPos[3];
+	store3(minPos, _mm_min_ps(min0, min1));
+	store3(maxPos, _mm_max_ps(max0, max1));
+
+	Bounds bounds = boundsFromMinMax(minPos, maxPos);
+
+	// Second pass for the sphere radius around the box centre
+	__m128 centre = _mm_setr_ps(bounds.sphereCentre[0], bounds.sphereCentre[1], bounds.sphereCentre[2], 0.0f);
+	__m128 maxDistSq0 = _mm_setzero_ps(), maxDistSq1 = _mm_setzero_ps();
+
+	for (i = 0; i + 1 < numWide; i += 2) {
+
+		__m128 a = _mm_sub_ps(_mm_loadu_ps(reinterpret_cast<const float*>(p + i * stride)), centre);
+		__m128 b = _mm_sub_ps(_mm_loadu_ps(reinterpret_cast<const float*>(p + (i + 1) * stride)), centre);
+
+		maxDistSq0 = _mm_max_ps(maxDistSq0, dot3(a));
+		maxDistSq1 = _mm_max_ps(maxDistSq1, dot3(b));
+	}
+
+	for (; i < count; ++i)
+		maxDistSq0 = _mm_max_ps(maxDistSq0, dot3(_mm_sub_ps(load3(reinterpret_cast<const float*>(p + i * stride), i < numWide), centre)));
+
+	bounds.sphereRadius = _mm_cvtss_f32(_mm_sqrt_ss(_mm_max_ps(maxDistSq0, maxDistSq1)));
+
+	return bounds;
+}
+
+
+static void transformBoundsSSE(const Bounds& local, const float *m, Bounds& world) {
+
+	if (local.isEmpty()) {
+
+		world = local;
+		return;
+	}
+
+	__m128 r0 = _mm_loadu_ps(m);
+	__m128 r1 = _mm_loadu_ps(m + 4);
+	__m128 r2 = _mm_loadu_ps(m + 8);
+	__m128 r3 = _mm_loadu_ps(m + 12);
+
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 a0 = _mm_and_ps(r0, absMask);
+	__m128 a1 = _mm_and_ps(r1, absMask);
+	__m128 a2 = _mm_and_ps(r2, absMask);
+
+	const float *c = local.boxCentre;
+	const float *e = local.boxExtents;
+	const float *s = local.sphereCentre;
+
+	__m128 centre = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(c[0]), r0), _mm_mul_ps(_mm_set1_ps(c[1]), r1)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(c[2]), r2), r3));
+	__m128 extents = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(e[0]), a0), _mm_mul_ps(_mm_set1_ps(e[1]), a1)), _mm_mul_ps(_mm_set1_ps(e[2]), a2));
+	__m128 sphereCentre = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(s[0]), r0), _mm_mul_ps(_mm_set1_ps(s[1]), r1)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(s[2]), r2), r3));
+	__m128 scaleSq = _mm_max_ps(_mm_max_ps(dot3(r0), dot3(r1)), dot3(r2));
+
+	store3(world.boxCentre, centre);
+	store3(world.boxExtents, extents);
+	store3(world.sphereCentre, sphereCentre);
+	world.sphereRadius = local.sphereRadius * _mm_cvtss_f32(_mm_sqrt_ss(scaleSq));
+}
+
+#endif
+
+
+Bounds computeBounds(const float *positions, size_t count, size_t stride) {
+
+#ifdef BOUNDS_SSE
+	return computeBoundsSSE(positions, count, stride);
+#else
+	return computeBoundsScalar(positions, count, stride);
+#endif
+}
+
+Bounds computeBounds(const MeshVertex *vertices, size_t count) {
+
+	return computeBounds(vertices ? vertices->pos : nullptr, count, sizeof(MeshVertex));
+}
+
+
+Bounds mergeBounds(const Bounds& a, const Bounds& b) {
+
+	if (a.isEmpty())
+		return b;
+	if (b.isEmpty())
+		return a;
+
+	float minPos[3], maxPos[3];
+
+	for (int i = 0; i < 3; ++i) {
+
+		minPos[i] = min(a.boxCentre[i] - a.boxExtents[i], b.boxCentre[i] - b.boxExtents[i]);
+		maxPos[i] = max(a.boxCentre[i] + a.boxExtents[i], b.boxCentre[i] + b.boxExtents[i]);
+	}
+
+	Bounds merged = boundsFromMinMax(minPos, maxPos);
+
+	// Sphere - keep the larger sphere if it contains the other, otherwise the smallest sphere around both
+	float d[3] = { b.sphereCentre[0] - a.sphereCentre[0], b.sphereCentre[1] - a.sphereCentre[1], b.sphereCentre[2] - a.sphereCentre[2] };
+	float dist = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+	if (dist + b.sphereRadius <= a.sphereRadius) {
+
+		memcpy(merged.sphereCentre, a.sphereCentre, sizeof(merged.sphereCentre));
+		merged.sphereRadius = a.sphereRadius;
+	}
+	else if (dist + a.sphereRadius <= b.sphereRadius) {
+
+		memcpy(merged.sphereCentre, b.sphereCentre, sizeof(merged.sphereCentre));
+		merged.sphereRadius = b.sphereRadius;
+	}
+	else {
+
+		merged.sphereRadius = 0.5f * (dist + a.sphereRadius + b.sphereRadius);
+		float t = (merged.sphereRadius - a.sphereRadius) / dist;
+
+		for (int i = 0; i < 3; ++i)
+			merged.sphereCentre[i] = a.sphereCentre[i] + d[i] * t;
+	}
+
+	return merged;
+}
+
+
+Bounds inflateBounds(const Bounds& bounds, const float lower[3], const float upper[3]) {
+
+	if (bounds.isEmpty())
+		return bounds;
+
+	float minPos[3], maxPos[3], offsetSq = 0.0f;
+
+	for (int i = 0; i < 3; ++i) {
+
+		minPos[i] = bounds.boxCentre[i] - bounds.boxExtents[i] - lower[i];
+		maxPos[i] = bounds.boxCentre[i] + bounds.boxExtents[i] + upper[i];
+
+		float offset = max(fabsf(lower[i]), fabsf(upper[i]));
+		offsetSq += offset * offset;
+	}
+
+	Bounds inflated = boundsFromMinMax(minPos, maxPos);
+
+	memcpy(inflated.sphereCentre, bounds.sphereCentre, sizeof(inflated.sphereCentre));
+	inflated.sphereRadius = bounds.sphereRadius + sqrtf(offsetSq);
+
+	return inflated;
+}
+
+
+Bounds transformBounds(const Bounds& local, const float matrix[16]) {
+
+#ifdef BOUNDS_SSE
+	Bounds world;
+	transformBoundsSSE(local, matrix, world);
+	return world;
+#else
+	return transformBoundsScalar(local, matrix);
+#endif
+}
+
+void transformBounds(const Bounds *local, const float *matrices, Bounds *world, size_t count) {
+
+	for (size_t i = 0; i < count; ++i) {
+
+#ifdef BOUNDS_SSE
+		transformBoundsSSE(local[i], matrices + i * 16, world[i]);
+#else
+		world[i] = transformBoundsScalar(local[i], matrices + i * 16);
+#endif
+	}
+}
+
+
+Bounds transformBoundsCorners(const Bounds& local, const float m[16]) {
+
+	if (local.isEmpty())
+		return local;
+
+	float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for (int corner = 0; corner < 8; ++corner) {
+
+		float p[3];
+
+		for (int i = 0; i < 3; ++i)
+			p[i] = local.boxCentre[i] + ((corner >> i) & 1 ? local.boxExtents[i] : -local.boxExtents[i]);
+
+		for (int i = 0; i < 3; ++i) {
+
+			float w = p[0] * m[i] + p[1] * m[4 + i] + p[2] * m[8 + i] + m[12 + i];
+			minPos[i] = min(minPos[i], w);
+			maxPos[i] = max(maxPos[i], w);
+		}
+	}
+
+	Bounds world = transformBoundsScalar(local, m);
+	Bounds box = boundsFromMinMax(minPos, maxPos);
+
+	memcpy(world.boxCentre, box.boxCentre, sizeof(world.boxCentre));
+	memcpy(world.boxExtents, box.boxExtents, sizeof(world.boxExtents));
+
+	return world;
+}
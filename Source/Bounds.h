@@ -0,0 +1,49 @@
+
+//
+// Bounds.h
+//
+
+// Axis aligned bounding boxes and bounding spheres for culling, LOD selection and streaming priority.  Local (model space) bounds are computed once per mesh at import or creation with a SIMD min/max reduction over the vertex positions and are transformed into world space when the world matrix changes (see BaseModel::getWorldBounds).
+// Matrices follow the DirectXMath row vector convention (p' = p * M with the translation in the 4th row) and are passed as 16 floats in row order so an XMFLOAT4X4 can be used directly.
+
+#pragma once
+#include <MeshData.h>
+#include <cstdint>
+#include <cstddef>
+
+
+struct Bounds {
+	float								boxCentre[3]; // AABB
+	float								boxExtents[3]; // Half size of the AABB
+	float								sphereCentre[3];
+	float								sphereRadius;
+
+	bool isEmpty() const { return boxExtents[0] < 0.0f; };
+};
+
+// Bounds that contain nothing - merging with empty bounds leaves the other bounds unchanged
+Bounds emptyBounds();
+
+// Bounds of count positions (3 floats each) stride bytes apart.  The box is the tight AABB and the sphere is centred on the box with the radius of the furthest position.
+Bounds computeBounds(const float *positions, size_t count, size_t stride);
+
+// Scalar reference of computeBounds, one position at a time.  Used to check and time the SIMD reduction.
+Bounds computeBoundsScalar(const float *positions, size_t count, size_t stride);
+
+// Bounds of a range of mesh vertices
+Bounds computeBounds(const MeshVertex *vertices, size_t count);
+
+// Smallest AABB containing both boxes and a sphere containing both spheres
+Bounds mergeBounds(const Bounds& a, const Bounds& b);
+
+// Grow the box by lower below its minimum and upper above its maximum (for geometry displaced by the vertex shader).  The sphere radius grows to cover the larger offsets.
+Bounds inflateBounds(const Bounds& bounds, const float lower[3], const float upper[3]);
+
+// Transform local bounds by a world matrix.  The box is the exact AABB of the transformed box (Arvo's method) and the sphere radius is scaled by the largest axis scale of the matrix.
+Bounds transformBounds(const Bounds& local, const float matrix[16]);
+
+// Transform count local bounds by their matrices (16 floats each).  Used to refresh world bounds for many objects at once.
+void transformBounds(const Bounds *local, const float *matrices, Bounds *world, size_t count);
+
+// Reference transform - projects the 8 corners of the box and takes their min/max.  Used to check and time transformBounds.
+Bounds transformBoundsCorners(const Bounds& local, const float matrix[16]);
@@ -115,6 +115,8 @@ HRESULT Box::init(ID3D11Device *device) {
 		if (!SUCCEEDED(hr))
 			throw exception("Vertex buffer cannot be created");
 
+		setLocalBounds(computeBounds(&vertices[0].pos.x, 24, sizeof(ExtendedVertexStruct)));
+
 		// Setup Box index buffer
 		D3D11_BUFFER_DESC indexDesc;
 		indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
@@ -153,7 +155,7 @@ HRESULT Box::init(ID3D11Device *device) {
 }
 
 
-void Box::render(ID3D11DeviceContext *context) {
+void Box::render(StateTrackingContext *context) {
 
 	context->PSSetConstantBuffers(0, 1, &cBufferModelGPU);
 	context->VSSetConstantBuffers(0, 1, &cBufferModelGPU);
@@ -16,7 +16,7 @@ using namespace DirectX::PackedVector;
 __declspec(align(16)) struct CBufferScene {
 	DirectX::XMFLOAT4						windDir;
 	FLOAT									Time;
-	FLOAT									grassHeight;
+	FLOAT									grassShellHeight; // Height between grass shells - each shell is an instance of the terrain (see grass_vs.hlsl)
 };
 
 
@@ -64,6 +64,11 @@ __declspec(align(16)) struct CBufferModel {
 	DirectX::XMMATRIX						worldMatrix;
 	DirectX::XMMATRIX						worldITMatrix; // Correctly transform normals to world space
 	//FLOAT									USE_SHADOW_MAP=1; 
+	DirectX::XMFLOAT4						posScale; // Dequantise model space position = pos * posScale + posOffset (see MeshQuantiser.h)
+	DirectX::XMFLOAT4						posOffset;
+	DirectX::XMFLOAT4						matDiffuse; // a represents alpha.
+	DirectX::XMFLOAT4						matSpecular; // a represents specular power.
+	DirectX::XMFLOAT4						texRect; // Texture coordinate scale (xy) and offset (zw) of the model's texture in an atlas (see TextureAtlas.h)
 };
 __declspec(align(16)) struct CBufferShadow {
 	DirectX::XMMATRIX						shadowTransformMatrix;
@@ -42,7 +42,7 @@ Camera::~Camera()
 	if (cBufferGPU)
 		cBufferGPU->Release();
 }
-void Camera::update(ID3D11DeviceContext *context) {
+void Camera::update(StateTrackingContext *context) {
 	cBufferCPU->viewMatrix = getViewMatrix();
 	cBufferCPU->projMatrix = getProjMatrix();
 	XMStoreFloat4(&(cBufferCPU->eyePos), getPos());
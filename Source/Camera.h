@@ -33,6 +33,6 @@ public:
 
 
 
-	void update(ID3D11DeviceContext *context);
+	void update(StateTrackingContext *context);
 };
 
@@ -0,0 +1,120 @@
+
+#include "CookedMesh.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+
+void writeCookedMesh(const string& filename, const MeshData& mesh, const vector<QuantisedVertexStruct>& vertices, const QuantisationParams& dequantisation) {
+
+	CookedMeshHeader header;
+	header.magic = CookedMeshMagic;
+	header.version = CookedMeshVersion;
+	header.numVertices = (uint32_t)vertices.size();
+	header.numIndices = (uint32_t)mesh.indices.size();
+	header.numLODs = (uint32_t)mesh.lods.size();
+	header.numMeshlets = (uint32_t)mesh.meshlets.size();
+	header.dequantisation = dequantisation;
+
+	ofstream file(filename, ios::binary);
+
+	if (!file)
+		throw runtime_error("Cannot create cooked mesh " + filename);
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(CookedMeshHeader));
+
+	for (const MeshLOD& lod : mesh.lods) {
+
+		uint32_t numSubMeshes = (uint32_t)lod.subMeshes.size();
+
+		file.write(reinterpret_cast<const char*>(&lod.error), sizeof(float));
+		file.write(reinterpret_cast<const char*>(&numSubMeshes), sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(lod.subMeshes.data()), numSubMeshes * sizeof(SubMesh));
+	}
+
+	file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), mesh.meshlets.size() * sizeof(Meshlet));
+	file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(QuantisedVertexStruct));
+	file.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(uint32_t));
+
+	if (!file)
+		throw runtime_error("Cannot write cooked mesh " + filename);
+}
+
+
+void readCookedMesh(const string& filename, MeshData& mesh, vector<QuantisedVertexStruct>& vertices, QuantisationParams& dequantisation) {
+
+	MappedFile file(filename);
+
+	if (!file.isValid())
+		throw runtime_error("Cannot open cooked mesh " + filename);
+
+	const uint8_t *ptr = file.getData();
+	const uint8_t *end = ptr + file.getSize();
+
+	// Copy the next size bytes of the file to dst
+	auto read = [&](void *dst, size_t size) {
+
+		if ((size_t)(end - ptr) < size)
+			throw runtime_error("Truncated cooked mesh " + filename);
+
+		memcpy(dst, ptr, size);
+		ptr += size;
+	};
+
+	CookedMeshHeader header;
+	read(&header, sizeof(CookedMeshHeader));
+
+	if (header.magic != CookedMeshMagic || header.version != CookedMeshVersion)
+		throw runtime_error("Not a cooked mesh (or cooked by a different version) " + filename);
+
+	if (header.numLODs == 0)
+		throw runtime_error("Cooked mesh has no LODs " + filename);
+
+	mesh.vertices.clear();
+	mesh.lods.resize(header.numLODs);
+
+	for (MeshLOD& lod : mesh.lods) {
+
+		uint32_t numSubMeshes;
+
+		read(&lod.error, sizeof(float));
+		read(&numSubMeshes, sizeof(uint32_t));
+
+		if (numSubMeshes > (size_t)(end - ptr) / sizeof(SubMesh))
+			throw runtime_error("Truncated cooked mesh " + filename);
+
+		lod.subMeshes.resize(numSubMeshes);
+		read(lod.subMeshes.data(), numSubMeshes * sizeof(SubMesh));
+
+		for (const SubMesh& subMesh : lod.subMeshes)
+			if ((uint64_t)subMesh.firstIndex + subMesh.indexCount > header.numIndices || (uint64_t)subMesh.baseVertex + subMesh.vertexCount > header.numVertices)
+				throw runtime_error("Invalid index range in cooked mesh " + filename);
+	}
+
+	if (header.numMeshlets > (size_t)(end - ptr) / sizeof(Meshlet))
+		throw runtime_error("Truncated cooked mesh " + filename);
+
+	mesh.meshlets.resize(header.numMeshlets);
+	read(mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+
+	for (const Meshlet& meshlet : mesh.meshlets)
+		if (meshlet.subMesh >= mesh.lods[0].subMeshes.size() || (uint64_t)meshlet.firstIndex + meshlet.indexCount > header.numIndices)
+			throw runtime_error("Invalid meshlet in cooked mesh " + filename);
+
+	if (header.numVertices > (size_t)(end - ptr) / sizeof(QuantisedVertexStruct))
+		throw runtime_error("Truncated cooked mesh " + filename);
+
+	vertices.resize(header.numVertices);
+	read(vertices.data(), vertices.size() * sizeof(QuantisedVertexStruct));
+
+	if (header.numIndices > (size_t)(end - ptr) / sizeof(uint32_t))
+		throw runtime_error("Truncated cooked mesh " + filename);
+
+	mesh.indices.resize(header.numIndices);
+	read(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+
+	dequantisation = header.dequantisation;
+}
@@ -0,0 +1,36 @@
+
+//
+// CookedMesh.h
+//
+
+// Binary cooked mesh format written by the asset cooker (Tools/AssetCooker).  A .mesh file holds the quantised vertices, the index buffer and the LOD table exactly as they are uploaded by MeshAsset so cooked models load without import, simplification or quantisation.
+//
+// Layout (little endian): CookedMeshHeader, then for each LOD the error (float), the number of SubMeshes (uint32_t) and the SubMeshes, then the Meshlet array (see Meshlet.h), the QuantisedVertexStruct array and the uint32_t index array.
+
+#pragma once
+#include <MeshData.h>
+#include <MeshQuantiser.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+static const uint32_t CookedMeshMagic = 0x4853454d; // "MESH"
+static const uint32_t CookedMeshVersion = 2;
+
+struct CookedMeshHeader {
+	uint32_t							magic;
+	uint32_t							version;
+	uint32_t							numVertices;
+	uint32_t							numIndices;
+	uint32_t							numLODs;
+	uint32_t							numMeshlets;
+	QuantisationParams					dequantisation;
+};
+
+
+// Write mesh (indices, LODs and meshlets) with its quantised vertices to filename.  Throws std::runtime_error if the file cannot be written.
+void writeCookedMesh(const std::string& filename, const MeshData& mesh, const std::vector<QuantisedVertexStruct>& vertices, const QuantisationParams& dequantisation);
+
+// Read a cooked mesh.  mesh receives the indices, LODs and meshlets (mesh.vertices is left empty - the full precision vertices are not stored).  Throws std::runtime_error if the file cannot be read or is malformed.
+void readCookedMesh(const std::string& filename, MeshData& mesh, std::vector<QuantisedVertexStruct>& vertices, QuantisationParams& dequantisation);
@@ -0,0 +1,492 @@
+
+#include "DDSFile.h"
+#include "MappedFile.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+using namespace std;
+
+
+// Header flags (see dds.h)
+static const uint32_t DDSFlagsTexture = 0x00001007; // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+static const uint32_t DDSFlagPitch = 0x00000008;
+static const uint32_t DDSFlagMipMapCount = 0x00020000;
+static const uint32_t DDSFlagLinearSize = 0x00080000;
+static const uint32_t DDSFlagDepth = 0x00800000;
+static const uint32_t DDSPixelFormatFourCC = 0x00000004;
+static const uint32_t DDSPixelFormatRGBA = 0x00000041; // DDPF_RGB | DDPF_ALPHAPIXELS
+static const uint32_t DDSPixelFormatAlphaPixels = 0x00000001;
+static const uint32_t DDSPixelFormatRGB = 0x00000040;
+static const uint32_t DDSPixelFormatAlpha = 0x00000002;
+static const uint32_t DDSPixelFormatLuminance = 0x00020000;
+static const uint32_t DDSCapsTexture = 0x00001000;
+static const uint32_t DDSCapsComplex = 0x00000008;
+static const uint32_t DDSCapsMipMap = 0x00400000;
+static const uint32_t DDSCaps2CubeMap = 0x00000200;
+static const uint32_t DDSCaps2CubeMapAllFaces = 0x0000fc00;
+static const uint32_t DDSCaps2Volume = 0x00200000;
+static const uint32_t DDSFourCCDX10 = 0x30315844; // "DX10"
+static const uint32_t DDSMiscTextureCube = 0x4;
+static const uint32_t DDSDimensionTexture2D = 3;
+static const uint32_t DDSDimensionTexture3D = 4;
+
+
+static uint32_t makeFourCC(char a, char b, char c, char d) {
+
+	return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+}
+
+
+static bool hasMasks(const DDSPixelFormat& pf, uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+
+	return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a;
+}
+
+
+// DXGI_FORMAT equivalent of a legacy (pre DX10) pixel format, 0 if there is none.  Follows GetDXGIFormat in DirectXTK's DDSTextureLoader.
+static uint32_t getLegacyFormat(const DDSPixelFormat& pf) {
+
+	if (pf.flags & DDSPixelFormatFourCC) {
+
+		if (pf.fourCC == makeFourCC('D', 'X', 'T', '1'))
+			return 71; // BC1_UNORM
+		if (pf.fourCC == makeFourCC('D', 'X', 'T', '2') || pf.fourCC == makeFourCC('D', 'X', 'T', '3'))
+			return 74; // BC2_UNORM
+		if (pf.fourCC == makeFourCC('D', 'X', 'T', '4') || pf.fourCC == makeFourCC('D', 'X', 'T', '5'))
+			return 77; // BC3_UNORM
+		if (pf.fourCC == makeFourCC('A', 'T', 'I', '1') || pf.fourCC == makeFourCC('B', 'C', '4', 'U'))
+			return 80; // BC4_UNORM
+		if (pf.fourCC == makeFourCC('B', 'C', '4', 'S'))
+			return 81; // BC4_SNORM
+		if (pf.fourCC == makeFourCC('A', 'T', 'I', '2') || pf.fourCC == makeFourCC('B', 'C', '5', 'U'))
+			return 83; // BC5_UNORM
+		if (pf.fourCC == makeFourCC('B', 'C', '5', 'S'))
+			return 84; // BC5_SNORM
+
+		// D3DFORMAT values stored as the fourCC
+		switch (pf.fourCC) {
+		case 36: return 11; // R16G16B16A16_UNORM
+		case 110: return 13; // R16G16B16A16_SNORM
+		case 111: return 54; // R16_FLOAT
+		case 112: return 34; // R16G16_FLOAT
+		case 113: return 10; // R16G16B16A16_FLOAT
+		case 114: return 41; // R32_FLOAT
+		case 115: return 16; // R32G32_FLOAT
+		case 116: return 2; // R32G32B32A32_FLOAT
+		}
+
+		return 0;
+	}
+
+	if (pf.flags & DDSPixelFormatRGB) {
+
+		if (pf.RGBBitCount == 32) {
+
+			if (hasMasks(pf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+				return 28; // R8G8B8A8_UNORM
+			if (hasMasks(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+				return 87; // B8G8R8A8_UNORM
+			if (hasMasks(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0))
+				return 88; // B8G8R8X8_UNORM
+			// D3DX writes R10G10B10A2 files with the red and blue masks swapped
+			if (hasMasks(pf, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+				return 24; // R10G10B10A2_UNORM
+			if (hasMasks(pf, 0x0000ffff, 0xffff0000, 0, 0))
+				return 35; // R16G16_UNORM
+			if (hasMasks(pf, 0xffffffff, 0, 0, 0))
+				return 41; // R32_FLOAT
+		}
+		else if (pf.RGBBitCount == 16) {
+
+			if (hasMasks(pf, 0x7c00, 0x03e0, 0x001f, 0x8000))
+				return 86; // B5G5R5A1_UNORM
+			if (hasMasks(pf, 0xf800, 0x07e0, 0x001f, 0))
+				return 85; // B5G6R5_UNORM
+			if (hasMasks(pf, 0x0f00, 0x00f0, 0x000f, 0xf000))
+				return 115; // B4G4R4A4_UNORM
+		}
+
+		// 24 bit RGB and the remaining 16 bit layouts have no DXGI format
+		return 0;
+	}
+
+	if (pf.flags & DDSPixelFormatLuminance) {
+
+		if (pf.RGBBitCount == 8 && pf.RBitMask == 0xff)
+			return 61; // R8_UNORM
+		if (pf.RGBBitCount == 16 && pf.RBitMask == 0xffff)
+			return 56; // R16_UNORM
+		if (pf.RGBBitCount == 16 && pf.RBitMask == 0xff && pf.ABitMask == 0xff00)
+			return 49; // R8G8_UNORM
+
+		return 0;
+	}
+
+	if ((pf.flags & DDSPixelFormatAlpha) && pf.RGBBitCount == 8)
+		return 65; // A8_UNORM
+
+	return 0;
+}
+
+
+uint32_t getDXGIFormatBytes(uint32_t dxgiFormat, bool& blockCompressed) {
+
+	blockCompressed = (dxgiFormat >= 70 && dxgiFormat <= 84) || (dxgiFormat >= 94 && dxgiFormat <= 99);
+
+	if (blockCompressed)
+		return (dxgiFormat <= 72 || (dxgiFormat >= 79 && dxgiFormat <= 81)) ? 8 : 16; // BC1 and BC4 blocks are 8 bytes
+
+	if (dxgiFormat >= 1 && dxgiFormat <= 4)
+		return 16; // R32G32B32A32
+	if (dxgiFormat >= 5 && dxgiFormat <= 8)
+		return 12; // R32G32B32
+	if (dxgiFormat >= 9 && dxgiFormat <= 22)
+		return 8; // R16G16B16A16, R32G32, R32G8X24
+	if ((dxgiFormat >= 23 && dxgiFormat <= 47) || dxgiFormat == 67 || (dxgiFormat >= 87 && dxgiFormat <= 93))
+		return 4; // R10G10B10A2, R11G11B10, R8G8B8A8, R16G16, R32, R24G8, R9G9B9E5, B8G8R8A8, B8G8R8X8
+	if ((dxgiFormat >= 48 && dxgiFormat <= 59) || dxgiFormat == 85 || dxgiFormat == 86 || dxgiFormat == 115)
+		return 2; // R8G8, R16, B5G6R5, B5G5R5A1, B4G4R4A4
+	if (dxgiFormat >= 60 && dxgiFormat <= 65)
+		return 1; // R8, A8
+
+	// Packed (R1_UNORM, R8G8_B8G8...) and video formats
+	blockCompressed = false;
+	return 0;
+}
+
+
+DDSInfo readDDSInfo(const uint8_t *data, size_t size) {
+
+	if (size < 4 + sizeof(DDSHeader))
+		throw runtime_error("Truncated dds header");
+
+	uint32_t magic;
+	memcpy(&magic, data, sizeof(uint32_t));
+
+	DDSHeader header;
+	memcpy(&header, data + 4, sizeof(DDSHeader));
+
+	if (magic != DDSMagic || header.size != sizeof(DDSHeader) || header.ddspf.size != sizeof(DDSPixelFormat))
+		throw runtime_error("Not a dds file");
+
+	DDSInfo info;
+	info.width = header.width;
+	info.height = header.height;
+	info.depth = (header.flags & DDSFlagDepth) ? header.depth : 1;
+	info.mipLevels = header.mipMapCount ? header.mipMapCount : 1;
+	info.arraySize = 1;
+	info.fourCC = (header.ddspf.flags & DDSPixelFormatFourCC) ? header.ddspf.fourCC : 0;
+	info.dxgiFormat = 0;
+	info.format = getLegacyFormat(header.ddspf);
+	info.isCubeMap = (header.caps2 & DDSCaps2CubeMap) != 0;
+	info.dataOffset = 4 + sizeof(DDSHeader);
+
+	if (info.fourCC == DDSFourCCDX10) {
+
+		if (size < info.dataOffset + sizeof(DDSHeaderDX10))
+			throw runtime_error("Truncated dds DX10 header");
+
+		DDSHeaderDX10 dx10;
+		memcpy(&dx10, data + info.dataOffset, sizeof(DDSHeaderDX10));
+
+		info.fourCC = 0;
+		info.dxgiFormat = dx10.dxgiFormat;
+		info.format = dx10.dxgiFormat;
+		info.arraySize = dx10.arraySize ? dx10.arraySize : 1;
+		info.isCubeMap = (dx10.miscFlag & DDSMiscTextureCube) != 0;
+		info.dataOffset += sizeof(DDSHeaderDX10);
+
+		if (dx10.resourceDimension == DDSDimensionTexture3D)
+			info.depth = max(1u, header.depth);
+
+		if (info.isCubeMap)
+			info.arraySize *= 6;
+	}
+	else if (info.isCubeMap) {
+
+		if ((header.caps2 & DDSCaps2CubeMapAllFaces) != DDSCaps2CubeMapAllFaces)
+			throw runtime_error("Partial dds cube maps are not supported");
+
+		info.arraySize = 6;
+	}
+
+	if (info.width == 0 || info.height == 0 || info.depth == 0 || info.mipLevels > 16)
+		throw runtime_error("Invalid dds dimensions");
+
+	if (info.depth > 1 && (info.isCubeMap || info.arraySize > 1))
+		throw runtime_error("dds volume texture arrays are not supported");
+
+	if (size <= info.dataOffset)
+		throw runtime_error("Truncated dds pixel data");
+
+	return info;
+}
+
+
+vector<DDSSubresource> getDDSSubresources(const DDSInfo& info, size_t size) {
+
+	bool blockCompressed;
+	uint32_t bytes = getDXGIFormatBytes(info.format, blockCompressed);
+
+	if (bytes == 0)
+		throw runtime_error("Unsupported dds pixel format");
+
+	// Direct3D 11 limits (D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION...) also keep the pitches below in 32 bits
+	if (info.width > 16384 || info.height > 16384 || info.depth > 2048 || info.arraySize > 2048 || (info.depth > 1 && max(info.width, info.height) > 2048))
+		throw runtime_error("Invalid dds dimensions");
+
+	uint32_t largest = max(max(info.width, info.height), info.depth);
+	uint32_t maxLevels = 1;
+
+	while (largest >> maxLevels)
+		++maxLevels;
+
+	if (info.mipLevels > maxLevels)
+		throw runtime_error("Invalid dds mip levels");
+
+	vector<DDSSubresource> subresources;
+	subresources.reserve((size_t)info.arraySize * info.mipLevels);
+
+	size_t offset = info.dataOffset;
+
+	for (uint32_t slice = 0; slice < info.arraySize; ++slice) {
+
+		for (uint32_t level = 0; level < info.mipLevels; ++level) {
+
+			DDSSubresource subresource;
+			subresource.offset = offset;
+			subresource.width = max(1u, info.width >> level);
+			subresource.height = max(1u, info.height >> level);
+			subresource.depth = max(1u, info.depth >> level);
+
+			uint32_t rows = subresource.height;
+
+			if (blockCompressed) {
+
+				subresource.rowPitch = ((subresource.width + 3) / 4) * bytes;
+				rows = (rows + 3) / 4;
+			}
+			else
+				subresource.rowPitch = subresource.width * bytes;
+
+			subresource.slicePitch = subresource.rowPitch * rows;
+
+			size_t levelBytes = (size_t)subresource.slicePitch * subresource.depth;
+
+			if (offset > size || levelBytes > size - offset)
+				throw runtime_error("Truncated dds pixel data");
+
+			offset += levelBytes;
+			subresources.push_back(subresource);
+		}
+	}
+
+	return subresources;
+}
+
+
+// Shift and 8 bit scale of a channel mask (masks of 8 bits or fewer only)
+static void maskShift(uint32_t mask, uint32_t& shift, uint32_t& maximum) {
+
+	shift = 0;
+
+	while (mask && !(mask & 1)) {
+
+		mask >>= 1;
+		++shift;
+	}
+
+	maximum = mask;
+
+	if (maximum > 255 || (maximum & (maximum + 1)) != 0)
+		throw runtime_error("Unsupported dds channel mask");
+}
+
+
+void readDDSImage(const uint8_t *data, size_t size, ImageData& image) {
+
+	DDSInfo info = readDDSInfo(data, size);
+
+	DDSHeader header;
+	memcpy(&header, data + 4, sizeof(DDSHeader));
+
+	if (info.fourCC != 0 || info.dxgiFormat != 0 || info.isCubeMap || info.depth != 1 || !(header.ddspf.flags & DDSPixelFormatRGB) || header.ddspf.RGBBitCount != 32)
+		throw runtime_error("Only uncompressed 32 bit dds textures can be decoded");
+
+	size_t numTexels = (size_t)info.width * info.height;
+
+	if (size - info.dataOffset < numTexels * 4)
+		throw runtime_error("Truncated dds pixel data");
+
+	bool hasAlpha = (header.ddspf.flags & DDSPixelFormatAlphaPixels) && header.ddspf.ABitMask;
+	uint32_t masks[4] = { header.ddspf.RBitMask, header.ddspf.GBitMask, header.ddspf.BBitMask, hasAlpha ? header.ddspf.ABitMask : 0 };
+	uint32_t shifts[4], maximums[4];
+
+	for (int j = 0; j < 4; ++j)
+		maskShift(masks[j], shifts[j], maximums[j]);
+
+	image.width = info.width;
+	image.height = info.height;
+	image.pixels.resize(numTexels * 4);
+
+	const uint8_t *source = data + info.dataOffset;
+
+	for (size_t i = 0; i < numTexels; ++i) {
+
+		uint32_t texel;
+		memcpy(&texel, source + i * 4, sizeof(uint32_t));
+
+		for (int j = 0; j < 4; ++j)
+			image.pixels[i * 4 + j] = maximums[j] ? (uint8_t)((((texel & masks[j]) >> shifts[j]) * 255 + maximums[j] / 2) / maximums[j]) : (j == 3 ? 255 : 0);
+	}
+}
+
+
+static void writeDDSFile(const string& filename, const DDSHeader& header, const DDSHeaderDX10 *dx10, const vector<const vector<uint8_t>*>& levels) {
+
+	ofstream file(filename, ios::binary);
+
+	if (!file)
+		throw runtime_error("Cannot create dds file " + filename);
+
+	file.write(reinterpret_cast<const char*>(&DDSMagic), sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(DDSHeader));
+
+	if (dx10)
+		file.write(reinterpret_cast<const char*>(dx10), sizeof(DDSHeaderDX10));
+
+	for (const vector<uint8_t> *level : levels)
+		file.write(reinterpret_cast<const char*>(level->data()), level->size());
+
+	if (!file)
+		throw runtime_error("Cannot write dds file " + filename);
+}
+
+
+void writeDDS(const string& filename, const ImageData& image) {
+
+	writeDDS(filename, vector<ImageData>(1, image));
+}
+
+
+void writeDDS(const string& filename, const vector<ImageData>& mips) {
+
+	if (mips.empty() || mips[0].width == 0 || mips[0].height == 0)
+		throw runtime_error("Invalid image for dds file " + filename);
+
+	vector<const vector<uint8_t>*> levels;
+
+	for (const ImageData& mip : mips) {
+
+		if (mip.pixels.size() != (size_t)mip.width * mip.height * 4)
+			throw runtime_error("Invalid image for dds file " + filename);
+
+		levels.push_back(&mip.pixels);
+	}
+
+	DDSHeader header;
+	memset(&header, 0, sizeof(DDSHeader));
+
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSFlagsTexture | DDSFlagPitch;
+	header.width = mips[0].width;
+	header.height = mips[0].height;
+	header.pitchOrLinearSize = mips[0].width * 4;
+	header.mipMapCount = (uint32_t)mips.size();
+	header.caps = DDSCapsTexture;
+
+	if (mips.size() > 1) {
+
+		header.flags |= DDSFlagMipMapCount;
+		header.caps |= DDSCapsComplex | DDSCapsMipMap;
+	}
+
+	// Byte order R, G, B, A - loaded as DXGI_FORMAT_R8G8B8A8_UNORM
+	header.ddspf.size = sizeof(DDSPixelFormat);
+	header.ddspf.flags = DDSPixelFormatRGBA;
+	header.ddspf.RGBBitCount = 32;
+	header.ddspf.RBitMask = 0x000000ff;
+	header.ddspf.GBitMask = 0x0000ff00;
+	header.ddspf.BBitMask = 0x00ff0000;
+	header.ddspf.ABitMask = 0xff000000;
+
+	writeDDSFile(filename, header, nullptr, levels);
+}
+
+
+// Slices are written one after the other, each with all of its levels
+static void writeBlockDDS(const string& filename, uint32_t width, uint32_t height, uint32_t dxgiFormat, uint32_t blockBytes, const vector<const vector<vector<uint8_t>>*>& slices) {
+
+	if (slices.empty() || slices[0]->empty() || width == 0 || height == 0)
+		throw runtime_error("Invalid image for dds file " + filename);
+
+	const vector<vector<uint8_t>>& mips = *slices[0];
+	vector<const vector<uint8_t>*> levels;
+
+	for (const vector<vector<uint8_t>> *slice : slices) {
+
+		if (slice->size() != mips.size())
+			throw runtime_error("Texture array slices have different mip levels in dds file " + filename);
+
+		for (size_t level = 0; level < slice->size(); ++level) {
+
+			uint32_t levelWidth = max(1u, width >> level);
+			uint32_t levelHeight = max(1u, height >> level);
+
+			if ((*slice)[level].size() != (size_t)((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockBytes)
+				throw runtime_error("Invalid block data for dds file " + filename);
+
+			levels.push_back(&(*slice)[level]);
+		}
+	}
+
+	DDSHeader header;
+	memset(&header, 0, sizeof(DDSHeader));
+
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSFlagsTexture | DDSFlagLinearSize;
+	header.width = width;
+	header.height = height;
+	header.pitchOrLinearSize = (uint32_t)mips[0].size();
+	header.mipMapCount = (uint32_t)mips.size();
+	header.caps = DDSCapsTexture;
+
+	if (mips.size() > 1) {
+
+		header.flags |= DDSFlagMipMapCount;
+		header.caps |= DDSCapsComplex | DDSCapsMipMap;
+	}
+
+	header.ddspf.size = sizeof(DDSPixelFormat);
+	header.ddspf.flags = DDSPixelFormatFourCC;
+	header.ddspf.fourCC = DDSFourCCDX10;
+
+	DDSHeaderDX10 dx10;
+	memset(&dx10, 0, sizeof(DDSHeaderDX10));
+
+	dx10.dxgiFormat = dxgiFormat;
+	dx10.resourceDimension = DDSDimensionTexture2D;
+	dx10.arraySize = (uint32_t)slices.size();
+
+	writeDDSFile(filename, header, &dx10, levels);
+}
+
+
+void writeDDS(const string& filename, uint32_t width, uint32_t height, uint32_t dxgiFormat, uint32_t blockBytes, const vector<vector<uint8_t>>& mips) {
+
+	writeBlockDDS(filename, width, height, dxgiFormat, blockBytes, vector<const vector<vector<uint8_t>>*>(1, &mips));
+}
+
+
+void writeDDS(const string& filename, uint32_t width, uint32_t height, uint32_t dxgiFormat, uint32_t blockBytes, const vector<vector<vector<uint8_t>>>& slices) {
+
+	vector<const vector<vector<uint8_t>>*> slicePointers;
+
+	for (const vector<vector<uint8_t>>& slice : slices)
+		slicePointers.push_back(&slice);
+
+	writeBlockDDS(filename, width, height, dxgiFormat, blockBytes, slicePointers);
+}
@@ -0,0 +1,106 @@
+
+//
+// DDSFile.h
+//
+
+// DirectDraw Surface (dds) file structures with a header reader, an uncompressed image reader and RGBA8 / block compressed (texture array) writers for the asset cooker.  The layout matches dds.h in DirectXTK so cooked files also load with CreateDDSTextureFromFile.
+// getDDSSubresources finds every mip level of every array slice / cube face inside the file so the application can create textures straight from a memory mapped file (see Texture::createDDSTexture) without reading it into a heap buffer first.
+
+#pragma once
+#include <ImageData.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+static const uint32_t DDSMagic = 0x20534444; // "DDS "
+
+struct DDSPixelFormat {
+	uint32_t							size;
+	uint32_t							flags;
+	uint32_t							fourCC;
+	uint32_t							RGBBitCount;
+	uint32_t							RBitMask;
+	uint32_t							GBitMask;
+	uint32_t							BBitMask;
+	uint32_t							ABitMask;
+};
+
+struct DDSHeader {
+	uint32_t							size;
+	uint32_t							flags;
+	uint32_t							height;
+	uint32_t							width;
+	uint32_t							pitchOrLinearSize;
+	uint32_t							depth;
+	uint32_t							mipMapCount;
+	uint32_t							reserved1[11];
+	DDSPixelFormat						ddspf;
+	uint32_t							caps;
+	uint32_t							caps2;
+	uint32_t							caps3;
+	uint32_t							caps4;
+	uint32_t							reserved2;
+};
+
+// Follows DDSHeader when ddspf.fourCC is "DX10"
+struct DDSHeaderDX10 {
+	uint32_t							dxgiFormat;
+	uint32_t							resourceDimension;
+	uint32_t							miscFlag;
+	uint32_t							arraySize;
+	uint32_t							miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124, "DDSHeader must match the dds file layout");
+static_assert(sizeof(DDSHeaderDX10) == 20, "DDSHeaderDX10 must match the dds file layout");
+
+// Summary of a dds file header
+struct DDSInfo {
+	uint32_t							width;
+	uint32_t							height;
+	uint32_t							depth;
+	uint32_t							mipLevels;
+	uint32_t							arraySize; // 6 for a cube map
+	uint32_t							fourCC; // Legacy compressed formats, 0 for uncompressed or DX10 files
+	uint32_t							dxgiFormat; // DX10 files only
+	uint32_t							format; // DXGI_FORMAT of the pixel data - dxgiFormat or the equivalent of a legacy pixel format, 0 if Direct3D 11 has none (24 bit RGB...)
+	bool								isCubeMap;
+	size_t								dataOffset; // Offset of the first subresource from the start of the file
+};
+
+// One mip level of one array slice or cube face in a dds file
+struct DDSSubresource {
+	size_t								offset; // From the start of the file
+	uint32_t							width;
+	uint32_t							height;
+	uint32_t							depth; // Volume textures only, 1 otherwise
+	uint32_t							rowPitch; // Bytes per row of texels (of 4x4 blocks for block compressed formats)
+	uint32_t							slicePitch; // Bytes per depth slice
+};
+
+
+// Validate the header of a dds file held in memory.  Throws std::runtime_error if the data is not a dds file or is truncated.
+DDSInfo readDDSInfo(const uint8_t *data, size_t size);
+
+// Layout of every subresource of the file described by info in Direct3D 11 order (all levels of slice 0, then all levels of slice 1...).  Throws std::runtime_error if info.format is not supported or the file (size bytes) is too small for its pixel data.
+std::vector<DDSSubresource> getDDSSubresources(const DDSInfo& info, size_t size);
+
+// Bytes per texel of an uncompressed DXGI_FORMAT or per 4x4 block of a block compressed one (blockCompressed is set), 0 if the format is not supported
+uint32_t getDXGIFormatBytes(uint32_t dxgiFormat, bool& blockCompressed);
+
+// Decode the top level of an uncompressed 32 bit dds file (any channel order) into RGBA8.  Throws std::runtime_error for compressed, cube map and volume files.
+void readDDSImage(const uint8_t *data, size_t size, ImageData& image);
+
+// Write image as a single level R8G8B8A8_UNORM dds file.  Throws std::runtime_error if the file cannot be written.
+void writeDDS(const std::string& filename, const ImageData& image);
+
+// Write a mip chain (largest first, see generateMipChain) as an R8G8B8A8_UNORM dds file
+void writeDDS(const std::string& filename, const std::vector<ImageData>& mips);
+
+// Write block compressed mip levels (largest first) with a DX10 header.  dxgiFormat and blockBytes describe the 4x4 blocks (see TextureCompressor.h).
+void writeDDS(const std::string& filename, uint32_t width, uint32_t height, uint32_t dxgiFormat, uint32_t blockBytes, const std::vector<std::vector<uint8_t>>& mips);
+
+// Write a texture array of block compressed slices, each a full set of mip levels as above (see TextureAtlas.h)
+void writeDDS(const std::string& filename, uint32_t width, uint32_t height, uint32_t dxgiFormat, uint32_t blockBytes, const std::vector<std::vector<std::vector<uint8_t>>>& slices);
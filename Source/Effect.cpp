@@ -1,10 +1,13 @@
 #include "stdafx.h"
 #include "Effect.h"
+#include <ShaderLibrary.h>
+#include <StateCache.h>
+#include <memory>
 
 
 using namespace std;
 
-void Effect::bindPipeline(ID3D11DeviceContext *context){
+void Effect::bindPipeline(StateTrackingContext *context){
 	context->RSSetState(RasterizerState);
 	// Apply dsState
 	context->OMSetDepthStencilState(DepthStencilState, 0);
@@ -17,8 +20,13 @@ void Effect::bindPipeline(ID3D11DeviceContext *context){
 	context->IASetInputLayout(VSInputLayout);
 }
 
-void Effect::initDefaultStates(ID3D11Device *device ){
+void Effect::initDefaultStates(ID3D11Device *device, StateCache *_stateCache){
 	
+	// States are shared through the state cache - the effect holds its own references so a temporary cache can be released
+	stateCache = _stateCache;
+	unique_ptr<StateCache> ownCache(stateCache ? nullptr : new StateCache(device));
+	StateCache *states = stateCache ? stateCache : ownCache.get();
+
 	// Rasteriser Stage
 
 	// Initialise default Rasteriser state
@@ -40,12 +48,8 @@ void Effect::initDefaultStates(ID3D11Device *device ){
 	RSdesc.AntialiasedLineEnable = FALSE;
 	// Setup default rasteriser state
 
-	// Create Rasterizer State (RasterizerState) object based on the given descriptor
-	HRESULT hr = device->CreateRasterizerState(&RSdesc, &RasterizerState);
-
-
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create Rasterise state interface");
+	// Get the shared Rasterizer State (RasterizerState) object for the given descriptor
+	RasterizerState = states->getRasterizerState(RSdesc);
 
 	// Output - Merger Stage
 
@@ -73,12 +77,8 @@ void Effect::initDefaultStates(ID3D11Device *device ){
 
 
 	
-	// Create depth-stencil state object (DepthStencilState) based on the given descriptor
-	hr = device->CreateDepthStencilState(&dsDesc, &DepthStencilState);
-
-
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create DepthStencil state interface");
+	// Get the shared depth-stencil state object (DepthStencilState) for the given descriptor
+	DepthStencilState = states->getDepthStencilState(dsDesc);
 
 	//// Initialise default blend state object (Alpha Blending Off)
 	D3D11_BLEND_DESC	blendDesc;
@@ -96,7 +96,7 @@ void Effect::initDefaultStates(ID3D11Device *device ){
 	blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
 	blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
 	
-	hr = device->CreateBlendState(&blendDesc, &BlendState);
+	BlendState = states->getBlendState(blendDesc);
 
 
 	// Initialise default blend state object (Alpha Blending On)
@@ -137,38 +137,89 @@ void Effect::initDefaultStates(ID3D11Device *device ){
 	//// Create blendState object (BlendState) based on the given descriptor
 	//hr = device->CreateBlendState(&blendDesc, &BlendState);
 
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create Blend state interface");
-
 	blendFactor[0] = blendFactor[1] = blendFactor[2] = blendFactor[3] = 1.0f;
 	sampleMask = 0xFFFFFFFF; // Bitwise flags to determine which samples to process in an MSAA context
 }
-Effect::Effect(ID3D11Device *device, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11InputLayout *_VSInputLayout)
+Effect::Effect(ID3D11Device *device, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11InputLayout *_VSInputLayout, StateCache *_stateCache)
 {
 	VertexShader = _VertexShader;
 	PixelShader = _PixelShader;
 	GeometryShader = NULL;
 	VSInputLayout = _VSInputLayout;
-	initDefaultStates(device);
+	initDefaultStates(device, _stateCache);
 	VertexShader->AddRef();
 	PixelShader->AddRef();
 	VSInputLayout->AddRef();
 
 }
 
-Effect::Effect(ID3D11Device *device, const char *vertexShaderPath, const char * pixelShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements)
+Effect::Effect(ID3D11Device *device, const char *vertexShaderPath, const char * pixelShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements, ShaderLibrary *shaderLibrary, StateCache *_stateCache)
 {
-	char *tmpShaderBytecode = nullptr;
+	// The effect holds its own references so a temporary library can be released
+	unique_ptr<ShaderLibrary> ownLibrary;
 
-	uint32_t tmpVSSizeBytes = CreateVertexShader(device, vertexShaderPath, &tmpShaderBytecode, &VertexShader);
-	
-	// Add code here (Create an input layout)
-	// Create an input layout object(VSInputLayout)
-	device->CreateInputLayout(vertexDesc, numVertexElements, tmpShaderBytecode, tmpVSSizeBytes, &VSInputLayout);
-	free(tmpShaderBytecode);
-	CreatePixelShader(device, pixelShaderPath, &tmpShaderBytecode, &PixelShader);
-	free(tmpShaderBytecode);
-	initDefaultStates(device);
+	if (!shaderLibrary) {
+
+		ownLibrary.reset(new ShaderLibrary(device));
+		shaderLibrary = ownLibrary.get();
+	}
+
+	VertexShader = shaderLibrary->getVertexShader(vertexShaderPath);
+	VSInputLayout = shaderLibrary->getInputLayout(vertexShaderPath, vertexDesc, numVertexElements);
+	PixelShader = shaderLibrary->getPixelShader(pixelShaderPath);
+	initDefaultStates(device, _stateCache);
+}
+
+Effect::Effect(ID3D11Device *device, const ShaderVariant& vertexShader, const ShaderVariant& pixelShader, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements, ShaderLibrary *shaderLibrary, StateCache *_stateCache)
+	: Effect(device, ShaderLibrary::getVariantFilename(vertexShader, VertexShaderType), ShaderLibrary::getVariantFilename(pixelShader, PixelShaderType), vertexDesc, numVertexElements, shaderLibrary, _stateCache)
+{
+}
+
+void Effect::setRasterizerState(ID3D11RasterizerState *_RasterizerState)
+{
+	if (RasterizerState)
+		RasterizerState->Release();
+	RasterizerState = _RasterizerState;
+	pipelineState = nullptr;
+}
+
+void Effect::setDepthStencilState(ID3D11DepthStencilState *_DepthStencilState)
+{
+	if (DepthStencilState)
+		DepthStencilState->Release();
+	DepthStencilState = _DepthStencilState;
+	pipelineState = nullptr;
+}
+
+void Effect::setBlendState(ID3D11BlendState *_BlendState)
+{
+	if (BlendState)
+		BlendState->Release();
+	BlendState = _BlendState;
+	pipelineState = nullptr;
+}
+
+const PipelineState *Effect::getPipelineState()
+{
+	if (!pipelineState && stateCache) {
+
+		PipelineState desc;
+		desc.inputLayout = VSInputLayout;
+		desc.vertexShader = VertexShader;
+		desc.hullShader = HullShader;
+		desc.domainShader = DomainShader;
+		desc.geometryShader = GeometryShader;
+		desc.pixelShader = PixelShader;
+		desc.rasterizerState = RasterizerState;
+		desc.depthStencilState = DepthStencilState;
+		desc.blendState = BlendState;
+		memcpy(desc.blendFactor, blendFactor, sizeof(blendFactor));
+		desc.sampleMask = sampleMask;
+
+		pipelineState = stateCache->getPipelineState(desc);
+	}
+
+	return pipelineState;
 }
 
 Effect::~Effect()
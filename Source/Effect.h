@@ -1,6 +1,11 @@
 #pragma once
 #include <Utils.h>
 
+class ShaderLibrary;
+struct ShaderVariant;
+class StateCache;
+struct PipelineState;
+
 class Effect
 {
 	// Pipeline Input Layout
@@ -19,19 +24,26 @@ class Effect
 	ID3D11BlendState						*BlendState = nullptr;
 	FLOAT			blendFactor[4];
 	UINT			sampleMask;
+
+	// Cache the states were created from (null if the effect was not given one) and the shared handle of the current pipeline
+	StateCache								*stateCache = nullptr;
+	const PipelineState						*pipelineState = nullptr;
 	
 public:
 	// Setup pipeline for this effect
-	void bindPipeline(ID3D11DeviceContext *context);
+	void bindPipeline(StateTrackingContext *context);
 	
-	// Initalise Default Pipeline States
-	void initDefaultStates(ID3D11Device *device);
+	// Initalise Default Pipeline States (shared with the other effects using stateCache)
+	void initDefaultStates(ID3D11Device *device, StateCache *_stateCache = nullptr);
 	
 	// Assign pre-loaded shaders
-	Effect(ID3D11Device *device, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11InputLayout *_VSInputLayout);
+	Effect(ID3D11Device *device, ID3D11VertexShader	*_VertexShader, ID3D11PixelShader *_PixelShader, ID3D11InputLayout *_VSInputLayout, StateCache *_stateCache = nullptr);
 	
-	//Load shaders given shader path
-	Effect(ID3D11Device *device, const char *vertexShaderPath, const char *pixelShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements);
+	//Load shaders given shader path.  Shaders and input layouts are shared with the other effects created from shaderLibrary and states with the other effects created from stateCache (a library / cache of its own is used if none is given).
+	Effect(ID3D11Device *device, const char *vertexShaderPath, const char *pixelShaderPath, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements, ShaderLibrary *shaderLibrary = nullptr, StateCache *_stateCache = nullptr);
+
+	// Load the compiled variants of permutation shader families (see ShaderPermutation.h) as above
+	Effect(ID3D11Device *device, const ShaderVariant& vertexShader, const ShaderVariant& pixelShader, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements, ShaderLibrary *shaderLibrary = nullptr, StateCache *_stateCache = nullptr);
 
 	// Getter and setter methods
 	ID3D11InputLayout		*getVSInputLayout(){ return VSInputLayout; };
@@ -41,14 +53,20 @@ public:
 	ID3D11RasterizerState	*getRasterizerState(){ return RasterizerState; };
 	ID3D11DepthStencilState	*getDepthStencilState(){ return DepthStencilState; };
 	ID3D11BlendState		*getBlendState(){ return BlendState; };
+	StateCache				*getStateCache(){ return stateCache; };
+
+	// Shared handle of the shaders and states the effect binds (null if the effect has no state cache)
+	const PipelineState		*getPipelineState();
+
+	void setPixelShader(ID3D11PixelShader	*_PixelShader){ PixelShader = _PixelShader; pipelineState = nullptr; };
+	void setGeometryShader(ID3D11GeometryShader	*_GeometryShader){ GeometryShader = _GeometryShader; pipelineState = nullptr; };
+	void setVertexShader(ID3D11VertexShader	*_VertexShader){ VertexShader = _VertexShader; pipelineState = nullptr; };
+	void setVSInputLayout(ID3D11InputLayout	*_VSInputLayout){ VSInputLayout = _VSInputLayout; pipelineState = nullptr; };
 
-	void setPixelShader(ID3D11PixelShader	*_PixelShader){ PixelShader = _PixelShader; };
-	void setGeometryShader(ID3D11GeometryShader	*_GeometryShader){ GeometryShader = _GeometryShader; };
-	void setVertexShader(ID3D11VertexShader	*_VertexShader){ VertexShader = _VertexShader; };
-	void setVSInputLayout(ID3D11InputLayout	*_VSInputLayout){ VSInputLayout = _VSInputLayout; };
-	void setRasterizerState(ID3D11RasterizerState	*_RasterizerState){ RasterizerState = _RasterizerState; };
-	void setDepthStencilState(ID3D11DepthStencilState	*_DepthStencilState){ DepthStencilState = _DepthStencilState; };
-	void setBlendState(ID3D11BlendState	*_BlendState){ BlendState = _BlendState; };
+	// The state setters take over the caller's reference (as returned by StateCache) and release the previous state
+	void setRasterizerState(ID3D11RasterizerState	*_RasterizerState);
+	void setDepthStencilState(ID3D11DepthStencilState	*_DepthStencilState);
+	void setBlendState(ID3D11BlendState	*_BlendState);
 
 	// Shader Creation Wrapper methods
 	uint32_t Effect::CreateVertexShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader);
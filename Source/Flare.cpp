@@ -2,15 +2,15 @@
 #include "Flare.h"
 
 
-HRESULT Flare::init(ID3D11Device *device, XMFLOAT3 position, XMCOLOR colour)
+HRESULT Flare::init(ID3D11Device *device, XMFLOAT3 position, XMCOLOR colour, XMFLOAT4 texRect)
 {
 
 	FlareVertexStruct vertices[] = {
 
-		{ position, XMFLOAT3(-1.0f, -1.0f, 0.0f), colour },
-		{ position, XMFLOAT3(-1.0f, 1.0f, 0.0f), colour },
-		{ position, XMFLOAT3(1.0f, -1.0f, 0.0f), colour },
-		{ position, XMFLOAT3(1.0f, 1.0f, 0.0f), colour }
+		{ position, XMFLOAT3(-1.0f, -1.0f, 0.0f), colour, texRect },
+		{ position, XMFLOAT3(-1.0f, 1.0f, 0.0f), colour, texRect },
+		{ position, XMFLOAT3(1.0f, -1.0f, 0.0f), colour, texRect },
+		{ position, XMFLOAT3(1.0f, 1.0f, 0.0f), colour, texRect }
 
 	};
 
@@ -40,7 +40,7 @@ Flare::~Flare()
 
 
 
-void Flare::render(ID3D11DeviceContext *context)
+void Flare::render(StateTrackingContext *context)
 {
 	// Validate object before rendering (see notes in constructor)
 	if (!context || !vertexBuffer || !effect)
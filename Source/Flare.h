@@ -25,11 +25,12 @@ protected:
 
 	//ID3D11SamplerState				*linearSampler = nullptr;
 public:
-	Flare(XMFLOAT3 position, XMCOLOR colour, ID3D11Device *device, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0) : BaseModel(device, _effect, _materials, _numMaterials, textures, numTextures){ init(device, position,colour); }
+	// texRect is the scale (xy) and offset (zw) of the flare's texture coordinates when textures is an atlas (see TextureAtlas.h).  Flares sharing an atlas bind the same texture.
+	Flare(XMFLOAT3 position, XMCOLOR colour, ID3D11Device *device, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0, XMFLOAT4 texRect = XMFLOAT4(1.0f, 1.0f, 0.0f, 0.0f)) : BaseModel(device, _effect, _materials, _numMaterials, textures, numTextures){ init(device, position, colour, texRect); }
 	//Flare(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *_flareTextureSRV,);
 	~Flare();
-	void render(ID3D11DeviceContext *context);
-	HRESULT init(ID3D11Device *device, XMFLOAT3 position, XMCOLOR colour);
+	void render(StateTrackingContext *context);
+	HRESULT init(ID3D11Device *device, XMFLOAT3 position, XMCOLOR colour, XMFLOAT4 texRect);
 	HRESULT init(ID3D11Device *device){ return S_OK; };
 //	void render(ID3D11DeviceContext *context, Camera *camera);
 	//void  update(ID3D11DeviceContext *context);
@@ -0,0 +1,225 @@
+
+#include "FrustumCulling.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#define CULLING_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+
+// Half size of the bounds of empty objects so they are never culled
+static const float unboundedExtent = 1e30f;
+
+
+void CullingBounds::resize(size_t _count) {
+
+	count = _count;
+	size_t padded = (count + 7) & ~(size_t)7;
+
+	for (vector<float> *array : { &centreX, &centreY, &centreZ, &extentX, &extentY, &extentZ, &sphereCentreX, &sphereCentreY, &sphereCentreZ, &radius })
+		array->assign(padded, 0.0f);
+}
+
+
+void CullingBounds::set(size_t i, const Bounds& bounds) {
+
+	if (bounds.isEmpty()) {
+
+		centreX[i] = centreY[i] = centreZ[i] = sphereCentreX[i] = sphereCentreY[i] = sphereCentreZ[i] = 0.0f;
+		extentX[i] = extentY[i] = extentZ[i] = radius[i] = unboundedExtent;
+		return;
+	}
+
+	centreX[i] = bounds.boxCentre[0];
+	centreY[i] = bounds.boxCentre[1];
+	centreZ[i] = bounds.boxCentre[2];
+	extentX[i] = bounds.boxExtents[0];
+	extentY[i] = bounds.boxExtents[1];
+	extentZ[i] = bounds.boxExtents[2];
+	sphereCentreX[i] = bounds.sphereCentre[0];
+	sphereCentreY[i] = bounds.sphereCentre[1];
+	sphereCentreZ[i] = bounds.sphereCentre[2];
+	radius[i] = bounds.sphereRadius;
+}
+
+
+void VisibilitySet::resize(size_t _count) {
+
+	count = _count;
+	words.assign((count + 63) / 64, 0);
+}
+
+
+size_t VisibilitySet::countVisible() const {
+
+	size_t visible = 0;
+
+	for (uint64_t word : words)
+		for (; word; word &= word - 1)
+			++visible;
+
+	return visible;
+}
+
+
+uint32_t getCullingWidth() {
+
+#if defined(CULLING_AVX)
+	return 8;
+#elif defined(CULLING_SSE)
+	return 4;
+#else
+	return 1;
+#endif
+}
+
+
+void normaliseFrustumPlanes(const float planes[6][4], float normalised[6][4]) {
+
+	for (int p = 0; p < 6; ++p) {
+
+		float length = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+		for (int i = 0; i < 4; ++i)
+			normalised[p][i] = planes[p][i] * scale;
+	}
+}
+
+
+// Clear the bits of the padding after the last object
+static void clearPadding(VisibilitySet& visibility) {
+
+	size_t count = visibility.size();
+
+	if (count & 63)
+		visibility.data()[count >> 6] &= (1ull << (count & 63)) - 1;
+}
+
+
+void cullBoundsScalar(const CullingBounds& bounds, const float planes[6][4], CullShape shape, VisibilitySet& visibility) {
+
+	float n[6][4];
+	normaliseFrustumPlanes(planes, n);
+	visibility.resize(bounds.size());
+
+	for (size_t i = 0; i < bounds.size(); ++i) {
+
+		bool visible = true;
+
+		for (int p = 0; p < 6; ++p) {
+
+			// Signed distance of the centre plus the largest distance of the shape from its centre along the plane normal
+			float distance, reach;
+
+			if (shape == CullBoxes) {
+
+				distance = ((n[p][0] * bounds.centreX[i] + n[p][1] * bounds.centreY[i]) + n[p][2] * bounds.centreZ[i]) + n[p][3];
+				reach = (fabsf(n[p][0]) * bounds.extentX[i] + fabsf(n[p][1]) * bounds.extentY[i]) + fabsf(n[p][2]) * bounds.extentZ[i];
+			}
+			else {
+
+				distance = ((n[p][0] * bounds.sphereCentreX[i] + n[p][1] * bounds.sphereCentreY[i]) + n[p][2] * bounds.sphereCentreZ[i]) + n[p][3];
+				reach = bounds.radius[i];
+			}
+
+			visible &= (distance + reach >= 0.0f);
+		}
+
+		if (visible)
+			visibility.data()[i >> 6] |= 1ull << (i & 63);
+	}
+}
+
+
+#if defined(CULLING_AVX)
+
+void cullBounds(const CullingBounds& bounds, const float planes[6][4], CullShape shape, VisibilitySet& visibility) {
+
+	float n[6][4];
+	normaliseFrustumPlanes(planes, n);
+	visibility.resize(bounds.size());
+
+	const float *x = shape == CullBoxes ? bounds.centreX.data() : bounds.sphereCentreX.data();
+	const float *y = shape == CullBoxes ? bounds.centreY.data() : bounds.sphereCentreY.data();
+	const float *z = shape == CullBoxes ? bounds.centreZ.data() : bounds.sphereCentreZ.data();
+	uint64_t *words = visibility.data();
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (size_t i = 0; i < bounds.size(); i += 8) {
+
+		__m256 cx = _mm256_loadu_ps(x + i), cy = _mm256_loadu_ps(y + i), cz = _mm256_loadu_ps(z + i);
+		__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+		for (int p = 0; p < 6; ++p) {
+
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(n[p][0]), cx), _mm256_mul_ps(_mm256_set1_ps(n[p][1]), cy)), _mm256_mul_ps(_mm256_set1_ps(n[p][2]), cz)), _mm256_set1_ps(n[p][3]));
+			__m256 reach;
+
+			if (shape == CullBoxes)
+				reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(fabsf(n[p][0])), _mm256_loadu_ps(&bounds.extentX[i])), _mm256_mul_ps(_mm256_set1_ps(fabsf(n[p][1])), _mm256_loadu_ps(&bounds.extentY[i]))), _mm256_mul_ps(_mm256_set1_ps(fabsf(n[p][2])), _mm256_loadu_ps(&bounds.extentZ[i])));
+			else
+				reach = _mm256_loadu_ps(&bounds.radius[i]);
+
+			visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+		}
+
+		words[i >> 6] |= (uint64_t)_mm256_movemask_ps(visible) << (i & 63);
+	}
+
+	clearPadding(visibility);
+}
+
+#elif defined(CULLING_SSE)
+
+void cullBounds(const CullingBounds& bounds, const float planes[6][4], CullShape shape, VisibilitySet& visibility) {
+
+	float n[6][4];
+	normaliseFrustumPlanes(planes, n);
+	visibility.resize(bounds.size());
+
+	const float *x = shape == CullBoxes ? bounds.centreX.data() : bounds.sphereCentreX.data();
+	const float *y = shape == CullBoxes ? bounds.centreY.data() : bounds.sphereCentreY.data();
+	const float *z = shape == CullBoxes ? bounds.centreZ.data() : bounds.sphereCentreZ.data();
+	uint64_t *words = visibility.data();
+	const __m128 zero = _mm_setzero_ps();
+
+	for (size_t i = 0; i < bounds.size(); i += 4) {
+
+		__m128 cx = _mm_loadu_ps(x + i), cy = _mm_loadu_ps(y + i), cz = _mm_loadu_ps(z + i);
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+		for (int p = 0; p < 6; ++p) {
+
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(n[p][0]), cx), _mm_mul_ps(_mm_set1_ps(n[p][1]), cy)), _mm_mul_ps(_mm_set1_ps(n[p][2]), cz)), _mm_set1_ps(n[p][3]));
+			__m128 reach;
+
+			if (shape == CullBoxes)
+				reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(n[p][0])), _mm_loadu_ps(&bounds.extentX[i])), _mm_mul_ps(_mm_set1_ps(fabsf(n[p][1])), _mm_loadu_ps(&bounds.extentY[i]))), _mm_mul_ps(_mm_set1_ps(fabsf(n[p][2])), _mm_loadu_ps(&bounds.extentZ[i])));
+			else
+				reach = _mm_loadu_ps(&bounds.radius[i]);
+
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+		}
+
+		words[i >> 6] |= (uint64_t)_mm_movemask_ps(visible) << (i & 63);
+	}
+
+	clearPadding(visibility);
+}
+
+#else
+
+void cullBounds(const CullingBounds& bounds, const float planes[6][4], CullShape shape, VisibilitySet& visibility) {
+
+	cullBoundsScalar(bounds, planes, shape, visibility);
+}
+
+#endif
@@ -0,0 +1,70 @@
+
+//
+// FrustumCulling.h
+//
+
+// View frustum culling of many objects at once.  World bounds are kept in structure of arrays form (one array per coordinate) so the boxes or spheres of 4 objects (SSE) or 8 objects (AVX, when the compiler targets it) are tested against each frustum plane with a handful of vector instructions.  The result is a visibility bitset with one bit per object.
+// Planes come from extractFrustumPlanes (see Meshlet.h) and are normalised before testing.  An object is culled only when its bounds lie entirely behind one plane, so culling is conservative.
+
+#pragma once
+#include <Bounds.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// World bounds of count objects.  The arrays are padded to a multiple of 8 (the padding is never reported visible).
+class CullingBounds {
+
+	size_t								count = 0;
+
+public:
+
+	std::vector<float>					centreX, centreY, centreZ; // Box
+	std::vector<float>					extentX, extentY, extentZ;
+	std::vector<float>					sphereCentreX, sphereCentreY, sphereCentreZ;
+	std::vector<float>					radius;
+
+	void resize(size_t _count);
+	size_t size() const { return count; };
+
+	// Empty bounds (geometry not created yet) are always visible
+	void set(size_t i, const Bounds& bounds);
+};
+
+
+// One bit per object, set if the object is visible
+class VisibilitySet {
+
+	std::vector<uint64_t>				words;
+	size_t								count = 0;
+
+public:
+
+	void resize(size_t _count);
+	size_t size() const { return count; };
+
+	bool isVisible(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; };
+	size_t countVisible() const;
+
+	uint64_t *data() { return words.data(); };
+	const std::vector<uint64_t>& getWords() const { return words; };
+};
+
+
+enum CullShape : uint32_t {
+	CullBoxes, // Axis aligned boxes (tighter)
+	CullSpheres
+};
+
+// Planes with unit normals so box extents and sphere radii are compared in world units.  Planes with no normal never cull.
+void normaliseFrustumPlanes(const float planes[6][4], float normalised[6][4]);
+
+// Vector width used by cullBounds (8 with AVX, 4 with SSE and 1 without either)
+uint32_t getCullingWidth();
+
+// Test every object against the frustum planes (see extractFrustumPlanes) and set visibility.  visibility is resized to the object count.
+void cullBounds(const CullingBounds& bounds, const float planes[6][4], CullShape shape, VisibilitySet& visibility);
+
+// Scalar reference of cullBounds with the same arithmetic, one object at a time
+void cullBoundsScalar(const CullingBounds& bounds, const float planes[6][4], CullShape shape, VisibilitySet& visibility);
@@ -1,6 +1,7 @@
 
 #include <stdafx.h>
 #include <Grid.h>
+#include <StateCache.h>
 #include <Material.h>
 using namespace std;
 //////using namespace DirectX;
@@ -61,6 +62,9 @@ HRESULT  Grid::init(ID3D11Device *device, UINT widthl, UINT heightl)//, Effect *
 		if (!SUCCEEDED(hr))
 			throw exception("Vertex buffer cannot be created");
 
+		// Flat grid - effects that displace the vertices (ocean waves) should inflate the bounds
+		setLocalBounds(computeBounds(&vertices[0].pos.x, width * height, sizeof(ExtendedVertexStruct)));
+
 
 		// Also creates sampler - from baseModel
 		D3D11_SAMPLER_DESC samplerDesc;
@@ -70,11 +74,16 @@ HRESULT  Grid::init(ID3D11Device *device, UINT widthl, UINT heightl)//, Effect *
 		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
 		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
 		samplerDesc.MinLOD = 0.0f;
-		samplerDesc.MaxLOD = 0.0f;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 		samplerDesc.MipLODBias = 0.0f;
 		samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 
-		device->CreateSamplerState(&samplerDesc, &cubeSampler);
+		StateCache *stateCache = effect ? effect->getStateCache() : nullptr;
+
+		if (stateCache)
+			cubeSampler = stateCache->getSamplerState(samplerDesc);
+		else
+			device->CreateSamplerState(&samplerDesc, &cubeSampler);
 
 
 
@@ -139,10 +148,12 @@ Grid::~Grid() {
 		vertexBuffer->Release();
 	if (indexBuffer)
 		indexBuffer->Release();
+	if (cubeSampler)
+		cubeSampler->Release();
 }
 
 
-void Grid::render(ID3D11DeviceContext *context) {
+void Grid::render(StateTrackingContext *context) {
 
 	context->PSSetConstantBuffers(0, 1, &cBufferModelGPU);
 	context->VSSetConstantBuffers(0, 1, &cBufferModelGPU);
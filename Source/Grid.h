@@ -25,7 +25,7 @@ public:
 	UINT getNumInd(){ return numInd; };
 	bool getVisible(){ return visible; };
 	void setVisible(bool _visible){ visible = _visible; };
-	void render(ID3D11DeviceContext *context);
+	void render(StateTrackingContext *context);
 	HRESULT init(ID3D11Device *device, UINT width, UINT  height);
 	HRESULT init(ID3D11Device *device){ return S_OK; };
 };
\ No newline at end of file
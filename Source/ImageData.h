@@ -0,0 +1,22 @@
+
+//
+// ImageData.h
+//
+
+// Platform independent CPU copy of a decoded texture image.  ImageData sits between the image importers and texture processing / cooking so they do not depend on Windows, WIC or Direct3D (see MeshData.h for the geometry equivalent).
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// 8 bit RGBA image, rows stored top to bottom with no padding (pitch = width * 4)
+struct ImageData {
+
+	uint32_t							width = 0;
+	uint32_t							height = 0;
+	std::vector<uint8_t>				pixels;
+
+	size_t getSizeBytes() const { return pixels.size(); };
+};
@@ -0,0 +1,488 @@
+
+#include "ImageImporter.h"
+#include "MappedFile.h"
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+#ifdef IMAGE_IMPORT_PNG
+#include <png.h>
+#endif
+
+#ifdef IMAGE_IMPORT_JPEG
+#include <cstdio>
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+using namespace std;
+
+
+static uint16_t readU16(const uint8_t *p, bool bigEndian) {
+
+	return bigEndian ? (uint16_t)((p[0] << 8) | p[1]) : (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t *p, bool bigEndian) {
+
+	return bigEndian ? ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3] : p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static string fileExtension(const string& filename) {
+
+	size_t dot = filename.find_last_of('.');
+	string ext = (dot == string::npos) ? string() : filename.substr(dot);
+
+	for (char& c : ext)
+		c = (char)tolower((unsigned char)c);
+
+	return ext;
+}
+
+// Shift and width of a contiguous channel mask
+static void maskShift(uint32_t mask, int& shift, int& bits) {
+
+	shift = 0;
+	bits = 0;
+
+	if (!mask)
+		return;
+
+	while (!(mask & 1)) {
+
+		mask >>= 1;
+		shift++;
+	}
+
+	while (mask & 1) {
+
+		mask >>= 1;
+		bits++;
+	}
+}
+
+
+//
+// BMP - BI_RGB 8 bit (palettised), 24 and 32 bit, BI_BITFIELDS 16 and 32 bit
+//
+
+static void importBMP(const uint8_t *data, size_t size, ImageData& image) {
+
+	if (size < 54 || data[0] != 'B' || data[1] != 'M')
+		throw runtime_error("Not a bmp file");
+
+	uint32_t pixelOffset = readU32(data + 10, false);
+	uint32_t headerSize = readU32(data + 14, false);
+
+	if (headerSize < 40)
+		throw runtime_error("Unsupported bmp header (OS/2 bitmap)");
+
+	int32_t width = (int32_t)readU32(data + 18, false);
+	int32_t height = (int32_t)readU32(data + 22, false);
+	uint16_t bitCount = readU16(data + 28, false);
+	uint32_t compression = readU32(data + 30, false);
+	uint32_t paletteSize = readU32(data + 46, false);
+
+	// Positive heights are stored bottom up
+	bool bottomUp = height > 0;
+	height = abs(height);
+
+	if (width <= 0 || height == 0 || width > 65536 || height > 65536)
+		throw runtime_error("Invalid bmp dimensions");
+
+	if (!(compression == 0 || (compression == 3 && (bitCount == 16 || bitCount == 32))))
+		throw runtime_error("Unsupported bmp compression");
+
+	if (bitCount != 8 && bitCount != 16 && bitCount != 24 && bitCount != 32)
+		throw runtime_error("Unsupported bmp bit depth");
+
+	// Channel masks - BI_BITFIELDS masks follow a 40 byte header or are part of a V4 / V5 header.  32 bit BI_RGB has no alpha (as WIC).
+	uint32_t masks[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0 };
+
+	if (compression == 3) {
+
+		if (size < 66)
+			throw runtime_error("Truncated bmp header");
+
+		masks[0] = readU32(data + 54, false);
+		masks[1] = readU32(data + 58, false);
+		masks[2] = readU32(data + 62, false);
+		masks[3] = (headerSize >= 56 && size >= 70) ? readU32(data + 66, false) : 0;
+	}
+	else if (bitCount == 16) {
+
+		// 5:5:5
+		masks[0] = 0x7c00;
+		masks[1] = 0x03e0;
+		masks[2] = 0x001f;
+	}
+
+	int shifts[4], bits[4];
+
+	for (int c = 0; c < 4; ++c)
+		maskShift(masks[c], shifts[c], bits[c]);
+
+	const uint8_t *palette = data + 14 + headerSize;
+
+	if (bitCount == 8) {
+
+		if (paletteSize == 0 || paletteSize > 256)
+			paletteSize = 256;
+
+		if ((size_t)(palette - data) + paletteSize * 4 > size)
+			throw runtime_error("Truncated bmp palette");
+	}
+
+	size_t rowBytes = (((size_t)width * bitCount + 31) / 32) * 4;
+
+	if (pixelOffset > size || (size - pixelOffset) / rowBytes < (size_t)height)
+		throw runtime_error("Truncated bmp pixel data");
+
+	image.width = (uint32_t)width;
+	image.height = (uint32_t)height;
+	image.pixels.resize((size_t)width * height * 4);
+
+	for (int32_t y = 0; y < height; ++y) {
+
+		const uint8_t *src = data + pixelOffset + rowBytes * (bottomUp ? height - 1 - y : y);
+		uint8_t *dst = &image.pixels[(size_t)y * width * 4];
+
+		for (int32_t x = 0; x < width; ++x, dst += 4) {
+
+			if (bitCount == 8) {
+
+				const uint8_t *entry = palette + 4 * min<uint32_t>(src[x], paletteSize - 1);
+				dst[0] = entry[2];
+				dst[1] = entry[1];
+				dst[2] = entry[0];
+				dst[3] = 255;
+			}
+			else if (bitCount == 24) {
+
+				dst[0] = src[3 * x + 2];
+				dst[1] = src[3 * x + 1];
+				dst[2] = src[3 * x];
+				dst[3] = 255;
+			}
+			else {
+
+				uint32_t value = (bitCount == 16) ? readU16(src + 2 * x, false) : readU32(src + 4 * x, false);
+
+				for (int c = 0; c < 4; ++c) {
+
+					if (!bits[c]) {
+
+						dst[c] = 255;
+						continue;
+					}
+
+					uint32_t channel = (value & masks[c]) >> shifts[c];
+					uint32_t maxValue = (1u << bits[c]) - 1;
+					dst[c] = (uint8_t)((channel * 255 + maxValue / 2) / maxValue);
+				}
+			}
+		}
+	}
+}
+
+
+//
+// TIFF - baseline uncompressed, 8 bits per sample, chunky (interleaved) strips
+//
+
+static void importTIFF(const uint8_t *data, size_t size, ImageData& image) {
+
+	if (size < 8 || !((data[0] == 'I' && data[1] == 'I') || (data[0] == 'M' && data[1] == 'M')))
+		throw runtime_error("Not a tif file");
+
+	bool bigEndian = data[0] == 'M';
+
+	if (readU16(data + 2, bigEndian) != 42)
+		throw runtime_error("Not a tif file");
+
+	uint32_t ifdOffset = readU32(data + 4, bigEndian);
+
+	if (ifdOffset + 2 > size)
+		throw runtime_error("Truncated tif directory");
+
+	uint16_t numEntries = readU16(data + ifdOffset, bigEndian);
+
+	if (ifdOffset + 2 + (size_t)numEntries * 12 > size)
+		throw runtime_error("Truncated tif directory");
+
+	uint32_t width = 0, height = 0, compression = 1, photometric = 2, samplesPerPixel = 1, planarConfig = 1, extraSamples = 0;
+	uint32_t rowsPerStrip = 0xffffffff;
+	vector<uint32_t> bitsPerSample, stripOffsets;
+
+	for (uint16_t i = 0; i < numEntries; ++i) {
+
+		const uint8_t *entry = data + ifdOffset + 2 + i * 12;
+
+		uint16_t tag = readU16(entry, bigEndian);
+		uint16_t type = readU16(entry + 2, bigEndian);
+		uint32_t count = readU32(entry + 4, bigEndian);
+
+		// SHORT or LONG values - stored in the entry if they fit in 4 bytes, otherwise at an offset
+		if (type != 3 && type != 4)
+			continue;
+
+		size_t valueSize = (type == 3) ? 2 : 4;
+		const uint8_t *values = entry + 8;
+
+		if (count * valueSize > 4) {
+
+			uint32_t offset = readU32(entry + 8, bigEndian);
+
+			if (count > size || offset + count * valueSize > size)
+				throw runtime_error("Truncated tif tag");
+
+			values = data + offset;
+		}
+
+		vector<uint32_t> v(count);
+
+		for (uint32_t j = 0; j < count; ++j)
+			v[j] = (type == 3) ? readU16(values + j * 2, bigEndian) : readU32(values + j * 4, bigEndian);
+
+		if (v.empty())
+			continue;
+
+		switch (tag) {
+
+		case 256: width = v[0]; break;
+		case 257: height = v[0]; break;
+		case 258: bitsPerSample = v; break;
+		case 259: compression = v[0]; break;
+		case 262: photometric = v[0]; break;
+		case 273: stripOffsets = v; break;
+		case 277: samplesPerPixel = v[0]; break;
+		case 278: rowsPerStrip = v[0]; break;
+		case 284: planarConfig = v[0]; break;
+		case 338: extraSamples = v[0]; break;
+		}
+	}
+
+	if (width == 0 || height == 0 || width > 65536 || height > 65536)
+		throw runtime_error("Invalid tif dimensions");
+
+	if (compression != 1)
+		throw runtime_error("Unsupported tif compression (only uncompressed tif files are supported)");
+
+	if (planarConfig != 1 || samplesPerPixel < 1 || samplesPerPixel > 4 || photometric > 2)
+		throw runtime_error("Unsupported tif layout");
+
+	for (uint32_t bits : bitsPerSample)
+		if (bits != 8)
+			throw runtime_error("Unsupported tif bit depth");
+
+	if (stripOffsets.empty())
+		throw runtime_error("Missing tif strip offsets");
+
+	rowsPerStrip = (rowsPerStrip == 0) ? height : min(rowsPerStrip, height);
+
+	size_t rowBytes = (size_t)width * samplesPerPixel;
+	bool grey = photometric < 2;
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize((size_t)width * height * 4);
+
+	for (uint32_t y = 0; y < height; ++y) {
+
+		uint32_t strip = y / rowsPerStrip;
+
+		if (strip >= stripOffsets.size())
+			throw runtime_error("Missing tif strip");
+
+		size_t offset = stripOffsets[strip] + (size_t)(y % rowsPerStrip) * rowBytes;
+
+		if (offset + rowBytes > size)
+			throw runtime_error("Truncated tif pixel data");
+
+		const uint8_t *src = data + offset;
+		uint8_t *dst = &image.pixels[(size_t)y * width * 4];
+
+		for (uint32_t x = 0; x < width; ++x, src += samplesPerPixel, dst += 4) {
+
+			if (grey) {
+
+				uint8_t value = (photometric == 0) ? 255 - src[0] : src[0];
+				dst[0] = dst[1] = dst[2] = value;
+				dst[3] = (samplesPerPixel > 1) ? src[1] : 255;
+			}
+			else {
+
+				dst[0] = src[0];
+				dst[1] = (samplesPerPixel > 1) ? src[1] : 0;
+				dst[2] = (samplesPerPixel > 2) ? src[2] : 0;
+				dst[3] = (samplesPerPixel > 3) ? src[3] : 255;
+			}
+
+			// Associated (premultiplied) alpha is converted to straight alpha as WIC does
+			if (extraSamples == 1 && dst[3] > 0 && dst[3] < 255)
+				for (int c = 0; c < 3; ++c)
+					dst[c] = (uint8_t)min(255, (dst[c] * 255 + dst[3] / 2) / dst[3]);
+		}
+	}
+}
+
+
+#ifdef IMAGE_IMPORT_PNG
+
+static void importPNG(const string& filename, ImageData& image) {
+
+	png_image png;
+	memset(&png, 0, sizeof(png_image));
+	png.version = PNG_IMAGE_VERSION;
+
+	if (!png_image_begin_read_from_file(&png, filename.c_str()))
+		throw runtime_error(string("Cannot read png file ") + filename + " (" + png.message + ")");
+
+	png.format = PNG_FORMAT_RGBA;
+
+	image.width = png.width;
+	image.height = png.height;
+	image.pixels.resize(PNG_IMAGE_SIZE(png));
+
+	if (!png_image_finish_read(&png, nullptr, image.pixels.data(), 0, nullptr)) {
+
+		string message = png.message;
+		png_image_free(&png);
+		throw runtime_error(string("Cannot decode png file ") + filename + " (" + message + ")");
+	}
+}
+
+#endif
+
+
+#ifdef IMAGE_IMPORT_JPEG
+
+// libjpeg reports errors through a callback that must not return - jump back to decodeJPEG
+struct JPEGError {
+	jpeg_error_mgr						manager;
+	jmp_buf								jump;
+	char								message[JMSG_LENGTH_MAX];
+};
+
+static void jpegErrorExit(j_common_ptr cinfo) {
+
+	JPEGError *error = reinterpret_cast<JPEGError*>(cinfo->err);
+	(*cinfo->err->format_message)(cinfo, error->message);
+	longjmp(error->jump, 1);
+}
+
+// No objects with destructors may be created between setjmp and the end of the function
+static bool decodeJPEG(const uint8_t *data, size_t size, ImageData& image, JPEGError& error) {
+
+	jpeg_decompress_struct cinfo;
+	cinfo.err = jpeg_std_error(&error.manager);
+	error.manager.error_exit = jpegErrorExit;
+
+	if (setjmp(error.jump)) {
+
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), (unsigned long)size);
+	jpeg_read_header(&cinfo, TRUE);
+
+	// Grey images are expanded below, everything else is converted to RGB by libjpeg
+	if (cinfo.num_components != 1)
+		cinfo.out_color_space = JCS_RGB;
+
+	jpeg_start_decompress(&cinfo);
+
+	image.width = cinfo.output_width;
+	image.height = cinfo.output_height;
+	image.pixels.resize((size_t)image.width * image.height * 4);
+
+	int components = cinfo.output_components;
+
+	while (cinfo.output_scanline < cinfo.output_height) {
+
+		// Decode the row into the end of its RGBA destination then expand in place (front to back never overwrites source bytes that have not been read)
+		uint8_t *dst = &image.pixels[(size_t)cinfo.output_scanline * image.width * 4];
+		uint8_t *row = dst + (size_t)image.width * (4 - components);
+		JSAMPROW rows[] = { row };
+
+		jpeg_read_scanlines(&cinfo, rows, 1);
+
+		for (uint32_t x = 0; x < image.width; ++x, dst += 4) {
+
+			const uint8_t *src = row + x * components;
+			uint8_t r = src[0], g = (components == 3) ? src[1] : src[0], b = (components == 3) ? src[2] : src[0];
+			dst[0] = r;
+			dst[1] = g;
+			dst[2] = b;
+			dst[3] = 255;
+		}
+	}
+
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+
+	return true;
+}
+
+static void importJPEG(const uint8_t *data, size_t size, ImageData& image) {
+
+	JPEGError error;
+
+	if (!decodeJPEG(data, size, image, error))
+		throw runtime_error(string("Cannot decode jpg file (") + error.message + ")");
+}
+
+#endif
+
+
+bool canImportImage(const string& ext) {
+
+	if (ext == ".bmp" || ext == ".tif" || ext == ".tiff")
+		return true;
+
+#ifdef IMAGE_IMPORT_PNG
+	if (ext == ".png")
+		return true;
+#endif
+
+#ifdef IMAGE_IMPORT_JPEG
+	if (ext == ".jpg" || ext == ".jpeg")
+		return true;
+#endif
+
+	return false;
+}
+
+
+void importImage(const string& filename, ImageData& image) {
+
+	string ext = fileExtension(filename);
+
+	if (!canImportImage(ext))
+		throw runtime_error(string("Image format not supported in this build: ") + filename);
+
+#ifdef IMAGE_IMPORT_PNG
+	if (ext == ".png") {
+
+		importPNG(filename, image);
+		return;
+	}
+#endif
+
+	MappedFile file(filename);
+
+	if (!file.isValid())
+		throw runtime_error(string("Cannot open image file ") + filename);
+
+	if (ext == ".bmp")
+		importBMP(file.getData(), file.getSize(), image);
+	else if (ext == ".tif" || ext == ".tiff")
+		importTIFF(file.getData(), file.getSize(), image);
+#ifdef IMAGE_IMPORT_JPEG
+	else
+		importJPEG(file.getData(), file.getSize(), image);
+#endif
+}
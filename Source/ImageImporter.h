@@ -0,0 +1,17 @@
+
+//
+// ImageImporter.h
+//
+
+// Platform independent image decoding for offline texture processing.  Uncompressed bmp (8, 24 and 32 bit) and baseline tif (uncompressed 8 bit grey, RGB and RGBA strips) files are decoded natively.  png and jpg files are decoded with libpng / libjpeg when the build defines IMAGE_IMPORT_PNG / IMAGE_IMPORT_JPEG (see CMakeLists.txt) - the Windows application decodes every format with WIC instead.
+
+#pragma once
+#include <ImageData.h>
+#include <string>
+
+
+// Return true if importImage can decode files with the given (lower case) extension in this build, for example ".png"
+bool canImportImage(const std::string& ext);
+
+// Decode filename into image as RGBA8.  Images without alpha receive alpha = 255.  Throws std::runtime_error if the file cannot be read, is malformed or uses an unsupported format.
+void importImage(const std::string& filename, ImageData& image);
@@ -0,0 +1,1037 @@
+
+#include "Importer3DS.h"
+#include "MappedFile.h"
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+
+// Chunk identifiers
+enum Chunk3DSId : uint16_t {
+
+	ChunkMain = 0x4D4D,
+	ChunkEditor = 0x3D3D,
+	ChunkMasterScale = 0x0100,
+	ChunkMaterial = 0xAFFF,
+	ChunkMaterialName = 0xA000,
+	ChunkObject = 0x4000,
+	ChunkTriMesh = 0x4100,
+	ChunkVertexList = 0x4110,
+	ChunkFaceList = 0x4120,
+	ChunkFaceMaterial = 0x4130,
+	ChunkTexCoordList = 0x4140,
+	ChunkSmoothGroups = 0x4150,
+	ChunkMeshMatrix = 0x4160,
+	ChunkKeyframer = 0xB000,
+	ChunkNodeAmbient = 0xB001,
+	ChunkNodeObject = 0xB002,
+	ChunkNodeSpotlight = 0xB007,
+	ChunkNodeHeader = 0xB010,
+	ChunkNodePivot = 0xB013,
+	ChunkTrackPosition = 0xB020,
+	ChunkTrackRotation = 0xB021,
+	ChunkTrackScale = 0xB022,
+	ChunkNodeId = 0xB030
+};
+
+static const uint32_t defaultMaterial = 0xffffffff;
+static const uint32_t emptySlot = 0xffffffff;
+
+
+// Affine transform p' = m * p (column vectors, m[row][3] is the translation)
+struct Transform3DS {
+	float								m[3][4];
+};
+
+static const Transform3DS identityTransform = { { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } } };
+
+
+// Faces of one face list chunk
+struct FaceList3DS {
+	const uint8_t						*faces = nullptr; // a, b, c, flags (uint16)
+	uint32_t							numFaces = 0;
+	const uint8_t						*smoothGroups = nullptr; // uint32 mask per face
+	struct MaterialList { const char *name; const uint8_t *faces; uint32_t numFaces; };
+	vector<MaterialList>				materialLists;
+};
+
+// Triangle mesh object.  Lists reference the mapped file.
+struct Mesh3DS {
+	const char							*name = "";
+	const uint8_t						*positions = nullptr; // float3
+	uint32_t							numPositions = 0;
+	const uint8_t						*texCoords = nullptr; // float2
+	uint32_t							numTexCoords = 0;
+	vector<FaceList3DS>					faceLists;
+	Transform3DS						matrix = identityTransform;
+};
+
+// Keyframer node - the first key of each track defines the node transform relative to its parent
+struct Node3DS {
+	const char							*name = "";
+	int32_t								id = -1;
+	int32_t								parentId = -1;
+	bool								isObject = false;
+	float								pivot[3] = { 0.0f, 0.0f, 0.0f };
+	float								position[3] = { 0.0f, 0.0f, 0.0f };
+	float								rotationAngle = 0.0f;
+	float								rotationAxis[3] = { 0.0f, 1.0f, 0.0f };
+	float								scale[3] = { 1.0f, 1.0f, 1.0f };
+	bool								hasRotation = false;
+	bool								hasScale = false;
+	int									transformState = 0; // 0 = not computed, 1 = in progress, 2 = done
+	Transform3DS						absTransform;
+};
+
+// Everything read by the chunk walk
+struct Scene3DS {
+	float								masterScale = 1.0f;
+	vector<const char*>					materials;
+	vector<Mesh3DS>						meshes;
+	vector<Node3DS>						nodes;
+};
+
+
+static inline uint16_t readU16(const uint8_t *p) { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+static inline uint32_t readU32(const uint8_t *p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+static inline float readF32(const uint8_t *p) { float v; memcpy(&v, p, sizeof(v)); return v; }
+
+
+struct Chunk3DS {
+	uint16_t							id;
+	const uint8_t						*data;
+	const uint8_t						*end;
+};
+
+// Read the chunk at p and advance p past it.  Returns false at the end of the parent chunk.
+static bool nextChunk(const uint8_t *&p, const uint8_t *end, Chunk3DS& chunk) {
+
+	if (end - p < 6)
+		return false;
+
+	uint32_t length = readU32(p + 2);
+
+	if (length < 6 || length > (size_t)(end - p))
+		throw runtime_error("3DS chunk overflow");
+
+	chunk = { readU16(p), p + 6, p + length };
+	p += length;
+
+	return true;
+}
+
+// Return the null terminated string at p and advance p past it
+static const char *readString(const uint8_t *&p, const uint8_t *end) {
+
+	const uint8_t *terminator = (const uint8_t*)memchr(p, 0, end - p);
+
+	if (!terminator)
+		throw runtime_error("Unterminated 3DS string");
+
+	const char *s = (const char*)p;
+	p = terminator + 1;
+
+	return s;
+}
+
+// Validate that count elements of elementSize bytes follow p
+static void checkSize(const uint8_t *p, const uint8_t *end, size_t count, size_t elementSize) {
+
+	if ((size_t)(end - p) < count * elementSize)
+		throw runtime_error("Truncated 3DS list");
+}
+
+
+// Read the value of the earliest key of a position, rotation or scale track (numValues floats)
+static bool readFirstKey(const uint8_t *p, const uint8_t *end, int numValues, float *value) {
+
+	// Track flags and two unused values precede the key count
+	checkSize(p, end, 14, 1);
+
+	uint32_t numKeys = readU32(p + 10);
+	p += 14;
+
+	bool found = false;
+	uint32_t firstFrame = 0;
+
+	for (uint32_t k = 0; k < numKeys; ++k) {
+
+		checkSize(p, end, 6, 1);
+
+		uint32_t frame = readU32(p);
+		uint16_t splineFlags = readU16(p + 4);
+		p += 6;
+
+		// Tension, continuity, bias, ease to and ease from are present if the corresponding flag is set
+		for (int bit = 0; bit < 5; ++bit)
+			if (splineFlags & (1 << bit))
+				p += 4;
+
+		checkSize(p, end, numValues, sizeof(float));
+
+		if (!found || frame < firstFrame) {
+
+			for (int i = 0; i < numValues; ++i)
+				value[i] = readF32(p + i * sizeof(float));
+
+			firstFrame = frame;
+			found = true;
+		}
+
+		p += numValues * sizeof(float);
+	}
+
+	return found;
+}
+
+
+static void parseFaceList(const uint8_t *p, const uint8_t *end, Mesh3DS& mesh) {
+
+	FaceList3DS faceList;
+
+	checkSize(p, end, 1, sizeof(uint16_t));
+
+	faceList.numFaces = readU16(p);
+	p += sizeof(uint16_t);
+
+	checkSize(p, end, faceList.numFaces, 4 * sizeof(uint16_t));
+
+	faceList.faces = p;
+	p += faceList.numFaces * 4 * sizeof(uint16_t);
+
+	Chunk3DS chunk;
+
+	while (nextChunk(p, end, chunk)) {
+
+		const uint8_t *q = chunk.data;
+
+		if (chunk.id == ChunkSmoothGroups) {
+
+			checkSize(q, chunk.end, faceList.numFaces, sizeof(uint32_t));
+			faceList.smoothGroups = q;
+		}
+		else if (chunk.id == ChunkFaceMaterial) {
+
+			FaceList3DS::MaterialList list;
+
+			list.name = readString(q, chunk.end);
+			checkSize(q, chunk.end, 1, sizeof(uint16_t));
+			list.numFaces = readU16(q);
+			q += sizeof(uint16_t);
+			checkSize(q, chunk.end, list.numFaces, sizeof(uint16_t));
+			list.faces = q;
+
+			faceList.materialLists.push_back(list);
+		}
+	}
+
+	mesh.faceLists.push_back(move(faceList));
+}
+
+static void parseTriMesh(const uint8_t *p, const uint8_t *end, Mesh3DS& mesh) {
+
+	Chunk3DS chunk;
+
+	while (nextChunk(p, end, chunk)) {
+
+		const uint8_t *q = chunk.data;
+
+		switch (chunk.id) {
+
+		case ChunkVertexList:
+			checkSize(q, chunk.end, 1, sizeof(uint16_t));
+			mesh.numPositions = readU16(q);
+			checkSize(q + 2, chunk.end, mesh.numPositions, 3 * sizeof(float));
+			mesh.positions = q + 2;
+			break;
+
+		case ChunkTexCoordList:
+			checkSize(q, chunk.end, 1, sizeof(uint16_t));
+			mesh.numTexCoords = readU16(q);
+			checkSize(q + 2, chunk.end, mesh.numTexCoords, 2 * sizeof(float));
+			mesh.texCoords = q + 2;
+			break;
+
+		case ChunkFaceList:
+			parseFaceList(q, chunk.end, mesh);
+			break;
+
+		case ChunkMeshMatrix:
+			// Stored as x axis, y axis, z axis and origin
+			checkSize(q, chunk.end, 12, sizeof(float));
+			for (int column = 0; column < 4; ++column)
+				for (int row = 0; row < 3; ++row)
+					mesh.matrix.m[row][column] = readF32(q + (column * 3 + row) * sizeof(float));
+			break;
+		}
+	}
+}
+
+static void parseEditor(const uint8_t *p, const uint8_t *end, Scene3DS& scene) {
+
+	Chunk3DS chunk;
+
+	while (nextChunk(p, end, chunk)) {
+
+		const uint8_t *q = chunk.data;
+
+		if (chunk.id == ChunkMasterScale) {
+
+			checkSize(q, chunk.end, 1, sizeof(float));
+			scene.masterScale = readF32(q);
+		}
+		else if (chunk.id == ChunkMaterial) {
+
+			Chunk3DS materialChunk;
+			const char *name = "";
+
+			while (nextChunk(q, chunk.end, materialChunk)) {
+
+				if (materialChunk.id == ChunkMaterialName) {
+
+					const uint8_t *s = materialChunk.data;
+					name = readString(s, materialChunk.end);
+				}
+			}
+
+			scene.materials.push_back(name);
+		}
+		else if (chunk.id == ChunkObject) {
+
+			const char *name = readString(q, chunk.end);
+			Chunk3DS objectChunk;
+
+			// Cameras and lights are ignored
+			while (nextChunk(q, chunk.end, objectChunk)) {
+
+				if (objectChunk.id == ChunkTriMesh) {
+
+					scene.meshes.emplace_back();
+					scene.meshes.back().name = name;
+					parseTriMesh(objectChunk.data, objectChunk.end, scene.meshes.back());
+				}
+			}
+		}
+	}
+}
+
+static void parseNode(const uint8_t *p, const uint8_t *end, Node3DS& node) {
+
+	Chunk3DS chunk;
+
+	while (nextChunk(p, end, chunk)) {
+
+		const uint8_t *q = chunk.data;
+
+		switch (chunk.id) {
+
+		case ChunkNodeId:
+			checkSize(q, chunk.end, 1, sizeof(uint16_t));
+			node.id = (int16_t)readU16(q);
+			break;
+
+		case ChunkNodeHeader:
+			node.name = readString(q, chunk.end);
+			// Two flag words then the parent id (-1 for top level nodes)
+			checkSize(q, chunk.end, 3, sizeof(uint16_t));
+			node.parentId = (int16_t)readU16(q + 4);
+			break;
+
+		case ChunkNodePivot:
+			checkSize(q, chunk.end, 3, sizeof(float));
+			for (int i = 0; i < 3; ++i)
+				node.pivot[i] = readF32(q + i * sizeof(float));
+			break;
+
+		case ChunkTrackPosition:
+			readFirstKey(q, chunk.end, 3, node.position);
+			break;
+
+		case ChunkTrackRotation: {
+
+			// Angle (radians) and axis
+			float key[4];
+
+			if (readFirstKey(q, chunk.end, 4, key)) {
+
+				node.rotationAngle = key[0];
+				node.rotationAxis[0] = key[1];
+				node.rotationAxis[1] = key[2];
+				node.rotationAxis[2] = key[3];
+				node.hasRotation = true;
+			}
+			break;
+		}
+
+		case ChunkTrackScale:
+			if (readFirstKey(q, chunk.end, 3, node.scale)) {
+
+				// Zero scale on an axis is treated as 1 (some exporters write zero scale keys)
+				for (int i = 0; i < 3; ++i)
+					if (node.scale[i] == 0.0f)
+						node.scale[i] = 1.0f;
+
+				node.hasScale = true;
+			}
+			break;
+		}
+	}
+}
+
+static void parseKeyframer(const uint8_t *p, const uint8_t *end, Scene3DS& scene) {
+
+	Chunk3DS chunk;
+
+	while (nextChunk(p, end, chunk)) {
+
+		// Camera, target and light nodes take part in the hierarchy but only object nodes reference meshes
+		if (chunk.id < ChunkNodeAmbient || chunk.id > ChunkNodeSpotlight)
+			continue;
+
+		Node3DS node;
+
+		node.id = (int32_t)scene.nodes.size();
+		node.isObject = (chunk.id == ChunkNodeObject);
+
+		parseNode(chunk.data, chunk.end, node);
+
+		scene.nodes.push_back(node);
+	}
+}
+
+
+static Transform3DS multiply(const Transform3DS& a, const Transform3DS& b) {
+
+	Transform3DS r;
+
+	for (int row = 0; row < 3; ++row) {
+
+		for (int column = 0; column < 4; ++column) {
+
+			r.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column] + a.m[row][2] * b.m[2][column];
+
+			if (column == 3)
+				r.m[row][3] += a.m[row][3];
+		}
+	}
+
+	return r;
+}
+
+static float determinant(const Transform3DS& t) {
+
+	const float (*m)[4] = t.m;
+
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+// Inverse of the 3x3 part, transposed (normal matrix).  A singular matrix returns identity.
+static void inverseTranspose(const Transform3DS& t, float result[3][3]) {
+
+	const float (*m)[4] = t.m;
+	float det = determinant(t);
+
+	if (det == 0.0f) {
+
+		for (int row = 0; row < 3; ++row)
+			for (int column = 0; column < 3; ++column)
+				result[row][column] = (row == column) ? 1.0f : 0.0f;
+
+		return;
+	}
+
+	// Cofactor matrix divided by the determinant
+	for (int row = 0; row < 3; ++row) {
+
+		int r0 = (row + 1) % 3, r1 = (row + 2) % 3;
+
+		for (int column = 0; column < 3; ++column) {
+
+			int c0 = (column + 1) % 3, c1 = (column + 2) % 3;
+			result[row][column] = (m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0]) / det;
+		}
+	}
+}
+
+static Transform3DS inverse(const Transform3DS& t) {
+
+	float it[3][3];
+	inverseTranspose(t, it);
+
+	Transform3DS r;
+
+	for (int row = 0; row < 3; ++row) {
+
+		for (int column = 0; column < 3; ++column)
+			r.m[row][column] = it[column][row];
+
+		r.m[row][3] = -(r.m[row][0] * t.m[0][3] + r.m[row][1] * t.m[1][3] + r.m[row][2] * t.m[2][3]);
+	}
+
+	return r;
+}
+
+// Node transform relative to its parent - translation * rotation * scale
+static Transform3DS nodeTransform(const Node3DS& node) {
+
+	Transform3DS t = identityTransform;
+
+	if (node.hasRotation) {
+
+		float axis[3] = { node.rotationAxis[0], node.rotationAxis[1], node.rotationAxis[2] };
+		float len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+		if (len == 0.0f) {
+
+			axis[0] = axis[2] = 0.0f;
+			axis[1] = len = 1.0f;
+		}
+
+		// 3DS rotation keys rotate clockwise about the axis
+		float s = sinf(-node.rotationAngle * 0.5f) / len;
+		float w = cosf(-node.rotationAngle * 0.5f);
+		float x = axis[0] * s, y = axis[1] * s, z = axis[2] * s;
+
+		float r[3][3] = {
+			{ 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - z * w), 2.0f * (x * z + y * w) },
+			{ 2.0f * (x * y + z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - x * w) },
+			{ 2.0f * (x * z - y * w), 2.0f * (y * z + x * w), 1.0f - 2.0f * (x * x + y * y) } };
+
+		for (int row = 0; row < 3; ++row)
+			for (int column = 0; column < 3; ++column)
+				t.m[row][column] = r[row][column];
+	}
+
+	if (node.hasScale)
+		for (int row = 0; row < 3; ++row)
+			for (int column = 0; column < 3; ++column)
+				t.m[row][column] *= node.scale[column];
+
+	for (int row = 0; row < 3; ++row)
+		t.m[row][3] = node.position[row];
+
+	return t;
+}
+
+// Absolute transform of node - rootTransform * parent transforms * node transform
+static const Transform3DS& absoluteTransform(vector<Node3DS>& nodes, size_t index, const Transform3DS& rootTransform) {
+
+	Node3DS& node = nodes[index];
+
+	if (node.transformState == 2)
+		return node.absTransform;
+
+	// Cycles in the parent links are broken by treating the node as top level
+	const Transform3DS *parentTransform = &rootTransform;
+
+	if (node.transformState == 0 && node.parentId >= 0) {
+
+		node.transformState = 1;
+
+		for (size_t p = 0; p < nodes.size(); ++p) {
+
+			if (p != index && nodes[p].id == node.parentId && nodes[p].transformState != 1) {
+
+				parentTransform = &absoluteTransform(nodes, p, rootTransform);
+				break;
+			}
+		}
+	}
+
+	node.absTransform = multiply(*parentTransform, nodeTransform(node));
+	node.transformState = 2;
+
+	return node.absTransform;
+}
+
+
+// Welds identical vertices of one material as they are emitted.  Open addressing hash table kept at a load factor <= 0.5.
+struct VertexWelder3DS {
+
+	vector<MeshVertex>					vertices;
+	vector<uint32_t>					indices;
+	vector<uint32_t>					table;
+
+	static uint32_t hashVertex(const MeshVertex& v) {
+
+		uint32_t words[8];
+		memcpy(words, &v, sizeof(words));
+
+		uint32_t h = 0x811c9dc5u;
+
+		for (uint32_t w : words)
+			h = (h ^ w) * 0x01000193u;
+
+		return h ^ (h >> 15);
+	}
+
+	void insert(uint32_t v) {
+
+		uint32_t mask = (uint32_t)table.size() - 1;
+		uint32_t slot = hashVertex(vertices[v]) & mask;
+
+		while (table[slot] != emptySlot)
+			slot = (slot + 1) & mask;
+
+		table[slot] = v;
+	}
+
+	void add(const MeshVertex& vertex) {
+
+		if ((vertices.size() + 1) * 2 > table.size()) {
+
+			table.assign(max(table.size() * 2, (size_t)256), emptySlot);
+
+			for (uint32_t v = 0; v < (uint32_t)vertices.size(); ++v)
+				insert(v);
+		}
+
+		uint32_t mask = (uint32_t)table.size() - 1;
+		uint32_t slot = hashVertex(vertex) & mask;
+
+		while (table[slot] != emptySlot) {
+
+			if (memcmp(&vertices[table[slot]], &vertex, sizeof(MeshVertex)) == 0) {
+
+				indices.push_back(table[slot]);
+				return;
+			}
+
+			slot = (slot + 1) & mask;
+		}
+
+		table[slot] = (uint32_t)vertices.size();
+		indices.push_back((uint32_t)vertices.size());
+		vertices.push_back(vertex);
+	}
+
+	size_t getSizeBytes() const {
+
+		return vertices.capacity() * sizeof(MeshVertex) + (indices.capacity() + table.capacity()) * sizeof(uint32_t);
+	}
+};
+
+
+// Working memory of the emit step
+struct Scratch3DS {
+	vector<uint32_t>					faceMaterials;
+	vector<float>						faceNormals;
+	vector<float>						cornerNormals;
+	vector<uint32_t>					smoothGroups;
+	vector<uint32_t>					positionGroups;
+	vector<uint32_t>					groupVertex;
+	vector<uint32_t>					groupStart;
+	vector<uint32_t>					groupCorners;
+	vector<uint32_t>					hashTable;
+
+	size_t getSizeBytes() const {
+
+		return (faceMaterials.capacity() + smoothGroups.capacity() + positionGroups.capacity() + groupVertex.capacity() + groupStart.capacity() + groupCorners.capacity() + hashTable.capacity()) * sizeof(uint32_t) + (faceNormals.capacity() + cornerNormals.capacity()) * sizeof(float);
+	}
+};
+
+// Vertex index of corner k of face f (indices beyond the vertex list are clamped as Assimp does)
+static inline uint32_t faceVertex(const Mesh3DS& mesh, const uint8_t *faces, uint32_t f, int k) {
+
+	return min((uint32_t)readU16(faces + (f * 4 + k) * sizeof(uint16_t)), mesh.numPositions - 1);
+}
+
+static inline void readPosition(const Mesh3DS& mesh, uint32_t v, float p[3]) {
+
+	memcpy(p, mesh.positions + v * 3 * sizeof(float), 3 * sizeof(float));
+}
+
+// Compute per corner normals (in the space of the vertex list) from face normals and smoothing groups.  Corners at the same position share the sum of the face normals of every corner whose smoothing groups overlap their own.  Smoothing group 0 smooths with every corner at the position.
+static void computeCornerNormals(const Mesh3DS& mesh, Scratch3DS& scratch) {
+
+	// Group vertices with identical positions
+	uint32_t tableSize = 1;
+
+	while (tableSize < mesh.numPositions * 2)
+		tableSize <<= 1;
+
+	scratch.hashTable.assign(tableSize, emptySlot);
+	scratch.positionGroups.resize(mesh.numPositions);
+
+	uint32_t numGroups = 0;
+	vector<uint32_t>& groupVertex = scratch.groupVertex;
+
+	groupVertex.clear();
+
+	for (uint32_t v = 0; v < mesh.numPositions; ++v) {
+
+		const uint8_t *p = mesh.positions + v * 3 * sizeof(float);
+		uint32_t h = 0x811c9dc5u;
+
+		for (int i = 0; i < 3; ++i)
+			h = (h ^ readU32(p + i * sizeof(float))) * 0x01000193u;
+
+		uint32_t slot = (h ^ (h >> 15)) & (tableSize - 1);
+
+		while (true) {
+
+			uint32_t g = scratch.hashTable[slot];
+
+			if (g == emptySlot) {
+
+				scratch.hashTable[slot] = numGroups;
+				scratch.positionGroups[v] = numGroups++;
+				groupVertex.push_back(v);
+				break;
+			}
+
+			if (memcmp(p, mesh.positions + groupVertex[g] * 3 * sizeof(float), 3 * sizeof(float)) == 0) {
+
+				scratch.positionGroups[v] = g;
+				break;
+			}
+
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+
+	// Face normals (unnormalised so larger faces contribute more) and corners per position group
+	uint32_t numFaces = 0;
+
+	for (const FaceList3DS& list : mesh.faceLists)
+		numFaces += list.numFaces;
+
+	scratch.faceNormals.resize(numFaces * 3);
+	scratch.groupStart.assign(numGroups + 1, 0);
+	scratch.groupCorners.resize(numFaces * 3);
+
+	uint32_t face = 0;
+
+	for (const FaceList3DS& list : mesh.faceLists) {
+
+		for (uint32_t f = 0; f < list.numFaces; ++f, ++face) {
+
+			float p[3][3];
+
+			for (int k = 0; k < 3; ++k) {
+
+				uint32_t v = faceVertex(mesh, list.faces, f, k);
+
+				readPosition(mesh, v, p[k]);
+				scratch.groupStart[scratch.positionGroups[v] + 1]++;
+			}
+
+			float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+			float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+			float *n = &scratch.faceNormals[face * 3];
+
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		}
+	}
+
+	for (uint32_t g = 0; g < numGroups; ++g)
+		scratch.groupStart[g + 1] += scratch.groupStart[g];
+
+	// Reuse the hash table as the fill position of each group
+	scratch.hashTable.assign(scratch.groupStart.begin(), scratch.groupStart.end() - 1);
+
+	vector<uint32_t>& smoothGroups = scratch.smoothGroups;
+
+	smoothGroups.assign(numFaces, 0);
+
+	face = 0;
+
+	for (const FaceList3DS& list : mesh.faceLists) {
+
+		for (uint32_t f = 0; f < list.numFaces; ++f, ++face) {
+
+			if (list.smoothGroups)
+				smoothGroups[face] = readU32(list.smoothGroups + f * sizeof(uint32_t));
+
+			for (int k = 0; k < 3; ++k)
+				scratch.groupCorners[scratch.hashTable[scratch.positionGroups[faceVertex(mesh, list.faces, f, k)]]++] = face * 3 + k;
+		}
+	}
+
+	// Sum compatible face normals for each corner
+	scratch.cornerNormals.resize(numFaces * 9);
+
+	face = 0;
+
+	for (const FaceList3DS& list : mesh.faceLists) {
+
+		for (uint32_t f = 0; f < list.numFaces; ++f, ++face) {
+
+			uint32_t sg = smoothGroups[face];
+
+			for (int k = 0; k < 3; ++k) {
+
+				uint32_t g = scratch.positionGroups[faceVertex(mesh, list.faces, f, k)];
+				float sum[3] = { 0.0f, 0.0f, 0.0f };
+
+				for (uint32_t i = scratch.groupStart[g]; i < scratch.groupStart[g + 1]; ++i) {
+
+					uint32_t otherFace = scratch.groupCorners[i] / 3;
+					uint32_t otherSg = smoothGroups[otherFace];
+
+					if (sg == 0 || otherSg == 0 || (sg & otherSg) || otherFace == face) {
+
+						sum[0] += scratch.faceNormals[otherFace * 3];
+						sum[1] += scratch.faceNormals[otherFace * 3 + 1];
+						sum[2] += scratch.faceNormals[otherFace * 3 + 2];
+					}
+				}
+
+				memcpy(&scratch.cornerNormals[(face * 3 + k) * 3], sum, sizeof(sum));
+			}
+		}
+	}
+}
+
+// Emit the triangles of mesh into the welder of each material.  positionTransform maps the vertex list to the output space and normalTransform is its normal matrix.
+static void emitMesh(const Mesh3DS& mesh, const vector<const char*>& materials, const Transform3DS& positionTransform, const float normalTransform[3][3], vector<VertexWelder3DS>& welders, Scratch3DS& scratch) {
+
+	if (mesh.numPositions == 0)
+		return;
+
+	computeCornerNormals(mesh, scratch);
+
+	// Material of each face - faces without a material use the default material (the last welder)
+	uint32_t numFaces = (uint32_t)(scratch.faceNormals.size() / 3);
+	uint32_t faceBase = 0;
+
+	scratch.faceMaterials.assign(numFaces, defaultMaterial);
+
+	for (const FaceList3DS& list : mesh.faceLists) {
+
+		for (const FaceList3DS::MaterialList& materialList : list.materialLists) {
+
+			uint32_t material = defaultMaterial;
+
+			for (uint32_t m = 0; m < (uint32_t)materials.size(); ++m) {
+
+				if (strcmp(materials[m], materialList.name) == 0) {
+
+					material = m;
+					break;
+				}
+			}
+
+			for (uint32_t i = 0; i < materialList.numFaces; ++i) {
+
+				uint32_t f = readU16(materialList.faces + i * sizeof(uint16_t));
+
+				if (f < list.numFaces)
+					scratch.faceMaterials[faceBase + f] = material;
+			}
+		}
+
+		faceBase += list.numFaces;
+	}
+
+	const float (*t)[4] = positionTransform.m;
+	uint32_t face = 0;
+
+	for (const FaceList3DS& list : mesh.faceLists) {
+
+		for (uint32_t f = 0; f < list.numFaces; ++f, ++face) {
+
+			uint32_t material = scratch.faceMaterials[face];
+			VertexWelder3DS& welder = welders[(material == defaultMaterial) ? welders.size() - 1 : material];
+
+			for (int k = 0; k < 3; ++k) {
+
+				uint32_t v = faceVertex(mesh, list.faces, f, k);
+				float p[3];
+				const float *n = &scratch.cornerNormals[(face * 3 + k) * 3];
+				MeshVertex vertex;
+
+				readPosition(mesh, v, p);
+
+				for (int row = 0; row < 3; ++row) {
+
+					vertex.pos[row] = t[row][0] * p[0] + t[row][1] * p[1] + t[row][2] * p[2] + t[row][3];
+					vertex.normal[row] = normalTransform[row][0] * n[0] + normalTransform[row][1] * n[1] + normalTransform[row][2] * n[2];
+				}
+
+				float len = sqrtf(vertex.normal[0] * vertex.normal[0] + vertex.normal[1] * vertex.normal[1] + vertex.normal[2] * vertex.normal[2]);
+
+				for (int row = 0; row < 3; ++row)
+					vertex.normal[row] = (len > 0.0f) ? vertex.normal[row] / len : 0.0f;
+
+				if (v < mesh.numTexCoords) {
+
+					vertex.texCoord[0] = readF32(mesh.texCoords + v * 2 * sizeof(float));
+					vertex.texCoord[1] = 1.0f - readF32(mesh.texCoords + (v * 2 + 1) * sizeof(float));
+				}
+				else {
+
+					vertex.texCoord[0] = 0.0f;
+					vertex.texCoord[1] = 1.0f;
+				}
+
+				welder.add(vertex);
+			}
+		}
+	}
+}
+
+
+void import3DS(const string& filename, MeshData& mesh, Import3DSStats *stats) {
+
+	auto startTime = chrono::high_resolution_clock::now();
+
+	MappedFile file(filename);
+
+	if (!file.isValid())
+		throw runtime_error("Cannot open 3DS file " + filename);
+
+	// Walk the chunk tree
+	Scene3DS scene;
+
+	const uint8_t *p = file.getData();
+	const uint8_t *end = p + file.getSize();
+	Chunk3DS chunk;
+
+	if (!nextChunk(p, end, chunk) || chunk.id != ChunkMain)
+		throw runtime_error("Not a 3DS file " + filename);
+
+	p = chunk.data;
+	end = chunk.end;
+
+	while (nextChunk(p, end, chunk)) {
+
+		if (chunk.id == ChunkEditor)
+			parseEditor(chunk.data, chunk.end, scene);
+		else if (chunk.id == ChunkKeyframer)
+			parseKeyframer(chunk.data, chunk.end, scene);
+	}
+
+	// Root transform - z up to y up and the master scale.  As with the Assimp import path the inverse of the master scale is applied.
+	float rootScale = (scene.masterScale != 0.0f) ? 1.0f / scene.masterScale : 1.0f;
+
+	Transform3DS rootTransform = { { { rootScale, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, rootScale, 0.0f }, { 0.0f, -rootScale, 0.0f, 0.0f } } };
+
+	// One welder per material plus the default material
+	vector<VertexWelder3DS> welders(scene.materials.size() + 1);
+	Scratch3DS scratch;
+	size_t peakBytes = 0;
+
+	auto updatePeak = [&]() {
+
+		size_t bytes = scratch.getSizeBytes();
+
+		for (const VertexWelder3DS& welder : welders)
+			bytes += welder.getSizeBytes();
+
+		peakBytes = max(peakBytes, bytes);
+	};
+
+	if (scene.nodes.empty()) {
+
+		// Without a keyframer the vertex lists are already in world space
+		float normalTransform[3][3];
+		inverseTranspose(rootTransform, normalTransform);
+
+		for (const Mesh3DS& m : scene.meshes) {
+
+			emitMesh(m, scene.materials, rootTransform, normalTransform, welders, scratch);
+			updatePeak();
+		}
+	}
+	else {
+
+		// Each object node instances the mesh with the same name.  Vertex lists are stored in world space so are moved back to the local space of the mesh matrix (mirrored if the matrix has a negative determinant) and offset by the node pivot before the node transform is applied.
+		for (size_t n = 0; n < scene.nodes.size(); ++n) {
+
+			const Node3DS& node = scene.nodes[n];
+
+			if (!node.isObject)
+				continue;
+
+			for (const Mesh3DS& m : scene.meshes) {
+
+				if (strcmp(m.name, node.name) != 0)
+					continue;
+
+				Transform3DS local = inverse(m.matrix);
+
+				if (determinant(m.matrix) < 0.0f)
+					for (int column = 0; column < 4; ++column)
+						local.m[0][column] = -local.m[0][column];
+
+				for (int row = 0; row < 3; ++row)
+					local.m[row][3] -= node.pivot[row];
+
+				Transform3DS positionTransform = multiply(absoluteTransform(scene.nodes, n, rootTransform), local);
+
+				// Normals are in the space of the vertex list so use the full transform
+				float normalTransform[3][3];
+				inverseTranspose(positionTransform, normalTransform);
+
+				emitMesh(m, scene.materials, positionTransform, normalTransform, welders, scratch);
+				updatePeak();
+			}
+		}
+	}
+
+	scratch = Scratch3DS();
+
+	// Concatenate the welded vertices of each material - one SubMesh per material
+	size_t numVertices = 0, numIndices = 0;
+
+	for (const VertexWelder3DS& welder : welders) {
+
+		numVertices += welder.vertices.size();
+		numIndices += welder.indices.size();
+	}
+
+	if (numIndices == 0)
+		throw runtime_error("No faces in 3DS file " + filename);
+
+	mesh.vertices.resize(numVertices);
+	mesh.indices.resize(numIndices);
+	mesh.lods.resize(1);
+	mesh.lods[0].error = 0.0f;
+	mesh.lods[0].subMeshes.clear();
+
+	uint32_t baseVertex = 0, firstIndex = 0;
+
+	for (VertexWelder3DS& welder : welders) {
+
+		if (welder.indices.empty())
+			continue;
+
+		vector<uint32_t>().swap(welder.table);
+
+		copy(welder.vertices.begin(), welder.vertices.end(), mesh.vertices.begin() + baseVertex);
+		copy(welder.indices.begin(), welder.indices.end(), mesh.indices.begin() + firstIndex);
+
+		mesh.lods[0].subMeshes.push_back({ baseVertex, (uint32_t)welder.vertices.size(), firstIndex, (uint32_t)welder.indices.size() });
+
+		baseVertex += (uint32_t)welder.vertices.size();
+		firstIndex += (uint32_t)welder.indices.size();
+	}
+
+	// Welded lists and the output exist together while concatenating
+	size_t concatenateBytes = mesh.getSizeBytes();
+
+	for (const VertexWelder3DS& welder : welders)
+		concatenateBytes += welder.getSizeBytes();
+
+	peakBytes = max(peakBytes, concatenateBytes);
+
+	auto endTime = chrono::high_resolution_clock::now();
+
+	if (stats) {
+
+		stats->numObjects = (uint32_t)scene.meshes.size();
+		stats->numNodes = (uint32_t)scene.nodes.size();
+		stats->numTriangles = (uint32_t)(numIndices / 3);
+		stats->numVertices = (uint32_t)numVertices;
+		stats->peakBytes = peakBytes;
+		stats->seconds = chrono::duration<double>(endTime - startTime).count();
+	}
+}
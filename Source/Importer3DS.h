@@ -0,0 +1,26 @@
+
+//
+// Importer3DS.h
+//
+
+// Native Autodesk 3DS importer.  The chunk tree of a memory mapped file (see MappedFile.h) is walked once - vertex, uv, face and smoothing group lists are referenced in place rather than copied and keyframer node transforms are read from the first key of each track.  Triangles are then emitted straight into MeshData (one SubMesh per material) with the node transform applied and identical vertices welded.  The result matches the Assimp import path (PreTransformVertices | JoinIdenticalVertices) including smoothing group normals, the z-up to y-up root rotation and Assimp's treatment of the master scale so existing scene transforms are unchanged.
+
+#pragma once
+#include <MeshData.h>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+// Timing and size statistics for one import
+struct Import3DSStats {
+	uint32_t							numObjects; // Triangle mesh objects in the file
+	uint32_t							numNodes; // Keyframer nodes
+	uint32_t							numTriangles;
+	uint32_t							numVertices; // Unique vertices after welding
+	size_t								peakBytes; // Peak working memory excluding the mapped file
+	double								seconds;
+};
+
+// Import the 3DS file filename into mesh as a single full detail LOD with one SubMesh per material.  Texture coordinates are stored as (u, 1 - v).  Throws std::runtime_error if the file cannot be read or is malformed.
+void import3DS(const std::string& filename, MeshData& mesh, Import3DSStats *stats = nullptr);
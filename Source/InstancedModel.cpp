@@ -0,0 +1,217 @@
+
+#include "stdafx.h"
+#include <InstancedModel.h>
+#include <Effect.h>
+#include <Meshlet.h>
+#include <iostream>
+#include <cfloat>
+#include <exception>
+
+using namespace std;
+using namespace DirectX;
+
+
+InstancedModel::~InstancedModel() {
+
+	if (instanceBuffer)
+		instanceBuffer->Release();
+}
+
+
+void InstancedModel::setInstances(ID3D11Device *device, const XMMATRIX *worldMatrices, uint32_t count) {
+
+	instances.resize(count);
+
+	for (uint32_t i = 0; i < count; ++i)
+		setInstanceMatrix(i, worldMatrices[i]);
+
+	if (count <= instanceCapacity)
+		return;
+
+	if (instanceBuffer)
+		instanceBuffer->Release();
+
+	instanceBuffer = nullptr;
+	instanceCapacity = 0;
+
+	// Rewritten with the visible instances every frame
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+	bufferDesc.ByteWidth = sizeof(InstanceStruct) * count;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	HRESULT hr = device->CreateBuffer(&bufferDesc, nullptr, &instanceBuffer);
+
+	if (!SUCCEEDED(hr)) {
+
+		cout << "Cannot create instance buffer" << endl;
+		throw exception("Cannot create instance buffer");
+	}
+
+	instanceCapacity = count;
+}
+
+
+void InstancedModel::setInstanceMatrix(uint32_t instance, FXMMATRIX worldMatrix) {
+
+	XMVECTOR det = XMMatrixDeterminant(worldMatrix);
+	XMStoreFloat4x4(&instances[instance].worldMatrix, worldMatrix);
+	XMStoreFloat4x4(&instances[instance].worldITMatrix, XMMatrixInverse(&det, XMMatrixTranspose(worldMatrix)));
+	boundsDirty = true;
+}
+
+
+void InstancedModel::updateBounds() {
+
+	const Bounds& meshBounds = mesh->getBounds();
+	Bounds allBounds = emptyBounds();
+
+	instanceBounds.resize(instances.size());
+	cullingBounds.resize(instances.size());
+
+	for (size_t i = 0; i < instances.size(); ++i) {
+
+		instanceBounds[i] = transformBounds(meshBounds, &instances[i].worldMatrix.m[0][0]);
+		cullingBounds.set(i, instanceBounds[i]);
+		allBounds = mergeBounds(allBounds, instanceBounds[i]);
+	}
+
+	// The Model's world matrix stays the identity so its world bounds are the bounds of every instance
+	setLocalBounds(allBounds);
+	boundsMesh = mesh;
+	boundsDirty = false;
+}
+
+
+void InstancedModel::updateInstances(StateTrackingContext *context, Camera *camera, float viewportHeight) {
+
+	numVisible = 0;
+	lodCounts.clear();
+
+	if (!context || !camera || !mesh || !instanceBuffer || instances.empty())
+		return;
+
+	// Streamed geometry replaces the placeholder mesh (and its bounds)
+	if (boundsDirty || mesh != boundsMesh)
+		updateBounds();
+
+	XMMATRIX viewMatrix = camera->getViewMatrix();
+	XMMATRIX projMatrix = camera->getProjMatrix();
+
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, viewMatrix * projMatrix);
+
+	float planes[6][4];
+	extractFrustumPlanes(&viewProj.m[0][0], planes);
+	cullBounds(cullingBounds, planes, CullBoxes, visibility);
+
+	// Level of detail of each visible instance, then count the instances of each LOD so they are uploaded grouped by LOD
+	lodCounts.assign(mesh->getNumLODs(), 0);
+	instanceLODs.resize(instances.size());
+
+	for (uint32_t i = 0; i < instances.size(); ++i)
+		if (visibility.isVisible(i)) {
+
+			instanceLODs[i] = mesh->selectLOD(XMLoadFloat4x4(&instances[i].worldMatrix), viewMatrix, projMatrix, viewportHeight);
+			lodCounts[instanceLODs[i]]++;
+			numVisible++;
+		}
+
+	if (numVisible == 0)
+		return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+
+	if (!SUCCEEDED(context->Map(instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+
+		numVisible = 0;
+		return;
+	}
+
+	vector<uint32_t> lodStart(lodCounts.size(), 0);
+
+	for (size_t lod = 1; lod < lodCounts.size(); ++lod)
+		lodStart[lod] = lodStart[lod - 1] + lodCounts[lod - 1];
+
+	InstanceStruct *target = (InstanceStruct*)mapped.pData;
+
+	for (uint32_t i = 0; i < instances.size(); ++i)
+		if (visibility.isVisible(i))
+			target[lodStart[instanceLODs[i]]++] = instances[i];
+
+	context->Unmap(instanceBuffer, 0);
+}
+
+
+uint32_t InstancedModel::getNumDraws() {
+
+	uint32_t draws = 0;
+
+	for (uint32_t count : lodCounts)
+		if (count)
+			draws += mesh->getNumMeshes();
+
+	return draws;
+}
+
+
+const Bounds& InstancedModel::getStreamingBounds(FXMVECTOR cameraPos) {
+
+	if (instanceBounds.empty())
+		return getWorldBounds();
+
+	XMFLOAT3 pos;
+	XMStoreFloat3(&pos, cameraPos);
+
+	size_t nearest = 0;
+	float nearestDistance = FLT_MAX;
+
+	for (size_t i = 0; i < instanceBounds.size(); ++i) {
+
+		const float *centre = instanceBounds[i].sphereCentre;
+		float dx = centre[0] - pos.x, dy = centre[1] - pos.y, dz = centre[2] - pos.z;
+		float distance = sqrtf(dx * dx + dy * dy + dz * dz) - instanceBounds[i].sphereRadius;
+
+		if (distance < nearestDistance) {
+
+			nearest = i;
+			nearestDistance = distance;
+		}
+	}
+
+	return instanceBounds[nearest];
+}
+
+
+void InstancedModel::render(StateTrackingContext *context) {
+
+	if (!context || !mesh || !effect || numVisible == 0)
+		return;
+
+	effect->bindPipeline(context);
+
+	if (cBufferDirty) {
+
+		update(context);
+		cBufferDirty = false;
+	}
+
+	if (numTextures>0 && sampler) {
+
+		context->PSSetShaderResources(0, numTextures, textures);
+		context->PSSetSamplers(0, 1, &sampler);
+	}
+	context->VSSetConstantBuffers(0, 1, &cBufferModelGPU);
+	context->PSSetConstantBuffers(0, 1, &cBufferModelGPU);
+
+	// One instanced draw per LOD (and sub-mesh) over the instances uploaded for it
+	UINT startInstance = 0;
+
+	for (size_t lod = 0; lod < lodCounts.size(); ++lod) {
+
+		mesh->renderInstanced(context, (int)lod, instanceBuffer, sizeof(InstanceStruct), lodCounts[lod], startInstance);
+		startInstance += lodCounts[lod];
+	}
+}
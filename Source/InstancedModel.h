@@ -0,0 +1,57 @@
+
+//
+// InstancedModel.h
+//
+
+// Many copies of one Model mesh drawn with hardware instancing.  Each instance has its own world matrix and the instances share the mesh, effect, materials and textures of the Model.  Every frame updateInstances culls the instances against the view frustum (see FrustumCulling), chooses the level of detail of each visible instance and uploads the visible instances grouped by LOD to the instance buffer with a single Map, so render issues one DrawIndexedInstanced per LOD (and sub-mesh) however many instances there are.
+// The effect must use an INSTANCED vertex shader variant (see ShaderPermutation.h) created with instancedQuantisedVertexDesc - the world matrices come from the instance buffer and the model cbuffer only supplies the dequantisation constants and material.  The world bounds of the InstancedModel contain every instance (its own world matrix is the identity).
+
+#pragma once
+#include <Model.h>
+#include <FrustumCulling.h>
+#include <vector>
+#include <cstdint>
+
+class InstancedModel : public Model {
+
+	// World matrices of every instance
+	std::vector<InstanceStruct>			instances;
+	ID3D11Buffer						*instanceBuffer = nullptr; // Holds every instance
+	UINT								instanceCapacity = 0;
+
+	// World bounds of each instance (recalculated when the instances or the mesh change)
+	std::vector<Bounds>					instanceBounds;
+	CullingBounds						cullingBounds;
+	VisibilitySet						visibility;
+	const MeshAsset						*boundsMesh = nullptr;
+	bool								boundsDirty = false;
+
+	// Visible instances drawn at each LOD in the last updateInstances (uploaded in LOD order)
+	std::vector<uint32_t>				lodCounts;
+	std::vector<uint32_t>				instanceLODs;
+	uint32_t							numVisible = 0;
+
+	void updateBounds();
+
+public:
+
+	InstancedModel(ID3D11Device *device, const std::wstring& filename, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0, MeshCache *cache = nullptr) : Model(device, filename, _effect, _materials, _numMaterials, textures, numTextures, cache) {};
+	InstancedModel(ID3D11Device *device, AssetStreamer *_streamer, const std::wstring& filename, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0) : Model(device, _streamer, filename, _effect, _materials, _numMaterials, textures, numTextures) {};
+	~InstancedModel();
+
+	// Replace the instances and create an instance buffer that holds all of them
+	void setInstances(ID3D11Device *device, const DirectX::XMMATRIX *worldMatrices, uint32_t count);
+	void setInstanceMatrix(uint32_t instance, DirectX::FXMMATRIX worldMatrix);
+	uint32_t getNumInstances() { return (uint32_t)instances.size(); };
+
+	// Cull the instances against the camera's view frustum, choose the LOD of each visible instance and upload them to the instance buffer.  Call each frame before render.
+	void updateInstances(StateTrackingContext *context, Camera *camera, float viewportHeight);
+
+	// Instances and draws of the last updateInstances
+	uint32_t getNumVisible() { return numVisible; };
+	uint32_t getNumDraws();
+
+	const Bounds& getStreamingBounds(DirectX::FXMVECTOR cameraPos);
+
+	void render(StateTrackingContext *context);
+};
@@ -0,0 +1,116 @@
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) {
+
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+
+		close();
+		return;
+	}
+
+	mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (!mappingHandle) {
+
+		close();
+		return;
+	}
+
+	data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	size = data ? (size_t)fileSize.QuadPart : 0;
+
+	if (!data)
+		close();
+}
+
+void MappedFile::close() {
+
+	if (data)
+		UnmapViewOfFile(data);
+
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle)
+		CloseHandle(fileHandle);
+
+	data = nullptr;
+	size = 0;
+	mappingHandle = fileHandle = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) {
+
+	fd = open(filename.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		return;
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+
+		close();
+		return;
+	}
+
+	void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (p == MAP_FAILED) {
+
+		close();
+		return;
+	}
+
+	madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	data = (const uint8_t*)p;
+	size = (size_t)st.st_size;
+}
+
+void MappedFile::close() {
+
+	if (data)
+		munmap((void*)data, size);
+
+	if (fd >= 0)
+		::close(fd);
+
+	data = nullptr;
+	size = 0;
+	fd = -1;
+}
+
+#endif
+
+
+MappedFile::~MappedFile() {
+
+	close();
+}
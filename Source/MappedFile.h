@@ -0,0 +1,40 @@
+
+//
+// MappedFile.h
+//
+
+// Read-only memory mapped file.  The whole file is mapped on construction and unmapped when the MappedFile is destroyed so pointers into the file are only valid for the lifetime of the MappedFile.  Uses file mapping objects on Windows and mmap elsewhere.
+
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+
+class MappedFile {
+
+	const uint8_t						*data = nullptr;
+	size_t								size = 0;
+
+#ifdef _WIN32
+	void								*fileHandle = nullptr;
+	void								*mappingHandle = nullptr;
+#else
+	int									fd = -1;
+#endif
+
+	void close();
+
+public:
+
+	// Map filename.  Check isValid() - an empty or missing file is not mapped.
+	MappedFile(const std::string& filename);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool isValid() const { return data != nullptr; };
+	const uint8_t *getData() const { return data; };
+	size_t getSize() const { return size; };
+};
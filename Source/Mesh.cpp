@@ -25,7 +25,7 @@ Mesh::Mesh(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *_tex
 	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
 	samplerDesc.MaxAnisotropy = 16;
 	samplerDesc.MinLOD = 0.0f;
-	samplerDesc.MaxLOD = 0.0f;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
 	samplerDesc.MipLODBias = 0.0f;
 	samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
 
@@ -38,7 +38,7 @@ Mesh::~Mesh()
 }
 
 
-void Mesh::render(ID3D11DeviceContext *context) {
+void Mesh::render(StateTrackingContext *context) {
 
 	effect->bindPipeline(context);
 
@@ -5,6 +5,7 @@
 class Texture;
 class Material;
 class Effect;
+class StateTrackingContext;
 
 class Mesh
 {
@@ -22,7 +23,7 @@ protected:
 
 public:
 	Mesh(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_view, Material *_material);
-	void render(ID3D11DeviceContext *context);
+	void render(StateTrackingContext *context);
 	~Mesh();
 };
 
@@ -0,0 +1,546 @@
+
+#include "stdafx.h"
+#include "MeshAsset.h"
+#include <VertexStructures.h>
+#include <MeshSimplifier.h>
+#include <ObjImporter.h>
+#include <Importer3DS.h>
+#include <CookedMesh.h>
+#include <MipResidency.h>
+#include <StateTrackingContext.h>
+#include <iostream>
+#include <cwctype>
+#include <exception>
+
+#include <Assimp\include\assimp\Importer.hpp>      // C++ importer interface
+#include <Assimp\include\assimp\scene.h>           // Output data structure
+#include <Assimp\include\assimp\postprocess.h>     // Post processing flags
+
+//using namespace std;
+using namespace DirectX;
+//using namespace DirectX::PackedVector;
+
+const unsigned int MeshAsset::defaultImportFlags = aiProcess_PreTransformVertices | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace |
+	aiProcess_Triangulate |
+	aiProcess_JoinIdenticalVertices |
+	aiProcess_SortByPType;
+
+
+// Convert the vertices of an imported mesh to MeshVertex in a single linear pass.  Each vertex is converted once regardless of how many faces share it.  flip is multiplied into positions and normals to change handedness (OBJ & GSF files).
+static void convertMeshVertices(const aiMesh *mesh, MeshVertex *vptr, FXMVECTOR flip) {
+
+	const aiVector3D *positions = mesh->mVertices;
+	const aiVector3D *normals = mesh->HasNormals() ? mesh->mNormals : nullptr;
+	const aiVector3D *uvs = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0] : nullptr;
+
+	// v' = 1 - v
+	const XMVECTOR uvScale = XMVectorSet(1.0f, -1.0f, 0.0f, 0.0f);
+	const XMVECTOR uvBias = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	const XMVECTOR defaultNormal = XMVectorMultiply(XMVectorSplatOne(), flip);
+
+	for (uint32_t v = 0; v < mesh->mNumVertices; ++v) {
+
+		// aiVector3D and the MeshVertex members are packed floats so can be loaded / stored directly as XMFLOAT3 / XMFLOAT2
+		XMVECTOR pos = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&positions[v]));
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(vptr[v].pos), XMVectorMultiply(pos, flip));
+
+		XMVECTOR normal = normals ? XMVectorMultiply(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&normals[v])), flip) : defaultNormal;
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(vptr[v].normal), normal);
+
+		XMVECTOR uv = uvs ? XMLoadFloat2(reinterpret_cast<const XMFLOAT2*>(&uvs[v])) : XMVectorZero();
+		XMStoreFloat2(reinterpret_cast<XMFLOAT2*>(vptr[v].texCoord), XMVectorMultiplyAdd(uv, uvScale, uvBias));
+	}
+}
+
+// Copy the (triangulated) face indices of an imported mesh.  Indices are relative to the mesh - the base vertex offset is applied by DrawIndexed.
+static void copyMeshIndices(const aiMesh *mesh, uint32_t *indexPtr) {
+
+	for (uint32_t j = 0; j < mesh->mNumFaces; ++j, indexPtr += 3)
+		memcpy(indexPtr, mesh->mFaces[j].mIndices, 3 * sizeof(uint32_t));
+}
+
+
+MeshAsset::MeshAsset(ID3D11Device *device, const std::wstring& filename, unsigned int importFlags) {
+
+	DecodedMesh decoded;
+
+	if (SUCCEEDED(decode(filename, importFlags, decoded)))
+		upload(device, filename, decoded);
+	else
+		cout << "MeshAsset could not be instantiated due to:\nCannot import model" << endl;
+}
+
+MeshAsset::MeshAsset(ID3D11Device *device, const std::wstring& name, const DecodedMesh& decoded) {
+
+	upload(device, name, decoded);
+}
+
+
+HRESULT MeshAsset::decode(const std::wstring& filename, unsigned int importFlags, DecodedMesh& decoded) {
+
+	// Cooked meshes are already simplified and quantised
+	if (filename.length() >= 5 && 0 == _wcsicmp(filename.c_str() + filename.length() - 5, L".mesh")) {
+
+		HRESULT hr = loadModelCooked(filename, decoded);
+
+		if (SUCCEEDED(hr))
+			computeBounds(decoded);
+
+		return hr;
+	}
+
+	// OBJ and 3DS files are parsed by the native importers, all other formats are imported via Assimp
+	wstring ext = (filename.length() >= 4) ? filename.substr(filename.length() - 4) : wstring();
+
+	for (wchar_t& c : ext)
+		c = towlower(c);
+
+	HRESULT hr;
+
+	if (0 == ext.compare(L".obj"))
+		hr = loadModelOBJ(filename, decoded.meshData);
+	else if (0 == ext.compare(L".3ds"))
+		hr = loadModel3DS(filename, decoded.meshData);
+	else
+		hr = loadModelAssimp(filename, importFlags, decoded.meshData);
+
+	if (!SUCCEEDED(hr))
+		return hr;
+
+	// Build LOD chain before upload - simplified levels are appended to the index buffer
+	generateLODs(decoded.meshData, numLODs, &decoded.lodStats);
+
+	// Meshlets reorder the full detail indices so they are built before upload as well
+	buildMeshlets(decoded.meshData);
+
+	decoded.dequantisation = quantiseMesh(decoded.meshData, decoded.vertices, &decoded.quantisationError);
+
+	computeBounds(decoded);
+
+	return S_OK;
+}
+
+
+void MeshAsset::computeBounds(DecodedMesh& decoded) {
+
+	const MeshData& meshData = decoded.meshData;
+
+	decoded.bounds = emptyBounds();
+	decoded.subMeshBounds.clear();
+
+	if (meshData.lods.empty())
+		return;
+
+	// Cooked meshes only keep the quantised vertices
+	vector<MeshVertex> dequantised;
+	const MeshVertex *vertices = meshData.vertices.data();
+
+	if (meshData.vertices.size() < decoded.vertices.size()) {
+
+		dequantised.resize(decoded.vertices.size());
+
+		for (size_t i = 0; i < dequantised.size(); ++i)
+			dequantiseVertex(decoded.vertices[i], decoded.dequantisation, &dequantised[i]);
+
+		vertices = dequantised.data();
+	}
+
+	for (const SubMesh& subMesh : meshData.lods[0].subMeshes) {
+
+		Bounds subMeshBounds = ::computeBounds(vertices + subMesh.baseVertex, subMesh.vertexCount);
+
+		decoded.subMeshBounds.push_back(subMeshBounds);
+		decoded.bounds = mergeBounds(decoded.bounds, subMeshBounds);
+	}
+
+	decoded.uvDensity = computeUVDensity(vertices, meshData.indices, meshData.lods[0].subMeshes);
+}
+
+
+void MeshAsset::upload(ID3D11Device *device, const std::wstring& name, const DecodedMesh& decoded) {
+
+	try
+	{
+		if (!device)
+			throw exception("Invalid parameters for MeshAsset instantiation");
+
+		HRESULT hr = createBuffers(device, decoded);
+
+		if (!SUCCEEDED(hr))
+			throw exception("Cannot create mesh buffers");
+
+		const vector<LODStats>& lodStats = decoded.lodStats;
+
+		wcout << L"MeshAsset " << name << L": " << decoded.vertices.size() << L" vertices, " << sizeof(ExtendedVertexStruct) << L" -> " << sizeof(QuantisedVertexStruct) << L" bytes per vertex" << endl;
+		cout << "  max position error = " << quantisationError.maxPosError << " (" << quantisationError.maxPosErrorRelative * 100.0f << "% of extent), max normal error = " << quantisationError.maxNormalError << " degrees, max uv error = " << quantisationError.maxTexCoordError << endl;
+		cout << "  " << meshlets.size() << " meshlets" << endl;
+
+		for (size_t i = 0; i < lodStats.size(); ++i) {
+
+			cout << "  LOD " << i << ": " << lodStats[i].numTriangles << " triangles, error = " << lodStats[i].error << " (" << lodStats[i].error / boundingSphere.w * 100.0f << "% of radius), geometric error = " << lodStats[i].geometricError;
+
+			// Tiny meshes can simplify within the timer resolution so the rate is only printed for a measurable time
+			if (i > 0) {
+
+				cout << ", simplified in " << lodStats[i].seconds * 1000.0 << " ms";
+
+				if (lodStats[i].seconds > 0.0)
+					cout << " (" << (uint64_t)(lodStats[i - 1].numTriangles / lodStats[i].seconds) << " triangles/sec)";
+			}
+
+			cout << endl;
+		}
+	}
+	catch (exception& e)
+	{
+		cout << "MeshAsset could not be instantiated due to:\n";
+		cout << e.what() << endl;
+
+		if (vertexBuffer)
+			vertexBuffer->Release();
+
+		if (indexBuffer)
+			indexBuffer->Release();
+
+		vertexBuffer = nullptr;
+		indexBuffer = nullptr;
+		lods.clear();
+		vertexBytes = indexBytes = unquantisedBytes = 0;
+	}
+}
+
+MeshAsset::~MeshAsset() {
+
+	if (vertexBuffer)
+		vertexBuffer->Release();
+
+	if (indexBuffer)
+		indexBuffer->Release();
+}
+
+
+// Retain asset
+void MeshAsset::retain() {
+
+	retainCount++;
+}
+
+// Release ownership of asset.  If retainCount=0 then delete the asset.  Return true if the asset is deleted so the caller knows the pointer is no longer valid.
+bool MeshAsset::release() {
+
+	retainCount--;
+
+	if (retainCount == 0) {
+
+		delete(this);
+		return true;
+	}
+
+	return false;
+}
+
+
+int MeshAsset::selectLOD(FXMMATRIX worldMatrix, CXMMATRIX viewMatrix, CXMMATRIX projMatrix, float viewportHeight, float maxErrorPixels) {
+
+	if (lods.size() < 2 || boundingSphere.w <= 0.0f)
+		return 0;
+
+	// World space radius - scale by the largest axis scale of the world matrix
+	float scale = sqrtf(max(XMVectorGetX(XMVector3LengthSq(worldMatrix.r[0])), max(XMVectorGetX(XMVector3LengthSq(worldMatrix.r[1])), XMVectorGetX(XMVector3LengthSq(worldMatrix.r[2])))));
+	float radius = boundingSphere.w * scale;
+
+	// View space distance to the nearest point of the sphere
+	XMVECTOR centre = XMVector3Transform(XMLoadFloat4(&boundingSphere), worldMatrix * viewMatrix);
+	float distance = XMVectorGetZ(centre) - radius;
+
+	if (distance <= 0.0f)
+		return 0;
+
+	// Projected radius in pixels (projMatrix._22 = cot(fovY / 2))
+	float projectedRadius = radius * XMVectorGetY(projMatrix.r[1]) * viewportHeight * 0.5f / distance;
+
+	for (int lod = (int)lods.size() - 1; lod > 0; --lod)
+		if (lods[lod].error / boundingSphere.w * projectedRadius <= maxErrorPixels)
+			return lod;
+
+	return 0;
+}
+
+
+void MeshAsset::render(StateTrackingContext *context, int lod) {
+
+	if (!context || !isValid())
+		return;
+
+	lod = min(max(lod, 0), (int)lods.size() - 1);
+
+	// Set vertex and index buffers for IA
+	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
+	UINT vertexStrides[] = { sizeof(QuantisedVertexStruct) };
+	UINT vertexOffsets[] = { 0 };
+
+	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
+	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+	// Set primitive topology for IA
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// Draw each mesh
+	for (const SubMesh& subMesh : lods[lod].subMeshes)
+		context->DrawIndexed(subMesh.indexCount, subMesh.firstIndex, subMesh.baseVertex);
+}
+
+
+bool MeshAsset::cullMeshlets(const float planes[6][4], const float *cameraPos, vector<IndexRange>& ranges, MeshletCullStats *stats) {
+
+	if (meshlets.empty() || lods.empty())
+		return false;
+
+	::cullMeshlets(meshlets.data(), meshlets.size(), lods[0].subMeshes.data(), planes, cameraPos, ranges, stats);
+
+	return true;
+}
+
+
+void MeshAsset::render(StateTrackingContext *context, const vector<IndexRange>& ranges) {
+
+	if (!context || !isValid())
+		return;
+
+	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
+	UINT vertexStrides[] = { sizeof(QuantisedVertexStruct) };
+	UINT vertexOffsets[] = { 0 };
+
+	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
+	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	for (const IndexRange& range : ranges)
+		context->DrawIndexed(range.indexCount, range.firstIndex, range.baseVertex);
+}
+
+
+void MeshAsset::renderInstanced(StateTrackingContext *context, int lod, ID3D11Buffer *instanceBuffer, UINT instanceStride, UINT instanceCount, UINT startInstance) {
+
+	if (!context || !isValid() || !instanceBuffer || instanceCount == 0)
+		return;
+
+	lod = min(max(lod, 0), (int)lods.size() - 1);
+
+	ID3D11Buffer* vertexBuffers[] = { vertexBuffer, instanceBuffer };
+	UINT vertexStrides[] = { sizeof(QuantisedVertexStruct), instanceStride };
+	UINT vertexOffsets[] = { 0, 0 };
+
+	context->IASetVertexBuffers(0, 2, vertexBuffers, vertexStrides, vertexOffsets);
+	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	for (const SubMesh& subMesh : lods[lod].subMeshes)
+		context->DrawIndexedInstanced(subMesh.indexCount, instanceCount, subMesh.firstIndex, subMesh.baseVertex, startInstance);
+}
+
+
+// Import model file into meshData
+HRESULT MeshAsset::loadModelAssimp(const std::wstring& filename, unsigned int importFlags, MeshData& meshData)
+{
+	Assimp::Importer importer;
+	std::wstring w(filename);
+	std::string filename_string(w.begin(), w.end());
+	// Get filename extension
+	wstring ext = filename.substr(filename.length() - 4);
+
+	try
+	{
+		const aiScene* scene = importer.ReadFile(filename_string, importFlags);
+
+
+		if (!scene)
+		{
+			printf("Couldn't load model - Error Importing Asset");
+			return E_FAIL;
+		}
+
+		uint32_t numMeshes = scene->mNumMeshes;
+
+		if (numMeshes == 0)
+			throw exception("Empty model loaded");
+
+		// Imported meshes form the full detail LOD
+		meshData.lods.resize(1);
+		MeshLOD& lod = meshData.lods[0];
+		lod.error = 0.0f;
+
+		uint32_t numVertices = 0;
+		uint32_t numIndices = 0;
+		//printf("Num Meshes %d\n", scene->mNumMeshes);
+		for (uint32_t k = 0; k < numMeshes; ++k)
+		{
+			aiMesh* mesh = scene->mMeshes[k];
+			// Store base vertex index and index range for current mesh
+			lod.subMeshes.push_back({ numVertices, mesh->mNumVertices, numIndices, mesh->mNumFaces * 3 });
+			// Increment vertex and index count
+			numVertices += mesh->mNumVertices;
+			numIndices += mesh->mNumFaces * 3;
+		}
+
+		meshData.vertices.resize(numVertices);
+		meshData.indices.resize(numIndices);
+
+		//Flip x for OBJ & GSF (might be required for other files too?) - handedness only depends on the file type so is resolved once before conversion
+		bool flipX = (0 == ext.compare(L".obj") || 0 == ext.compare(L".gsf"));
+		XMVECTOR flip = flipX ? XMVectorSet(-1.0f, 1.0f, 1.0f, 1.0f) : XMVectorSplatOne();
+
+		// Convert each vertex once then copy the face indices as a separate pass
+		for (uint32_t i = 0; i < numMeshes; ++i)
+		{
+			aiMesh* mesh = scene->mMeshes[i];
+
+			convertMeshVertices(mesh, &meshData.vertices[lod.subMeshes[i].baseVertex], flip);
+			copyMeshIndices(mesh, &meshData.indices[lod.subMeshes[i].firstIndex]);
+
+		}//for each mesh
+
+	}
+	catch (exception& e)
+	{
+		cout << "Model could not be instantiated due to:\n";
+		cout << e.what() << endl;
+
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
+
+
+// Import OBJ file into meshData with the native parallel importer
+HRESULT MeshAsset::loadModelOBJ(const std::wstring& filename, MeshData& meshData)
+{
+	std::string filename_string(filename.begin(), filename.end());
+
+	try
+	{
+		// Flip x to match the handedness of the Assimp import path
+		importOBJ(filename_string, meshData, true);
+	}
+	catch (exception& e)
+	{
+		cout << "Model could not be instantiated due to:\n";
+		cout << e.what() << endl;
+
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
+
+
+// Import 3DS file into meshData with the native chunk reader
+HRESULT MeshAsset::loadModel3DS(const std::wstring& filename, MeshData& meshData)
+{
+	std::string filename_string(filename.begin(), filename.end());
+
+	try
+	{
+		import3DS(filename_string, meshData);
+	}
+	catch (exception& e)
+	{
+		cout << "Model could not be instantiated due to:\n";
+		cout << e.what() << endl;
+
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
+
+
+// Read a mesh cooked offline by the asset cooker - no LOD generation or quantisation is needed
+HRESULT MeshAsset::loadModelCooked(const std::wstring& filename, DecodedMesh& decoded)
+{
+	std::string filename_string(filename.begin(), filename.end());
+
+	try
+	{
+		readCookedMesh(filename_string, decoded.meshData, decoded.vertices, decoded.dequantisation);
+		decoded.quantisationError = { 0.0f, 0.0f, 0.0f, 0.0f };
+	}
+	catch (exception& e)
+	{
+		cout << "Model could not be instantiated due to:\n";
+		cout << e.what() << endl;
+
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
+
+
+// Create the GPU vertex and index buffers for decoded (quantised) geometry
+HRESULT MeshAsset::createBuffers(ID3D11Device *device, const DecodedMesh& decoded) {
+
+	const MeshData& meshData = decoded.meshData;
+	const vector<QuantisedVertexStruct>& vertices = decoded.vertices;
+
+	dequantisation = decoded.dequantisation;
+	quantisationError = decoded.quantisationError;
+
+	// Setup DX vertex buffer interfaces
+	D3D11_BUFFER_DESC vertexDesc;
+	D3D11_SUBRESOURCE_DATA vertexData;
+
+	ZeroMemory(&vertexDesc, sizeof(D3D11_BUFFER_DESC));
+	ZeroMemory(&vertexData, sizeof(D3D11_SUBRESOURCE_DATA));
+
+	vertexDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	vertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexDesc.ByteWidth = (UINT)(vertices.size() * sizeof(QuantisedVertexStruct));
+	vertexData.pSysMem = vertices.data();
+
+	HRESULT hr = device->CreateBuffer(&vertexDesc, &vertexData, &vertexBuffer);
+
+	if (!SUCCEEDED(hr))
+		return hr;
+
+	// Setup index buffer
+	D3D11_BUFFER_DESC indexDesc;
+	D3D11_SUBRESOURCE_DATA indexData;
+
+	ZeroMemory(&indexDesc, sizeof(D3D11_BUFFER_DESC));
+	ZeroMemory(&indexData, sizeof(D3D11_SUBRESOURCE_DATA));
+
+	indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexDesc.ByteWidth = (UINT)(meshData.indices.size() * sizeof(uint32_t));
+	indexData.pSysMem = meshData.indices.data();
+
+	hr = device->CreateBuffer(&indexDesc, &indexData, &indexBuffer);
+
+	if (!SUCCEEDED(hr))
+		return hr;
+
+	lods = meshData.lods;
+	meshlets = meshData.meshlets;
+
+	bounds = decoded.bounds;
+	subMeshBounds = decoded.subMeshBounds;
+	uvDensity = decoded.uvDensity;
+
+	if (!bounds.isEmpty())
+		boundingSphere = XMFLOAT4(bounds.sphereCentre[0], bounds.sphereCentre[1], bounds.sphereCentre[2], bounds.sphereRadius);
+	else {
+
+		// Bounding sphere around the centre of the quantisation AABB
+		XMVECTOR extent = XMVectorSet(dequantisation.posScale[0], dequantisation.posScale[1], dequantisation.posScale[2], 0.0f);
+		XMVECTOR centre = XMVectorAdd(XMVectorSet(dequantisation.posOffset[0], dequantisation.posOffset[1], dequantisation.posOffset[2], 0.0f), XMVectorScale(extent, 0.5f));
+		XMStoreFloat4(&boundingSphere, XMVectorSetW(centre, 0.5f * XMVectorGetX(XMVector3Length(extent))));
+	}
+
+	vertexBytes = vertexDesc.ByteWidth;
+	indexBytes = indexDesc.ByteWidth;
+	unquantisedBytes = vertices.size() * sizeof(ExtendedVertexStruct) + indexBytes;
+
+	return S_OK;
+}
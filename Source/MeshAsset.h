@@ -0,0 +1,135 @@
+
+//
+// MeshAsset.h
+//
+
+// Shared geometry imported from a model file (obj and 3ds files via the native ObjImporter and Importer3DS, mesh files cooked offline via CookedMesh, gsf etc via Assimp).  A MeshAsset owns the vertex and index buffers along with the per-mesh draw ranges and is referenced by any number of Model instances.  Ownership follows a retain-release mechanism - the creator adopts the first reference, each additional owner calls retain() and every owner calls release() when done.  The asset deletes itself when the last reference is released.
+// Vertices are quantised to QuantisedVertexStruct on import (see MeshQuantiser.h) so effects used to render a MeshAsset must be created with quantisedVertexDesc.
+// A chain of simplified levels of detail is generated on import (see MeshSimplifier.h).  All levels share the vertex buffer and are stored as additional index ranges.
+// Full detail geometry is also split into meshlets (see Meshlet.h) so Models can draw only the clusters that are inside the view frustum and facing the camera.
+// Loading is split into decode() - import, LOD generation and quantisation with no Direct3D calls so it can run on a background thread (see AssetStreamer.h) - and the upload of the decoded mesh to the GPU.
+
+#pragma once
+#include <d3d11_2.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <MeshData.h>
+#include <MeshQuantiser.h>
+#include <MeshSimplifier.h>
+#include <Bounds.h>
+#include <Meshlet.h>
+#include <DirectXMath.h>
+
+class StateTrackingContext;
+
+class MeshAsset {
+
+public:
+
+	// CPU side result of decode() ready to be uploaded
+	struct DecodedMesh {
+		MeshData						meshData;
+		std::vector<QuantisedVertexStruct>	vertices;
+		QuantisationParams				dequantisation;
+		QuantisationError				quantisationError;
+		std::vector<LODStats>			lodStats;
+		Bounds							bounds; // Model space bounds of every mesh
+		std::vector<Bounds>				subMeshBounds; // One per mesh - simplified LODs use the same vertex ranges
+		float							uvDensity = 0.0f; // Model space texture coordinate density (see computeUVDensity)
+
+		// Size of the vertex and index data to upload
+		size_t getUploadBytes() const { return vertices.size() * sizeof(QuantisedVertexStruct) + meshData.indices.size() * sizeof(uint32_t); };
+	};
+
+private:
+
+	unsigned int						retainCount = 1;
+
+	ID3D11Buffer						*vertexBuffer = nullptr;
+	ID3D11Buffer						*indexBuffer = nullptr;
+	std::vector<MeshLOD>				lods; // lods[0] is full detail
+	std::vector<Meshlet>				meshlets; // Clusters of lods[0]
+
+	// Model space bounding sphere (xyz = centre, w = radius) used for LOD selection
+	DirectX::XMFLOAT4					boundingSphere = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	// Model space bounds of the whole asset and of each mesh
+	Bounds								bounds = emptyBounds();
+	std::vector<Bounds>					subMeshBounds;
+
+	// Texture coordinate units per model space unit over the full detail mesh, used to estimate the mip level of streamed textures (see MipResidency.h)
+	float								uvDensity = 0.0f;
+
+	// Dequantisation constants for the vertex buffer
+	QuantisationParams					dequantisation = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	QuantisationError					quantisationError = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	// Size of the GPU buffers created for this asset and the size they would have been with the original ExtendedVertexStruct layout
+	size_t								vertexBytes = 0;
+	size_t								indexBytes = 0;
+	size_t								unquantisedBytes = 0;
+
+	static HRESULT loadModelAssimp(const std::wstring& filename, unsigned int importFlags, MeshData& meshData);
+	static HRESULT loadModelOBJ(const std::wstring& filename, MeshData& meshData);
+	static HRESULT loadModel3DS(const std::wstring& filename, MeshData& meshData);
+	static HRESULT loadModelCooked(const std::wstring& filename, DecodedMesh& decoded);
+	HRESULT createBuffers(ID3D11Device *device, const DecodedMesh& decoded);
+	void upload(ID3D11Device *device, const std::wstring& name, const DecodedMesh& decoded);
+
+	// Use release() rather than delete
+	~MeshAsset();
+
+public:
+
+	// Assimp post processing flags used when no flags are specified (OBJ and 3DS files are imported natively and ignore the import flags)
+	static const unsigned int defaultImportFlags;
+
+	// Number of levels of detail generated for each asset (including full detail)
+	static const int numLODs = 4;
+
+	MeshAsset(ID3D11Device *device, const std::wstring& filename, unsigned int importFlags);
+
+	// Create the GPU buffers for a previously decoded mesh.  name is only used for reporting.
+	MeshAsset(ID3D11Device *device, const std::wstring& name, const DecodedMesh& decoded);
+
+	// Import filename, generate the LOD chain and quantise the vertices.  Thread safe - no Direct3D calls are made.
+	static HRESULT decode(const std::wstring& filename, unsigned int importFlags, DecodedMesh& decoded);
+
+	// Set the bounds and texture coordinate density of decoded geometry from the full precision vertices (or the dequantised vertices if only those are available).  Called by decode() - geometry decoded by other means must call this before upload.
+	static void computeBounds(DecodedMesh& decoded);
+
+	// Retain-release reference counting
+	void retain();
+	bool release();
+	unsigned int getRetainCount() { return retainCount; };
+
+	// Return true if the vertex and index buffers were created successfully
+	bool isValid() { return vertexBuffer != nullptr && indexBuffer != nullptr && !lods.empty(); };
+	size_t getSizeBytes() { return vertexBytes + indexBytes; };
+	size_t getUnquantisedSizeBytes() { return unquantisedBytes; };
+	uint32_t getNumMeshes() { return lods.empty() ? 0 : (uint32_t)lods[0].subMeshes.size(); };
+	int getNumLODs() { return (int)lods.size(); };
+	const DirectX::XMFLOAT4& getBoundingSphere() { return boundingSphere; };
+	const Bounds& getBounds() { return bounds; };
+	const Bounds& getSubMeshBounds(uint32_t meshIndex) { return subMeshBounds[meshIndex]; };
+	float getUVDensity() { return uvDensity; };
+	const QuantisationParams& getDequantisation() { return dequantisation; };
+	const QuantisationError& getQuantisationError() { return quantisationError; };
+
+	// Return the coarsest LOD whose simplification error projects to no more than maxErrorPixels.  The error in pixels is the LOD error relative to the bounding sphere radius scaled by the projected screen space radius of the (world space) bounding sphere.
+	int selectLOD(DirectX::FXMMATRIX worldMatrix, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX projMatrix, float viewportHeight, float maxErrorPixels = 1.0f);
+
+	// Bind vertex and index buffers to the IA stage and draw every mesh at the given level of detail
+	void render(StateTrackingContext *context, int lod = 0);
+
+	// Append the full detail index ranges of the meshlets inside the frustum planes (model space) to ranges.  Meshlets facing away from cameraPos (model space) are also culled unless cameraPos is null.  Returns false if the asset has no meshlets.
+	bool cullMeshlets(const float planes[6][4], const float *cameraPos, std::vector<IndexRange>& ranges, MeshletCullStats *stats = nullptr);
+
+	// Bind vertex and index buffers to the IA stage and draw the given index ranges
+	void render(StateTrackingContext *context, const std::vector<IndexRange>& ranges);
+
+	// Bind the vertex and index buffers with an instance buffer in slot 1 and draw instanceCount instances of every mesh at the given level of detail from startInstance
+	void renderInstanced(StateTrackingContext *context, int lod, ID3D11Buffer *instanceBuffer, UINT instanceStride, UINT instanceCount, UINT startInstance);
+	uint32_t getNumMeshlets() { return (uint32_t)meshlets.size(); };
+};
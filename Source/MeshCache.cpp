@@ -0,0 +1,135 @@
+
+#include "stdafx.h"
+#include "MeshCache.h"
+#include <MeshAsset.h>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cwctype>
+
+using namespace std;
+
+
+MeshCache::~MeshCache() {
+
+	// Release the cache's reference - assets still in use by a Model are deleted when the Model releases them
+	for (auto& entry : assets)
+		entry.second.asset->release();
+}
+
+
+// Resolve relative paths and "." / ".." segments and fold case (Windows paths are case insensitive) so L"Resources\\Models\\shark.obj" and L"Resources\\Models\\Shark.obj" map to the same asset
+wstring MeshCache::canonicalPath(const wstring& filename) {
+
+	wchar_t fullPath[MAX_PATH];
+	DWORD len = GetFullPathNameW(filename.c_str(), MAX_PATH, fullPath, nullptr);
+
+	wstring path = (len > 0 && len < MAX_PATH) ? wstring(fullPath, len) : filename;
+
+	for (auto& c : path)
+		c = (c == L'/') ? L'\\' : towlower(c);
+
+	return path;
+}
+
+
+wstring MeshCache::makeKey(const wstring& filename, unsigned int importFlags) {
+
+	wostringstream key;
+
+	key << canonicalPath(filename) << L"|" << hex << importFlags;
+
+	return key.str();
+}
+
+
+MeshAsset *MeshCache::acquire(ID3D11Device *device, const wstring& filename, unsigned int importFlags) {
+
+	MeshAsset *asset = find(filename, importFlags);
+
+	if (asset)
+		return asset;
+
+	// Cache miss - import and upload
+	gu_time_index startTime = CGDClock::ActualTime();
+
+	asset = new MeshAsset(device, filename, importFlags);
+
+	gu_seconds loadTime = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - startTime);
+
+	if (!asset->isValid()) {
+
+		asset->release();
+		return nullptr;
+	}
+
+	// Cache takes a second reference, caller keeps the initial one
+	insert(filename, importFlags, asset, loadTime);
+
+	return asset;
+}
+
+
+MeshAsset *MeshCache::find(const wstring& filename, unsigned int importFlags) {
+
+	numRequests++;
+
+	auto it = assets.find(makeKey(filename, importFlags));
+
+	if (it == assets.end())
+		return nullptr;
+
+	// Cache hit - share the existing buffers
+	MeshAsset *asset = it->second.asset;
+
+	bytesSaved += asset->getSizeBytes();
+	timeSaved += it->second.loadTime;
+
+	asset->retain();
+	return asset;
+}
+
+
+void MeshCache::insert(const wstring& filename, unsigned int importFlags, MeshAsset *asset, gu_seconds loadTime) {
+
+	if (!asset || !asset->isValid())
+		return;
+
+	wstring key = makeKey(filename, importFlags);
+
+	if (assets.find(key) != assets.end())
+		return;
+
+	numLoads++;
+	bytesLoaded += asset->getSizeBytes();
+	bytesUnquantised += asset->getUnquantisedSizeBytes();
+	timeLoading += loadTime;
+
+	assets[key] = { asset, loadTime };
+	asset->retain();
+}
+
+
+void MeshCache::purge() {
+
+	for (auto it = assets.begin(); it != assets.end();) {
+
+		if (it->second.asset->getRetainCount() == 1) {
+
+			it->second.asset->release();
+			it = assets.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+
+void MeshCache::reportStats() {
+
+	cout << "MeshCache: " << numRequests << " requests, " << numLoads << " loads, " << (numRequests - numLoads) << " shared" << endl;
+	cout << "MeshCache: geometry resident = " << bytesLoaded / 1024 << " KB, memory saved = " << bytesSaved / 1024 << " KB" << endl;
+	cout << "MeshCache: geometry before quantisation = " << bytesUnquantised / 1024 << " KB, after quantisation = " << bytesLoaded / 1024 << " KB" << endl;
+	cout << "MeshCache: load time = " << fixed << setprecision(3) << timeLoading << "s, load time saved = " << timeSaved << "s" << endl;
+	cout.unsetf(ios::floatfield);
+}
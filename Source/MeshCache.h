@@ -0,0 +1,57 @@
+
+//
+// MeshCache.h
+//
+
+// Cache of shared MeshAsset geometry so a model file that is instanced several times in the scene is only imported and uploaded once.  Assets are keyed by canonical file path plus import flags - material colours are per-draw constants so Models with different materials share the same asset.  The cache keeps its own reference to every asset until it is destroyed or purged.
+
+#pragma once
+#include <d3d11_2.h>
+#include <string>
+#include <map>
+#include <cstdint>
+#include <CGDClock.h>
+
+class MeshAsset;
+
+class MeshCache {
+
+	struct CacheEntry {
+		MeshAsset				*asset;
+		gu_seconds				loadTime; // Time taken to import and upload the asset on first request
+	};
+
+	std::map<std::wstring, CacheEntry>	assets;
+
+	// Cache statistics
+	uint32_t							numRequests = 0;
+	uint32_t							numLoads = 0;
+	size_t								bytesLoaded = 0;
+	size_t								bytesSaved = 0;
+	size_t								bytesUnquantised = 0; // Size of the loaded geometry had it used ExtendedVertexStruct
+	gu_seconds							timeLoading = 0.0;
+	gu_seconds							timeSaved = 0.0;
+
+	static std::wstring canonicalPath(const std::wstring& filename);
+	static std::wstring makeKey(const std::wstring& filename, unsigned int importFlags);
+
+public:
+
+	MeshCache() {};
+	~MeshCache();
+
+	// Return the shared asset for the given file, importing it on first request.  The returned asset is retained on behalf of the caller who must release() it when done.  Returns nullptr if the file cannot be loaded.
+	MeshAsset *acquire(ID3D11Device *device, const std::wstring& filename, unsigned int importFlags);
+
+	// Return the shared asset for the given file (retained on behalf of the caller) or nullptr if it has not been loaded yet.  Counts as a request.
+	MeshAsset *find(const std::wstring& filename, unsigned int importFlags);
+
+	// Add an asset loaded outside the cache (for example by an AssetStreamer).  The cache takes its own reference.  loadTime is the time taken to import and upload the asset.
+	void insert(const std::wstring& filename, unsigned int importFlags, MeshAsset *asset, gu_seconds loadTime);
+
+	// Release assets that are only referenced by the cache
+	void purge();
+
+	// Print the number of loads, hits, the memory and load time saved by sharing and the memory saved by quantisation
+	void reportStats();
+};
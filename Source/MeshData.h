@@ -0,0 +1,55 @@
+
+//
+// MeshData.h
+//
+
+// Platform independent CPU copy of imported model geometry.  MeshData sits between the file importers and the GPU MeshAsset so import and offline processing (quantisation etc) do not depend on Windows or Direct3D.
+// The same rule covers every source built by CMakeLists.txt (the AssetPipeline library) - they include only standard and platform independent headers and do not use the precompiled header, so the tools build without Windows and the application compiles them unchanged.
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// Full precision vertex as imported - model space position, unit normal and texture coordinate
+struct MeshVertex {
+	float								pos[3];
+	float								normal[3];
+	float								texCoord[2];
+};
+
+// Each mesh is a range of the shared vertex and index buffers.  Indices are relative to baseVertex (see DrawIndexed)
+struct SubMesh {
+	uint32_t							baseVertex;
+	uint32_t							vertexCount;
+	uint32_t							firstIndex;
+	uint32_t							indexCount;
+};
+
+// A level of detail is a set of index ranges over the shared vertices - simplified levels only remove triangles so every LOD uses the same vertex buffer
+struct MeshLOD {
+	std::vector<SubMesh>				subMeshes;
+	float								error; // Model space simplification error relative to LOD 0
+};
+
+// A cluster of neighbouring triangles from one LOD 0 SubMesh.  The triangles of a meshlet are a contiguous index range so visible meshlets can be drawn with DrawIndexed (see Meshlet.h).
+struct Meshlet {
+	uint32_t							firstIndex;
+	uint32_t							indexCount;
+	uint32_t							subMesh; // Index into lods[0].subMeshes
+	float								centre[3]; // Bounding sphere
+	float								radius;
+	float								coneAxis[3]; // Average facing direction of the triangles
+	float								coneCutoff; // Sine of the widest triangle angle from coneAxis (1 if the meshlet can never be back facing)
+};
+
+struct MeshData {
+
+	std::vector<MeshVertex>				vertices;
+	std::vector<uint32_t>				indices;
+	std::vector<MeshLOD>				lods; // lods[0] is the full detail mesh
+	std::vector<Meshlet>				meshlets; // Clusters of lods[0] (empty if not built)
+
+	size_t getSizeBytes() const { return vertices.size() * sizeof(MeshVertex) + indices.size() * sizeof(uint32_t); };
+};
@@ -0,0 +1,249 @@
+
+#include "MeshQuantiser.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+
+static const float pi = 3.14159265358979f;
+
+
+static int16_t toSnorm16(float v) {
+
+	v = min(max(v, -1.0f), 1.0f);
+	return (int16_t)roundf(v * 32767.0f);
+}
+
+static float fromSnorm16(int16_t v) {
+
+	// -32768 and -32767 both map to -1 (D3D SNORM conversion rules)
+	return max((float)v / 32767.0f, -1.0f);
+}
+
+static uint16_t toUnorm16(float v) {
+
+	v = min(max(v, 0.0f), 1.0f);
+	return (uint16_t)(v * 65535.0f + 0.5f);
+}
+
+static float signNotZero(float v) {
+
+	return (v >= 0.0f) ? 1.0f : -1.0f;
+}
+
+
+void octahedralEncode(const float n[3], int16_t result[2]) {
+
+	float l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+
+	// Degenerate normals are encoded as +z
+	if (l1 == 0.0f) {
+
+		result[0] = result[1] = 0;
+		return;
+	}
+
+	// Project onto the octahedron |x| + |y| + |z| = 1 then fold the lower hemisphere over the diagonals
+	float x = n[0] / l1;
+	float y = n[1] / l1;
+
+	if (n[2] < 0.0f) {
+
+		float fx = (1.0f - fabsf(y)) * signNotZero(x);
+		float fy = (1.0f - fabsf(x)) * signNotZero(y);
+		x = fx;
+		y = fy;
+	}
+
+	result[0] = toSnorm16(x);
+	result[1] = toSnorm16(y);
+}
+
+
+void octahedralDecode(const int16_t e[2], float result[3]) {
+
+	float x = fromSnorm16(e[0]);
+	float y = fromSnorm16(e[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower hemisphere
+	float t = max(-z, 0.0f);
+	x += (x >= 0.0f) ? -t : t;
+	y += (y >= 0.0f) ? -t : t;
+
+	float len = sqrtf(x * x + y * y + z * z);
+
+	result[0] = x / len;
+	result[1] = y / len;
+	result[2] = z / len;
+}
+
+
+uint16_t floatToHalf(float f) {
+
+	uint32_t x;
+	memcpy(&x, &f, sizeof(uint32_t));
+
+	uint32_t sign = (x >> 16) & 0x8000;
+	uint32_t absx = x & 0x7fffffff;
+
+	// Inf or NaN
+	if (absx >= 0x7f800000)
+		return (uint16_t)(sign | 0x7c00 | ((absx > 0x7f800000) ? 0x200 : 0));
+
+	// Values >= 65520 round to infinity
+	if (absx >= 0x477ff000)
+		return (uint16_t)(sign | 0x7c00);
+
+	// Half denormal (< 2^-14)
+	if (absx < 0x38800000) {
+
+		// < 2^-25 rounds to zero
+		if (absx < 0x33000000)
+			return (uint16_t)sign;
+
+		uint32_t mantissa = (absx & 0x7fffff) | 0x800000;
+		uint32_t shift = 126 - (absx >> 23);
+		uint32_t h = mantissa >> shift;
+		uint32_t rem = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+
+		if (rem > halfway || (rem == halfway && (h & 1)))
+			h++;
+
+		return (uint16_t)(sign | h);
+	}
+
+	// Normal - rebias exponent and round mantissa (a carry out of the mantissa correctly increments the exponent)
+	uint32_t h = ((absx >> 23) - 112) << 10 | ((absx & 0x7fffff) >> 13);
+	uint32_t rem = absx & 0x1fff;
+
+	if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+		h++;
+
+	return (uint16_t)(sign | h);
+}
+
+
+float halfToFloat(uint16_t h) {
+
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+
+	if (exponent == 0) {
+
+		float f = ldexpf((float)mantissa, -24);
+		return sign ? -f : f;
+	}
+
+	uint32_t x = (exponent == 31) ? (sign | 0x7f800000 | (mantissa << 13)) : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+
+	float f;
+	memcpy(&f, &x, sizeof(float));
+	return f;
+}
+
+
+QuantisationParams quantiseMesh(const MeshData& mesh, vector<QuantisedVertexStruct>& vertices, QuantisationError *error) {
+
+	QuantisationParams params = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+
+	vertices.resize(mesh.vertices.size());
+
+	if (mesh.vertices.empty()) {
+
+		if (error)
+			*error = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		return params;
+	}
+
+	// Model AABB
+	float minP[3] = { mesh.vertices[0].pos[0], mesh.vertices[0].pos[1], mesh.vertices[0].pos[2] };
+	float maxP[3] = { minP[0], minP[1], minP[2] };
+
+	for (const MeshVertex& v : mesh.vertices) {
+
+		for (int k = 0; k < 3; ++k) {
+
+			minP[k] = min(minP[k], v.pos[k]);
+			maxP[k] = max(maxP[k], v.pos[k]);
+		}
+	}
+
+	float invExtent[3];
+
+	for (int k = 0; k < 3; ++k) {
+
+		params.posOffset[k] = minP[k];
+		params.posScale[k] = maxP[k] - minP[k];
+		invExtent[k] = (params.posScale[k] > 0.0f) ? 1.0f / params.posScale[k] : 0.0f;
+	}
+
+	for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+
+		const MeshVertex& v = mesh.vertices[i];
+		QuantisedVertexStruct& q = vertices[i];
+
+		for (int k = 0; k < 3; ++k)
+			q.pos[k] = toUnorm16((v.pos[k] - minP[k]) * invExtent[k]);
+
+		q.pos[3] = 0;
+
+		octahedralEncode(v.normal, q.normal);
+
+		q.texCoord[0] = floatToHalf(v.texCoord[0]);
+		q.texCoord[1] = floatToHalf(v.texCoord[1]);
+	}
+
+	if (error) {
+
+		*error = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+		float maxNormalCos = 1.0f;
+
+		for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+
+			const MeshVertex& v = mesh.vertices[i];
+			MeshVertex d;
+
+			dequantiseVertex(vertices[i], params, &d);
+
+			for (int k = 0; k < 3; ++k)
+				error->maxPosError = max(error->maxPosError, fabsf(d.pos[k] - v.pos[k]));
+
+			for (int k = 0; k < 2; ++k)
+				error->maxTexCoordError = max(error->maxTexCoordError, fabsf(d.texCoord[k] - v.texCoord[k]));
+
+			float len = sqrtf(v.normal[0] * v.normal[0] + v.normal[1] * v.normal[1] + v.normal[2] * v.normal[2]);
+
+			if (len > 0.0f) {
+
+				float c = (v.normal[0] * d.normal[0] + v.normal[1] * d.normal[1] + v.normal[2] * d.normal[2]) / len;
+				maxNormalCos = min(maxNormalCos, c);
+			}
+		}
+
+		float maxExtent = max(params.posScale[0], max(params.posScale[1], params.posScale[2]));
+
+		error->maxPosErrorRelative = (maxExtent > 0.0f) ? error->maxPosError / maxExtent : 0.0f;
+		error->maxNormalError = acosf(min(max(maxNormalCos, -1.0f), 1.0f)) * 180.0f / pi;
+	}
+
+	return params;
+}
+
+
+void dequantiseVertex(const QuantisedVertexStruct& v, const QuantisationParams& params, MeshVertex *result) {
+
+	for (int k = 0; k < 3; ++k)
+		result->pos[k] = ((float)v.pos[k] / 65535.0f) * params.posScale[k] + params.posOffset[k];
+
+	octahedralDecode(v.normal, result->normal);
+
+	result->texCoord[0] = halfToFloat(v.texCoord[0]);
+	result->texCoord[1] = halfToFloat(v.texCoord[1]);
+}
@@ -0,0 +1,50 @@
+
+//
+// MeshQuantiser.h
+//
+
+// Import-time quantisation of MeshData to a compact 16 byte vertex.  Positions are stored as 16 bit UNORM values relative to the model AABB, normals are octahedral encoded into two 16 bit SNORM values and texture coordinates are stored as half floats.  Material colours are not stored per-vertex - they are set per-draw in the model cbuffer.  Platform independent so models can also be quantised offline.
+
+#pragma once
+#include <MeshData.h>
+#include <vector>
+#include <cstdint>
+
+
+struct QuantisedVertexStruct {
+	uint16_t							pos[4]; // UNORM position relative to model AABB (w unused)
+	int16_t								normal[2]; // SNORM octahedral encoded unit normal
+	uint16_t							texCoord[2]; // Half float
+};
+
+static_assert(sizeof(QuantisedVertexStruct) == 16, "QuantisedVertexStruct must match quantisedVertexDesc");
+
+
+// Dequantisation constants - model space position = quantised position * posScale + posOffset
+struct QuantisationParams {
+	float								posScale[3];
+	float								posOffset[3];
+};
+
+// Largest error introduced by quantising a mesh
+struct QuantisationError {
+	float								maxPosError; // Model space units
+	float								maxPosErrorRelative; // Fraction of the largest AABB extent
+	float								maxNormalError; // Degrees
+	float								maxTexCoordError;
+};
+
+
+// Quantise every vertex of mesh into vertices (resized to match).  Returns the dequantisation constants for the mesh.  If error is not null the mesh is decoded again and compared against the source vertices.
+QuantisationParams quantiseMesh(const MeshData& mesh, std::vector<QuantisedVertexStruct>& vertices, QuantisationError *error = nullptr);
+
+// Decode a quantised vertex (matches the vertex shader decode)
+void dequantiseVertex(const QuantisedVertexStruct& v, const QuantisationParams& params, MeshVertex *result);
+
+// Octahedral normal encoding - n does not need to be normalised
+void octahedralEncode(const float n[3], int16_t result[2]);
+void octahedralDecode(const int16_t e[2], float result[3]);
+
+// IEEE half float conversion (round to nearest even)
+uint16_t floatToHalf(float f);
+float halfToFloat(uint16_t h);
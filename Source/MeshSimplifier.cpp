@@ -0,0 +1,656 @@
+
+#include "MeshSimplifier.h"
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+#include <unordered_map>
+#include <chrono>
+
+using namespace std;
+
+
+// Weight of the normal and uv change relative to squared distance.  The attribute change is scaled by the squared edge length so it is comparable with the position error.
+static const float normalWeight = 0.5f;
+static const float texCoordWeight = 0.5f;
+
+// Weight of the planes added along open borders
+static const float borderWeight = 10.0f;
+
+// Largest collapse error used when generating LODs (fraction of the largest AABB extent)
+static const float maxLODError = 0.1f;
+
+
+namespace {
+
+	struct Vec3 {
+		float x, y, z;
+	};
+
+	// Symmetric 3x3 matrix A, vector b and constant c of the quadric  E(p) = pAp + 2bp + c.  w is the total weight of the planes summed into the quadric.
+	struct Quadric {
+		double a00, a11, a22, a01, a02, a12;
+		double b0, b1, b2;
+		double c;
+		double w;
+	};
+
+	enum VertexKind : uint8_t { Manifold, Border, Seam, Locked };
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		float cost;
+		float geometricCost;
+	};
+
+	struct PositionKey {
+		uint32_t x, y, z;
+		bool operator==(const PositionKey& k) const { return x == k.x && y == k.y && z == k.z; }
+	};
+
+	struct PositionHash {
+		size_t operator()(const PositionKey& k) const { return (k.x * 73856093u) ^ (k.y * 19349663u) ^ (k.z * 83492791u); }
+	};
+
+	// Working state for one simplifyMesh call.  Topology is tracked per position id (pid) - the first vertex with a given position.  Every vertex with that position is a wedge of the pid.
+	struct Simplifier {
+
+		const MeshVertex				*vertices;
+		size_t							numVertices;
+		vector<uint32_t>&				indices;
+
+		vector<Vec3>					positions; // Normalised to the unit cube
+		vector<uint32_t>				pid;
+		vector<Quadric>					quadrics;
+		vector<uint32_t>				remap;
+		vector<uint8_t>					kind;
+		vector<uint8_t>					locked;
+
+		vector<uint64_t>				edges; // Sorted directed pid edges
+		vector<uint32_t>				adjOffset; // Triangles around each pid
+		vector<uint32_t>				adjTriangles;
+
+		vector<pair<uint32_t, uint32_t>> wedgeMap;
+
+		Simplifier(const MeshVertex *_vertices, size_t _numVertices, vector<uint32_t>& _indices) : vertices(_vertices), numVertices(_numVertices), indices(_indices) {}
+
+		void buildPositions(float invExtent, const float minP[3]);
+		void buildEdges();
+		void buildAdjacency();
+		void classifyVertices();
+		void buildQuadrics();
+
+		size_t edgeCount(uint32_t a, uint32_t b) const;
+		bool canCollapse(uint32_t from, uint32_t to, bool borderEdge) const;
+		bool mapWedges(uint32_t from, uint32_t to);
+		bool hasFlips(uint32_t from, uint32_t to) const;
+		bool evaluate(uint32_t from, uint32_t to, bool borderEdge, Collapse& collapse);
+	};
+}
+
+
+static Vec3 sub(const Vec3& a, const Vec3& b) {
+
+	return{ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+static Vec3 cross(const Vec3& a, const Vec3& b) {
+
+	return{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+static float dot(const Vec3& a, const Vec3& b) {
+
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+
+static void quadricAddPlane(Quadric& q, const Vec3& n, float d, double w) {
+
+	q.a00 += w * n.x * n.x;
+	q.a11 += w * n.y * n.y;
+	q.a22 += w * n.z * n.z;
+	q.a01 += w * n.x * n.y;
+	q.a02 += w * n.x * n.z;
+	q.a12 += w * n.y * n.z;
+	q.b0 += w * n.x * d;
+	q.b1 += w * n.y * d;
+	q.b2 += w * n.z * d;
+	q.c += w * d * d;
+	q.w += w;
+}
+
+static void quadricAdd(Quadric& q, const Quadric& r) {
+
+	q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+	q.a01 += r.a01; q.a02 += r.a02; q.a12 += r.a12;
+	q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+	q.c += r.c;
+	q.w += r.w;
+}
+
+// Weighted mean squared distance from p to the planes of q
+static double quadricError(const Quadric& q, const Vec3& p) {
+
+	double x = p.x, y = p.y, z = p.z;
+
+	double ax = q.a00 * x + q.a01 * y + q.a02 * z;
+	double ay = q.a01 * x + q.a11 * y + q.a12 * z;
+	double az = q.a02 * x + q.a12 * y + q.a22 * z;
+
+	double e = x * ax + y * ay + z * az + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+
+	return (q.w > 0.0) ? fabs(e) / q.w : 0.0;
+}
+
+
+void Simplifier::buildPositions(float invExtent, const float minP[3]) {
+
+	positions.resize(numVertices);
+	pid.resize(numVertices);
+
+	unordered_map<PositionKey, uint32_t, PositionHash> positionIds;
+	positionIds.reserve(numVertices);
+
+	for (size_t i = 0; i < numVertices; ++i) {
+
+		const float *p = vertices[i].pos;
+
+		positions[i] = { (p[0] - minP[0]) * invExtent, (p[1] - minP[1]) * invExtent, (p[2] - minP[2]) * invExtent };
+
+		// Adding 0 folds -0 into +0 so both hash to the same position
+		float px = p[0] + 0.0f, py = p[1] + 0.0f, pz = p[2] + 0.0f;
+		PositionKey key;
+		memcpy(&key.x, &px, sizeof(float));
+		memcpy(&key.y, &py, sizeof(float));
+		memcpy(&key.z, &pz, sizeof(float));
+
+		pid[i] = positionIds.insert(make_pair(key, (uint32_t)i)).first->second;
+	}
+}
+
+
+void Simplifier::buildEdges() {
+
+	edges.clear();
+	edges.reserve(indices.size());
+
+	for (size_t t = 0; t < indices.size(); t += 3) {
+
+		for (int k = 0; k < 3; ++k) {
+
+			uint32_t a = pid[indices[t + k]];
+			uint32_t b = pid[indices[t + (k + 1) % 3]];
+			edges.push_back((uint64_t)a << 32 | b);
+		}
+	}
+
+	sort(edges.begin(), edges.end());
+}
+
+
+size_t Simplifier::edgeCount(uint32_t a, uint32_t b) const {
+
+	uint64_t key = (uint64_t)a << 32 | b;
+	auto range = equal_range(edges.begin(), edges.end(), key);
+	return range.second - range.first;
+}
+
+
+void Simplifier::buildAdjacency() {
+
+	adjOffset.assign(numVertices + 1, 0);
+
+	for (uint32_t i : indices)
+		adjOffset[pid[i] + 1]++;
+
+	for (size_t i = 0; i < numVertices; ++i)
+		adjOffset[i + 1] += adjOffset[i];
+
+	adjTriangles.resize(indices.size());
+
+	vector<uint32_t> fill(adjOffset.begin(), adjOffset.end() - 1);
+
+	for (size_t i = 0; i < indices.size(); ++i)
+		adjTriangles[fill[pid[indices[i]]]++] = (uint32_t)(i / 3);
+}
+
+
+void Simplifier::classifyVertices() {
+
+	kind.assign(numVertices, Locked);
+
+	vector<uint32_t> wedges;
+
+	for (uint32_t p = 0; p < numVertices; ++p) {
+
+		if (pid[p] != p || adjOffset[p] == adjOffset[p + 1])
+			continue;
+
+		int borderOut = 0, borderIn = 0;
+		bool nonManifold = false;
+
+		wedges.clear();
+
+		for (uint32_t a = adjOffset[p]; a < adjOffset[p + 1]; ++a) {
+
+			const uint32_t *tri = &indices[adjTriangles[a] * 3];
+			int k = (pid[tri[0]] == p) ? 0 : (pid[tri[1]] == p) ? 1 : 2;
+
+			uint32_t next = pid[tri[(k + 1) % 3]];
+			uint32_t prev = pid[tri[(k + 2) % 3]];
+
+			if (edgeCount(p, next) > 1)
+				nonManifold = true;
+
+			if (edgeCount(next, p) == 0)
+				borderOut++;
+
+			if (edgeCount(p, prev) == 0)
+				borderIn++;
+
+			wedges.push_back(tri[k]);
+		}
+
+		sort(wedges.begin(), wedges.end());
+		size_t numWedges = unique(wedges.begin(), wedges.end()) - wedges.begin();
+
+		if (nonManifold)
+			kind[p] = Locked;
+		else if (borderOut == 0 && borderIn == 0)
+			kind[p] = (numWedges == 1) ? Manifold : (numWedges == 2) ? Seam : Locked;
+		else if (borderOut == 1 && borderIn == 1 && numWedges == 1)
+			kind[p] = Border;
+		else
+			kind[p] = Locked;
+	}
+}
+
+
+void Simplifier::buildQuadrics() {
+
+	quadrics.assign(numVertices, Quadric());
+
+	for (size_t t = 0; t < indices.size(); t += 3) {
+
+		uint32_t p[3] = { pid[indices[t]], pid[indices[t + 1]], pid[indices[t + 2]] };
+
+		Vec3 n = cross(sub(positions[p[1]], positions[p[0]]), sub(positions[p[2]], positions[p[0]]));
+		float len = sqrtf(dot(n, n));
+
+		if (len == 0.0f)
+			continue;
+
+		n = { n.x / len, n.y / len, n.z / len };
+		float d = -dot(n, positions[p[0]]);
+		double area = 0.5 * len;
+
+		for (int k = 0; k < 3; ++k)
+			quadricAddPlane(quadrics[p[k]], n, d, area);
+
+		// Open border edges add a plane perpendicular to the triangle through the edge so border vertices only move along the border
+		for (int k = 0; k < 3; ++k) {
+
+			uint32_t a = p[k], b = p[(k + 1) % 3];
+
+			if (edgeCount(b, a) != 0)
+				continue;
+
+			Vec3 e = sub(positions[b], positions[a]);
+			Vec3 m = cross(e, n);
+			float mlen = sqrtf(dot(m, m));
+
+			if (mlen == 0.0f)
+				continue;
+
+			m = { m.x / mlen, m.y / mlen, m.z / mlen };
+			float md = -dot(m, positions[a]);
+			double w = borderWeight * dot(e, e);
+
+			quadricAddPlane(quadrics[a], m, md, w);
+			quadricAddPlane(quadrics[b], m, md, w);
+		}
+	}
+}
+
+
+bool Simplifier::canCollapse(uint32_t from, uint32_t to, bool borderEdge) const {
+
+	switch (kind[from]) {
+
+	case Manifold:
+		return true;
+
+	case Border:
+		return borderEdge && (kind[to] == Border || kind[to] == Locked);
+
+	case Seam:
+		return kind[to] == Seam || kind[to] == Locked;
+
+	default:
+		return false;
+	}
+}
+
+
+// For each wedge of from find the wedge of to it shares a triangle with.  Returns false if a wedge has no or more than one such wedge - the collapse would cross an attribute seam.
+bool Simplifier::mapWedges(uint32_t from, uint32_t to) {
+
+	wedgeMap.clear();
+
+	for (uint32_t a = adjOffset[from]; a < adjOffset[from + 1]; ++a) {
+
+		const uint32_t *tri = &indices[adjTriangles[a] * 3];
+		int k = (pid[tri[0]] == from) ? 0 : (pid[tri[1]] == from) ? 1 : 2;
+
+		uint32_t w = tri[k];
+		uint32_t u = (pid[tri[(k + 1) % 3]] == to) ? tri[(k + 1) % 3] : (pid[tri[(k + 2) % 3]] == to) ? tri[(k + 2) % 3] : UINT32_MAX;
+
+		auto it = find_if(wedgeMap.begin(), wedgeMap.end(), [w](const pair<uint32_t, uint32_t>& m) { return m.first == w; });
+
+		if (it == wedgeMap.end())
+			wedgeMap.push_back(make_pair(w, u));
+		else if (it->second == UINT32_MAX)
+			it->second = u;
+		else if (u != UINT32_MAX && u != it->second)
+			return false;
+	}
+
+	for (auto& m : wedgeMap)
+		if (m.second == UINT32_MAX)
+			return false;
+
+	return !wedgeMap.empty();
+}
+
+
+// Return true if moving from onto to flips any remaining triangle around from
+bool Simplifier::hasFlips(uint32_t from, uint32_t to) const {
+
+	for (uint32_t a = adjOffset[from]; a < adjOffset[from + 1]; ++a) {
+
+		const uint32_t *tri = &indices[adjTriangles[a] * 3];
+		uint32_t p[3] = { pid[tri[0]], pid[tri[1]], pid[tri[2]] };
+
+		// Triangles containing the edge are removed by the collapse
+		if (p[0] == to || p[1] == to || p[2] == to)
+			continue;
+
+		Vec3 v[3] = { positions[p[0]], positions[p[1]], positions[p[2]] };
+		Vec3 n0 = cross(sub(v[1], v[0]), sub(v[2], v[0]));
+
+		for (int k = 0; k < 3; ++k)
+			if (p[k] == from)
+				v[k] = positions[to];
+
+		Vec3 n1 = cross(sub(v[1], v[0]), sub(v[2], v[0]));
+
+		if (dot(n0, n1) <= 0.0f)
+			return true;
+	}
+
+	return false;
+}
+
+
+bool Simplifier::evaluate(uint32_t from, uint32_t to, bool borderEdge, Collapse& collapse) {
+
+	if (!canCollapse(from, to, borderEdge) || !mapWedges(from, to))
+		return false;
+
+	Vec3 e = sub(positions[to], positions[from]);
+	float edgeLengthSq = dot(e, e);
+
+	float attributeError = 0.0f;
+
+	for (auto& m : wedgeMap) {
+
+		const MeshVertex& w = vertices[m.first];
+		const MeshVertex& u = vertices[m.second];
+
+		float dn = 0.0f, duv = 0.0f;
+
+		for (int k = 0; k < 3; ++k)
+			dn += (w.normal[k] - u.normal[k]) * (w.normal[k] - u.normal[k]);
+
+		for (int k = 0; k < 2; ++k)
+			duv += (w.texCoord[k] - u.texCoord[k]) * (w.texCoord[k] - u.texCoord[k]);
+
+		attributeError = max(attributeError, normalWeight * dn + texCoordWeight * duv);
+	}
+
+	collapse.from = from;
+	collapse.to = to;
+	collapse.geometricCost = (float)quadricError(quadrics[from], positions[to]);
+	collapse.cost = collapse.geometricCost + attributeError * edgeLengthSq;
+
+	return true;
+}
+
+
+SimplifyResult simplifyMesh(const MeshVertex *vertices, size_t numVertices, const uint32_t *indices, size_t numIndices, size_t targetIndexCount, float maxError, vector<uint32_t>& result) {
+
+	SimplifyResult simplifyResult = { 0.0f, 0.0f };
+
+	result.assign(indices, indices + numIndices);
+
+	if (numIndices <= targetIndexCount || numVertices == 0)
+		return simplifyResult;
+
+	// Normalise positions to the unit cube so errors do not depend on model scale
+	float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for (size_t i = 0; i < numVertices; ++i) {
+
+		for (int k = 0; k < 3; ++k) {
+
+			minP[k] = min(minP[k], vertices[i].pos[k]);
+			maxP[k] = max(maxP[k], vertices[i].pos[k]);
+		}
+	}
+
+	float extent = max(maxP[0] - minP[0], max(maxP[1] - minP[1], maxP[2] - minP[2]));
+
+	if (extent <= 0.0f)
+		return simplifyResult;
+
+	Simplifier s(vertices, numVertices, result);
+
+	s.buildPositions(1.0f / extent, minP);
+	s.buildEdges();
+	s.buildQuadrics();
+
+	s.remap.resize(numVertices);
+
+	for (size_t i = 0; i < numVertices; ++i)
+		s.remap[i] = (uint32_t)i;
+
+	float maxErrorSq = (maxError / extent) * (maxError / extent);
+	float worstCost = 0.0f, worstGeometricCost = 0.0f;
+
+	vector<Collapse> collapses;
+
+	// Each pass collapses the cheapest set of independent edges (no two collapses share a triangle) then rebuilds the topology
+	while (result.size() > targetIndexCount) {
+
+		s.buildAdjacency();
+		s.classifyVertices();
+
+		collapses.clear();
+
+		for (size_t t = 0; t < result.size(); t += 3) {
+
+			for (int k = 0; k < 3; ++k) {
+
+				uint32_t a = s.pid[result[t + k]];
+				uint32_t b = s.pid[result[t + (k + 1) % 3]];
+
+				// Interior edges appear in two triangles - only evaluate them once
+				bool border = s.edgeCount(b, a) == 0;
+
+				if (a > b && !border)
+					continue;
+
+				Collapse ab, ba;
+				bool validAB = s.evaluate(a, b, border, ab);
+				bool validBA = s.evaluate(b, a, border, ba);
+
+				if (validAB && (!validBA || ab.cost <= ba.cost))
+					collapses.push_back(ab);
+				else if (validBA)
+					collapses.push_back(ba);
+			}
+		}
+
+		sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		s.locked.assign(numVertices, 0);
+
+		size_t goal = (result.size() - targetIndexCount + 2) / 3;
+		size_t removed = 0;
+		size_t numCollapses = 0;
+
+		for (const Collapse& c : collapses) {
+
+			if (removed >= goal || c.cost > maxErrorSq)
+				break;
+
+			if (s.locked[c.from] || s.locked[c.to])
+				continue;
+
+			if (s.hasFlips(c.from, c.to) || !s.mapWedges(c.from, c.to))
+				continue;
+
+			for (auto& m : s.wedgeMap)
+				s.remap[m.first] = m.second;
+
+			quadricAdd(s.quadrics[c.to], s.quadrics[c.from]);
+
+			// Lock the 1-ring so the triangles around every later collapse this pass are unchanged
+			for (uint32_t a = s.adjOffset[c.from]; a < s.adjOffset[c.from + 1]; ++a) {
+
+				const uint32_t *tri = &result[s.adjTriangles[a] * 3];
+
+				uint32_t p0 = s.pid[tri[0]], p1 = s.pid[tri[1]], p2 = s.pid[tri[2]];
+
+				s.locked[p0] = s.locked[p1] = s.locked[p2] = 1;
+
+				if (p0 == c.to || p1 == c.to || p2 == c.to)
+					removed++;
+			}
+
+			worstCost = max(worstCost, c.cost);
+			worstGeometricCost = max(worstGeometricCost, c.geometricCost);
+			numCollapses++;
+		}
+
+		if (numCollapses == 0)
+			break;
+
+		// Apply collapses and remove degenerate triangles
+		size_t write = 0;
+
+		for (size_t t = 0; t < result.size(); t += 3) {
+
+			uint32_t i0 = s.remap[result[t]], i1 = s.remap[result[t + 1]], i2 = s.remap[result[t + 2]];
+
+			if (s.pid[i0] == s.pid[i1] || s.pid[i1] == s.pid[i2] || s.pid[i0] == s.pid[i2])
+				continue;
+
+			result[write++] = i0;
+			result[write++] = i1;
+			result[write++] = i2;
+		}
+
+		result.resize(write);
+		s.buildEdges();
+	}
+
+	simplifyResult.error = sqrtf(worstCost) * extent;
+	simplifyResult.geometricError = sqrtf(worstGeometricCost) * extent;
+
+	return simplifyResult;
+}
+
+
+void generateLODs(MeshData& mesh, int numLODs, vector<LODStats> *stats) {
+
+	if (mesh.lods.empty())
+		return;
+
+	if (stats) {
+
+		uint32_t numTriangles = 0;
+
+		for (const SubMesh& subMesh : mesh.lods[0].subMeshes)
+			numTriangles += subMesh.indexCount / 3;
+
+		stats->push_back({ numTriangles, 0.0f, 0.0f, 0.0 });
+	}
+
+	vector<uint32_t> simplified;
+	float geometricError = 0.0f;
+
+	for (int lod = 1; lod < numLODs; ++lod) {
+
+		const MeshLOD& source = mesh.lods[lod - 1];
+		MeshLOD result = { {}, source.error };
+
+		float levelGeometricError = 0.0f;
+		uint32_t sourceTriangles = 0, resultTriangles = 0;
+
+		auto startTime = chrono::high_resolution_clock::now();
+
+		for (const SubMesh& subMesh : source.subMeshes) {
+
+			// Copy the source range - mesh.indices grows as the new level is appended
+			vector<uint32_t> sourceIndices(mesh.indices.begin() + subMesh.firstIndex, mesh.indices.begin() + subMesh.firstIndex + subMesh.indexCount);
+
+			const MeshVertex *vertices = &mesh.vertices[subMesh.baseVertex];
+
+			float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+			for (uint32_t i = 0; i < subMesh.vertexCount; ++i) {
+
+				for (int k = 0; k < 3; ++k) {
+
+					minP[k] = min(minP[k], vertices[i].pos[k]);
+					maxP[k] = max(maxP[k], vertices[i].pos[k]);
+				}
+			}
+
+			float extent = max(maxP[0] - minP[0], max(maxP[1] - minP[1], maxP[2] - minP[2]));
+			size_t target = (subMesh.indexCount / 6) * 3;
+
+			SimplifyResult r = simplifyMesh(vertices, subMesh.vertexCount, sourceIndices.data(), sourceIndices.size(), target, maxLODError * extent, simplified);
+
+			result.subMeshes.push_back({ subMesh.baseVertex, subMesh.vertexCount, (uint32_t)mesh.indices.size(), (uint32_t)simplified.size() });
+			mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+
+			result.error = max(result.error, source.error + r.error);
+			levelGeometricError = max(levelGeometricError, r.geometricError);
+
+			sourceTriangles += subMesh.indexCount / 3;
+			resultTriangles += (uint32_t)simplified.size() / 3;
+		}
+
+		double seconds = chrono::duration<double>(chrono::high_resolution_clock::now() - startTime).count();
+
+		// Stop when the mesh cannot be reduced further - remove the level just appended
+		if (resultTriangles * 20 > sourceTriangles * 19) {
+
+			mesh.indices.resize(result.subMeshes.empty() ? mesh.indices.size() : result.subMeshes[0].firstIndex);
+			break;
+		}
+
+		geometricError += levelGeometricError;
+
+		if (stats)
+			stats->push_back({ resultTriangles, result.error, geometricError, seconds });
+
+		mesh.lods.push_back(result);
+	}
+}
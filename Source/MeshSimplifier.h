@@ -0,0 +1,33 @@
+
+//
+// MeshSimplifier.h
+//
+
+// Quadric error metric mesh simplification used to build the LOD chain of imported models.  Simplification collapses vertices onto a neighbouring vertex (half-edge collapse) so simplified levels only need a new index list over the original vertices.  Collapse cost is the area weighted distance to the planes of the triangles merged into a vertex plus a penalty for the change in normal and texture coordinate.  Open borders are preserved by additional perpendicular border planes and border vertices only slide along the border.  Attribute seams (vertices with the same position but different normal / uv) are only collapsed along the seam.
+
+#pragma once
+#include <MeshData.h>
+#include <vector>
+#include <cstdint>
+
+
+// Result of simplifying a triangle list
+struct SimplifyResult {
+	float								error; // Largest collapse error (model units, includes attribute penalty)
+	float								geometricError; // Largest distance to the original surface planes (model units)
+};
+
+// Simplify the triangle list indices (relative to vertices) until at most targetIndexCount indices remain or no collapse below maxError (model units) is possible.  Vertices are not modified - result references the same vertices.
+SimplifyResult simplifyMesh(const MeshVertex *vertices, size_t numVertices, const uint32_t *indices, size_t numIndices, size_t targetIndexCount, float maxError, std::vector<uint32_t>& result);
+
+
+// Statistics for one generated LOD
+struct LODStats {
+	uint32_t							numTriangles;
+	float								error; // Model units, relative to LOD 0
+	float								geometricError;
+	double								seconds; // Time to simplify the level
+};
+
+// Append numLODs - 1 levels to mesh.lods, each with roughly half the triangles of the previous level.  Generation stops early if a level cannot be reduced further.  mesh.lods[0] must describe the full detail mesh.
+void generateLODs(MeshData& mesh, int numLODs, std::vector<LODStats> *stats = nullptr);
@@ -0,0 +1,463 @@
+
+#include "Meshlet.h"
+#include "Bounds.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+
+static inline float dot3(const float a[3], const float b[3]) {
+
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline float length3(const float a[3]) {
+
+	return sqrtf(dot3(a, a));
+}
+
+// Normalise a in place - returns false (and leaves a zero) if a has no length
+static bool normalise3(float a[3]) {
+
+	float len = length3(a);
+
+	if (len <= 0.0f) {
+
+		a[0] = a[1] = a[2] = 0.0f;
+		return false;
+	}
+
+	for (int i = 0; i < 3; ++i)
+		a[i] /= len;
+
+	return true;
+}
+
+// Spread the low 10 bits of v so there are two zero bits between each bit
+static uint32_t spreadBits(uint32_t v) {
+
+	v &= 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+
+	return v;
+}
+
+
+// Sphere and normal cone of the triangles tris (3 local indices each) of a SubMesh
+static void setMeshletBounds(Meshlet& meshlet, const MeshVertex *vertices, const uint32_t *tris, uint32_t numTriangles, const vector<float>& faceNormals, const uint32_t *triangleIds) {
+
+	vector<float> positions;
+	positions.reserve(numTriangles * 9);
+
+	for (uint32_t i = 0; i < numTriangles * 3; ++i)
+		positions.insert(positions.end(), vertices[tris[i]].pos, vertices[tris[i]].pos + 3);
+
+	Bounds bounds = computeBounds(positions.data(), numTriangles * 3, 3 * sizeof(float));
+
+	for (int i = 0; i < 3; ++i)
+		meshlet.centre[i] = bounds.sphereCentre[i];
+
+	meshlet.radius = bounds.sphereRadius;
+
+	// Cone axis is the average unit face normal - the cone is wide enough to contain every face normal
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+
+	for (uint32_t i = 0; i < numTriangles; ++i)
+		for (int j = 0; j < 3; ++j)
+			axis[j] += faceNormals[triangleIds[i] * 3 + j];
+
+	meshlet.coneCutoff = 1.0f;
+
+	if (!normalise3(axis)) {
+
+		meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+		return;
+	}
+
+	float minDot = 1.0f;
+
+	for (uint32_t i = 0; i < numTriangles; ++i) {
+
+		const float *n = &faceNormals[triangleIds[i] * 3];
+
+		// Degenerate triangles have no facing
+		if (n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f)
+			minDot = min(minDot, dot3(n, axis));
+	}
+
+	for (int i = 0; i < 3; ++i)
+		meshlet.coneAxis[i] = axis[i];
+
+	// Cones wider than ~85 degrees are (almost) never entirely back facing.  The cone is back facing when the view direction is within 90 degrees less the cone angle of the axis, so the cutoff is cos(90 - angle) = sin(angle).
+	if (minDot > 0.1f)
+		meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+
+MeshletBuildStats buildMeshlets(MeshData& mesh, uint32_t maxTriangles) {
+
+	auto start = chrono::steady_clock::now();
+
+	MeshletBuildStats stats = {};
+
+	mesh.meshlets.clear();
+
+	if (mesh.lods.empty() || mesh.vertices.empty())
+		return stats;
+
+	maxTriangles = max(1u, maxTriangles);
+	uint32_t minTriangles = max(1u, maxTriangles / 2);
+
+	const vector<SubMesh>& subMeshes = mesh.lods[0].subMeshes;
+	float totalCutoff = 0.0f;
+
+	for (uint32_t s = 0; s < (uint32_t)subMeshes.size(); ++s) {
+
+		const SubMesh& subMesh = subMeshes[s];
+		uint32_t numTriangles = subMesh.indexCount / 3;
+
+		if (numTriangles == 0)
+			continue;
+
+		const uint32_t *indices = &mesh.indices[subMesh.firstIndex];
+		const MeshVertex *vertices = &mesh.vertices[subMesh.baseVertex];
+
+		// Centroid and unit face normal of each triangle - the face normal is oriented to agree with the vertex normals so the winding order does not matter
+		vector<float> centroids(numTriangles * 3), faceNormals(numTriangles * 3);
+		float minCentroid[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxCentroid[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		float edgeSum = 0.0f;
+
+		for (uint32_t t = 0; t < numTriangles; ++t) {
+
+			const float *a = vertices[indices[t * 3]].pos;
+			const float *b = vertices[indices[t * 3 + 1]].pos;
+			const float *c = vertices[indices[t * 3 + 2]].pos;
+
+			float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float *n = &faceNormals[t * 3];
+
+			edgeSum += length3(e0) + length3(e1);
+			n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+			n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+			n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+
+			float vertexNormal[3];
+
+			for (int i = 0; i < 3; ++i) {
+
+				vertexNormal[i] = vertices[indices[t * 3]].normal[i] + vertices[indices[t * 3 + 1]].normal[i] + vertices[indices[t * 3 + 2]].normal[i];
+				centroids[t * 3 + i] = (a[i] + b[i] + c[i]) / 3.0f;
+				minCentroid[i] = min(minCentroid[i], centroids[t * 3 + i]);
+				maxCentroid[i] = max(maxCentroid[i], centroids[t * 3 + i]);
+			}
+
+			if (dot3(n, vertexNormal) < 0.0f)
+				for (int i = 0; i < 3; ++i)
+					n[i] = -n[i];
+
+			normalise3(n);
+		}
+
+		float averageEdge = edgeSum / (numTriangles * 2);
+
+		// Visit seed triangles in Morton order so consecutive meshlets are spatially close
+		vector<pair<uint32_t, uint32_t>> mortonOrder(numTriangles);
+
+		for (uint32_t t = 0; t < numTriangles; ++t) {
+
+			uint32_t code = 0;
+
+			for (int i = 0; i < 3; ++i) {
+
+				float extent = maxCentroid[i] - minCentroid[i];
+				float unit = extent > 0.0f ? (centroids[t * 3 + i] - minCentroid[i]) / extent : 0.0f;
+				code |= spreadBits((uint32_t)(unit * 1023.0f)) << i;
+			}
+
+			mortonOrder[t] = make_pair(code, t);
+		}
+
+		sort(mortonOrder.begin(), mortonOrder.end());
+
+		// Triangles using each vertex
+		vector<uint32_t> vertexOffsets(subMesh.vertexCount + 1, 0);
+		vector<uint32_t> vertexTriangles(numTriangles * 3);
+
+		for (uint32_t i = 0; i < numTriangles * 3; ++i)
+			vertexOffsets[indices[i] + 1]++;
+
+		for (uint32_t v = 0; v < subMesh.vertexCount; ++v)
+			vertexOffsets[v + 1] += vertexOffsets[v];
+
+		vector<uint32_t> fill(vertexOffsets.begin(), vertexOffsets.end() - 1);
+
+		for (uint32_t i = 0; i < numTriangles * 3; ++i)
+			vertexTriangles[fill[indices[i]]++] = i / 3;
+
+		// Grow each meshlet from the next unassigned triangle in Morton order
+		vector<uint8_t> assigned(numTriangles, 0);
+		vector<uint32_t> candidateOf(numTriangles, UINT32_MAX); // Meshlet that last added the triangle as a candidate
+		vector<uint32_t> reordered;
+		vector<uint32_t> meshletTriangles, candidates;
+		reordered.reserve(subMesh.indexCount);
+
+		uint32_t remaining = numTriangles;
+		size_t nextSeed = 0;
+
+		while (remaining > 0) {
+
+			uint32_t meshletId = (uint32_t)mesh.meshlets.size();
+			float centroidSum[3] = { 0.0f, 0.0f, 0.0f }, normalSum[3] = { 0.0f, 0.0f, 0.0f };
+
+			meshletTriangles.clear();
+			candidates.clear();
+
+			auto addTriangle = [&](uint32_t t) {
+
+				assigned[t] = 1;
+				--remaining;
+				meshletTriangles.push_back(t);
+
+				for (int i = 0; i < 3; ++i) {
+
+					centroidSum[i] += centroids[t * 3 + i];
+					normalSum[i] += faceNormals[t * 3 + i];
+				}
+
+				for (int corner = 0; corner < 3; ++corner) {
+
+					uint32_t v = indices[t * 3 + corner];
+
+					for (uint32_t j = vertexOffsets[v]; j < vertexOffsets[v + 1]; ++j) {
+
+						uint32_t neighbour = vertexTriangles[j];
+
+						if (!assigned[neighbour] && candidateOf[neighbour] != meshletId) {
+
+							candidateOf[neighbour] = meshletId;
+							candidates.push_back(neighbour);
+						}
+					}
+				}
+			};
+
+			auto nextUnassigned = [&]() {
+
+				while (assigned[mortonOrder[nextSeed].second])
+					++nextSeed;
+
+				return mortonOrder[nextSeed].second;
+			};
+
+			addTriangle(nextUnassigned());
+
+			while (meshletTriangles.size() < maxTriangles && remaining > 0) {
+
+				float n = (float)meshletTriangles.size();
+				float spread = max(averageEdge * sqrtf(n), FLT_MIN); // Approximate meshlet radius
+				float centre[3] = { centroidSum[0] / n, centroidSum[1] / n, centroidSum[2] / n };
+				float axis[3] = { normalSum[0], normalSum[1], normalSum[2] };
+				normalise3(axis);
+
+				// Prefer the neighbour closest to the meshlet centre (relative to its size) that faces the same way - this keeps meshlets compact and their normal cones narrow
+				size_t best = SIZE_MAX;
+				float bestScore = FLT_MAX;
+
+				for (size_t i = 0; i < candidates.size();) {
+
+					uint32_t t = candidates[i];
+
+					if (assigned[t]) {
+
+						candidates[i] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+
+					const float *c = &centroids[t * 3];
+					float d[3] = { c[0] - centre[0], c[1] - centre[1], c[2] - centre[2] };
+					float score = length3(d) / spread + 4.0f * (1.0f - dot3(&faceNormals[t * 3], axis));
+
+					if (score < bestScore) {
+
+						bestScore = score;
+						best = i;
+					}
+
+					++i;
+				}
+
+				if (best != SIZE_MAX) {
+
+					uint32_t t = candidates[best];
+					candidates[best] = candidates.back();
+					candidates.pop_back();
+					addTriangle(t);
+				}
+				else if (meshletTriangles.size() < minTriangles)
+					addTriangle(nextUnassigned()); // Disconnected piece - continue with the nearest triangle in Morton order
+				else
+					break;
+			}
+
+			Meshlet meshlet;
+			meshlet.firstIndex = subMesh.firstIndex + (uint32_t)reordered.size();
+			meshlet.indexCount = (uint32_t)meshletTriangles.size() * 3;
+			meshlet.subMesh = s;
+
+			for (uint32_t t : meshletTriangles)
+				reordered.insert(reordered.end(), indices + t * 3, indices + t * 3 + 3);
+
+			setMeshletBounds(meshlet, vertices, &reordered[meshlet.firstIndex - subMesh.firstIndex], (uint32_t)meshletTriangles.size(), faceNormals, meshletTriangles.data());
+
+			totalCutoff += meshlet.coneCutoff;
+			mesh.meshlets.push_back(meshlet);
+		}
+
+		copy(reordered.begin(), reordered.end(), mesh.indices.begin() + subMesh.firstIndex);
+		stats.numTriangles += numTriangles;
+	}
+
+	stats.numMeshlets = (uint32_t)mesh.meshlets.size();
+	stats.averageTriangles = stats.numMeshlets ? (float)stats.numTriangles / stats.numMeshlets : 0.0f;
+	stats.averageConeCutoff = stats.numMeshlets ? totalCutoff / stats.numMeshlets : 0.0f;
+	stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	return stats;
+}
+
+
+void extractFrustumPlanes(const float m[16], float planes[6][4]) {
+
+	// clip = p * m so each clip coordinate is the dot product of p with a column of m
+	for (int i = 0; i < 4; ++i) {
+
+		float x = m[i * 4], y = m[i * 4 + 1], z = m[i * 4 + 2], w = m[i * 4 + 3];
+
+		planes[0][i] = w + x; // Left
+		planes[1][i] = w - x; // Right
+		planes[2][i] = w + y; // Bottom
+		planes[3][i] = w - y; // Top
+		planes[4][i] = z; // Near
+		planes[5][i] = w - z; // Far
+	}
+}
+
+
+void cullMeshlets(const Meshlet *meshlets, size_t count, const SubMesh *subMeshes, const float planes[6][4], const float *cameraPos, vector<IndexRange>& ranges, MeshletCullStats *stats) {
+
+	size_t firstRange = ranges.size();
+	MeshletCullStats result = {};
+
+	// Planes are not normalised - the sphere radius is scaled by the length of the plane normal instead
+	float planeScale[6];
+
+	for (int p = 0; p < 6; ++p)
+		planeScale[p] = length3(planes[p]);
+
+	for (size_t i = 0; i < count; ++i) {
+
+		const Meshlet& meshlet = meshlets[i];
+		uint32_t numTriangles = meshlet.indexCount / 3;
+
+		result.numTriangles += numTriangles;
+
+		bool inside = true;
+
+		for (int p = 0; p < 6 && inside; ++p)
+			inside = dot3(planes[p], meshlet.centre) + planes[p][3] >= -meshlet.radius * planeScale[p];
+
+		if (!inside) {
+
+			result.frustumCulled++;
+			continue;
+		}
+
+		if (cameraPos && meshlet.coneCutoff < 1.0f) {
+
+			float view[3] = { meshlet.centre[0] - cameraPos[0], meshlet.centre[1] - cameraPos[1], meshlet.centre[2] - cameraPos[2] };
+
+			if (dot3(view, meshlet.coneAxis) >= meshlet.coneCutoff * length3(view) + meshlet.radius) {
+
+				result.backfaceCulled++;
+				continue;
+			}
+		}
+
+		result.visibleTriangles += numTriangles;
+
+		uint32_t baseVertex = subMeshes[meshlet.subMesh].baseVertex;
+
+		// Merge with the previous visible meshlet if their index ranges are adjacent
+		if (ranges.size() > firstRange && ranges.back().baseVertex == baseVertex && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex)
+			ranges.back().indexCount += meshlet.indexCount;
+		else
+			ranges.push_back({ meshlet.firstIndex, meshlet.indexCount, baseVertex });
+	}
+
+	result.numMeshlets = (uint32_t)count;
+	result.numRanges = (uint32_t)(ranges.size() - firstRange);
+
+	if (stats)
+		*stats = result;
+}
+
+
+void lookAtLH(const float eye[3], const float target[3], float m[16]) {
+
+	float z[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+	normalise3(z);
+
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+
+	if (fabsf(z[1]) > 0.99f) {
+
+		up[1] = 0.0f;
+		up[2] = 1.0f;
+	}
+
+	float x[3] = { up[1] * z[2] - up[2] * z[1], up[2] * z[0] - up[0] * z[2], up[0] * z[1] - up[1] * z[0] };
+	normalise3(x);
+
+	float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+
+	for (int i = 0; i < 3; ++i) {
+
+		m[i * 4] = x[i];
+		m[i * 4 + 1] = y[i];
+		m[i * 4 + 2] = z[i];
+		m[i * 4 + 3] = 0.0f;
+	}
+
+	m[12] = -dot3(x, eye);
+	m[13] = -dot3(y, eye);
+	m[14] = -dot3(z, eye);
+	m[15] = 1.0f;
+}
+
+void perspectiveFovLH(float fovY, float aspect, float zNear, float zFar, float m[16]) {
+
+	float h = 1.0f / tanf(0.5f * fovY);
+	float q = zFar / (zFar - zNear);
+
+	fill(m, m + 16, 0.0f);
+	m[0] = h / aspect;
+	m[5] = h;
+	m[10] = q;
+	m[11] = 1.0f;
+	m[14] = -q * zNear;
+}
+
+void multiplyMatrices(const float a[16], const float b[16], float result[16]) {
+
+	for (int row = 0; row < 4; ++row)
+		for (int col = 0; col < 4; ++col)
+			result[row * 4 + col] = a[row * 4] * b[col] + a[row * 4 + 1] * b[4 + col] + a[row * 4 + 2] * b[8 + col] + a[row * 4 + 3] * b[12 + col];
+}
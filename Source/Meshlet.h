@@ -0,0 +1,55 @@
+
+//
+// Meshlet.h
+//
+
+// Meshlet (cluster) building and culling.  buildMeshlets partitions each LOD 0 SubMesh into clusters of up to maxTriangles neighbouring triangles - triangles are visited in Morton order of their centroids and each cluster grows across shared vertices towards the triangles closest to its centre and normal - and reorders the LOD 0 indices so every cluster is a contiguous index range.  Each cluster has a bounding sphere and a normal cone.
+// cullMeshlets tests each cluster against the view frustum and (optionally) its normal cone against the camera position and returns the visible index ranges with adjacent ranges merged, so large meshes are drawn with a few DrawIndexed calls covering only the visible clusters.
+
+#pragma once
+#include <MeshData.h>
+#include <vector>
+#include <cstdint>
+
+
+// Default cluster size.  Clusters are only closed below half this size when their SubMesh has no more triangles.
+static const uint32_t defaultMeshletTriangles = 128;
+
+struct MeshletBuildStats {
+	uint32_t							numMeshlets;
+	uint32_t							numTriangles;
+	float								averageTriangles; // Per meshlet
+	float								averageConeCutoff; // Lower is easier to cull
+	double								seconds;
+};
+
+// Range of the index buffer to draw
+struct IndexRange {
+	uint32_t							firstIndex;
+	uint32_t							indexCount;
+	uint32_t							baseVertex;
+};
+
+struct MeshletCullStats {
+	uint32_t							numMeshlets;
+	uint32_t							frustumCulled;
+	uint32_t							backfaceCulled;
+	uint32_t							numTriangles;
+	uint32_t							visibleTriangles;
+	uint32_t							numRanges; // Draw calls after merging adjacent ranges
+};
+
+
+// Build mesh.meshlets from mesh.lods[0] (mesh.vertices must hold the full precision vertices).  The LOD 0 index ranges are reordered - simplified LODs are not changed.
+MeshletBuildStats buildMeshlets(MeshData& mesh, uint32_t maxTriangles = defaultMeshletTriangles);
+
+// Frustum planes (a, b, c, d with ax + by + cz + d >= 0 inside) of a row vector view-projection matrix with a D3D [0, 1] depth range.  If the matrix includes a world matrix the planes are in model space.
+void extractFrustumPlanes(const float matrix[16], float planes[6][4]);
+
+// Row vector look-at and perspective matrices matching XMMatrixLookAtLH and XMMatrixPerspectiveFovLH, and their product, for building views without DirectXMath (used by the culling tests and benchmarks)
+void lookAtLH(const float eye[3], const float target[3], float m[16]);
+void perspectiveFovLH(float fovY, float aspect, float zNear, float zFar, float m[16]);
+void multiplyMatrices(const float a[16], const float b[16], float result[16]);
+
+// Append the index ranges of the meshlets that are inside the frustum to ranges.  planes and cameraPos must be in the space of the mesh (model space).  Meshlets facing away from cameraPos are also culled unless cameraPos is null (for effects that do not cull back faces).  subMeshes are mesh.lods[0].subMeshes.
+void cullMeshlets(const Meshlet *meshlets, size_t count, const SubMesh *subMeshes, const float planes[6][4], const float *cameraPos, std::vector<IndexRange>& ranges, MeshletCullStats *stats = nullptr);
@@ -0,0 +1,553 @@
+
+#include "MipGenerator.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_SSE
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+
+// Half width of the windowed sinc filters in destination texels
+static const float sincFilterWidth = 3.0f;
+
+// Kaiser window shape - larger values trade sharpness for less ringing
+static const float kaiserAlpha = 4.0f;
+
+// Levels smaller than this (in texels) are filtered on the calling thread only
+static const size_t minParallelTexels = 64 * 1024;
+
+// Rows handed to a thread at a time
+static const uint32_t rowsPerTask = 8;
+
+// Entries in the linear to sRGB table
+static const int linearToSRGBSize = 8192;
+
+static const float pi = 3.14159265358979f;
+
+
+const char *getFilterName(MipFilter filter) {
+
+	switch (filter) {
+
+	case MipFilter::Box: return "box";
+	case MipFilter::Kaiser: return "Kaiser";
+	default: return "Lanczos";
+	}
+}
+
+
+static bool nameContains(const string& name, const char *pattern) {
+
+	return name.find(pattern) != string::npos;
+}
+
+
+MipOptions getDefaultMipOptions(const string& filename) {
+
+	string name = filename.substr(filename.find_last_of("/\\") + 1);
+
+	for (char& c : name)
+		c = (char)tolower((unsigned char)c);
+
+	MipOptions options;
+
+	if (nameContains(name, "normal") || nameContains(name, "waves")) {
+
+		options.normalMap = true;
+		options.sRGB = false;
+	}
+	else if (nameContains(name, "height") || nameContains(name, "disp") || nameContains(name, "spec"))
+		options.sRGB = false;
+
+	if (nameContains(name, "grass") || nameContains(name, "tree") || nameContains(name, "leaf") || nameContains(name, "foliage"))
+		options.alphaCoverageReference = 0.5f;
+
+	return options;
+}
+
+
+uint32_t getMipLevelCount(uint32_t width, uint32_t height) {
+
+	uint32_t levels = 1;
+
+	for (uint32_t size = max(width, height); size > 1; size >>= 1)
+		++levels;
+
+	return levels;
+}
+
+
+ImageData resizeImage(const ImageData& image, uint32_t width, uint32_t height) {
+
+	if (image.width == 0 || image.height == 0 || image.pixels.size() != (size_t)image.width * image.height * 4 || width == 0 || height == 0)
+		throw runtime_error("Invalid image for resizing");
+
+	ImageData result;
+	result.width = width;
+	result.height = height;
+	result.pixels.resize((size_t)width * height * 4);
+
+	float scaleX = (float)image.width / width;
+	float scaleY = (float)image.height / height;
+
+	for (uint32_t y = 0; y < height; ++y) {
+
+		float sy = max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+		uint32_t y0 = min((uint32_t)sy, image.height - 1);
+		uint32_t y1 = min(y0 + 1, image.height - 1);
+		float fy = sy - y0;
+
+		for (uint32_t x = 0; x < width; ++x) {
+
+			float sx = max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+			uint32_t x0 = min((uint32_t)sx, image.width - 1);
+			uint32_t x1 = min(x0 + 1, image.width - 1);
+			float fx = sx - x0;
+
+			const uint8_t *t00 = &image.pixels[((size_t)y0 * image.width + x0) * 4];
+			const uint8_t *t01 = &image.pixels[((size_t)y0 * image.width + x1) * 4];
+			const uint8_t *t10 = &image.pixels[((size_t)y1 * image.width + x0) * 4];
+			const uint8_t *t11 = &image.pixels[((size_t)y1 * image.width + x1) * 4];
+
+			uint8_t *target = &result.pixels[((size_t)y * width + x) * 4];
+
+			for (int j = 0; j < 4; ++j) {
+
+				float top = t00[j] + (t01[j] - t00[j]) * fx;
+				float bottom = t10[j] + (t11[j] - t10[j]) * fx;
+
+				target[j] = (uint8_t)min(255.0f, top + (bottom - top) * fy + 0.5f);
+			}
+		}
+	}
+
+	return result;
+}
+
+
+//
+// Filter kernels
+//
+
+static float sinc(float x) {
+
+	if (fabs(x) < 1e-5f)
+		return 1.0f;
+
+	x *= pi;
+
+	return sin(x) / x;
+}
+
+
+// Modified Bessel function of the first kind (order 0) for the Kaiser window
+static float besselI0(float x) {
+
+	float sum = 1.0f, term = 1.0f;
+
+	for (int k = 1; k < 32 && term > sum * 1e-8f; ++k) {
+
+		float f = x / (2.0f * k);
+		term *= f * f;
+		sum += term;
+	}
+
+	return sum;
+}
+
+
+// Weight of a source texel t destination texels from the centre of a destination texel
+static float sincFilterWeight(MipFilter filter, float t) {
+
+	if (fabs(t) >= sincFilterWidth)
+		return 0.0f;
+
+	if (filter == MipFilter::Lanczos)
+		return sinc(t) * sinc(t / sincFilterWidth);
+
+	float ratio = t / sincFilterWidth;
+
+	return sinc(t) * besselI0(kaiserAlpha * sqrt(1.0f - ratio * ratio)) / besselI0(kaiserAlpha);
+}
+
+
+// Source texels and weights of each destination texel along one axis.  Every destination texel has numTaps entries (unused entries have zero weight).
+struct FilterKernel {
+	int									numTaps;
+	vector<uint32_t>					indices; // Clamped to the source
+	vector<float>						weights; // Sum to 1 for each destination texel
+};
+
+
+static FilterKernel buildKernel(MipFilter filter, uint32_t sourceSize, uint32_t targetSize) {
+
+	float scale = (float)sourceSize / targetSize;
+
+	// Support radius in source texels - the box covers exactly the footprint of the destination texel
+	float support = (filter == MipFilter::Box) ? 0.5f * scale : sincFilterWidth * scale;
+
+	FilterKernel kernel;
+	kernel.numTaps = (int)ceil(2.0f * support) + 2;
+	kernel.indices.resize((size_t)targetSize * kernel.numTaps);
+	kernel.weights.resize((size_t)targetSize * kernel.numTaps);
+
+	for (uint32_t x = 0; x < targetSize; ++x) {
+
+		// Source texel j covers [j, j + 1]
+		float centre = (x + 0.5f) * scale;
+		int first = (int)floor(centre - support);
+		float total = 0.0f;
+
+		uint32_t *indices = &kernel.indices[(size_t)x * kernel.numTaps];
+		float *weights = &kernel.weights[(size_t)x * kernel.numTaps];
+
+		for (int k = 0; k < kernel.numTaps; ++k) {
+
+			int j = first + k;
+			float weight;
+
+			if (filter == MipFilter::Box)
+				weight = max(0.0f, min(j + 1.0f, centre + support) - max((float)j, centre - support));
+			else
+				weight = sincFilterWeight(filter, (j + 0.5f - centre) / scale);
+
+			indices[k] = (uint32_t)min(max(j, 0), (int)sourceSize - 1);
+			weights[k] = weight;
+			total += weight;
+		}
+
+		for (int k = 0; k < kernel.numTaps; ++k)
+			weights[k] /= total;
+	}
+
+	return kernel;
+}
+
+
+//
+// Separable filtering of RGBA float images
+//
+
+// Filter rows [firstRow, endRow) of source horizontally into target (targetWidth texels per row)
+static void filterRows(const float *source, uint32_t sourceWidth, const FilterKernel& kernel, float *target, uint32_t targetWidth, uint32_t firstRow, uint32_t endRow, bool useSIMD) {
+
+	for (uint32_t y = firstRow; y < endRow; ++y) {
+
+		const float *sourceRow = source + (size_t)y * sourceWidth * 4;
+		float *targetRow = target + (size_t)y * targetWidth * 4;
+
+		for (uint32_t x = 0; x < targetWidth; ++x) {
+
+			const uint32_t *indices = &kernel.indices[(size_t)x * kernel.numTaps];
+			const float *weights = &kernel.weights[(size_t)x * kernel.numTaps];
+
+#ifdef MIP_SSE
+			if (useSIMD) {
+
+				__m128 sum = _mm_setzero_ps();
+
+				for (int k = 0; k < kernel.numTaps; ++k)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(sourceRow + indices[k] * 4), _mm_set1_ps(weights[k])));
+
+				_mm_storeu_ps(targetRow + x * 4, sum);
+				continue;
+			}
+#endif
+			float sum[4] = {};
+
+			for (int k = 0; k < kernel.numTaps; ++k)
+				for (int j = 0; j < 4; ++j)
+					sum[j] += sourceRow[indices[k] * 4 + j] * weights[k];
+
+			memcpy(targetRow + x * 4, sum, sizeof(sum));
+		}
+	}
+}
+
+
+// Filter rows [firstRow, endRow) of target vertically from source (both width texels per row)
+static void filterColumns(const float *source, uint32_t width, const FilterKernel& kernel, float *target, uint32_t firstRow, uint32_t endRow, bool useSIMD) {
+
+	size_t rowFloats = (size_t)width * 4;
+
+	for (uint32_t y = firstRow; y < endRow; ++y) {
+
+		const uint32_t *indices = &kernel.indices[(size_t)y * kernel.numTaps];
+		const float *weights = &kernel.weights[(size_t)y * kernel.numTaps];
+		float *targetRow = target + y * rowFloats;
+
+		memset(targetRow, 0, rowFloats * sizeof(float));
+
+		// Accumulate whole source rows so the inner loop runs along contiguous memory
+		for (int k = 0; k < kernel.numTaps; ++k) {
+
+			const float *sourceRow = source + indices[k] * rowFloats;
+			size_t i = 0;
+
+#ifdef MIP_SSE
+			if (useSIMD) {
+
+				__m128 weight = _mm_set1_ps(weights[k]);
+
+				for (; i < rowFloats; i += 4)
+					_mm_storeu_ps(targetRow + i, _mm_add_ps(_mm_loadu_ps(targetRow + i), _mm_mul_ps(_mm_loadu_ps(sourceRow + i), weight)));
+			}
+#endif
+			for (; i < rowFloats; ++i)
+				targetRow[i] += sourceRow[i] * weights[k];
+		}
+	}
+}
+
+
+// Call task for blocks of rows in [0, numRows) on up to numThreads threads (including the caller)
+static void parallelRows(uint32_t numRows, unsigned int numThreads, const function<void(uint32_t, uint32_t)>& task) {
+
+	atomic<uint32_t> nextRow(0);
+
+	auto worker = [&]() {
+
+		for (uint32_t first = nextRow.fetch_add(rowsPerTask); first < numRows; first = nextRow.fetch_add(rowsPerTask))
+			task(first, min(first + rowsPerTask, numRows));
+	};
+
+	numThreads = max(1u, min(numThreads, (numRows + rowsPerTask - 1) / rowsPerTask));
+
+	vector<thread> workers;
+
+	for (unsigned int t = 1; t < numThreads; ++t)
+		workers.push_back(thread(worker));
+
+	worker();
+
+	for (thread& t : workers)
+		t.join();
+}
+
+
+// Halve a float RGBA level
+static void downsample(const vector<float>& source, uint32_t sourceWidth, uint32_t sourceHeight, vector<float>& target, uint32_t targetWidth, uint32_t targetHeight, MipFilter filter, unsigned int numThreads, bool useSIMD) {
+
+	FilterKernel horizontal = buildKernel(filter, sourceWidth, targetWidth);
+	FilterKernel vertical = buildKernel(filter, sourceHeight, targetHeight);
+
+	if ((size_t)sourceWidth * sourceHeight < minParallelTexels)
+		numThreads = 1;
+
+	vector<float> rows((size_t)targetWidth * sourceHeight * 4);
+	target.resize((size_t)targetWidth * targetHeight * 4);
+
+	parallelRows(sourceHeight, numThreads, [&](uint32_t first, uint32_t end) { filterRows(source.data(), sourceWidth, horizontal, rows.data(), targetWidth, first, end, useSIMD); });
+	parallelRows(targetHeight, numThreads, [&](uint32_t first, uint32_t end) { filterColumns(rows.data(), targetWidth, vertical, target.data(), first, end, useSIMD); });
+}
+
+
+//
+// Colour conversion
+//
+
+static float sRGBToLinear(float c) {
+
+	return c <= 0.04045f ? c / 12.92f : pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+
+static float linearToSRGB(float c) {
+
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+
+struct ColourTables {
+	float								sRGBToLinear[256];
+	uint8_t								linearToSRGB[linearToSRGBSize];
+
+	ColourTables() {
+
+		for (int i = 0; i < 256; ++i)
+			sRGBToLinear[i] = ::sRGBToLinear(i / 255.0f);
+
+		for (int i = 0; i < linearToSRGBSize; ++i)
+			linearToSRGB[i] = (uint8_t)(::linearToSRGB(i / (float)(linearToSRGBSize - 1)) * 255.0f + 0.5f);
+	}
+};
+
+static const ColourTables& getColourTables() {
+
+	static const ColourTables tables;
+
+	return tables;
+}
+
+
+static void toFloat(const ImageData& image, const MipOptions& options, vector<float>& texels) {
+
+	const ColourTables& tables = getColourTables();
+	bool sRGB = options.sRGB && !options.normalMap;
+
+	texels.resize(image.pixels.size());
+
+	for (size_t i = 0; i < image.pixels.size(); ++i)
+		texels[i] = (sRGB && (i & 3) != 3) ? tables.sRGBToLinear[image.pixels[i]] : image.pixels[i] / 255.0f;
+}
+
+
+static inline float saturate(float x) {
+
+	return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+
+static void toImage(const vector<float>& texels, uint32_t width, uint32_t height, const MipOptions& options, float alphaScale, ImageData& image) {
+
+	const ColourTables& tables = getColourTables();
+	bool sRGB = options.sRGB && !options.normalMap;
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize(texels.size());
+
+	for (size_t i = 0; i < texels.size(); i += 4) {
+
+		for (int j = 0; j < 3; ++j) {
+
+			float c = saturate(texels[i + j]);
+			image.pixels[i + j] = sRGB ? tables.linearToSRGB[(int)(c * (linearToSRGBSize - 1) + 0.5f)] : (uint8_t)(c * 255.0f + 0.5f);
+		}
+
+		image.pixels[i + 3] = (uint8_t)(saturate(texels[i + 3] * alphaScale) * 255.0f + 0.5f);
+	}
+}
+
+
+// Renormalise packed normals in place
+static void renormalise(vector<float>& texels) {
+
+	for (size_t i = 0; i < texels.size(); i += 4) {
+
+		float n[3], lengthSquared = 0.0f;
+
+		for (int j = 0; j < 3; ++j) {
+
+			n[j] = texels[i + j] * 2.0f - 1.0f;
+			lengthSquared += n[j] * n[j];
+		}
+
+		if (lengthSquared < 1e-8f)
+			continue;
+
+		float scale = 1.0f / sqrt(lengthSquared);
+
+		for (int j = 0; j < 3; ++j)
+			texels[i + j] = n[j] * scale * 0.5f + 0.5f;
+	}
+}
+
+
+static float alphaCoverage(const vector<float>& texels, float reference, float scale) {
+
+	size_t covered = 0;
+
+	for (size_t i = 3; i < texels.size(); i += 4)
+		covered += (texels[i] * scale >= reference) ? 1 : 0;
+
+	return (float)covered / (texels.size() / 4);
+}
+
+
+// Alpha scale that gives the level the target coverage (Castano, "Computing Alpha Mipmaps").  Coverage grows with the scale so it is found by bisection.
+static float findAlphaScale(const vector<float>& texels, float reference, float targetCoverage) {
+
+	// Levels that already match (opaque textures, or opaque regions of an atlas) are left unscaled rather than scaled down to the smallest scale with the same coverage
+	if (alphaCoverage(texels, reference, 1.0f) == targetCoverage)
+		return 1.0f;
+
+	float low = 0.0f, high = 4.0f;
+
+	for (int iteration = 0; iteration < 16; ++iteration) {
+
+		float scale = 0.5f * (low + high);
+
+		if (alphaCoverage(texels, reference, scale) < targetCoverage)
+			low = scale;
+		else
+			high = scale;
+	}
+
+	return high;
+}
+
+
+static vector<ImageData> generateMipChain(const ImageData& image, const MipOptions& options, bool useSIMD) {
+
+	if (image.width == 0 || image.height == 0 || image.pixels.size() != (size_t)image.width * image.height * 4)
+		throw runtime_error("Invalid image for mip generation");
+
+	uint32_t numLevels = getMipLevelCount(image.width, image.height);
+
+	vector<ImageData> mips(numLevels);
+	mips[0] = image;
+
+	if (numLevels == 1)
+		return mips;
+
+	vector<float> level, next;
+	toFloat(image, options, level);
+
+	float targetCoverage = (options.alphaCoverageReference > 0.0f) ? alphaCoverage(level, options.alphaCoverageReference, 1.0f) : 0.0f;
+
+	uint32_t width = image.width, height = image.height;
+
+	for (uint32_t i = 1; i < numLevels; ++i) {
+
+		uint32_t nextWidth = max(1u, width / 2);
+		uint32_t nextHeight = max(1u, height / 2);
+
+		// Each level is filtered from the unscaled float level above so rounding and alpha scaling do not accumulate
+		downsample(level, width, height, next, nextWidth, nextHeight, options.filter, options.numThreads, useSIMD);
+
+		if (options.normalMap)
+			renormalise(next);
+
+		float alphaScale = (options.alphaCoverageReference > 0.0f) ? findAlphaScale(next, options.alphaCoverageReference, targetCoverage) : 1.0f;
+
+		toImage(next, nextWidth, nextHeight, options, alphaScale, mips[i]);
+
+		swap(level, next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	return mips;
+}
+
+
+vector<ImageData> generateMipChain(const ImageData& image, const MipOptions& options) {
+
+	return generateMipChain(image, options, true);
+}
+
+vector<ImageData> generateMipChainScalar(const ImageData& image, const MipOptions& options) {
+
+	return generateMipChain(image, options, false);
+}
+
+
+float getAlphaCoverage(const ImageData& image, float reference) {
+
+	size_t covered = 0;
+
+	for (size_t i = 3; i < image.pixels.size(); i += 4)
+		covered += (image.pixels[i] >= reference * 255.0f) ? 1 : 0;
+
+	return image.pixels.empty() ? 0.0f : (float)covered / (image.pixels.size() / 4);
+}
@@ -0,0 +1,45 @@
+
+//
+// MipGenerator.h
+//
+
+// Mip chain generation for loaded and cooked textures.  Each level halves the level above (rounding down, minimum 1) with a separable box, Kaiser windowed sinc or Lanczos-3 filter evaluated in float.  The filter weights are computed once per level and axis for the exact size ratio so odd sizes are filtered correctly, and texels outside the image are clamped.
+// Colour is averaged in linear light (sRGB decoded through a table and encoded again for each level) so mips do not darken, normal maps are renormalised after filtering, and alpha tested textures (foliage) can have the alpha of each level scaled so the fraction of texels passing the alpha test matches the top level - otherwise distant grass and leaves thin out and disappear.
+// Rows are filtered with SSE (one RGBA texel per register) and split across threads - the result does not depend on the number of threads.
+
+#pragma once
+#include <ImageData.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+enum class MipFilter { Box, Kaiser, Lanczos };
+
+struct MipOptions {
+	MipFilter							filter = MipFilter::Kaiser;
+	bool								sRGB = true; // rgb is sRGB encoded colour - filtered in linear light.  Alpha is always linear.
+	bool								normalMap = false; // rgb holds a unit vector packed as 0.5 * n + 0.5 (implies sRGB = false)
+	float								alphaCoverageReference = 0.0f; // If > 0 scale alpha so the fraction of texels with alpha >= reference is the same in every level
+	unsigned int						numThreads = 1;
+};
+
+const char *getFilterName(MipFilter filter);
+
+// Options for a texture file by naming convention - normal maps ("normal", "waves"), linear data ("height", "disp", "spec") and alpha tested foliage ("grass", "tree", "leaf", "foliage") are recognised, anything else is treated as sRGB colour
+MipOptions getDefaultMipOptions(const std::string& filename);
+
+// Number of levels in a full mip chain down to 1x1
+uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+// Bilinear resample of image to width x height (texel centres aligned).  Used to round textures up to whole compression blocks - texture coordinates are normalised so the resized texture maps the same way.
+ImageData resizeImage(const ImageData& image, uint32_t width, uint32_t height);
+
+// Full mip chain of image, largest (a copy of image) first
+std::vector<ImageData> generateMipChain(const ImageData& image, const MipOptions& options = MipOptions());
+
+// Scalar reference of generateMipChain with the same summation order.  Used to check and time the SSE filters.
+std::vector<ImageData> generateMipChainScalar(const ImageData& image, const MipOptions& options = MipOptions());
+
+// Fraction of texels with alpha >= reference (0 - 1)
+float getAlphaCoverage(const ImageData& image, float reference);
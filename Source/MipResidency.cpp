@@ -0,0 +1,394 @@
+
+#include "MipResidency.h"
+#include <algorithm>
+#include <queue>
+#include <stdexcept>
+#include <cmath>
+#include <chrono>
+
+using namespace std;
+
+
+MipResidency::TextureState& MipResidency::getState(uint32_t texture) {
+
+	if (texture == 0 || texture > textures.size() || !textures[texture - 1].active)
+		throw runtime_error("Invalid streamed texture id");
+
+	return textures[texture - 1];
+}
+
+
+size_t MipResidency::getResidentBytes(const TextureState& state) const {
+
+	size_t bytes = 0;
+
+	for (size_t level = state.residentLevel; level < state.levelBytes.size(); ++level)
+		bytes += state.levelBytes[level];
+
+	return bytes;
+}
+
+
+float MipResidency::getNeededLevel(const TextureState& state) const {
+
+	float level = (float)state.startupLevel;
+
+	if (state.requested)
+		level = state.wantedLevel;
+	else if (frame - state.lastUsedFrame <= options.keepFrames)
+		level = state.lastWantedLevel;
+
+	return min(max(level, 0.0f), (float)state.startupLevel);
+}
+
+
+uint32_t MipResidency::addTexture(uint32_t width, uint32_t height, const vector<size_t>& levelBytes, uint32_t maxTopLevel) {
+
+	if (width == 0 || height == 0 || levelBytes.empty())
+		throw runtime_error("Invalid streamed texture");
+
+	TextureState state;
+	state.width = width;
+	state.height = height;
+	state.levelBytes = levelBytes;
+	state.active = true;
+
+	uint32_t lastLevel = min((uint32_t)levelBytes.size() - 1, maxTopLevel);
+
+	while (state.startupLevel < lastLevel && (max(1u, width >> state.startupLevel) > options.startupSize || max(1u, height >> state.startupLevel) > options.startupSize))
+		++state.startupLevel;
+
+	state.residentLevel = state.startupLevel;
+	state.lastWantedLevel = (float)state.startupLevel;
+	state.lastUsedFrame = frame;
+
+	residentBytes += getResidentBytes(state);
+
+	if (!freeIds.empty()) {
+
+		uint32_t texture = freeIds.back();
+		freeIds.pop_back();
+
+		textures[texture - 1] = state;
+		return texture;
+	}
+
+	textures.push_back(state);
+	return (uint32_t)textures.size();
+}
+
+
+void MipResidency::removeTexture(uint32_t texture) {
+
+	TextureState& state = getState(texture);
+
+	residentBytes -= getResidentBytes(state);
+
+	if (state.loading)
+		loadingBytes -= state.levelBytes[state.residentLevel - 1];
+
+	state = TextureState();
+	freeIds.push_back(texture);
+}
+
+
+void MipResidency::beginFrame() {
+
+	++frame;
+
+	for (TextureState& state : textures)
+		state.requested = false;
+}
+
+
+void MipResidency::requestLevel(uint32_t texture, float level) {
+
+	TextureState& state = getState(texture);
+
+	level += options.lodBias;
+
+	state.wantedLevel = state.requested ? min(state.wantedLevel, level) : level;
+	state.lastWantedLevel = state.wantedLevel;
+	state.lastUsedFrame = frame;
+	state.requested = true;
+}
+
+
+void MipResidency::requestView(uint32_t texture, float uvDensity, float distance, float screenScale) {
+
+	TextureState& state = getState(texture);
+
+	requestLevel(texture, estimateMipLevel(uvDensity, state.width, state.height, distance, screenScale));
+}
+
+
+// Level of a texture considered for loading or eviction.  priority is the level minus the level the texture needs - a level is needed if its priority is above -1, loads with the highest priority are made first and levels with the lowest priority are evicted first.
+struct MipCandidate {
+	float								priority;
+	uint64_t							lastUsedFrame;
+	uint32_t							texture;
+	uint32_t							level;
+};
+
+
+void MipResidency::update(vector<MipRequest>& loads, vector<MipRequest>& evictions) {
+
+	auto start = chrono::steady_clock::now();
+
+	loads.clear();
+	evictions.clear();
+
+	// Least needed (then least recently used) level on top
+	auto victimOrder = [](const MipCandidate& a, const MipCandidate& b) {
+
+		if (a.priority != b.priority)
+			return a.priority > b.priority;
+
+		return a.lastUsedFrame > b.lastUsedFrame;
+	};
+
+	priority_queue<MipCandidate, vector<MipCandidate>, decltype(victimOrder)> victims(victimOrder);
+	vector<MipCandidate> candidates;
+
+	// Only the most detailed resident level of each texture can be evicted and only the next level can be loaded
+	for (uint32_t i = 0; i < textures.size(); ++i) {
+
+		const TextureState& state = textures[i];
+
+		if (!state.active || state.loading)
+			continue;
+
+		float needed = getNeededLevel(state);
+
+		if (state.residentLevel < state.startupLevel)
+			victims.push({ (float)state.residentLevel - needed, state.lastUsedFrame, i + 1, state.residentLevel });
+
+		if (state.residentLevel > 0 && (float)(state.residentLevel - 1) - needed > -1.0f)
+			candidates.push_back({ (float)(state.residentLevel - 1) - needed, state.lastUsedFrame, i + 1, state.residentLevel - 1 });
+	}
+
+	// Entries become stale when their texture starts loading or loses the level
+	auto isValidVictim = [this](const MipCandidate& victim) {
+
+		const TextureState& state = textures[victim.texture - 1];
+		return state.active && !state.loading && state.residentLevel == victim.level;
+	};
+
+	auto evict = [&](const MipCandidate& victim) {
+
+		TextureState& state = textures[victim.texture - 1];
+
+		residentBytes -= state.levelBytes[victim.level];
+		state.residentLevel++;
+		evictions.push_back({ victim.texture, victim.level });
+
+		if (state.residentLevel < state.startupLevel)
+			victims.push({ victim.priority + 1.0f, victim.lastUsedFrame, victim.texture, state.residentLevel });
+	};
+
+	// Over budget (the budget was lowered) - evict whether the levels are needed or not
+	while (residentBytes + loadingBytes > options.budgetBytes && !victims.empty()) {
+
+		MipCandidate victim = victims.top();
+		victims.pop();
+
+		if (isValidVictim(victim))
+			evict(victim);
+	}
+
+	sort(candidates.begin(), candidates.end(), [](const MipCandidate& a, const MipCandidate& b) {
+
+		if (a.priority != b.priority)
+			return a.priority > b.priority;
+
+		return a.lastUsedFrame > b.lastUsedFrame;
+	});
+
+	size_t loadBytes = 0;
+
+	for (const MipCandidate& candidate : candidates) {
+
+		if (loads.size() >= options.maxLoadsPerUpdate)
+			break;
+
+		TextureState& state = textures[candidate.texture - 1];
+
+		// Lost a level to an earlier load
+		if (state.residentLevel != candidate.level + 1)
+			continue;
+
+		size_t bytes = state.levelBytes[candidate.level];
+
+		if (!loads.empty() && loadBytes + bytes > options.maxLoadBytesPerUpdate)
+			continue;
+
+		// Make room by evicting levels needed less than this one - undone if they do not free enough
+		vector<MipCandidate> evicted;
+
+		while (residentBytes + loadingBytes + bytes > options.budgetBytes && !victims.empty()) {
+
+			MipCandidate victim = victims.top();
+
+			if (!isValidVictim(victim)) {
+
+				victims.pop();
+				continue;
+			}
+
+			if (victim.priority >= candidate.priority - mipEvictionHysteresis)
+				break;
+
+			victims.pop();
+			evict(victim);
+			evicted.push_back(victim);
+		}
+
+		if (residentBytes + loadingBytes + bytes > options.budgetBytes) {
+
+			for (auto victim = evicted.rbegin(); victim != evicted.rend(); ++victim) {
+
+				TextureState& victimState = textures[victim->texture - 1];
+
+				victimState.residentLevel--;
+				residentBytes += victimState.levelBytes[victim->level];
+				evictions.pop_back();
+				victims.push(*victim);
+			}
+
+			continue;
+		}
+
+		state.loading = true;
+		loadingBytes += bytes;
+		loadBytes += bytes;
+		loads.push_back({ candidate.texture, candidate.level });
+	}
+
+	stats.loadsLastUpdate = (uint32_t)loads.size();
+	stats.evictionsLastUpdate = (uint32_t)evictions.size();
+	stats.totalLoads += loads.size();
+	stats.totalEvictions += evictions.size();
+	stats.updateMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+
+void MipResidency::loaded(uint32_t texture, uint32_t level) {
+
+	TextureState& state = getState(texture);
+
+	if (!state.loading || level + 1 != state.residentLevel)
+		throw runtime_error("Streamed texture level was not loading");
+
+	state.loading = false;
+	state.residentLevel = level;
+	loadingBytes -= state.levelBytes[level];
+	residentBytes += state.levelBytes[level];
+}
+
+
+void MipResidency::loadFailed(uint32_t texture, uint32_t level) {
+
+	TextureState& state = getState(texture);
+
+	if (!state.loading || level + 1 != state.residentLevel)
+		throw runtime_error("Streamed texture level was not loading");
+
+	state.loading = false;
+	loadingBytes -= state.levelBytes[level];
+}
+
+
+uint32_t MipResidency::getResidentLevel(uint32_t texture) {
+
+	return getState(texture).residentLevel;
+}
+
+
+uint32_t MipResidency::getStartupLevel(uint32_t texture) {
+
+	return getState(texture).startupLevel;
+}
+
+
+uint32_t MipResidency::getNumLevels(uint32_t texture) {
+
+	return (uint32_t)getState(texture).levelBytes.size();
+}
+
+
+uint32_t MipResidency::getNeededLevel(uint32_t texture) {
+
+	return (uint32_t)getNeededLevel(getState(texture));
+}
+
+
+MipStreamingStats MipResidency::getStats() {
+
+	stats.residentBytes = residentBytes;
+	stats.loadingBytes = loadingBytes;
+	stats.fullBytes = 0;
+	stats.numTextures = 0;
+	stats.missingLevels = 0;
+	stats.surplusLevels = 0;
+
+	for (const TextureState& state : textures) {
+
+		if (!state.active)
+			continue;
+
+		uint32_t needed = (uint32_t)getNeededLevel(state);
+
+		for (size_t bytes : state.levelBytes)
+			stats.fullBytes += bytes;
+
+		stats.numTextures++;
+		stats.missingLevels += state.residentLevel > needed ? state.residentLevel - needed : 0;
+		stats.surplusLevels += needed > state.residentLevel ? needed - state.residentLevel : 0;
+	}
+
+	return stats;
+}
+
+
+float computeUVDensity(const MeshVertex *vertices, const vector<uint32_t>& indices, const vector<SubMesh>& subMeshes) {
+
+	double area = 0.0, uvArea = 0.0;
+
+	for (const SubMesh& subMesh : subMeshes) {
+
+		for (uint32_t i = subMesh.firstIndex; i + 2 < subMesh.firstIndex + subMesh.indexCount; i += 3) {
+
+			const MeshVertex& a = vertices[subMesh.baseVertex + indices[i]];
+			const MeshVertex& b = vertices[subMesh.baseVertex + indices[i + 1]];
+			const MeshVertex& c = vertices[subMesh.baseVertex + indices[i + 2]];
+
+			double e1[3], e2[3];
+
+			for (int j = 0; j < 3; ++j) {
+
+				e1[j] = b.pos[j] - a.pos[j];
+				e2[j] = c.pos[j] - a.pos[j];
+			}
+
+			double cross[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+			area += 0.5 * sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+			uvArea += 0.5 * fabs((double)(b.texCoord[0] - a.texCoord[0]) * (c.texCoord[1] - a.texCoord[1]) - (double)(c.texCoord[0] - a.texCoord[0]) * (b.texCoord[1] - a.texCoord[1]));
+		}
+	}
+
+	return area > 0.0 ? (float)sqrt(uvArea / area) : 0.0f;
+}
+
+
+float estimateMipLevel(float uvDensity, uint32_t width, uint32_t height, float distance, float screenScale) {
+
+	// Texels and pixels covered by one world unit of the surface
+	float texels = uvDensity * sqrtf((float)width * (float)height);
+	float pixels = screenScale / max(distance, 1e-3f);
+
+	if (texels <= 0.0f)
+		return 1e9f;
+
+	return log2f(texels / pixels);
+}
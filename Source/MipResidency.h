@@ -0,0 +1,123 @@
+
+//
+// MipResidency.h
+//
+
+// Residency decisions for mip level texture streaming.  Each texture starts with only its small levels resident (the startup levels, never evicted) and the more detailed levels are loaded one at a time as the objects using the texture need them.  The level an object needs is estimated on the CPU from its distance from the camera and the texture coordinate density of its mesh (see estimateMipLevel) and every use of a texture in a frame is recorded with requestLevel / requestView.
+// update() compares the level each texture needs with the levels it has and returns the loads and evictions to perform.  Resident and loading levels are kept within a memory budget - the least needed levels (those finer than their texture needs, then those of textures that have not been used for longest) are evicted first, and only to make room for a level that is needed more.  MipResidency only keeps sizes and decisions so it can be tested and benchmarked without a GPU - TextureStreamer creates the textures.
+// Levels are numbered as in Direct3D (0 is the most detailed) so "finer" means a lower level.
+
+#pragma once
+#include <MeshData.h>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// A level is only evicted for a load whose need exceeds its own by this many levels so textures needing about the same level do not swap levels every frame
+static const float mipEvictionHysteresis = 0.25f;
+
+struct MipStreamingOptions {
+	size_t								budgetBytes = 64 * 1024 * 1024; // Resident and loading levels of every texture, including the startup levels
+	uint32_t							startupSize = 64; // Levels no larger than this (width and height) are loaded with the texture and never evicted
+	uint32_t							maxLoadsPerUpdate = 4;
+	size_t								maxLoadBytesPerUpdate = 8 * 1024 * 1024; // At least one level is loaded per update regardless of size
+	float								lodBias = 0.0f; // Added to every requested level - positive values stream less detail
+	uint32_t							keepFrames = 60; // Frames a texture that is no longer requested keeps asking for its last level before only its startup levels are needed
+};
+
+// Load or evict level of texture.  A load makes level the most detailed resident level, an eviction makes level + 1 the most detailed.
+struct MipRequest {
+	uint32_t							texture;
+	uint32_t							level;
+};
+
+struct MipStreamingStats {
+	size_t								residentBytes;
+	size_t								loadingBytes; // Levels returned by update() that have not been reported loaded
+	size_t								fullBytes; // Every level of every texture
+	uint32_t							numTextures;
+	uint32_t							missingLevels; // Sum over textures of levels needed but not resident
+	uint32_t							surplusLevels; // Sum over textures of resident levels finer than needed
+	uint32_t							loadsLastUpdate;
+	uint32_t							evictionsLastUpdate;
+	uint64_t							totalLoads;
+	uint64_t							totalEvictions;
+	double								updateMs; // Time of the last update()
+};
+
+
+class MipResidency {
+
+	struct TextureState {
+		uint32_t						width = 0;
+		uint32_t						height = 0;
+		std::vector<size_t>				levelBytes; // Bytes of each level (of every array slice)
+		uint32_t						startupLevel = 0; // Levels startupLevel and coarser are always resident
+		uint32_t						residentLevel = 0; // Most detailed resident level
+		bool							loading = false; // Level residentLevel - 1 is loading
+		bool							active = false;
+		float							wantedLevel = 0.0f; // Finest level requested this frame (unclamped)
+		float							lastWantedLevel = 0.0f; // Finest level requested on lastUsedFrame
+		bool							requested = false;
+		uint64_t						lastUsedFrame = 0;
+	};
+
+	MipStreamingOptions					options;
+	std::vector<TextureState>			textures; // Indexed by texture id - 1
+	std::vector<uint32_t>				freeIds;
+	uint64_t							frame = 0;
+	size_t								residentBytes = 0;
+	size_t								loadingBytes = 0;
+	MipStreamingStats					stats = {};
+
+	TextureState& getState(uint32_t texture);
+	size_t getResidentBytes(const TextureState& state) const;
+
+	// Level the texture needs this frame (startupLevel if it has not been used for keepFrames frames)
+	float getNeededLevel(const TextureState& state) const;
+
+public:
+
+	MipResidency(const MipStreamingOptions& _options = MipStreamingOptions()) : options(_options) {};
+
+	// Register a texture with levelBytes.size() levels of the given sizes (width x height is the size of level 0).  maxTopLevel is the coarsest level that can be the most detailed level of the texture (block compressed textures need a top level that is a multiple of 4).  Returns the texture id - the startup levels are resident immediately (see getResidentLevel).
+	uint32_t addTexture(uint32_t width, uint32_t height, const std::vector<size_t>& levelBytes, uint32_t maxTopLevel = UINT32_MAX);
+
+	// Forget a texture and free its levels.  Decisions already returned for it must be ignored.
+	void removeTexture(uint32_t texture);
+
+	// Start a new frame of requests
+	void beginFrame();
+
+	// Record a use of the texture this frame needing level (fractional - level 1.5 needs level 1 resident).  The finest level requested in a frame is used.
+	void requestLevel(uint32_t texture, float level);
+
+	// Record a use of the texture by a surface with uvDensity (see computeUVDensity) at distance from the camera.  screenScale is the height in pixels of one world unit at distance 1 (viewport height * projMatrix._22 / 2).
+	void requestView(uint32_t texture, float uvDensity, float distance, float screenScale);
+
+	// Decide the levels to load and evict this frame.  Evictions have already taken effect when update() returns.  Loads are counted against the budget until loaded() or loadFailed() is called (in this frame or a later one) and at most one level of each texture loads at a time.
+	void update(std::vector<MipRequest>& loads, std::vector<MipRequest>& evictions);
+
+	// Report the outcome of a load returned by update()
+	void loaded(uint32_t texture, uint32_t level);
+	void loadFailed(uint32_t texture, uint32_t level);
+
+	uint32_t getResidentLevel(uint32_t texture);
+	uint32_t getStartupLevel(uint32_t texture);
+	uint32_t getNumLevels(uint32_t texture);
+
+	// Level the texture needs this frame clamped to its levels
+	uint32_t getNeededLevel(uint32_t texture);
+
+	const MipStreamingOptions& getOptions() const { return options; };
+	void setBudget(size_t budgetBytes) { options.budgetBytes = budgetBytes; };
+	MipStreamingStats getStats();
+};
+
+
+// Texture coordinate units per world unit over the triangles of the given meshes - the square root of the ratio of their total uv area to their total (model space) area.  Returns 0 if the meshes have no area.
+float computeUVDensity(const MeshVertex *vertices, const std::vector<uint32_t>& indices, const std::vector<SubMesh>& subMeshes);
+
+// Level of a width x height texture needed by a surface with uvDensity at distance from the camera (see MipResidency::requestView) - log2 of the texels covered by a pixel.  May be negative (magnified) or beyond the last level.
+float estimateMipLevel(float uvDensity, uint32_t width, uint32_t height, float distance, float screenScale);
@@ -4,6 +4,12 @@
 //
 
 // Version 1.  Encapsulate the mesh contents of a CGModel imported via CGImport3.  Currently supports obj, 3ds or gsf files.  md2, md3 and md5 (CGImport4) untested.  For version 1 a single texture and sampler interface are associated with the Model.
+// Version 2.  The Model is a lightweight instance (world matrix, effect, materials and textures) that references shared MeshAsset geometry.  Models created with a MeshCache share the vertex and index buffers of every other Model loaded from the same file.
+// Version 3.  Model vertices are quantised (QuantisedVertexStruct) and material colours are per-draw constants in the model cbuffer.  The Model effect must be created with quantisedVertexDesc.
+// Version 4.  The Model renders the level of detail chosen by selectLOD from the shared MeshAsset LOD chain.
+// Version 5.  Models created with an AssetStreamer load their geometry in the background and render the streamer's placeholder mesh until it is committed.
+// Version 6.  At full detail the Model only draws the meshlets of its MeshAsset that cullMeshlets found inside the view frustum (and facing the camera if the effect culls back faces).
+// Version 7.  The mesh is visible to subclasses so InstancedModel can draw many copies of it with hardware instancing.
 
 
 #pragma once
@@ -18,30 +24,72 @@
 #include <Utils.h>
 #include <Camera.h>
 #include <VertexStructures.h>
-
-#include <Assimp\include\assimp\Importer.hpp>      // C++ importer interface
-#include <Assimp\include\assimp\scene.h>           // Output data structure
-#include <Assimp\include\assimp\postprocess.h>     // Post processing flags
+#include <MeshAsset.h>
 
 class Texture;
 class Material;
 class Effect;
+class MeshCache;
+class AssetStreamer;
 #define MAX_TEXTURES 8
 
 class Model : public BaseModel {
-	uint32_t							numMeshes = 0;
-	std::vector<uint32_t>				indexCount;
-	std::vector<uint32_t>				baseVertexOffset;
+
+protected:
+
+	// Shared geometry - retained by this Model
+	MeshAsset							*mesh = nullptr;
+
+	// The dequantisation constants changed since the cbuffer was last mapped
+	bool								cBufferDirty = false;
+
+private:
+
+	// Level of detail rendered by this Model
+	int									lod = 0;
+
+	// Pending geometry request (0 once the geometry is loaded)
+	AssetStreamer						*streamer = nullptr;
+	uint32_t							streamRequest = 0;
+
+	// Visible full detail index ranges found by cullMeshlets this frame
+	std::vector<IndexRange>				visibleRanges;
+	bool								meshletsCulled = false;
+	MeshletCullStats					cullStats = {};
 
 	HRESULT init(ID3D11Device *device) { return S_OK; };
-	HRESULT loadModelAssimp(ID3D11Device *device, const std::wstring& filename);
-	void load(ID3D11Device *device,  const std::wstring& filename);
+	void load(ID3D11Device *device,  const std::wstring& filename, MeshCache *cache);
+	void stream(const std::wstring& filename);
 
 
 public:
 
-	Model(ID3D11Device *device, const std::wstring& filename, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0) : BaseModel(device, _effect, _materials, _numMaterials, textures, numTextures){ load(device,  filename); }
+	// If a MeshCache is given the geometry is shared with other Models loaded from the same file, otherwise the Model imports its own private copy
+	Model(ID3D11Device *device, const std::wstring& filename, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0, MeshCache *cache = nullptr) : BaseModel(device, _effect, _materials, _numMaterials, textures, numTextures){ load(device,  filename, cache); }
+
+	// Stream the geometry with the given AssetStreamer (prioritised by distance from the camera)
+	Model(ID3D11Device *device, AssetStreamer *_streamer, const std::wstring& filename, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0) : BaseModel(device, _effect, _materials, _numMaterials, textures, numTextures), streamer(_streamer) { stream(filename); }
 	~Model();
+
+	MeshAsset *getMesh(){ return mesh; };
+
+	// Replace the geometry rendered by this Model.  The Model retains _mesh and releases its previous mesh.
+	void setMesh(MeshAsset *_mesh);
+
+	// Return true once streamed geometry has been committed
+	bool isLoaded(){ return mesh && streamRequest == 0; };
+
+	// Choose the level of detail to render from the projected size of the Model for the given camera.  Call after the world matrix is updated.
+	void selectLOD(Camera *camera, float viewportHeight);
+	void setLOD(int _lod){ lod = _lod; };
+	int getLOD(){ return lod; };
+
+	// Find the meshlets visible from the camera.  Call each frame after selectLOD - meshlets are only culled at full detail.
+	void cullMeshlets(Camera *camera);
+	const MeshletCullStats& getCullStats(){ return cullStats; };
+
+	// World bounds the mip levels of the Model's streamed textures are chosen for (the nearest instance of an InstancedModel)
+	virtual const Bounds& getStreamingBounds(DirectX::FXMVECTOR cameraPos) { return getWorldBounds(); };
 	
-	void render(ID3D11DeviceContext *context);
+	void render(StateTrackingContext *context);
 };
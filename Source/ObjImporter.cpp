@@ -0,0 +1,703 @@
+
+#include "ObjImporter.h"
+#include "MappedFile.h"
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+
+
+// Stream indices - each face corner references one element of each stream
+enum ObjStream { StreamPosition = 0, StreamTexCoord, StreamNormal, NumStreams };
+
+static const uint32_t missingIndex = 0xffffffff;
+
+// Minimum chunk size - smaller files are parsed on fewer threads
+static const size_t minChunkBytes = 64 * 1024;
+
+
+// Face corner as parsed.  Negative (relative) OBJ indices can only be resolved once the number of elements in preceding chunks is known so they are stored relative to the start of the chunk.
+struct ObjCorner {
+	int32_t								index[NumStreams];
+	uint8_t								present; // Bit per stream
+	uint8_t								relative; // Bit per stream - index is relative to the first element of the chunk
+};
+
+// Streams parsed from one line aligned chunk of the file
+struct ObjChunk {
+	const char							*begin;
+	const char							*end;
+	vector<float>						positions; // xyz
+	vector<float>						texCoords; // uv
+	vector<float>						normals; // xyz
+	vector<ObjCorner>					corners; // Triangulated - 3 per triangle
+	vector<ObjCorner>					polygon; // Scratch
+	const char							*error = nullptr;
+
+	uint32_t count(int stream) const {
+
+		return (uint32_t)((stream == StreamTexCoord) ? texCoords.size() / 2 : ((stream == StreamPosition) ? positions.size() : normals.size()) / 3);
+	}
+};
+
+
+static inline bool isSpace(char c) {
+
+	return c == ' ' || c == '\t';
+}
+
+static inline bool isDigit(char c) {
+
+	return (unsigned char)(c - '0') < 10;
+}
+
+static inline const char *skipSpace(const char *p, const char *end) {
+
+	while (p < end && isSpace(*p))
+		++p;
+
+	return p;
+}
+
+
+static double powerOf10(int e) {
+
+	// Exactly representable powers of 10
+	static const double table[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	return (e <= 22) ? table[e] : pow(10.0, (double)e);
+}
+
+// Parse a decimal float (optional sign, digits, fraction and exponent).  Locale independent and does not require a null terminated string.  Returns the first character after the number or nullptr if there is no number at p.
+static const char *parseFloat(const char *p, const char *end, float& result) {
+
+	p = skipSpace(p, end);
+
+	bool negative = false;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+
+	// Accumulate up to 19 significant digits in an integer mantissa
+	uint64_t mantissa = 0;
+	int exponent = 0;
+	int numDigits = 0;
+	bool anyDigits = false;
+
+	for (; p < end && isDigit(*p); ++p) {
+
+		anyDigits = true;
+
+		if (numDigits < 19) {
+
+			mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+			numDigits += (mantissa != 0);
+		}
+		else
+			exponent++;
+	}
+
+	if (p < end && *p == '.') {
+
+		for (++p; p < end && isDigit(*p); ++p) {
+
+			anyDigits = true;
+
+			if (numDigits < 19) {
+
+				mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+				numDigits += (mantissa != 0);
+				exponent--;
+			}
+		}
+	}
+
+	if (!anyDigits)
+		return nullptr;
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+
+		const char *e = p + 1;
+		bool negativeExponent = false;
+
+		if (e < end && (*e == '-' || *e == '+'))
+			negativeExponent = (*e++ == '-');
+
+		if (e < end && isDigit(*e)) {
+
+			int value = 0;
+
+			for (; e < end && isDigit(*e); ++e)
+				value = min(value * 10 + (*e - '0'), 1000);
+
+			exponent += negativeExponent ? -value : value;
+			p = e;
+		}
+	}
+
+	double value = (double)mantissa;
+
+	if (mantissa != 0 && exponent != 0)
+		value = (exponent < 0) ? value / powerOf10(-exponent) : value * powerOf10(exponent);
+
+	result = (float)(negative ? -value : value);
+
+	return p;
+}
+
+// Parse a signed decimal integer.  Returns nullptr if there is no integer at p.
+static const char *parseInt(const char *p, const char *end, int32_t& result) {
+
+	bool negative = false;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+
+	if (p >= end || !isDigit(*p))
+		return nullptr;
+
+	int64_t value = 0;
+
+	for (; p < end && isDigit(*p); ++p)
+		value = min(value * 10 + (*p - '0'), (int64_t)INT32_MAX);
+
+	result = (int32_t)(negative ? -value : value);
+
+	return p;
+}
+
+
+// Parse count floats into values.  Returns false if fewer than minCount values are present - missing optional values are set to 0.
+static bool parseFloats(const char *p, const char *end, int count, int minCount, vector<float>& values) {
+
+	for (int i = 0; i < count; ++i) {
+
+		float v = 0.0f;
+		const char *next = parseFloat(p, end, v);
+
+		if (!next) {
+
+			if (i < minCount)
+				return false;
+		}
+		else
+			p = next;
+
+		values.push_back(v);
+	}
+
+	return true;
+}
+
+// Store OBJ index value (1 based, negative values are relative to the end of the stream) in corner
+static bool setCornerIndex(ObjCorner& corner, int stream, int32_t value, const ObjChunk& chunk) {
+
+	if (value == 0)
+		return false;
+
+	if (value > 0)
+		corner.index[stream] = value - 1;
+	else {
+
+		corner.index[stream] = (int32_t)chunk.count(stream) + value;
+		corner.relative |= (1 << stream);
+	}
+
+	corner.present |= (1 << stream);
+
+	return true;
+}
+
+// Parse the corners of a face (v, v/vt, v//vn or v/vt/vn) and fan triangulate into chunk.corners
+static bool parseFace(const char *p, const char *end, ObjChunk& chunk) {
+
+	chunk.polygon.clear();
+
+	while (true) {
+
+		p = skipSpace(p, end);
+
+		if (p >= end || *p == '\r' || *p == '#')
+			break;
+
+		ObjCorner corner = { { 0, 0, 0 }, 0, 0 };
+		int32_t value;
+
+		p = parseInt(p, end, value);
+
+		if (!p || !setCornerIndex(corner, StreamPosition, value, chunk))
+			return false;
+
+		if (p < end && *p == '/') {
+
+			++p;
+
+			if (p < end && *p != '/') {
+
+				p = parseInt(p, end, value);
+
+				if (!p || !setCornerIndex(corner, StreamTexCoord, value, chunk))
+					return false;
+			}
+
+			if (p < end && *p == '/') {
+
+				p = parseInt(p + 1, end, value);
+
+				if (!p || !setCornerIndex(corner, StreamNormal, value, chunk))
+					return false;
+			}
+		}
+
+		if (p < end && !isSpace(*p) && *p != '\r')
+			return false;
+
+		chunk.polygon.push_back(corner);
+	}
+
+	if (chunk.polygon.size() < 3)
+		return false;
+
+	for (size_t i = 2; i < chunk.polygon.size(); ++i) {
+
+		chunk.corners.push_back(chunk.polygon[0]);
+		chunk.corners.push_back(chunk.polygon[i - 1]);
+		chunk.corners.push_back(chunk.polygon[i]);
+	}
+
+	return true;
+}
+
+// Parse every line in [chunk.begin, chunk.end).  Unsupported statements are skipped.
+static void parseChunk(ObjChunk& chunk) {
+
+	const char *p = chunk.begin;
+	const char *end = chunk.end;
+
+	while (p < end) {
+
+		p = skipSpace(p, end);
+
+		const char *lineEnd = (const char*)memchr(p, '\n', end - p);
+
+		if (!lineEnd)
+			lineEnd = end;
+
+		bool valid = true;
+
+		if (lineEnd - p >= 2) {
+
+			if (p[0] == 'v') {
+
+				if (isSpace(p[1]))
+					valid = parseFloats(p + 2, lineEnd, 3, 3, chunk.positions);
+				else if (p[1] == 't' && lineEnd - p >= 3 && isSpace(p[2]))
+					valid = parseFloats(p + 3, lineEnd, 2, 1, chunk.texCoords);
+				else if (p[1] == 'n' && lineEnd - p >= 3 && isSpace(p[2]))
+					valid = parseFloats(p + 3, lineEnd, 3, 3, chunk.normals);
+			}
+			else if (p[0] == 'f' && isSpace(p[1]))
+				valid = parseFace(p + 2, lineEnd, chunk);
+		}
+
+		if (!valid) {
+
+			chunk.error = (p[0] == 'f') ? "Malformed OBJ face" : "Malformed OBJ vertex";
+			return;
+		}
+
+		p = lineEnd + 1;
+	}
+}
+
+
+// Run fn(i) for i in [0, count) with one thread per index
+template <typename Fn>
+static void parallelFor(uint32_t count, Fn fn) {
+
+	vector<thread> threads;
+
+	for (uint32_t i = 1; i < count; ++i)
+		threads.emplace_back(fn, i);
+
+	if (count > 0)
+		fn(0);
+
+	for (thread& t : threads)
+		t.join();
+}
+
+
+static inline uint32_t hashCorner(const uint32_t key[NumStreams]) {
+
+	uint32_t h = key[StreamPosition] * 0x9e3779b1u;
+	h ^= (key[StreamTexCoord] + 0x7f4a7c15u + (h << 6) + (h >> 2)) * 0x85ebca6bu;
+	h ^= (key[StreamNormal] + 0x7f4a7c15u + (h << 6) + (h >> 2)) * 0xc2b2ae35u;
+	return h ^ (h >> 16);
+}
+
+
+void importOBJ(const string& filename, MeshData& mesh, bool flipX, ObjImportStats *stats) {
+
+	auto startTime = chrono::high_resolution_clock::now();
+
+	MappedFile file(filename);
+
+	if (!file.isValid())
+		throw runtime_error("Cannot open OBJ file " + filename);
+
+	const char *data = (const char*)file.getData();
+	const char *dataEnd = data + file.getSize();
+
+	// Split into line aligned chunks - one per hardware thread
+	uint32_t numThreads = max(thread::hardware_concurrency(), 1u);
+	uint32_t numChunks = (uint32_t)min((size_t)numThreads, max(file.getSize() / minChunkBytes, (size_t)1));
+
+	vector<ObjChunk> chunks(numChunks);
+
+	const char *chunkBegin = data;
+
+	for (uint32_t i = 0; i < numChunks; ++i) {
+
+		const char *chunkEnd = (i + 1 == numChunks) ? dataEnd : data + file.getSize() * (i + 1) / numChunks;
+
+		if (chunkEnd < chunkBegin)
+			chunkEnd = chunkBegin;
+
+		const char *newline = (const char*)memchr(chunkEnd, '\n', dataEnd - chunkEnd);
+		chunkEnd = newline ? newline + 1 : dataEnd;
+
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	parallelFor(numChunks, [&](uint32_t i) { parseChunk(chunks[i]); });
+
+	for (const ObjChunk& chunk : chunks)
+		if (chunk.error)
+			throw runtime_error(string(chunk.error) + " in " + filename);
+
+	auto parseTime = chrono::high_resolution_clock::now();
+
+	// Offset of each chunk in the merged streams
+	vector<uint32_t> chunkBase[NumStreams];
+	vector<size_t> cornerBase(numChunks + 1, 0);
+	uint32_t streamSize[NumStreams] = { 0, 0, 0 };
+
+	for (int s = 0; s < NumStreams; ++s) {
+
+		chunkBase[s].resize(numChunks);
+
+		for (uint32_t i = 0; i < numChunks; ++i) {
+
+			chunkBase[s][i] = streamSize[s];
+			streamSize[s] += chunks[i].count(s);
+		}
+	}
+
+	for (uint32_t i = 0; i < numChunks; ++i)
+		cornerBase[i + 1] = cornerBase[i] + chunks[i].corners.size();
+
+	size_t numCorners = cornerBase[numChunks];
+
+	if (numCorners == 0)
+		throw runtime_error("No faces in OBJ file " + filename);
+
+	// Keep the weld hash table size within 32 bits
+	if (numCorners > (1u << 30))
+		throw runtime_error("Too many faces in OBJ file " + filename);
+
+	vector<float> positions(streamSize[StreamPosition] * 3);
+	vector<float> texCoords(streamSize[StreamTexCoord] * 2);
+	vector<float> normals(streamSize[StreamNormal] * 3);
+	vector<uint32_t> corners(numCorners * NumStreams);
+
+	// Merge chunk streams and resolve corner indices
+	vector<uint8_t> chunkIndexError(numChunks, 0);
+	vector<uint8_t> chunkMissingNormals(numChunks, 0);
+
+	parallelFor(numChunks, [&](uint32_t i) {
+
+		ObjChunk& chunk = chunks[i];
+
+		copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunkBase[StreamPosition][i] * 3);
+		copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunkBase[StreamTexCoord][i] * 2);
+		copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunkBase[StreamNormal][i] * 3);
+
+		uint32_t *dest = &corners[cornerBase[i] * NumStreams];
+
+		for (const ObjCorner& corner : chunk.corners) {
+
+			for (int s = 0; s < NumStreams; ++s, ++dest) {
+
+				if (!(corner.present & (1 << s))) {
+
+					*dest = missingIndex;
+					chunkMissingNormals[i] |= (s == StreamNormal);
+					continue;
+				}
+
+				int64_t index = corner.index[s];
+
+				if (corner.relative & (1 << s))
+					index += chunkBase[s][i];
+
+				if (index < 0 || index >= streamSize[s])
+					chunkIndexError[i] = 1;
+
+				*dest = (uint32_t)index;
+			}
+		}
+
+		// Release chunk memory early
+		vector<float>().swap(chunk.positions);
+		vector<float>().swap(chunk.texCoords);
+		vector<float>().swap(chunk.normals);
+		vector<ObjCorner>().swap(chunk.corners);
+	});
+
+	if (find(chunkIndexError.begin(), chunkIndexError.end(), 1) != chunkIndexError.end())
+		throw runtime_error("Face index out of range in OBJ file " + filename);
+
+	bool missingNormals = find(chunkMissingNormals.begin(), chunkMissingNormals.end(), 1) != chunkMissingNormals.end();
+
+	auto mergeTime = chrono::high_resolution_clock::now();
+
+	// Weld corners with identical (position, uv, normal) indices into one vertex.  Open addressing hash table sized for a load factor <= 0.5.
+	uint32_t tableSize = 1;
+
+	while (tableSize < numCorners * 2)
+		tableSize <<= 1;
+
+	vector<uint32_t> table(tableSize, missingIndex);
+	vector<uint32_t> vertexKeys;
+
+	vertexKeys.reserve(min(numCorners, (size_t)streamSize[StreamPosition] * 2) * NumStreams);
+
+	mesh.indices.resize(numCorners);
+
+	for (size_t c = 0; c < numCorners; ++c) {
+
+		const uint32_t *key = &corners[c * NumStreams];
+		uint32_t slot = hashCorner(key) & (tableSize - 1);
+
+		while (true) {
+
+			uint32_t v = table[slot];
+
+			if (v == missingIndex) {
+
+				v = (uint32_t)(vertexKeys.size() / NumStreams);
+				table[slot] = v;
+				vertexKeys.insert(vertexKeys.end(), key, key + NumStreams);
+				mesh.indices[c] = v;
+				break;
+			}
+
+			const uint32_t *vk = &vertexKeys[v * NumStreams];
+
+			if (vk[0] == key[0] && vk[1] == key[1] && vk[2] == key[2]) {
+
+				mesh.indices[c] = v;
+				break;
+			}
+
+			slot = (slot + 1) & (tableSize - 1);
+		}
+	}
+
+	vector<uint32_t>().swap(table);
+
+	// Area weighted smooth normals per position for corners without a normal (summing unnormalised face normals weights by area)
+	vector<float> smoothNormals;
+
+	if (missingNormals) {
+
+		smoothNormals.assign(streamSize[StreamPosition] * 3, 0.0f);
+
+		for (size_t c = 0; c < numCorners; c += 3) {
+
+			uint32_t i0 = corners[c * NumStreams], i1 = corners[(c + 1) * NumStreams], i2 = corners[(c + 2) * NumStreams];
+			const float *p0 = &positions[i0 * 3], *p1 = &positions[i1 * 3], *p2 = &positions[i2 * 3];
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+			for (uint32_t i : { i0, i1, i2 })
+				for (int k = 0; k < 3; ++k)
+					smoothNormals[i * 3 + k] += n[k];
+		}
+
+		for (size_t i = 0; i < smoothNormals.size(); i += 3) {
+
+			float *n = &smoothNormals[i];
+			float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			if (len > 0.0f) {
+
+				n[0] /= len;
+				n[1] /= len;
+				n[2] /= len;
+			}
+			else {
+
+				n[0] = n[1] = 0.0f;
+				n[2] = 1.0f;
+			}
+		}
+	}
+
+	// Build vertices
+	float flip = flipX ? -1.0f : 1.0f;
+	size_t numVertices = vertexKeys.size() / NumStreams;
+
+	mesh.vertices.resize(numVertices);
+
+	for (size_t v = 0; v < numVertices; ++v) {
+
+		const uint32_t *key = &vertexKeys[v * NumStreams];
+		MeshVertex& vertex = mesh.vertices[v];
+
+		const float *p = &positions[key[StreamPosition] * 3];
+		const float *n = (key[StreamNormal] != missingIndex) ? &normals[key[StreamNormal] * 3] : &smoothNormals[key[StreamPosition] * 3];
+
+		vertex.pos[0] = p[0] * flip;
+		vertex.pos[1] = p[1];
+		vertex.pos[2] = p[2];
+
+		vertex.normal[0] = n[0] * flip;
+		vertex.normal[1] = n[1];
+		vertex.normal[2] = n[2];
+
+		if (key[StreamTexCoord] != missingIndex) {
+
+			vertex.texCoord[0] = texCoords[key[StreamTexCoord] * 2];
+			vertex.texCoord[1] = 1.0f - texCoords[key[StreamTexCoord] * 2 + 1];
+		}
+		else {
+
+			vertex.texCoord[0] = 0.0f;
+			vertex.texCoord[1] = 1.0f;
+		}
+	}
+
+	// Single mesh forms the full detail LOD
+	mesh.lods.resize(1);
+	mesh.lods[0].error = 0.0f;
+	mesh.lods[0].subMeshes.assign(1, { 0, (uint32_t)numVertices, 0, (uint32_t)numCorners });
+
+	auto endTime = chrono::high_resolution_clock::now();
+
+	if (stats) {
+
+		stats->numThreads = numChunks;
+		stats->numPositions = streamSize[StreamPosition];
+		stats->numTriangles = (uint32_t)(numCorners / 3);
+		stats->numVertices = (uint32_t)numVertices;
+		stats->parseSeconds = chrono::duration<double>(parseTime - startTime).count();
+		stats->mergeSeconds = chrono::duration<double>(mergeTime - parseTime).count();
+		stats->weldSeconds = chrono::duration<double>(endTime - mergeTime).count();
+		stats->totalSeconds = chrono::duration<double>(endTime - startTime).count();
+	}
+}
+
+
+void writeSyntheticOBJ(const string& filename, uint32_t numTriangles) {
+
+	ofstream out(filename, ios::binary);
+
+	if (!out)
+		throw runtime_error("Cannot create OBJ file " + filename);
+
+	// n x n grid of quads (2 triangles each)
+	uint32_t n = max((uint32_t)ceil(sqrt(numTriangles / 2.0)), 1u);
+	uint32_t numVerticesPerRow = n + 1;
+
+	string buffer;
+	char line[128];
+
+	auto flush = [&]() {
+
+		if (buffer.size() > (1 << 20)) {
+
+			out.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	};
+
+	buffer += "# Synthetic benchmark mesh\n";
+
+	for (uint32_t y = 0; y <= n; ++y) {
+
+		for (uint32_t x = 0; x <= n; ++x) {
+
+			float u = (float)x / n, v = (float)y / n;
+			float h = 0.05f * sinf(u * 20.0f) * cosf(v * 20.0f);
+
+			snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", u * 2.0f - 1.0f, h, v * 2.0f - 1.0f);
+			buffer += line;
+		}
+
+		flush();
+	}
+
+	for (uint32_t y = 0; y <= n; ++y) {
+
+		for (uint32_t x = 0; x <= n; ++x) {
+
+			snprintf(line, sizeof(line), "vt %.6f %.6f\n", (float)x / n, (float)y / n);
+			buffer += line;
+		}
+
+		flush();
+	}
+
+	for (uint32_t y = 0; y <= n; ++y) {
+
+		for (uint32_t x = 0; x <= n; ++x) {
+
+			// Normal of the height field h(u, v) (derivatives in grid units)
+			float u = (float)x / n, v = (float)y / n;
+			float dx = 0.5f * cosf(u * 20.0f) * cosf(v * 20.0f);
+			float dz = -0.5f * sinf(u * 20.0f) * sinf(v * 20.0f);
+			float len = sqrtf(dx * dx + 1.0f + dz * dz);
+
+			snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", -dx / len, 1.0f / len, -dz / len);
+			buffer += line;
+		}
+
+		flush();
+	}
+
+	for (uint32_t y = 0; y < n; ++y) {
+
+		for (uint32_t x = 0; x < n; ++x) {
+
+			uint32_t i0 = y * numVerticesPerRow + x + 1;
+			uint32_t i1 = i0 + 1;
+			uint32_t i2 = i0 + numVerticesPerRow;
+			uint32_t i3 = i2 + 1;
+
+			snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", i0, i0, i0, i2, i2, i2, i1, i1, i1);
+			buffer += line;
+			snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", i1, i1, i1, i2, i2, i2, i3, i3, i3);
+			buffer += line;
+		}
+
+		flush();
+	}
+
+	out.write(buffer.data(), buffer.size());
+
+	if (!out)
+		throw runtime_error("Cannot write OBJ file " + filename);
+}
@@ -0,0 +1,30 @@
+
+//
+// ObjImporter.h
+//
+
+// Native Wavefront OBJ importer.  The file is memory mapped (see MappedFile.h) and split into line aligned chunks that are parsed in parallel.  The position, texture coordinate, normal and face streams of each chunk are merged in file order and face corners are welded into unique vertices with a hash map so the result matches the Assimp import path (Triangulate | JoinIdenticalVertices | GenSmoothNormals).  Only geometry is read (v, vt, vn, f) - materials, groups and smoothing groups are ignored so the model is imported as a single mesh.
+
+#pragma once
+#include <MeshData.h>
+#include <string>
+#include <cstdint>
+
+
+// Timing and size statistics for one import
+struct ObjImportStats {
+	uint32_t							numThreads;
+	uint32_t							numPositions;
+	uint32_t							numTriangles;
+	uint32_t							numVertices; // Unique vertices after welding
+	double								parseSeconds; // Parallel chunk parse
+	double								mergeSeconds; // Merge streams and resolve indices
+	double								weldSeconds; // Weld corners and generate missing normals
+	double								totalSeconds;
+};
+
+// Import the OBJ file filename into mesh as a single full detail LOD.  Polygons are fan triangulated.  flipX mirrors positions and normals in x (the handedness change applied to OBJ files by MeshAsset) and texture coordinates are stored as (u, 1 - v).  Corners without a normal receive an area weighted smooth normal.  Throws std::runtime_error if the file cannot be read or is malformed.
+void importOBJ(const std::string& filename, MeshData& mesh, bool flipX, ObjImportStats *stats = nullptr);
+
+// Write a synthetic OBJ with v, vt and vn streams and at least numTriangles triangles (a displaced grid) for import benchmarks
+void writeSyntheticOBJ(const std::string& filename, uint32_t numTriangles);
@@ -6,6 +6,10 @@
 #include <Material.h>
 
 
+const float ParticleSystem::particleLife = 0.7f;
+const float ParticleSystem::maxParticleSize = 0.2f * 0.7f + 0.2f * 2.0f;
+
+
 HRESULT ParticleSystem::init(ID3D11Device *device)
 {
 
@@ -43,6 +47,23 @@ HRESULT ParticleSystem::init(ID3D11Device *device)
 
 		}
 
+		// Particles move from pos to pos + velocity * particleLife - the billboards are expanded around that path in the vertex shader
+		vector<XMFLOAT3> path;
+
+		for (int i = 0; i < N_VERT; i += 4) {
+
+			XMFLOAT3 end;
+			XMStoreFloat3(&end, XMVectorAdd(XMLoadFloat3(&vertices[i].pos), XMVectorScale(XMLoadFloat3(&vertices[i].velocity), particleLife)));
+
+			path.push_back(vertices[i].pos);
+			path.push_back(end);
+		}
+
+		// The billboard half size along a diagonal
+		float billboard = maxParticleSize * 1.4142136f;
+		float offset[3] = { billboard, billboard, billboard };
+		setLocalBounds(inflateBounds(computeBounds(&path[0].x, path.size(), sizeof(XMFLOAT3)), offset, offset));
+
 	
 		// Setup particles vertex buffer
 
@@ -133,7 +154,7 @@ ParticleSystem::~ParticleSystem() {
 }
 
 
-void ParticleSystem::render(ID3D11DeviceContext *context) {
+void ParticleSystem::render(StateTrackingContext *context) {
 
 	context->PSSetConstantBuffers(0, 1, &cBufferModelGPU);
 	context->VSSetConstantBuffers(0, 1, &cBufferModelGPU);
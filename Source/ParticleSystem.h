@@ -12,6 +12,10 @@ int N_PART = 50;
 int N_VERT = N_PART * 4;
 int N_P_IND = N_PART * 6;
 
+// Particle life time and the size of the largest billboard (see fire_vs.hlsl)
+static const float particleLife;
+static const float maxParticleSize;
+
 public:
 	ParticleSystem( ID3D11Device *device, Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0) : BaseModel(device, _effect, _materials, _numMaterials, textures, numTextures){ init(device); }
 
@@ -19,5 +23,5 @@ public:
 
 	HRESULT init(ID3D11Device *device);
 
-	void render(ID3D11DeviceContext *context);
+	void render(StateTrackingContext *context);
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 
 #include <stdafx.h>
 #include <Quad.h>
+#include <StateTrackingContext.h>
 #include <VertexStructures.h>
 #include <iostream>
 #include <exception>
@@ -118,7 +119,7 @@ Quad::~Quad() {
 }
 
 
-void Quad::render(ID3D11DeviceContext *context) {
+void Quad::render(StateTrackingContext *context) {
 
 	// Validate object before rendering (see notes in constructor)
 	if (!context || !vertexBuffer || !inputLayout)
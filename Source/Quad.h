@@ -1,5 +1,7 @@
 #pragma once
 
+class StateTrackingContext;
+
 
 
 
@@ -15,5 +17,5 @@ public:
 	Quad(ID3D11Device *device,  ID3D11InputLayout	*_inputLayout);
 	~Quad();
 
-	void render(ID3D11DeviceContext *context);
+	void render(StateTrackingContext *context);
 };
\ No newline at end of file
@@ -0,0 +1,264 @@
+
+#include "RenderQueue.h"
+#include <algorithm>
+#include <utility>
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+
+static const uint32_t pipelineMask = (1u << renderKeyPipelineBits) - 1;
+static const uint32_t textureSetMask = (1u << renderKeyTextureSetBits) - 1;
+static const uint32_t depthMask = (1u << renderKeyDepthBits) - 1;
+
+
+uint32_t quantiseRenderDepth(float depth) {
+
+	if (!(depth > 0.0f))
+		return 0;
+
+	// Positive floats order as their bit patterns - the top 24 of the 31 bits keep the order with 16 bits of relative precision
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+
+	return bits >> (31 - renderKeyDepthBits);
+}
+
+
+uint64_t makeRenderKey(RenderPass pass, uint32_t pipeline, uint32_t textureSet, float depth) {
+
+	uint64_t key = (uint64_t)pass << 62;
+	uint64_t quantised = quantiseRenderDepth(depth);
+
+	if (pass == TransparentPass)
+		return key | (uint64_t)(~quantised & depthMask) << 38 | (uint64_t)(pipeline & pipelineMask) << 24 | (uint64_t)(textureSet & textureSetMask) << 10;
+
+	return key | (uint64_t)(pipeline & pipelineMask) << 48 | (uint64_t)(textureSet & textureSetMask) << 34 | quantised << 10;
+}
+
+
+RenderPass getRenderKeyPass(uint64_t key) {
+
+	return (RenderPass)(key >> 62);
+}
+
+
+uint32_t getRenderKeyPipeline(uint64_t key) {
+
+	return (uint32_t)(key >> (getRenderKeyPass(key) == TransparentPass ? 24 : 48)) & pipelineMask;
+}
+
+
+uint32_t getRenderKeyTextureSet(uint64_t key) {
+
+	return (uint32_t)(key >> (getRenderKeyPass(key) == TransparentPass ? 10 : 34)) & textureSetMask;
+}
+
+
+void radixSortRenderKeys(uint64_t *keys, uint32_t *values, size_t count, uint64_t *keyScratch, uint32_t *valueScratch) {
+
+	if (count < 2)
+		return;
+
+	// Histograms of every byte in one pass over the keys
+	vector<size_t> histograms(8 * 256, 0);
+
+	for (size_t i = 0; i < count; ++i)
+		for (uint32_t byte = 0; byte < 8; ++byte)
+			histograms[byte * 256 + ((keys[i] >> (byte * 8)) & 255)]++;
+
+	uint64_t *sourceKeys = keys, *targetKeys = keyScratch;
+	uint32_t *sourceValues = values, *targetValues = valueScratch;
+
+	for (uint32_t byte = 0; byte < 8; ++byte) {
+
+		size_t *histogram = &histograms[byte * 256];
+		uint32_t shift = byte * 8;
+
+		// A byte every key shares leaves the order unchanged (the unused low bits, a single pass or pipeline)
+		if (histogram[(sourceKeys[0] >> shift) & 255] == count)
+			continue;
+
+		size_t offset = 0;
+
+		for (uint32_t bucket = 0; bucket < 256; ++bucket) {
+
+			size_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; ++i) {
+
+			size_t target = histogram[(sourceKeys[i] >> shift) & 255]++;
+			targetKeys[target] = sourceKeys[i];
+			targetValues[target] = sourceValues[i];
+		}
+
+		swap(sourceKeys, targetKeys);
+		swap(sourceValues, targetValues);
+	}
+
+	if (sourceKeys != keys) {
+
+		memcpy(keys, sourceKeys, count * sizeof(uint64_t));
+		memcpy(values, sourceValues, count * sizeof(uint32_t));
+	}
+}
+
+
+//
+// RenderQueue
+//
+
+void RenderQueue::clear() {
+
+	keys.clear();
+	packets.clear();
+	sortedKeys.clear();
+	order.clear();
+}
+
+
+void RenderQueue::submit(uint64_t key, const DrawPacket& packet) {
+
+	keys.push_back(key);
+	packets.push_back(packet);
+}
+
+
+uint32_t RenderQueue::getTextureSet(const void *const *textures, uint32_t count) {
+
+	if (count == 0)
+		return 0;
+
+	vector<const void*> set(textures, textures + count);
+	auto entry = textureSets.find(set);
+
+	if (entry != textureSets.end())
+		return entry->second;
+
+	uint32_t id = (uint32_t)textureSets.size() + 1;
+	textureSets[set] = id;
+
+	return id;
+}
+
+
+// Draws with a different pipeline or texture set to the draw before
+static void countChanges(const uint64_t *keys, size_t count, uint32_t& pipelineChanges, uint32_t& textureSetChanges) {
+
+	pipelineChanges = textureSetChanges = 0;
+
+	for (size_t i = 0; i < count; ++i) {
+
+		pipelineChanges += (i == 0 || getRenderKeyPipeline(keys[i]) != getRenderKeyPipeline(keys[i - 1]));
+		textureSetChanges += (i == 0 || getRenderKeyTextureSet(keys[i]) != getRenderKeyTextureSet(keys[i - 1]));
+	}
+}
+
+
+void RenderQueue::sort() {
+
+	size_t count = keys.size();
+
+	sortedKeys = keys;
+	order.resize(count);
+	keyScratch.resize(count);
+	orderScratch.resize(count);
+
+	for (size_t i = 0; i < count; ++i)
+		order[i] = (uint32_t)i;
+
+	radixSortRenderKeys(sortedKeys.data(), order.data(), count, keyScratch.data(), orderScratch.data());
+
+	// Transparent draws are last and keep their depth order
+	for (size_t begin = 0, end = 0; end < count; begin = end) {
+
+		RenderPass pass = getRenderKeyPass(sortedKeys[begin]);
+
+		while (end < count && getRenderKeyPass(sortedKeys[end]) == pass)
+			++end;
+
+		if (pass != TransparentPass && end < count)
+			orderPassEnd(begin, end);
+	}
+
+	stats.draws = (uint32_t)count;
+	countChanges(keys.data(), count, stats.submittedPipelineChanges, stats.submittedTextureSetChanges);
+	countChanges(sortedKeys.data(), count, stats.pipelineChanges, stats.textureSetChanges);
+}
+
+
+// Move the pipeline group of the sorted draws begin to end that shares the most state with the first draw of the next pass to the end of the pass, with its draws of that draw's texture set last in the group
+void RenderQueue::orderPassEnd(size_t begin, size_t end) {
+
+	uint32_t nextPipeline = getRenderKeyPipeline(sortedKeys[end]), nextTextureSet = getRenderKeyTextureSet(sortedKeys[end]);
+	size_t groupBegin = end, groupEnd = end, runBegin = end, runEnd = end;
+	int bestShared = 0;
+
+	for (size_t group = begin; group < end; ) {
+
+		uint32_t pipeline = getRenderKeyPipeline(sortedKeys[group]);
+		size_t next = group, matchBegin = end, matchEnd = end;
+
+		// Draws of one texture set are contiguous within a pipeline group
+		for (; next < end && getRenderKeyPipeline(sortedKeys[next]) == pipeline; ++next)
+			if (getRenderKeyTextureSet(sortedKeys[next]) == nextTextureSet) {
+
+				matchBegin = min(matchBegin, next);
+				matchEnd = next + 1;
+			}
+
+		int shared = (pipeline == nextPipeline) + (matchBegin != end);
+
+		if (shared > bestShared) {
+
+			bestShared = shared;
+			groupBegin = group;
+			groupEnd = next;
+			runBegin = matchBegin;
+			runEnd = matchEnd;
+		}
+
+		group = next;
+	}
+
+	if (bestShared == 0)
+		return;
+
+	// Moving the group can separate groups that happened to share a texture set, so keep the move only if it removes changes
+	size_t first = (begin > 0) ? begin - 1 : begin, last = end + 1;
+	uint32_t pipelineChanges, textureSetChanges, movedPipelineChanges, movedTextureSetChanges;
+	countChanges(sortedKeys.data() + first, last - first, pipelineChanges, textureSetChanges);
+
+	vector<uint64_t> movedKeys(sortedKeys.begin() + first, sortedKeys.begin() + last);
+	vector<uint32_t> movedOrder(order.begin() + first, order.begin() + last);
+
+	auto moveToEnd = [&](size_t moveBegin, size_t moveEnd, size_t rangeEnd) {
+
+		if (moveBegin == moveEnd)
+			return;
+
+		rotate(movedKeys.begin() + (moveBegin - first), movedKeys.begin() + (moveEnd - first), movedKeys.begin() + (rangeEnd - first));
+		rotate(movedOrder.begin() + (moveBegin - first), movedOrder.begin() + (moveEnd - first), movedOrder.begin() + (rangeEnd - first));
+	};
+
+	moveToEnd(runBegin, runEnd, groupEnd);
+	moveToEnd(groupBegin, groupEnd, end);
+
+	countChanges(movedKeys.data(), movedKeys.size(), movedPipelineChanges, movedTextureSetChanges);
+
+	if (movedPipelineChanges + movedTextureSetChanges >= pipelineChanges + textureSetChanges)
+		return;
+
+	copy(movedKeys.begin(), movedKeys.end(), sortedKeys.begin() + first);
+	copy(movedOrder.begin(), movedOrder.end(), order.begin() + first);
+}
+
+
+void RenderQueue::reportStats() {
+
+	cout << "RenderQueue: " << stats.draws << " draws, before = " << stats.submittedPipelineChanges << " pipeline and " << stats.submittedTextureSetChanges << " texture changes, after = " << stats.pipelineChanges << " pipeline and " << stats.textureSetChanges << " texture changes" << endl;
+}
@@ -0,0 +1,114 @@
+
+//
+// RenderQueue.h
+//
+
+// Sort key render queue.  Each draw of a frame is submitted as a 64 bit sort key and a compact draw packet, the keys are radix sorted and the packets executed in key order.  The key orders the passes, then opaque draws by pipeline, texture set and front to back depth (fewest state changes, with the nearest geometry first within a state group to reduce overdraw) and transparent draws back to front so they blend correctly.  Draws with equal keys keep their submission order (the sort is stable), so multi-pass draws are drawn in the order submitted.
+// The order of the pipeline groups within a pass is arbitrary, so the sort moves the group (and within it the texture set) that the next pass starts with to the end of the pass - the pass boundary then adds no state change the submission order did not have.
+// The queue knows nothing about what a packet draws - Scene executes the packets.
+
+#pragma once
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+
+// Passes in the order they are drawn
+enum RenderPass : uint32_t {
+	OpaquePass,
+	SkyPass, // Drawn at the far plane behind the opaque geometry so only uncovered pixels are shaded
+	TransparentPass, // Back to front
+	NumRenderPasses
+};
+
+// Key fields from the most significant bit:
+//   opaque and sky passes: pass (2 bits), pipeline (14), texture set (14), depth (24), unused (10)
+//   transparent pass: pass (2 bits), inverted depth (24), pipeline (14), texture set (14), unused (10)
+static const uint32_t renderKeyPipelineBits = 14;
+static const uint32_t renderKeyTextureSetBits = 14;
+static const uint32_t renderKeyDepthBits = 24;
+
+// Depth quantised to renderKeyDepthBits keeping its order.  Depths at or behind the eye are 0.
+uint32_t quantiseRenderDepth(float depth);
+
+// Sort key of a draw.  Pipeline and texture set ids are truncated to their fields (ids that collide only group less well).
+uint64_t makeRenderKey(RenderPass pass, uint32_t pipeline, uint32_t textureSet, float depth);
+
+RenderPass getRenderKeyPass(uint64_t key);
+uint32_t getRenderKeyPipeline(uint64_t key);
+uint32_t getRenderKeyTextureSet(uint64_t key);
+
+// Stable LSD radix sort of count keys and their values, 8 bits a pass.  Passes over a byte every key shares are skipped.  The scratch arrays hold count entries.
+void radixSortRenderKeys(uint64_t *keys, uint32_t *values, size_t count, uint64_t *keyScratch, uint32_t *valueScratch);
+
+
+// What to draw - object and type are chosen by the submitter
+struct DrawPacket {
+	uint32_t							object;
+	uint16_t							type;
+	uint16_t							param;
+};
+
+struct RenderQueueStats {
+	uint32_t							draws;
+	uint32_t							pipelineChanges; // Draws with a different pipeline to the draw before (including the first draw), in sorted order
+	uint32_t							textureSetChanges;
+	uint32_t							submittedPipelineChanges; // As above in submission order
+	uint32_t							submittedTextureSetChanges;
+};
+
+
+class RenderQueue {
+
+	std::vector<uint64_t>				keys;
+	std::vector<DrawPacket>				packets;
+
+	// Keys and packet indices in sorted order and the radix sort scratch arrays
+	std::vector<uint64_t>				sortedKeys;
+	std::vector<uint32_t>				order;
+	std::vector<uint64_t>				keyScratch;
+	std::vector<uint32_t>				orderScratch;
+
+	// Texture sets are kept between frames so each set keeps its id
+	std::map<std::vector<const void*>, uint32_t>	textureSets;
+
+	RenderQueueStats					stats = {}; // Of the last sorted frame
+
+	void orderPassEnd(size_t begin, size_t end);
+
+public:
+
+	// Start a new frame
+	void clear();
+
+	void submit(uint64_t key, const DrawPacket& packet);
+
+	// Sort the submitted draws and count their state changes
+	void sort();
+
+	// Id of the textures bound by a draw (0 for none).  The same textures in the same order always have the same id.
+	uint32_t getTextureSet(const void *const *textures, uint32_t count);
+
+	// Sorted draws (valid after sort)
+	size_t size() const { return order.size(); };
+	uint64_t getKey(size_t i) const { return sortedKeys[i]; };
+	const DrawPacket& getPacket(size_t i) const { return packets[order[i]]; };
+
+	// Call draw(packet) for each draw in sorted order
+	template <class Draw>
+	void execute(Draw draw) const;
+
+	const RenderQueueStats& getStats() const { return stats; };
+
+	// Print the draws and state changes of the last frame in submission and sorted order
+	void reportStats();
+};
+
+
+template <class Draw>
+void RenderQueue::execute(Draw draw) const {
+
+	for (uint32_t index : order)
+		draw(packets[index]);
+}
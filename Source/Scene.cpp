@@ -19,6 +19,8 @@
 #include <VertexStructures.h>
 #include <Texture.h>
 #include <BlurUtility.h>
+#include <Meshlet.h>
+#include <cfloat>
 
 //using namespace std;
 //using namespace DirectX;
@@ -47,6 +49,9 @@ HRESULT Scene::rebuildViewport(){
 	viewport.MaxDepth = 1.0f;
 	//Set Viewport
 	context->RSSetViewports(1, &viewport);
+	// The render context must not assume state bound around it
+	if (renderContext)
+		renderContext->invalidate();
 	return S_OK;
 }
 
@@ -59,122 +64,107 @@ HRESULT Scene::initialiseSceneResources() {
 	// Set up viewport for the main window (wndHandle) 
 	rebuildViewport();
 
+	renderContext = new StateTrackingContext(context);
+
 	// Setup main effects (pipeline shaders, states etc)
 	// The Effect class is a helper class similar to the depricated DX9 Effect. It stores pipeline shaders, pipeline states  etc and binds them to setup the pipeline to render with a particular Effect. The constructor requires that at least shaders are provided along a description of the vertex structure.
-	basicColourEffect = new Effect(device, "Shaders\\cso\\basic_colour_vs.cso", "Shaders\\cso\\basic_colour_ps.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc));
-	basicLightingEffect = new Effect(device, "Shaders\\cso\\basic_lighting_vs.cso", "Shaders\\cso\\basic_colour_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	perPixelLightingEffect = new Effect(device, "Shaders\\cso\\per_pixel_lighting_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	skyBoxEffect = new Effect(device, "Shaders\\cso\\sky_box_vs.cso", "Shaders\\cso\\sky_box_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
+	// Effects share the shaders and input layouts of the shader library (fireEffect and smokeEffect use the same shaders) and the states of the state cache
+	shaderLibrary = new ShaderLibrary(device);
+	stateCache = new StateCache(device);
+	basicColourEffect = new Effect(device, "Shaders\\cso\\basic_colour_vs.cso", "Shaders\\cso\\basic_colour_ps.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc), shaderLibrary, stateCache);
+	basicLightingEffect = new Effect(device, "Shaders\\cso\\basic_lighting_vs.cso", "Shaders\\cso\\basic_colour_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc), shaderLibrary, stateCache);
+	// Model effects (per-pixel lighting, reflection mapping and trees) use the quantised Model vertex layout (see MeshQuantiser.h) and compiled variants of the model shader families (see ShaderPermutation.h)
+	perPixelLightingEffect = new Effect(device, modelVertexShader, modelPixelShader, quantisedVertexDesc, ARRAYSIZE(quantisedVertexDesc), shaderLibrary, stateCache);
+	skyBoxEffect = new Effect(device, "Shaders\\cso\\sky_box_vs.cso", "Shaders\\cso\\sky_box_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc), shaderLibrary, stateCache);
 	
-	// Add Code Here ( Load reflection_map_vs.cso and reflection_map_ps.cso  )
-	reflectionMappingEffect = new Effect(device, "Shaders\\cso\\reflection_map_vs.cso", "Shaders\\cso\\reflection_map_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	waterEffect = new Effect(device, "Shaders\\cso\\ocean_vs.cso", "Shaders\\cso\\ocean_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
+	reflectionMappingEffect = new Effect(device, modelVertexShader, reflectionMapPixelShader, quantisedVertexDesc, ARRAYSIZE(quantisedVertexDesc), shaderLibrary, stateCache);
+	waterEffect = new Effect(device, "Shaders\\cso\\ocean_vs.cso", "Shaders\\cso\\ocean_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc), shaderLibrary, stateCache);
 	
-	grassEffect = new Effect(device, "Shaders\\cso\\grass_vs.cso", "Shaders\\cso\\grass_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	treeEffect = new Effect(device, "Shaders\\cso\\tree_vs.cso", "Shaders\\cso\\tree_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	fireEffect = new Effect(device, "Shaders\\cso\\fire_vs.cso", "Shaders\\cso\\fire_ps.cso", particleVertexDesc, ARRAYSIZE(particleVertexDesc));
-	smokeEffect = new Effect(device, "Shaders\\cso\\fire_vs.cso", "Shaders\\cso\\fire_ps.cso", particleVertexDesc, ARRAYSIZE(particleVertexDesc));
-	flareEffect = new Effect(device, "Shaders\\cso\\flare_vs.cso", "Shaders\\cso\\flare_ps.cso", flareVertexDesc, ARRAYSIZE(flareVertexDesc));
+	grassEffect = new Effect(device, "Shaders\\cso\\grass_vs.cso", "Shaders\\cso\\grass_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc), shaderLibrary, stateCache);
+	treeEffect = new Effect(device, treeVertexShader, treePixelShader, quantisedVertexDesc, ARRAYSIZE(quantisedVertexDesc), shaderLibrary, stateCache);
+	instancedTreeEffect = new Effect(device, instancedTreeVertexShader, treePixelShader, instancedQuantisedVertexDesc, ARRAYSIZE(instancedQuantisedVertexDesc), shaderLibrary, stateCache);
+	fireEffect = new Effect(device, "Shaders\\cso\\fire_vs.cso", "Shaders\\cso\\fire_ps.cso", particleVertexDesc, ARRAYSIZE(particleVertexDesc), shaderLibrary, stateCache);
+	smokeEffect = new Effect(device, "Shaders\\cso\\fire_vs.cso", "Shaders\\cso\\fire_ps.cso", particleVertexDesc, ARRAYSIZE(particleVertexDesc), shaderLibrary, stateCache);
+	flareEffect = new Effect(device, "Shaders\\cso\\flare_vs.cso", "Shaders\\cso\\flare_ps.cso", flareVertexDesc, ARRAYSIZE(flareVertexDesc), shaderLibrary, stateCache);
 
 	//Blend States
+	// Customised states come from the state cache - the effect setters release the default state they replace
 	// FOILAGE
-	ID3D11BlendState* foilageBSState = grassEffect->getBlendState();
 	D3D11_BLEND_DESC foilageBSDesc;
-	foilageBSState->GetDesc(&foilageBSDesc);
+	grassEffect->getBlendState()->GetDesc(&foilageBSDesc);
 
 	foilageBSDesc.RenderTarget[0].BlendEnable = FALSE;
 	foilageBSDesc.AlphaToCoverageEnable = TRUE;
-	grassEffect->getBlendState()->Release();
-	device->CreateBlendState(&foilageBSDesc, &foilageBSState);
-	grassEffect->setBlendState(foilageBSState);
-	treeEffect->setBlendState(foilageBSState);
+	grassEffect->setBlendState(stateCache->getBlendState(foilageBSDesc));
+	treeEffect->setBlendState(stateCache->getBlendState(foilageBSDesc));
+	instancedTreeEffect->setBlendState(stateCache->getBlendState(foilageBSDesc));
 
 	// FIRE
-	ID3D11BlendState* fireBSState = fireEffect->getBlendState();
 	D3D11_BLEND_DESC fireBSDesc;
-	fireBSState->GetDesc(&fireBSDesc);
+	fireEffect->getBlendState()->GetDesc(&fireBSDesc);
 	fireBSDesc.RenderTarget[0].BlendEnable = TRUE;
 	fireBSDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
 	fireBSDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-	fireEffect->getBlendState()->Release();
-	device->CreateBlendState(&fireBSDesc, &fireBSState);
-	fireEffect->setBlendState(fireBSState);
+	fireEffect->setBlendState(stateCache->getBlendState(fireBSDesc));
 
-	ID3D11DepthStencilState* fireDSState = fireEffect->getDepthStencilState();
 	D3D11_DEPTH_STENCIL_DESC fireDSDesc;
-	fireDSState->GetDesc(&fireDSDesc);
+	fireEffect->getDepthStencilState()->GetDesc(&fireDSDesc);
 	fireDSDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
-
-	fireEffect->getDepthStencilState()->Release();
-	device->CreateDepthStencilState(&fireDSDesc, &fireDSState);
-	fireEffect->setDepthStencilState(fireDSState);
+	fireEffect->setDepthStencilState(stateCache->getDepthStencilState(fireDSDesc));
 
 	//FLARE
-	ID3D11BlendState* flareBlendState = flareEffect->getBlendState();
 	D3D11_BLEND_DESC flareBSDesc;
-	flareBlendState->GetDesc(&flareBSDesc);
+	flareEffect->getBlendState()->GetDesc(&flareBSDesc);
 	flareBSDesc.AlphaToCoverageEnable = FALSE;
 	flareBSDesc.RenderTarget[0].BlendEnable = TRUE;
 	flareBSDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
 	flareBSDesc.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
-	// Create custom flare blend state object
-	flareBlendState->Release(); 
-	device->CreateBlendState(&flareBSDesc, &flareBlendState);
-	flareEffect->setBlendState(flareBlendState);
+	// Custom flare blend state object
+	flareEffect->setBlendState(stateCache->getBlendState(flareBSDesc));
 
 	// The Effect class constructor sets default depth/stencil, rasteriser and blend states
 	// The Effect binds these states to the pipeline whenever an object using the effect is rendered
 	// We can customise states if required
-	ID3D11DepthStencilState *skyBoxDSState = skyBoxEffect->getDepthStencilState();
 	D3D11_DEPTH_STENCIL_DESC skyBoxDSDesc;
-	skyBoxDSState->GetDesc(&skyBoxDSDesc);
+	skyBoxEffect->getDepthStencilState()->GetDesc(&skyBoxDSDesc);
 	skyBoxDSDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	skyBoxDSState->Release(); 
-	device->CreateDepthStencilState(&skyBoxDSDesc, &skyBoxDSState);
-	skyBoxEffect->setDepthStencilState(skyBoxDSState);
+	skyBoxEffect->setDepthStencilState(stateCache->getDepthStencilState(skyBoxDSDesc));
 
 	// Setup Textures
-	// The Texture class is a helper class to load textures
+	// The Texture class is a helper class to load textures.  loadTextures decodes the files on a pool of threads and only creates the textures on this thread.
 
-	heightMap = new Texture(device, L"Resources\\Textures\\heightmap.bmp");
-	normalMap = new Texture(device, L"Resources\\Textures\\normalmap.bmp");
+	vector<Texture*> textures = Texture::loadTextures(device, {
+		L"Resources\\Textures\\heightmap.bmp",
+		L"Resources\\Textures\\normalmap.bmp",
+		L"Resources\\Textures\\grassenvmap1024.dds",
+		L"Resources\\Textures\\Waves.dds",
+		L"Resources\\Textures\\grassAlpha.tif", // Foiliage / grass
+		L"Resources\\Textures\\grass.png" });
 
-	cubeDayTexture = new Texture(device, L"Resources\\Textures\\grassenvmap1024.dds");
-	waterNormalTexture = new Texture(device, L"Resources\\Textures\\Waves.dds");
-	sharkTexture = new Texture(device, L"Resources\\Textures\\greatwhiteshark.png");
-	castleTexture = new Texture(device, L"Resources\\Textures\\castle.jpg");
+	heightMap = textures[0];
+	normalMap = textures[1];
 
-	// Foiliage / grass
-	grassAlphaTexture = new Texture(device, L"Resources\\Textures\\grassAlpha.tif");
-	grassDiffTexture = new Texture(device, L"Resources\\Textures\\grass.png");
-	treeTexture = new Texture(device, L"Resources\\Textures\\tree.tif");
+	cubeDayTexture = textures[2];
+	waterNormalTexture = textures[3];
 
-	brickTexture = new Texture(device, L"Resources\\Textures\\Brick_DIFFUSE.jpg");
-	knightTexture = new Texture(device, L"Resources\\Textures\\knight_orig.jpg");
+	grassAlphaTexture = textures[4];
+	grassDiffTexture = textures[5];
 
-	//Fire
-	fireTexture = new Texture(device, L"Resources\\Textures\\Fire.tif");
-	smokeTexture = new Texture(device, L"Resources\\Textures\\smoke.tif");
+	// Fire, smoke and flare sprites are packed into one atlas (see TextureAtlas.h) so the particle systems and flares all bind the same texture.  Each draw samples its rectangle of the atlas.
+	vector<AtlasEntry> spriteRects;
+	spriteAtlas = new Texture(device, { L"Resources\\Textures\\Fire.tif", L"Resources\\Textures\\smoke.tif", L"Resources\\Textures\\flares\\divine.png", L"Resources\\Textures\\flares\\extendring.png" }, AtlasOptions(), spriteRects);
 
-	//Flare
-	flare1Texture = new Texture(device, L"Resources\\Textures\\flares\\divine.png");
-	flare2Texture = new Texture(device, L"Resources\\Textures\\flares\\extendring.png");
+	// Whole texture rectangles if the atlas could not be created
+	AtlasEntry wholeTexture = { "", 0, 0, 0, 0, 0, { 1.0f, 1.0f, 0.0f, 0.0f } };
+	spriteRects.resize(4, wholeTexture);
 
 
 	// The BaseModel class supports multitexturing and the constructor takes a pointer to an array of shader resource views of textures. 
 	// Even if we only need 1 texture/shader resource view for an effect we still need to create an array.
 	ID3D11ShaderResourceView *skyBoxTextureArray[] = { cubeDayTexture->getShaderResourceView()};
 	ID3D11ShaderResourceView* waterTextureArray[] = { waterNormalTexture->getShaderResourceView(), cubeDayTexture->getShaderResourceView()};
-	ID3D11ShaderResourceView *brickTextureArray[] = { brickTexture->getShaderResourceView() };
-	ID3D11ShaderResourceView* knightTextureArray[] = { knightTexture->getShaderResourceView()};
-	ID3D11ShaderResourceView* sharkTextureArray[] = { sharkTexture->getShaderResourceView() };
 	ID3D11ShaderResourceView* grassTextureArray[] = { grassDiffTexture->getShaderResourceView(), grassAlphaTexture->getShaderResourceView() };
-	ID3D11ShaderResourceView* treeTextureArray[] = { treeTexture->getShaderResourceView() };
-	ID3D11ShaderResourceView* castleTextureArray[] = { castleTexture->getShaderResourceView() };
-	ID3D11ShaderResourceView* fireTextureArray[] = { fireTexture->getShaderResourceView() };
-	ID3D11ShaderResourceView* smokeTextureArray[] = { smokeTexture->getShaderResourceView() }; 
-	ID3D11ShaderResourceView* flare1TextureArray[] = { flare1Texture->getShaderResourceView() };
-	ID3D11ShaderResourceView* flare2TextureArray[] = { flare2Texture->getShaderResourceView() };
+	ID3D11ShaderResourceView* spriteTextureArray[] = { spriteAtlas->getShaderResourceView() };
 
 
 
@@ -185,20 +175,30 @@ HRESULT Scene::initialiseSceneResources() {
 	// The baseModel class now manages a CBuffer containing model/world matrix properties. It has methods to update the cbuffers if the model/world changes 
 	// The render methods of the objects attatch the world/model Cbuffers to the pipeline at slot b0 for vertex and pixel shaders
 	
+	// Models loaded through the mesh cache share geometry with every other Model created from the same file
+	meshCache = new MeshCache();
+
+	// Model geometry and textures are streamed in the background - Models render a placeholder until their assets are committed
+	assetStreamer = new AssetStreamer(device, meshCache);
+	ID3D11ShaderResourceView *placeholderTextureArray[] = { assetStreamer->getPlaceholderTexture() };
+
+	// Cooked Model textures start with their small mip levels and load more detailed levels within a fixed memory budget as the camera approaches
+	textureStreamer = new TextureStreamer(device);
+
 	// Create a skybox
 	// The box class is derived from the BaseModel class 
 	box = new Box(device, skyBoxEffect, NULL, 0, skyBoxTextureArray,1);
 	
 	// Add code here scale the box x1000
 	box->setWorldMatrix(XMMatrixScaling(1000,1000,1000));
-	box->update(context);
+	box->update(renderContext);
 
 	// Create an orb model 
 	// The Model class is also derived from the BaseModel class 
-	orb0 = new Model(device, wstring(L"Resources\\Models\\sphere.3ds"), reflectionMappingEffect, NULL, 0, skyBoxTextureArray, 1);
+	orb0 = new Model(device, assetStreamer, wstring(L"Resources\\Models\\sphere.3ds"), reflectionMappingEffect, NULL, 0, skyBoxTextureArray, 1);
 	// Add code here scale the orb
 	orb0->setWorldMatrix(XMMatrixScaling(2.0, 2.0, 2.0) * XMMatrixTranslation(-8, 0, 0));
-	orb0->update(context);
+	orb0->update(renderContext);
 	
 
 	Material glossRed(XMCOLOR(1.0f, 0.0f, 0.0f, 1.0f));
@@ -207,62 +207,90 @@ HRESULT Scene::initialiseSceneResources() {
 	matWhite.setSpecular(XMCOLOR(0.2f, 0.2f, 0.2f, 0.01f));
 	Material*matWhiteArray[]{ &matWhite };
 	
-	orb1 = new Model(device, wstring(L"Resources\\Models\\sphere.3ds"), perPixelLightingEffect,matWhiteArray, 1, brickTextureArray, 1);
+	orb1 = new Model(device, assetStreamer, wstring(L"Resources\\Models\\sphere.3ds"), perPixelLightingEffect,matWhiteArray, 1, placeholderTextureArray, 1);
 	orb1->setWorldMatrix(XMMatrixScaling(0.5, 0.5, 0.5)*XMMatrixTranslation(-8, 3, 0));
-	orb1->update(context);
+	orb1->update(renderContext);
 	
-	knight = new Model(device, wstring(L"Resources\\Models\\knight.3ds"), perPixelLightingEffect, matWhiteArray, 1, knightTextureArray, 1);
+	knight = new Model(device, assetStreamer, wstring(L"Resources\\Models\\knight.3ds"), perPixelLightingEffect, matWhiteArray, 1, placeholderTextureArray, 1);
 	knight->setWorldMatrix(XMMatrixScaling(0.02, 0.02, 0.02)* XMMatrixTranslation(2, -0.75f, 0));
-	knight->update(context);
+	knight->update(renderContext);
 
-	shark = new Model(device, wstring(L"Resources\\Models\\shark.obj"), treeEffect, matWhiteArray, 1, sharkTextureArray, 1);
+	shark = new Model(device, assetStreamer, wstring(L"Resources\\Models\\shark.obj"), treeEffect, matWhiteArray, 1, placeholderTextureArray, 1);
 	shark->setWorldMatrix(XMMatrixScaling(0.25, 0.25, 0.25) * XMMatrixTranslation(-5, -0.75f, 0));
-	shark->update(context);
+	shark->update(renderContext);
 
-	castle = new Model(device, wstring(L"Resources\\Models\\castle.3DS"), perPixelLightingEffect, matWhiteArray, 1, castleTextureArray, 1);
+	castle = new Model(device, assetStreamer, wstring(L"Resources\\Models\\castle.3DS"), perPixelLightingEffect, matWhiteArray, 1, placeholderTextureArray, 1);
 	castle->setWorldMatrix(XMMatrixRotationY(90) * XMMatrixScaling(10.0f, 10.0f, 10.0f) * XMMatrixTranslation(-10, 0, 20));
-	castle->update(context);
+	castle->update(renderContext);
 		
 	//OLD Grid based Grass
 	//grass = new Grid(20, 20, device, grassEffect, matWhiteArray, 1, grassTextureArray, 2);
 	//grass->setWorldMatrix(XMMatrixScaling(5, 5, 5) * XMMatrixTranslation(-10, 0, 0));
-	//grass->update(context);
+	//grass->update(renderContext);
 
 	grass = new Terrain(device, context, 100, 100, heightMap->getTexture(), normalMap->getTexture(), grassEffect, matWhiteArray, 1, grassTextureArray, 2);
 	grass->setWorldMatrix(XMMatrixScaling(1, 2, 1) *XMMatrixTranslation(-50.0f,0.0f,-50.0f));
-	grass->update(context);
+
+	// Grass shells are instances of the terrain extruded up to grassLength above it (see grass_vs.hlsl)
+	grass->setNumInstances(numGrassPasses);
+	float noOffset[3] = { 0.0f, 0.0f, 0.0f };
+	float grassOffset[3] = { 0.0f, grassLength, 0.0f };
+	grass->setLocalBounds(inflateBounds(grass->getLocalBounds(), noOffset, grassOffset));
+	grass->update(renderContext);
 
 	// Water init - final int is number of textures
 	water = new Grid(32, 30, device, waterEffect, matWhiteArray, 1, waterTextureArray, 2);
 	water->setWorldMatrix(XMMatrixScaling(1, 1, 1)* XMMatrixTranslation(-25, grass->CalculateYValueWorld(5, 5)+.01f, -15));
-	water->update(context);
 
-	tree0 = new Model(device, wstring(L"Resources\\Models\\tree.3DS"), treeEffect, matWhiteArray, 1, treeTextureArray, 1);
-	tree0->setWorldMatrix(XMMatrixTranslation(-30, grass->CalculateYValueWorld(-30, 10), 10));
-	tree0->update(context); 
+	// Sum of the wave amplitudes in ocean_vs.hlsl
+	float waveOffset[3] = { 0.0f, 0.075f, 0.0f };
+	water->setLocalBounds(inflateBounds(water->getLocalBounds(), waveOffset, waveOffset));
+	water->update(renderContext);
+
+	// The trees share one mesh and are drawn as instances of it
+	trees = new InstancedModel(device, assetStreamer, wstring(L"Resources\\Models\\tree.3DS"), instancedTreeEffect, matWhiteArray, 1, placeholderTextureArray, 1);
 
-	tree1 = new Model(device, wstring(L"Resources\\Models\\tree.3DS"), treeEffect, matWhiteArray, 1, treeTextureArray, 1);
-	tree1->setWorldMatrix(XMMatrixTranslation(-20, grass->CalculateYValueWorld(-20,10), 10));
-	tree1->update(context);
+	XMMATRIX treeMatrices[] = {
+		XMMatrixTranslation(-30, grass->CalculateYValueWorld(-30, 10), 10),
+		XMMatrixTranslation(-20, grass->CalculateYValueWorld(-20, 10), 10),
+		XMMatrixTranslation(-30, grass->CalculateYValueWorld(-30, 20), 20) };
 
-	tree2 = new Model(device, wstring(L"Resources\\Models\\tree.3DS"), treeEffect, matWhiteArray, 1, treeTextureArray, 1);
-	tree2->setWorldMatrix(XMMatrixTranslation(-30, grass->CalculateYValueWorld(-30, 20), 20));
-	tree2->update(context);
+	trees->setInstances(device, treeMatrices, ARRAYSIZE(treeMatrices));
+	trees->update(renderContext);
+
+	streamTexture(L"Resources\\Textures\\Brick_DIFFUSE.jpg", &brickTexture, { orb1 });
+	streamTexture(L"Resources\\Textures\\knight_orig.jpg", &knightTexture, { knight });
+	streamTexture(L"Resources\\Textures\\greatwhiteshark.png", &sharkTexture, { shark });
+	streamTexture(L"Resources\\Textures\\castle.jpg", &castleTexture, { castle });
+	streamTexture(L"Resources\\Textures\\tree.tif", &treeTexture, { trees });
 	
-	fire = new ParticleSystem(device, fireEffect, matWhiteArray, 1, fireTextureArray, 1);
+	fire = new ParticleSystem(device, fireEffect, matWhiteArray, 1, spriteTextureArray, 1);
 	fire->setWorldMatrix(XMMatrixTranslation(10, 1.0f, 0));
-	smoke = new ParticleSystem(device, fireEffect, matWhiteArray, 1, smokeTextureArray, 1);
+	fire->setTextureRect(spriteRects[0].scaleOffset);
+	smoke = new ParticleSystem(device, fireEffect, matWhiteArray, 1, spriteTextureArray, 1);
+	smoke->setTextureRect(spriteRects[1].scaleOffset);
+	smoke->update(renderContext);
+
+	cullObjects = { orb0, orb1, knight, shark, water, castle, grass, trees, fire, smoke };
+
+	for (BaseModel *model : cullObjects) {
+
+		sceneBVH.insert(model->getWorldBounds());
+		cullBoundsVersions.push_back(model->getBoundsVersion());
+	}
 
 	// Create Flares
 	for (int i = 0; i < numFlares; i++)
 	{
 		if (randM1P1() > 0)
-			flares[i] = new Flare(XMFLOAT3(-125.0f, 60.0f, 70.0f), XMCOLOR(randM1P1() * 0.5f + 0.5f, randM1P1() * 0.5f + 0.5f, randM1P1() * 0.5f + 0.5f, (float)i / numFlares), device, flareEffect, NULL, 0, flare1TextureArray, 1);
+			flares[i] = new Flare(XMFLOAT3(-125.0f, 60.0f, 70.0f), XMCOLOR(randM1P1() * 0.5f + 0.5f, randM1P1() * 0.5f + 0.5f, randM1P1() * 0.5f + 0.5f, (float)i / numFlares), device, flareEffect, NULL, 0, spriteTextureArray, 1, XMFLOAT4(spriteRects[2].scaleOffset));
 		else
-			flares[i] = new Flare(XMFLOAT3(-125.0f, 60.0f, 70.0f), XMCOLOR(randM1P1() * 0.5f + 0.5f, randM1P1() * 0.5f + 0.5f, randM1P1() * 0.5f + 0.5f, (float)i / numFlares), device, flareEffect, NULL, 0, flare2TextureArray, 1);
+			flares[i] = new Flare(XMFLOAT3(-125.0f, 60.0f, 70.0f), XMCOLOR(randM1P1() * 0.5f + 0.5f, randM1P1() * 0.5f + 0.5f, randM1P1() * 0.5f + 0.5f, (float)i / numFlares), device, flareEffect, NULL, 0, spriteTextureArray, 1, XMFLOAT4(spriteRects[3].scaleOffset));
 	}
 
-	glow = new BlurUtility(system->getDevice(), context, 256, 256);
+	glow = new BlurUtility(system->getDevice(), renderContext, shaderLibrary, stateCache, 256, 256);
+	shaderLibrary->reportStats();
+	stateCache->reportStats();
 
 
 	// Setup a camera
@@ -315,7 +343,7 @@ HRESULT Scene::initialiseSceneResources() {
 	// Fill out cBufferSceneCPU
 	cBufferSceneCPU->windDir = DirectX::XMFLOAT4(1, 0, 0, 1);
 	cBufferSceneCPU->Time = 0.0;
-	cBufferSceneCPU->grassHeight = 0.0;
+	cBufferSceneCPU->grassShellHeight = grassLength / numGrassPasses;
 	
 	cbufferInitData.pSysMem = cBufferSceneCPU;// Initialise GPU CBuffer with data from CPU CBuffer
 	cbufferDesc.ByteWidth = sizeof(CBufferScene);
@@ -329,8 +357,107 @@ HRESULT Scene::initialiseSceneResources() {
 	return S_OK;
 }
 
+void Scene::streamTexture(const std::wstring& filename, Texture **texture, std::vector<Model*> models) {
+
+	// The AssetCooker writes Resources\Textures\name.ext to Cooked\Textures\name.dds
+	wstring cooked = filename;
+
+	if (0 == cooked.compare(0, 10, L"Resources\\"))
+		cooked = L"Cooked\\" + cooked.substr(10);
+
+	cooked = cooked.substr(0, cooked.find_last_of(L'.')) + L".dds";
+
+	uint32_t streamed = textureStreamer->addTexture(cooked, [models](ID3D11ShaderResourceView *SRV) {
+
+		ID3D11ShaderResourceView *textureArray[] = { SRV };
+
+		for (Model *model : models)
+			model->setTextures(textureArray, 1);
+	});
+
+	if (streamed) {
+
+		streamedTextures.push_back({ streamed, models });
+		return;
+	}
+
+	assetStreamer->requestTexture(filename,
+		[this, models]() {
+
+			float priority = FLT_MAX;
+
+			for (Model *model : models) {
+
+				float modelPriority = assetStreamer->viewPriority(model->getWorldMatrix());
+				priority = min(priority, modelPriority);
+			}
+
+			return priority;
+		},
+		[texture, models](Texture *result) {
+
+			*texture = result;
+
+			if (!result)
+				return;
+
+			ID3D11ShaderResourceView *textureArray[] = { result->getShaderResourceView() };
+
+			for (Model *model : models)
+				model->setTextures(textureArray, 1);
+		});
+}
+
+void Scene::submitDraw(BaseModel *model, const XMMATRIX& view, RenderPass pass, SceneDrawType type, uint16_t param) {
+
+	if (!model || !isVisible(model))
+		return;
+
+	Effect *effect = model->getEffect();
+	const PipelineState *pipeline = effect ? effect->getPipelineState() : nullptr;
+	uint32_t textureSet = renderQueue.getTextureSet((const void *const *)model->getTextures(), model->getNumTextures());
+
+	const Bounds& bounds = model->getWorldBounds();
+	float depth = XMVectorGetZ(XMVector3TransformCoord(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(bounds.sphereCentre)), view));
+
+	if (pass != TransparentPass)
+		depth -= bounds.sphereRadius;
+
+	DrawPacket packet = { (uint32_t)drawObjects.size(), (uint16_t)type, param };
+	drawObjects.push_back(model);
+	renderQueue.submit(makeRenderKey(pass, pipeline ? pipeline->id : 0, textureSet, depth), packet);
+}
+
+void Scene::cullScene(const XMMATRIX& view, const XMMATRIX& proj) {
+
+	for (uint32_t i = 0; i < cullObjects.size(); ++i)
+		if (cullObjects[i]->getBoundsVersion() != cullBoundsVersions[i]) {
+
+			sceneBVH.setBounds(i, cullObjects[i]->getWorldBounds());
+			cullBoundsVersions[i] = cullObjects[i]->getBoundsVersion();
+		}
+
+	sceneBVH.refit();
+
+	XMFLOAT4X4 viewProj;
+	XMStoreFloat4x4(&viewProj, view * proj);
+
+	float planes[6][4];
+	extractFrustumPlanes(&viewProj.m[0][0], planes);
+	sceneBVH.queryFrustum(planes, visibility);
+}
+
+bool Scene::isVisible(const BaseModel *model) const {
+
+	for (size_t i = 0; i < cullObjects.size(); ++i)
+		if (cullObjects[i] == model)
+			return visibility.isVisible(i);
+
+	return true;
+}
+
 // Update scene state (perform animations etc)
-HRESULT Scene::updateScene(ID3D11DeviceContext *context,Camera *camera) {
+HRESULT Scene::updateScene(StateTrackingContext *context,Camera *camera) {
 
 	// mainClock is a helper class to manage game time data
 	mainClock->tick();
@@ -340,6 +467,11 @@ HRESULT Scene::updateScene(ID3D11DeviceContext *context,Camera *camera) {
 	{
 		cout << "Average FPS: " << mainClock->averageFPS() << endl;
 		cout << "Average SPF: " << mainClock->averageSPF() << endl;
+		context->reportStats();
+		renderQueue.reportStats();
+		cout << "Frustum culling: " << visibility.countVisible() << " of " << cullObjects.size() << " objects visible" << endl;
+		sceneBVH.reportStats();
+		cout << "Trees: " << trees->getNumVisible() << " of " << trees->getNumInstances() << " instances visible in " << trees->getNumDraws() << " draws" << endl;
 		timer = 5.0f;
 	}
 	double dT = mainClock->gameTimeDelta();
@@ -349,6 +481,19 @@ HRESULT Scene::updateScene(ID3D11DeviceContext *context,Camera *camera) {
 	// If the CPU CBuffer contents are changed then the changes need to be copied to GPU CBuffer with the mapCbuffer helper function
 	mainCamera->update(context);
 
+	// Commit streamed assets within this frame's upload budget, nearest visible objects first
+	assetStreamer->setView(mainCamera->getViewMatrix(), mainCamera->getProjMatrix());
+	assetStreamer->update();
+
+	if (!streamingReported && assetStreamer->isIdle()) {
+
+		cout << "Streaming complete after " << mainClock->gameTimeElapsed() << " seconds" << endl;
+		assetStreamer->reportStats();
+		meshCache->reportStats();
+		textureStreamer->reportStats();
+		streamingReported = true;
+	}
+
 	orb1->setWorldMatrix(orb1->getWorldMatrix() * XMMatrixRotationZ((float)dT));
 	orb1->update(context);
 
@@ -362,9 +507,40 @@ HRESULT Scene::updateScene(ID3D11DeviceContext *context,Camera *camera) {
 
 	fire->update(context);
 
-	tree0->setWorldMatrix(XMMatrixTranslation(10, grass->CalculateYValueWorld(10, 10), 10));
-	tree0->setWorldMatrix(XMMatrixTranslation(50, grass->CalculateYValueWorld(10, 10), 10));
-	tree0->setWorldMatrix(XMMatrixTranslation(20, grass->CalculateYValueWorld(10, 10), 50));
+	// Choose the level of detail of each Model from its projected size and cull the meshlets of full detail Models
+	Model *models[] = { orb0, orb1, knight, shark, castle };
+
+	for (Model *model : models)
+		if (model) {
+
+			model->selectLOD(mainCamera, viewport.Height);
+			model->cullMeshlets(mainCamera);
+		}
+
+	// Instanced Models cull and choose the level of detail of each instance
+	trees->updateInstances(context, mainCamera, viewport.Height);
+
+	// Each streamed texture needs the mip level of its nearest Model (or instance) - estimated from the distance to the Model and the texture coordinate density of its mesh
+	textureStreamer->beginFrame();
+
+	XMVECTOR cameraPos = mainCamera->getPos();
+	float screenScale = viewport.Height * XMVectorGetY(mainCamera->getProjMatrix().r[1]) * 0.5f;
+
+	for (StreamedTextureUse& use : streamedTextures)
+		for (Model *model : use.models) {
+
+			if (!model->isLoaded())
+				continue;
+
+			// The world matrix scales the density by the ratio of the local and world bounding spheres
+			const Bounds& bounds = model->getStreamingBounds(cameraPos);
+			float scale = bounds.sphereRadius / max(model->getMesh()->getBounds().sphereRadius, 1e-6f);
+			float distance = XMVectorGetX(XMVector3Length(cameraPos - XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(bounds.sphereCentre)))) - bounds.sphereRadius;
+
+			textureStreamer->requestView(use.texture, model->getMesh()->getUVDensity() / max(scale, 1e-6f), max(distance, 0.0f), screenScale);
+		}
+
+	textureStreamer->update();
 
 	//OBJ->setWorldMatrix(OBJ->getWorldMatrix() * XMMatrixTranslation(0, 0,0));
 
@@ -381,7 +557,7 @@ HRESULT Scene::updateScene(ID3D11DeviceContext *context,Camera *camera) {
 // Render scene
 HRESULT Scene::renderScene() {
 
-	ID3D11DeviceContext *context = system->getDeviceContext();
+	StateTrackingContext *context = renderContext;
 	
 	// Validate window and D3D context
 	if (isMinimised() || !context)
@@ -392,63 +568,45 @@ HRESULT Scene::renderScene() {
 	context->ClearRenderTargetView(system->getBackBufferRTV(), clearColor);
 	context->ClearDepthStencilView(system->getDepthStencil(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-	// Render Scene objects
-	
-	// Render SkyBox
-	if (box)
-		box->render(context);
-	
-	// Render orb
-	if (orb0)
-	{
-		orb0->render(context);
-	}
-	
-	if (orb1)
-	{
-		glow->blurModel(orb1, system->getDepthStencilSRV());
-		orb1->render(context);
-	}
-	
-	// Render goat
-	if (knight)
-	{
-		knight->render(context);
-	}
-	
-	if (shark)
-		shark->render(context);
+	// Queue the Scene objects - opaque objects are drawn grouped by pipeline and textures and front to back, the sky box behind them (only where nothing covers it) and the glowing orb and particles over them back to front
+	XMMATRIX view = mainCamera->getViewMatrix();
+	renderQueue.clear();
+	drawObjects.clear();
 
-	if (water)
-		water->render(context);
-	
-	if (castle)
-		castle->render(context);
-	
-	if (grass)
-	{
-		for (int i = 0; i < numGrassPasses; i++)
-		{
-			cBufferSceneCPU->grassHeight = (grassLength / numGrassPasses) * i;
-			mapCbuffer(context, cBufferSceneCPU, cBufferSceneGPU, sizeof(CBufferScene));
-			grass->render(context);
+	// Objects outside the view frustum are not queued
+	cullScene(view, mainCamera->getProjMatrix());
+
+	submitDraw(box, view, SkyPass);
+	submitDraw(orb0, view, OpaquePass);
+	// The glow is composited without depth testing, so orb1 is drawn after it (the glow and orb draws have equal keys and keep their order)
+	submitDraw(orb1, view, TransparentPass, DrawGlow);
+	submitDraw(orb1, view, TransparentPass);
+	submitDraw(knight, view, OpaquePass);
+	submitDraw(shark, view, OpaquePass);
+	submitDraw(water, view, OpaquePass);
+	submitDraw(castle, view, OpaquePass);
+
+	submitDraw(grass, view, OpaquePass);
+	submitDraw(trees, view, OpaquePass);
+	submitDraw(fire, view, TransparentPass);
+	submitDraw(smoke, view, TransparentPass);
+
+	renderQueue.sort();
+
+	renderQueue.execute([&](const DrawPacket& packet) {
+
+		BaseModel *model = drawObjects[packet.object];
+
+		switch (packet.type) {
+
+		case DrawGlow:
+			glow->blurModel(static_cast<Model*>(model), system->getDepthStencilSRV());
+			break;
+
+		default:
+			model->render(context);
 		}
-	}
-	
-	if (tree0)
-		tree0->render(context);
-	
-	if (tree1)
-		tree1->render(context);
-	
-	if (tree2)
-		tree2->render(context);
-	
-	if (fire)
-		fire->render(context);
-	
-	if (smoke)
-		smoke->render(context);
+	});
 
 	DrawFlare(context);
 
@@ -604,8 +762,9 @@ Scene::Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName,
 
 // Helper function to call updateScene followed by renderScene
 HRESULT Scene::updateAndRenderScene() {
-	ID3D11DeviceContext *context = system->getDeviceContext();
-	HRESULT hr = updateScene(context, (Camera*)mainCamera);
+	// Each frame starts from unknown state (the window and system code bind state directly) and rolls the call counters
+	renderContext->beginFrame();
+	HRESULT hr = updateScene(renderContext, (Camera*)mainCamera);
 	if (SUCCEEDED(hr))
 		hr = renderScene();
 
@@ -677,6 +836,8 @@ Scene::~Scene() {
 		delete grassEffect;
 	if (treeEffect)
 		delete treeEffect;
+	if (instancedTreeEffect)
+		delete instancedTreeEffect;
 	if (fireEffect)
 		delete fireEffect;
 	if (smokeEffect)
@@ -707,14 +868,8 @@ Scene::~Scene() {
 		delete brickTexture;
 	if (knightTexture)
 		delete knightTexture;
-	if (fireTexture)
-		delete fireTexture;
-	if (smokeTexture)
-		delete smokeTexture;
-	if (flare1Texture)
-		delete flare1Texture;
-	if (flare2Texture)
-		delete flare2Texture;
+	if (spriteAtlas)
+		delete spriteAtlas;
 
 
 	// Delete Scene objects
@@ -735,12 +890,18 @@ Scene::~Scene() {
 		delete(water);
 	if (grass)
 		delete(grass);
-	if(tree0)
-		delete(tree0);
-	if(tree1)
-		delete(tree1);
-	if (tree2)
-		delete(tree2);
+	if (trees)
+		delete(trees);
+	if (assetStreamer)
+		delete(assetStreamer);
+	if (textureStreamer)
+		delete(textureStreamer);
+	if (meshCache)
+		delete(meshCache);
+	if (shaderLibrary)
+		delete(shaderLibrary);
+	if (stateCache)
+		delete(stateCache);
 	if (fire)
 		delete(fire);
 	if (smoke)
@@ -754,6 +915,8 @@ Scene::~Scene() {
 	}
 	if (glow)
 		delete glow;
+	if (renderContext)
+		delete(renderContext);
 	if (mainClock)
 		delete(mainClock);
 	if (mainCamera)
@@ -792,7 +955,7 @@ HRESULT Scene::resizeResources() {
 	return S_OK;
 }
 
-void Scene::DrawFlare(ID3D11DeviceContext* context)
+void Scene::DrawFlare(StateTrackingContext* context)
 {
 	// Draw the Fire (Draw all transparent objects last)
 	if (flares) {
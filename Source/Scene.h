@@ -10,6 +10,7 @@
 #include <Camera.h>
 #include <Triangle.h>
 #include "Model.h"
+#include <InstancedModel.h>
 #include <Box.h>
 #include <Grid.h>
 #include <CBufferStructures.h>
@@ -18,6 +19,13 @@
 #include <Flare.h>
 #include "BlurUtility.h"
 #include "Terrain.h"
+#include <MeshCache.h>
+#include <AssetStreamer.h>
+#include <TextureStreamer.h>
+#include <ShaderLibrary.h>
+#include <StateCache.h>
+#include <RenderQueue.h>
+#include <SceneBVH.h>
 
 class Scene{// : public GUObject {
 
@@ -31,6 +39,30 @@ class Scene{// : public GUObject {
 	CGDClock								*mainClock;
 	FirstPersonCamera*mainCamera;
 
+	// Shaders and input layouts shared by the effects - each compiled shader is loaded once
+	ShaderLibrary	*shaderLibrary = nullptr;
+
+	// Rasterizer, depth-stencil, blend and sampler states shared by the effects and models - each distinct state is created once
+	StateCache		*stateCache = nullptr;
+
+	// Context used to render the scene - redundant state calls are dropped (see StateTrackingContext)
+	StateTrackingContext	*renderContext = nullptr;
+
+	// Draws of the frame sorted by pass, state and depth (see RenderQueue).  Packets index drawObjects.
+	enum SceneDrawType : uint16_t {
+		DrawModel,
+		DrawGlow // Blur and composite the model over the scene
+	};
+
+	RenderQueue				renderQueue;
+	std::vector<BaseModel*>	drawObjects;
+
+	// Objects culled against the view frustum each frame (everything but the sky box) and their visibility.  Their world bounds are kept in a BVH (object ids are cullObjects indices) refitted when objects move.
+	std::vector<BaseModel*>	cullObjects;
+	std::vector<uint32_t>	cullBoundsVersions; // Bounds version of each object in sceneBVH
+	SceneBVH				sceneBVH;
+	VisibilitySet			visibility;
+
 	CBufferScene *cBufferSceneCPU = nullptr;
 	ID3D11Buffer *cBufferSceneGPU = nullptr;
 	CBufferLight *cBufferLightCPU = nullptr;
@@ -50,20 +82,19 @@ class Scene{// : public GUObject {
 	Texture *treeTexture = nullptr;
 	Texture *castleTexture = nullptr;
 	
+	// Fire, smoke and flare sprites (see Scene::initialiseSceneResources)
+	Texture *spriteAtlas = nullptr;
+
 	// Particles
-	Texture *fireTexture = nullptr;
 	Effect	*fireEffect = nullptr;
 	ParticleSystem *fire = nullptr;
 
-	Texture* smokeTexture = nullptr;
 	Effect* smokeEffect = nullptr;
 	ParticleSystem* smoke = nullptr;
 
 	// Flares
 	static const int numFlares = 6;
 	Flare *flares[numFlares];
-	Texture* flare1Texture = nullptr;
-	Texture* flare2Texture = nullptr;
 	Effect* flareEffect = nullptr;
 	ParticleSystem* flare = nullptr;
 
@@ -79,6 +110,23 @@ class Scene{// : public GUObject {
 	Effect *waterEffect = nullptr;
 	Effect *grassEffect = nullptr;
 	Effect *treeEffect = nullptr;
+	Effect *instancedTreeEffect = nullptr;
+
+	// Shared model geometry - models loaded from the same file share vertex and index buffers
+	MeshCache	*meshCache = nullptr;
+
+	// Background loading of Model geometry and textures
+	AssetStreamer	*assetStreamer = nullptr;
+	bool		streamingReported = false;
+
+	// Mip level streaming of cooked Model textures and the Models using each streamed texture
+	struct StreamedTextureUse {
+		uint32_t						texture;
+		std::vector<Model*>				models;
+	};
+
+	TextureStreamer	*textureStreamer = nullptr;
+	std::vector<StreamedTextureUse>	streamedTextures;
 
 	// Add objects to the scene
 	Triangle	*triangle = nullptr; //pointer to a Triangle the actual triangle is created in initialiseSceneResources
@@ -93,12 +141,10 @@ class Scene{// : public GUObject {
 	Model		*shark = nullptr;
 
 
-	//Trees
-	Model* tree0 = nullptr;
-	Model* tree1 = nullptr;
-	Model* tree2 = nullptr;
+	// Trees - one instanced draw per level of detail
+	InstancedModel* trees = nullptr;
 
-	// Grass
+	// Grass - the shells are instances of the terrain drawn in one draw
 	float grassLength = 0.01f;
 	int numGrassPasses = 80;
 
@@ -108,6 +154,14 @@ class Scene{// : public GUObject {
 	Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc);
 	// Return TRUE if the window is in a minimised state, FALSE otherwise
 	BOOL isMinimised();
+	// Stream a Model texture.  If the texture has been cooked (Cooked\Textures\*.dds, see AssetCooker) its mip levels are streamed by the TextureStreamer as the models need them, otherwise the whole texture is loaded by the AssetStreamer - the models render the placeholder texture until it is committed and are prioritised by the nearest of them.
+	void streamTexture(const std::wstring& filename, Texture **texture, std::vector<Model*> models);
+	// Queue a draw of model keyed by its pipeline, textures and depth for view unless it has been culled.  Opaque and sky draws use the nearest depth of the model's bounding sphere and transparent draws its centre.
+	void submitDraw(BaseModel *model, const DirectX::XMMATRIX& view, RenderPass pass, SceneDrawType type = DrawModel, uint16_t param = 0);
+	// Refit sceneBVH to the objects that moved and cull cullObjects against the view frustum of view and proj
+	void cullScene(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& proj);
+	// Returns false if model was culled by the last cullScene (objects that are not culled are always visible)
+	bool isVisible(const BaseModel *model) const;
 
 public:
 	// Public methods
@@ -117,7 +171,7 @@ public:
 	// Methods to handle initialisation, update and rendering of the scene
 	HRESULT rebuildViewport();
 	HRESULT initialiseSceneResources();
-	HRESULT updateScene(ID3D11DeviceContext *context, Camera *camera);
+	HRESULT updateScene(StateTrackingContext *context, Camera *camera);
 	HRESULT renderScene();
 
 	// Clock handling methods
@@ -139,7 +193,7 @@ public:
 	HRESULT updateAndRenderScene();
 
 	//Flares
-	void DrawFlare(ID3D11DeviceContext* context);
+	void DrawFlare(StateTrackingContext* context);
 	
 	// Destructor
 	~Scene();
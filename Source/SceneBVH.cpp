@@ -0,0 +1,782 @@
+
+#include "SceneBVH.h"
+#include "Meshlet.h"
+#include <algorithm>
+#include <iostream>
+#include <cmath>
+#include <cfloat>
+
+using namespace std;
+
+
+// Node frustum tests are widened by this fraction of the distances involved so rounding in the node centre and extents never culls an object the object test would keep
+static const float nodeSlack = 1e-5f;
+
+
+static float halfArea(const float minBox[3], const float maxBox[3]) {
+
+	float d[3] = { maxBox[0] - minBox[0], maxBox[1] - minBox[1], maxBox[2] - minBox[2] };
+
+	if (d[0] < 0.0f || d[1] < 0.0f || d[2] < 0.0f)
+		return 0.0f;
+
+	return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+}
+
+
+static void emptyBox(float minBox[3], float maxBox[3]) {
+
+	for (int a = 0; a < 3; ++a) {
+
+		minBox[a] = FLT_MAX;
+		maxBox[a] = -FLT_MAX;
+	}
+}
+
+
+static void growBox(float minBox[3], float maxBox[3], const float addMin[3], const float addMax[3]) {
+
+	for (int a = 0; a < 3; ++a) {
+
+		minBox[a] = min(minBox[a], addMin[a]);
+		maxBox[a] = max(maxBox[a], addMax[a]);
+	}
+}
+
+
+// As cullBoundsScalar for one box and the planes in mask
+static bool boxInFrustum(const float n[6][4], uint32_t mask, const float centre[3], const float extents[3]) {
+
+	for (int p = 0; p < 6; ++p)
+		if (mask & (1 << p)) {
+
+			float distance = ((n[p][0] * centre[0] + n[p][1] * centre[1]) + n[p][2] * centre[2]) + n[p][3];
+			float reach = (fabsf(n[p][0]) * extents[0] + fabsf(n[p][1]) * extents[1]) + fabsf(n[p][2]) * extents[2];
+
+			if (!(distance + reach >= 0.0f))
+				return false;
+		}
+
+	return true;
+}
+
+
+bool rayHitsBox(const float origin[3], const float inverseDirection[3], const float minBox[3], const float maxBox[3], float maxDistance, float& entry) {
+
+	float enter = 0.0f, exit = maxDistance;
+
+	for (int a = 0; a < 3; ++a) {
+
+		float t0 = (minBox[a] - origin[a]) * inverseDirection[a];
+		float t1 = (maxBox[a] - origin[a]) * inverseDirection[a];
+
+		enter = max(enter, min(t0, t1));
+		exit = min(exit, max(t0, t1));
+	}
+
+	entry = enter;
+	return enter <= exit;
+}
+
+
+bool sphereHitsBox(const float centre[3], float radius, const float minBox[3], const float maxBox[3]) {
+
+	float distanceSquared = 0.0f;
+
+	for (int a = 0; a < 3; ++a) {
+
+		float d = centre[a] < minBox[a] ? minBox[a] - centre[a] : (centre[a] > maxBox[a] ? centre[a] - maxBox[a] : 0.0f);
+		distanceSquared += d * d;
+	}
+
+	return distanceSquared <= radius * radius;
+}
+
+
+//
+// SceneBVH
+//
+
+SceneBVH::SceneBVH() : rebuildDone(false) {
+}
+
+
+SceneBVH::~SceneBVH() {
+
+	if (rebuildThread.joinable())
+		rebuildThread.join();
+}
+
+
+uint32_t SceneBVH::insert(const Bounds& bounds) {
+
+	uint32_t id = (uint32_t)objects.size();
+	ObjectBox box;
+
+	for (int a = 0; a < 3; ++a) {
+
+		box.centre[a] = bounds.boxCentre[a];
+		box.extents[a] = bounds.boxExtents[a];
+	}
+
+	objects.push_back(box);
+	live.push_back(true);
+	objectLeaf.push_back(bvhNoObject);
+	pending.push_back(id);
+
+	return id;
+}
+
+
+void SceneBVH::setBounds(uint32_t object, const Bounds& bounds) {
+
+	if (object >= objects.size() || !live[object])
+		return;
+
+	ObjectBox& box = objects[object];
+
+	for (int a = 0; a < 3; ++a) {
+
+		box.centre[a] = bounds.boxCentre[a];
+		box.extents[a] = bounds.boxExtents[a];
+	}
+
+	uint32_t leaf = objectLeaf[object];
+
+	if (leaf == bvhNoObject)
+		return;
+
+	// Objects without bounds cannot be placed in the tree
+	if (bounds.isEmpty()) {
+
+		detach(object);
+		pending.push_back(object);
+		return;
+	}
+
+	if (!leafDirty[leaf]) {
+
+		leafDirty[leaf] = true;
+		dirtyLeaves.push_back(leaf);
+	}
+
+	stats.refits++;
+}
+
+
+void SceneBVH::remove(uint32_t object) {
+
+	if (object >= objects.size() || !live[object])
+		return;
+
+	live[object] = false;
+	numRemoved++;
+
+	if (objectLeaf[object] != bvhNoObject)
+		detach(object);
+	else
+		pending.erase(find(pending.begin(), pending.end(), object));
+}
+
+
+// Remove an object from its leaf - the leaf is refitted by the next refit
+void SceneBVH::detach(uint32_t object) {
+
+	uint32_t leaf = objectLeaf[object];
+	Node& node = tree.nodes[leaf];
+	uint32_t *items = &tree.items[node.first];
+
+	*find(items, items + node.count, object) = items[node.count - 1];
+	node.count--;
+	objectLeaf[object] = bvhNoObject;
+
+	if (!leafDirty[leaf]) {
+
+		leafDirty[leaf] = true;
+		dirtyLeaves.push_back(leaf);
+	}
+}
+
+
+void SceneBVH::buildTree(const vector<ObjectBox>& boxes, vector<uint32_t> ids, Tree& result) {
+
+	struct BuildTask {
+		uint32_t						node;
+		uint32_t						first;
+		uint32_t						count;
+	};
+
+	struct Bin {
+		float							minBox[3];
+		float							maxBox[3];
+		uint32_t						count;
+	};
+
+	result.nodes.clear();
+	result.parents.clear();
+	result.items = move(ids);
+
+	uint32_t numItems = (uint32_t)result.items.size();
+	result.nodes.reserve(max(2 * numItems, 1u));
+	result.parents.reserve(max(2 * numItems, 1u));
+	result.nodes.push_back(Node());
+	result.parents.push_back(bvhNoObject);
+
+	vector<BuildTask> tasks = { { 0, 0, numItems } };
+
+	while (!tasks.empty()) {
+
+		BuildTask task = tasks.back();
+		tasks.pop_back();
+
+		uint32_t *items = result.items.data() + task.first;
+
+		// Bounds of the boxes and of their centres
+		float minBox[3], maxBox[3], minCentre[3], maxCentre[3];
+		emptyBox(minBox, maxBox);
+		emptyBox(minCentre, maxCentre);
+
+		for (uint32_t i = 0; i < task.count; ++i) {
+
+			const ObjectBox& box = boxes[items[i]];
+			float boxMin[3] = { box.centre[0] - box.extents[0], box.centre[1] - box.extents[1], box.centre[2] - box.extents[2] };
+			float boxMax[3] = { box.centre[0] + box.extents[0], box.centre[1] + box.extents[1], box.centre[2] + box.extents[2] };
+
+			growBox(minBox, maxBox, boxMin, boxMax);
+			growBox(minCentre, maxCentre, box.centre, box.centre);
+		}
+
+		Node& node = result.nodes[task.node];
+		copy(minBox, minBox + 3, node.minBox);
+		copy(maxBox, maxBox + 3, node.maxBox);
+		node.first = task.first;
+		node.count = task.count;
+
+		if (task.count <= bvhMaxLeafObjects)
+			continue;
+
+		// Split along the longest axis of the centres
+		int axis = 0;
+
+		for (int a = 1; a < 3; ++a)
+			if (maxCentre[a] - minCentre[a] > maxCentre[axis] - minCentre[axis])
+				axis = a;
+
+		float extent = maxCentre[axis] - minCentre[axis];
+		uint32_t leftCount;
+
+		if (extent <= 0.0f) {
+
+			// Every centre is the same - split large leaves in half
+			if (task.count <= bvhMaxLeafObjectsSAH)
+				continue;
+
+			leftCount = task.count / 2;
+		}
+		else {
+
+			float scale = bvhSAHBins / extent;
+			auto binOf = [&](uint32_t id) { return min((uint32_t)((boxes[id].centre[axis] - minCentre[axis]) * scale), bvhSAHBins - 1); };
+
+			Bin bins[bvhSAHBins];
+
+			for (Bin& bin : bins) {
+
+				emptyBox(bin.minBox, bin.maxBox);
+				bin.count = 0;
+			}
+
+			for (uint32_t i = 0; i < task.count; ++i) {
+
+				const ObjectBox& box = boxes[items[i]];
+				float boxMin[3] = { box.centre[0] - box.extents[0], box.centre[1] - box.extents[1], box.centre[2] - box.extents[2] };
+				float boxMax[3] = { box.centre[0] + box.extents[0], box.centre[1] + box.extents[1], box.centre[2] + box.extents[2] };
+				Bin& bin = bins[binOf(items[i])];
+
+				growBox(bin.minBox, bin.maxBox, boxMin, boxMax);
+				bin.count++;
+			}
+
+			// Area times count of the bins left of each boundary, then the cost of splitting at each boundary
+			float leftCost[bvhSAHBins - 1];
+			float sweepMin[3], sweepMax[3];
+			uint32_t sweepCount = 0;
+			emptyBox(sweepMin, sweepMax);
+
+			for (uint32_t b = 0; b < bvhSAHBins - 1; ++b) {
+
+				growBox(sweepMin, sweepMax, bins[b].minBox, bins[b].maxBox);
+				sweepCount += bins[b].count;
+				leftCost[b] = halfArea(sweepMin, sweepMax) * sweepCount;
+			}
+
+			uint32_t bestSplit = 0;
+			float bestCost = FLT_MAX;
+			emptyBox(sweepMin, sweepMax);
+			sweepCount = 0;
+
+			for (uint32_t b = bvhSAHBins - 1; b > 0; --b) {
+
+				growBox(sweepMin, sweepMax, bins[b].minBox, bins[b].maxBox);
+				sweepCount += bins[b].count;
+
+				if (sweepCount == 0 || sweepCount == task.count)
+					continue;
+
+				float cost = leftCost[b - 1] + halfArea(sweepMin, sweepMax) * sweepCount;
+
+				if (cost < bestCost) {
+
+					bestCost = cost;
+					bestSplit = b - 1;
+				}
+			}
+
+			// Traversal costs as much as testing one object
+			float area = halfArea(minBox, maxBox);
+			float splitCost = 1.0f + (area > 0.0f ? bestCost / area : 0.0f);
+
+			if (splitCost >= task.count && task.count <= bvhMaxLeafObjectsSAH)
+				continue;
+
+			leftCount = (uint32_t)(partition(items, items + task.count, [&](uint32_t id) { return binOf(id) <= bestSplit; }) - items);
+		}
+
+		uint32_t children = (uint32_t)result.nodes.size();
+		result.nodes[task.node].first = children;
+		result.nodes[task.node].count = internalNode;
+		result.nodes.push_back(Node());
+		result.nodes.push_back(Node());
+		result.parents.push_back(task.node);
+		result.parents.push_back(task.node);
+
+		tasks.push_back({ children, task.first, leftCount });
+		tasks.push_back({ children + 1, task.first + leftCount, task.count - leftCount });
+	}
+
+	result.cost = computeCost(result.nodes);
+}
+
+
+// SAH cost of a tree relative to the area of its root - the expected number of nodes visited and objects tested by a query that hits the root
+float SceneBVH::computeCost(const vector<Node>& nodes) {
+
+	if (nodes.empty())
+		return 0.0f;
+
+	float rootArea = halfArea(nodes[0].minBox, nodes[0].maxBox);
+	float cost = 0.0f;
+
+	if (rootArea <= 0.0f)
+		return nodes[0].count == internalNode ? 1.0f : (float)nodes[0].count;
+
+	for (const Node& node : nodes)
+		cost += halfArea(node.minBox, node.maxBox) * (node.count == internalNode ? 1.0f : (float)node.count);
+
+	return cost / rootArea;
+}
+
+
+void SceneBVH::installTree(Tree& built) {
+
+	tree = move(built);
+	objectLeaf.assign(objects.size(), bvhNoObject);
+
+	for (uint32_t i = 0; i < tree.nodes.size(); ++i) {
+
+		const Node& node = tree.nodes[i];
+
+		if (node.count != internalNode)
+			for (uint32_t j = 0; j < node.count; ++j)
+				objectLeaf[tree.items[node.first + j]] = i;
+	}
+
+	leafDirty.assign(tree.nodes.size(), false);
+	dirtyLeaves.clear();
+
+	// Objects removed or left without bounds while a background build ran leave the tree and objects added stay pending
+	for (uint32_t id = 0; id < objects.size(); ++id)
+		if (objectLeaf[id] != bvhNoObject && (!live[id] || objects[id].extents[0] < 0.0f))
+			detach(id);
+
+	pending.clear();
+
+	for (uint32_t id = 0; id < objects.size(); ++id)
+		if (live[id] && objectLeaf[id] == bvhNoObject)
+			pending.push_back(id);
+
+	// Boxes may have moved since they were copied for the build
+	refitAll();
+	leafDirty.assign(tree.nodes.size(), false);
+	dirtyLeaves.clear();
+
+	cost = tree.cost = computeCost(tree.nodes);
+	stats.builds++;
+}
+
+
+void SceneBVH::refitLeaf(uint32_t leaf) {
+
+	Node& node = tree.nodes[leaf];
+	float minBox[3], maxBox[3];
+	emptyBox(minBox, maxBox);
+
+	for (uint32_t i = 0; i < node.count; ++i) {
+
+		const ObjectBox& box = objects[tree.items[node.first + i]];
+		float boxMin[3] = { box.centre[0] - box.extents[0], box.centre[1] - box.extents[1], box.centre[2] - box.extents[2] };
+		float boxMax[3] = { box.centre[0] + box.extents[0], box.centre[1] + box.extents[1], box.centre[2] + box.extents[2] };
+
+		growBox(minBox, maxBox, boxMin, boxMax);
+	}
+
+	copy(minBox, minBox + 3, node.minBox);
+	copy(maxBox, maxBox + 3, node.maxBox);
+	stats.nodesRefitted++;
+
+	// Ancestors stop changing at the first that still contains the children
+	for (uint32_t parent = tree.parents[leaf]; parent != bvhNoObject; parent = tree.parents[parent]) {
+
+		Node& p = tree.nodes[parent];
+		emptyBox(minBox, maxBox);
+		growBox(minBox, maxBox, tree.nodes[p.first].minBox, tree.nodes[p.first].maxBox);
+		growBox(minBox, maxBox, tree.nodes[p.first + 1].minBox, tree.nodes[p.first + 1].maxBox);
+
+		if (equal(minBox, minBox + 3, p.minBox) && equal(maxBox, maxBox + 3, p.maxBox))
+			break;
+
+		copy(minBox, minBox + 3, p.minBox);
+		copy(maxBox, maxBox + 3, p.maxBox);
+		stats.nodesRefitted++;
+	}
+}
+
+
+// Children always follow their parent in nodes so a reverse pass refits every node after its children
+void SceneBVH::refitAll() {
+
+	for (size_t i = tree.nodes.size(); i-- > 0;) {
+
+		Node& node = tree.nodes[i];
+
+		if (node.count != internalNode) {
+
+			emptyBox(node.minBox, node.maxBox);
+
+			for (uint32_t j = 0; j < node.count; ++j) {
+
+				const ObjectBox& box = objects[tree.items[node.first + j]];
+				float boxMin[3] = { box.centre[0] - box.extents[0], box.centre[1] - box.extents[1], box.centre[2] - box.extents[2] };
+				float boxMax[3] = { box.centre[0] + box.extents[0], box.centre[1] + box.extents[1], box.centre[2] + box.extents[2] };
+
+				growBox(node.minBox, node.maxBox, boxMin, boxMax);
+			}
+		}
+		else {
+
+			emptyBox(node.minBox, node.maxBox);
+			growBox(node.minBox, node.maxBox, tree.nodes[node.first].minBox, tree.nodes[node.first].maxBox);
+			growBox(node.minBox, node.maxBox, tree.nodes[node.first + 1].minBox, tree.nodes[node.first + 1].maxBox);
+		}
+	}
+
+	stats.nodesRefitted += tree.nodes.size();
+}
+
+
+void SceneBVH::startRebuild() {
+
+	vector<uint32_t> ids;
+
+	for (uint32_t id = 0; id < objects.size(); ++id)
+		if (live[id] && objects[id].extents[0] >= 0.0f)
+			ids.push_back(id);
+
+	vector<ObjectBox> boxes = objects;
+
+	rebuilding = true;
+	rebuildDone = false;
+	rebuildThread = thread([this, boxes, ids]() {
+
+		buildTree(boxes, ids, rebuildTree);
+		rebuildDone = true;
+	});
+}
+
+
+void SceneBVH::rebuild() {
+
+	// A build in progress is out of date
+	if (rebuilding) {
+
+		rebuildThread.join();
+		rebuilding = false;
+	}
+
+	vector<uint32_t> ids;
+
+	for (uint32_t id = 0; id < objects.size(); ++id)
+		if (live[id] && objects[id].extents[0] >= 0.0f)
+			ids.push_back(id);
+
+	Tree built;
+	buildTree(objects, ids, built);
+	installTree(built);
+}
+
+
+void SceneBVH::refit() {
+
+	if (rebuilding && rebuildDone) {
+
+		rebuildThread.join();
+		rebuilding = false;
+		installTree(rebuildTree);
+		stats.backgroundBuilds++;
+	}
+
+	for (uint32_t leaf : dirtyLeaves) {
+
+		refitLeaf(leaf);
+		leafDirty[leaf] = false;
+	}
+
+	if (!dirtyLeaves.empty())
+		cost = computeCost(tree.nodes);
+
+	dirtyLeaves.clear();
+
+	if (rebuilding)
+		return;
+
+	// Rebuild when the tree has loosened or many objects that could be placed are outside it
+	size_t placeable = 0;
+
+	for (uint32_t id : pending)
+		if (objects[id].extents[0] >= 0.0f)
+			placeable++;
+
+	size_t placed = objects.size() - numRemoved - pending.size();
+
+	if (placeable > placed / 16 || cost > bvhRebuildCostRatio * tree.cost) {
+
+		if (backgroundRebuild && placed > 0)
+			startRebuild();
+		else
+			rebuild();
+	}
+}
+
+
+void SceneBVH::queryFrustum(const float planes[6][4], VisibilitySet& visibility) const {
+
+	float n[6][4];
+	normaliseFrustumPlanes(planes, n);
+	visibility.resize(objects.size());
+	uint64_t *words = visibility.data();
+
+	if (!tree.nodes.empty()) {
+
+		// Nodes to visit with the planes they may cross
+		vector<pair<uint32_t, uint32_t>> stack = { { 0u, 0x3fu } };
+
+		while (!stack.empty()) {
+
+			uint32_t index = stack.back().first, mask = stack.back().second;
+			stack.pop_back();
+
+			const Node& node = tree.nodes[index];
+
+			if (node.count == 0)
+				continue;
+
+			float centre[3], extents[3];
+
+			for (int a = 0; a < 3; ++a) {
+
+				centre[a] = (node.minBox[a] + node.maxBox[a]) * 0.5f;
+				extents[a] = (node.maxBox[a] - node.minBox[a]) * 0.5f;
+			}
+
+			bool outside = false;
+
+			for (int p = 0; p < 6 && !outside; ++p)
+				if (mask & (1 << p)) {
+
+					float distance = ((n[p][0] * centre[0] + n[p][1] * centre[1]) + n[p][2] * centre[2]) + n[p][3];
+					float reach = (fabsf(n[p][0]) * extents[0] + fabsf(n[p][1]) * extents[1]) + fabsf(n[p][2]) * extents[2];
+					float slack = (fabsf(distance) + reach) * nodeSlack;
+
+					if (distance + reach + slack < 0.0f)
+						outside = true;
+					else if (distance - reach - slack >= 0.0f)
+						mask &= ~(1 << p); // Every descendant is in front of the plane
+				}
+
+			if (outside)
+				continue;
+
+			if (node.count == internalNode) {
+
+				stack.push_back({ node.first, mask });
+				stack.push_back({ node.first + 1, mask });
+				continue;
+			}
+
+			for (uint32_t i = 0; i < node.count; ++i) {
+
+				uint32_t id = tree.items[node.first + i];
+
+				if (mask == 0 || boxInFrustum(n, mask, objects[id].centre, objects[id].extents))
+					words[id >> 6] |= 1ull << (id & 63);
+			}
+		}
+	}
+
+	for (uint32_t id : pending)
+		if (objects[id].extents[0] < 0.0f || boxInFrustum(n, 0x3f, objects[id].centre, objects[id].extents))
+			words[id >> 6] |= 1ull << (id & 63);
+}
+
+
+uint32_t SceneBVH::queryRay(const float origin[3], const float direction[3], float maxDistance, float& distance) const {
+
+	float inverseDirection[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+	uint32_t nearest = bvhNoObject;
+	distance = maxDistance;
+
+	auto testObject = [&](uint32_t id) {
+
+		const ObjectBox& box = objects[id];
+		float boxMin[3] = { box.centre[0] - box.extents[0], box.centre[1] - box.extents[1], box.centre[2] - box.extents[2] };
+		float boxMax[3] = { box.centre[0] + box.extents[0], box.centre[1] + box.extents[1], box.centre[2] + box.extents[2] };
+		float entry;
+
+		if (rayHitsBox(origin, inverseDirection, boxMin, boxMax, distance, entry) && (entry < distance || nearest == bvhNoObject)) {
+
+			nearest = id;
+			distance = entry;
+		}
+	};
+
+	for (uint32_t id : pending)
+		if (objects[id].extents[0] >= 0.0f)
+			testObject(id);
+
+	float entry;
+
+	if (tree.nodes.empty() || tree.nodes[0].count == 0 || !rayHitsBox(origin, inverseDirection, tree.nodes[0].minBox, tree.nodes[0].maxBox, distance, entry))
+		return nearest;
+
+	// Nodes to visit with their entry distances - the nearer child is visited first and nodes entered beyond the nearest hit are skipped
+	vector<pair<uint32_t, float>> stack = { { 0u, entry } };
+
+	while (!stack.empty()) {
+
+		uint32_t index = stack.back().first;
+		float nodeEntry = stack.back().second;
+		stack.pop_back();
+
+		if (nodeEntry > distance)
+			continue;
+
+		const Node& node = tree.nodes[index];
+
+		if (node.count != internalNode) {
+
+			for (uint32_t i = 0; i < node.count; ++i)
+				testObject(tree.items[node.first + i]);
+
+			continue;
+		}
+
+		const Node& a = tree.nodes[node.first];
+		const Node& b = tree.nodes[node.first + 1];
+		float entryA, entryB;
+		bool hitA = a.count != 0 && rayHitsBox(origin, inverseDirection, a.minBox, a.maxBox, distance, entryA);
+		bool hitB = b.count != 0 && rayHitsBox(origin, inverseDirection, b.minBox, b.maxBox, distance, entryB);
+
+		if (hitA && hitB) {
+
+			if (entryA <= entryB) {
+
+				stack.push_back({ node.first + 1, entryB });
+				stack.push_back({ node.first, entryA });
+			}
+			else {
+
+				stack.push_back({ node.first, entryA });
+				stack.push_back({ node.first + 1, entryB });
+			}
+		}
+		else if (hitA)
+			stack.push_back({ node.first, entryA });
+		else if (hitB)
+			stack.push_back({ node.first + 1, entryB });
+	}
+
+	return nearest;
+}
+
+
+void SceneBVH::querySphere(const float centre[3], float radius, vector<uint32_t>& found) const {
+
+	found.clear();
+
+	auto testObject = [&](uint32_t id) {
+
+		const ObjectBox& box = objects[id];
+		float boxMin[3] = { box.centre[0] - box.extents[0], box.centre[1] - box.extents[1], box.centre[2] - box.extents[2] };
+		float boxMax[3] = { box.centre[0] + box.extents[0], box.centre[1] + box.extents[1], box.centre[2] + box.extents[2] };
+
+		if (sphereHitsBox(centre, radius, boxMin, boxMax))
+			found.push_back(id);
+	};
+
+	if (!tree.nodes.empty()) {
+
+		vector<uint32_t> stack = { 0 };
+
+		while (!stack.empty()) {
+
+			const Node& node = tree.nodes[stack.back()];
+			stack.pop_back();
+
+			if (node.count == 0 || !sphereHitsBox(centre, radius, node.minBox, node.maxBox))
+				continue;
+
+			if (node.count == internalNode) {
+
+				stack.push_back(node.first);
+				stack.push_back(node.first + 1);
+			}
+			else
+				for (uint32_t i = 0; i < node.count; ++i)
+					testObject(tree.items[node.first + i]);
+		}
+	}
+
+	for (uint32_t id : pending)
+		if (objects[id].extents[0] >= 0.0f)
+			testObject(id);
+}
+
+
+SceneBVHStats SceneBVH::getStats() const {
+
+	SceneBVHStats result = stats;
+	result.objects = (uint32_t)count(live.begin(), live.end(), true);
+	result.pending = (uint32_t)pending.size();
+	result.nodes = (uint32_t)tree.nodes.size();
+	result.costRatio = tree.cost > 0.0f ? cost / tree.cost : 1.0f;
+
+	return result;
+}
+
+
+void SceneBVH::reportStats() const {
+
+	SceneBVHStats s = getStats();
+
+	cout << "SceneBVH: " << s.objects << " objects (" << s.pending << " outside the tree), " << s.nodes << " nodes, cost " << s.costRatio << " x built, " << s.builds << " builds (" << s.backgroundBuilds << " in the background), " << s.refits << " objects refitted" << endl;
+}
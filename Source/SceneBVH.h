@@ -0,0 +1,133 @@
+
+//
+// SceneBVH.h
+//
+
+// Dynamic bounding volume hierarchy over the world boxes of scene objects for frustum culling, picking (ray) and proximity (sphere) queries.  The tree is built top down with a binned surface area heuristic - objects are split along the longest axis of their centres at the cheapest of 16 bin boundaries - into a flat array of nodes with the two children of a node next to each other.
+// Moving an object only refits the boxes of its leaf and the ancestors that change.  Refitting keeps queries exact but the tree loosens as objects move apart, so when its SAH cost grows past rebuildCostRatio times the cost it was built with (or many objects were added since) a new tree is built from a copy of the boxes on a background thread and swapped in by a later refit.  Objects added since the last build and objects with empty bounds are kept outside the tree and tested one by one.
+
+#pragma once
+#include <Bounds.h>
+#include <FrustumCulling.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+
+static const uint32_t bvhMaxLeafObjects = 4; // Leaves are split down to this size when the SAH favours it
+static const uint32_t bvhMaxLeafObjectsSAH = 16; // and always split above it
+static const uint32_t bvhSAHBins = 16;
+static const float bvhRebuildCostRatio = 1.5f;
+
+static const uint32_t bvhNoObject = 0xffffffff;
+
+
+struct SceneBVHStats {
+	uint32_t							objects; // Live objects
+	uint32_t							pending; // Objects outside the tree
+	uint32_t							nodes;
+	float								costRatio; // SAH cost of the refitted tree over its cost when built
+	uint32_t							builds; // Completed builds (including background builds)
+	uint32_t							backgroundBuilds;
+	uint64_t							refits; // Objects refitted
+	uint64_t							nodesRefitted;
+};
+
+
+class SceneBVH {
+
+	struct ObjectBox {
+		float							centre[3];
+		float							extents[3]; // Negative for empty bounds
+	};
+
+	struct Node {
+		float							minBox[3];
+		uint32_t						first; // First child of an internal node or first entry of items of a leaf
+		float							maxBox[3];
+		uint32_t						count; // Objects in a leaf or internalNode
+	};
+
+	static const uint32_t				internalNode = 0xffffffff;
+
+	// A tree over a set of objects
+	struct Tree {
+		std::vector<Node>				nodes;
+		std::vector<uint32_t>			items; // Objects of each leaf
+		std::vector<uint32_t>			parents;
+		float							cost = 0.0f; // When built
+	};
+
+	std::vector<ObjectBox>				objects; // Indexed by object id
+	std::vector<bool>					live;
+	std::vector<uint32_t>				objectLeaf; // Leaf of each object or bvhNoObject if it is pending or removed
+	std::vector<uint32_t>				pending; // Live objects outside the tree
+	size_t								numRemoved = 0;
+
+	Tree								tree;
+	std::vector<uint32_t>				dirtyLeaves;
+	std::vector<bool>					leafDirty;
+	float								cost = 0.0f; // After the last refit
+
+	// Background build - the thread builds rebuildTree from a copy of the object boxes
+	bool								backgroundRebuild = true;
+	std::thread							rebuildThread;
+	std::atomic<bool>					rebuildDone;
+	bool								rebuilding = false;
+	Tree								rebuildTree;
+
+	SceneBVHStats						stats = {};
+
+	static void buildTree(const std::vector<ObjectBox>& boxes, std::vector<uint32_t> ids, Tree& result);
+	static float computeCost(const std::vector<Node>& nodes);
+
+	void startRebuild();
+	void installTree(Tree& built);
+	void detach(uint32_t object);
+	void refitLeaf(uint32_t leaf);
+	void refitAll();
+
+public:
+
+	SceneBVH();
+
+	// Waits for a background build
+	~SceneBVH();
+
+	// Add an object - it is tested one by one until the next build.  Returns the object id (ids are not reused).
+	uint32_t insert(const Bounds& bounds);
+
+	// Change the bounds of an object (the change is applied to the tree by refit)
+	void setBounds(uint32_t object, const Bounds& bounds);
+
+	void remove(uint32_t object);
+
+	// Apply the changed bounds to the tree.  Installs a finished background build and starts a new one when the tree has degraded.  Call once a frame before querying.
+	void refit();
+
+	// Build the tree from every object now (on the calling thread)
+	void rebuild();
+
+	// If false degraded trees are rebuilt on the calling thread by refit
+	void setBackgroundRebuild(bool background) { backgroundRebuild = background; };
+	bool isRebuilding() const { return rebuilding; };
+
+	// Set visibility (sized to the number of object ids) to the objects whose boxes intersect the frustum planes (see extractFrustumPlanes).  Objects with empty bounds are always visible as with cullBounds.
+	void queryFrustum(const float planes[6][4], VisibilitySet& visibility) const;
+
+	// Nearest object whose box is hit by the ray within maxDistance (direction need not be normalised - distances are in its units).  Returns bvhNoObject if none is hit.
+	uint32_t queryRay(const float origin[3], const float direction[3], float maxDistance, float& distance) const;
+
+	// Objects whose boxes intersect the sphere
+	void querySphere(const float centre[3], float radius, std::vector<uint32_t>& found) const;
+
+	SceneBVHStats getStats() const;
+	void reportStats() const;
+};
+
+
+// Box tests of the queries, also used by the brute force reference of the tests.  rayHitsBox returns the entry distance of a ray (with the inverse of its direction) into a box and false if the ray misses the box within maxDistance.
+bool rayHitsBox(const float origin[3], const float inverseDirection[3], const float minBox[3], const float maxBox[3], float maxDistance, float& entry);
+bool sphereHitsBox(const float centre[3], float radius, const float minBox[3], const float maxBox[3]);
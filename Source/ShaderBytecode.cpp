@@ -0,0 +1,74 @@
+
+#include "ShaderBytecode.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash) {
+
+	const uint8_t *bytes = (const uint8_t*)data;
+
+	for (size_t i = 0; i < size; ++i) {
+
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+
+// The same file may be named with either separator (and in any case on Windows)
+static string getFileKey(const string& filename) {
+
+	string key = filename;
+
+	for (char& c : key) {
+
+		if (c == '\\')
+			c = '/';
+#ifdef _WIN32
+		c = (char)tolower((unsigned char)c);
+#endif
+	}
+
+	return key;
+}
+
+
+ShaderBytecode ShaderBytecodeStore::load(const string& filename, bool countRequest) {
+
+	string key = getFileKey(filename);
+	auto entry = files.find(key);
+
+	if (entry == files.end()) {
+
+		MappedBytecode mapped;
+		mapped.file.reset(new MappedFile(filename));
+
+		if (!mapped.file->isValid())
+			throw runtime_error("Cannot open shader " + filename);
+
+		mapped.bytecode.data = mapped.file->getData();
+		mapped.bytecode.size = mapped.file->getSize();
+		mapped.bytecode.hash = hashBytes(mapped.bytecode.data, mapped.bytecode.size);
+
+		stats.fileLoads++;
+		stats.bytesRead += mapped.bytecode.size;
+
+		if (hashes.insert(mapped.bytecode.hash).second)
+			stats.uniqueBytecodes++;
+
+		entry = files.insert(make_pair(key, move(mapped))).first;
+	}
+
+	if (countRequest) {
+
+		stats.requests++;
+		stats.requestedBytes += entry->second.bytecode.size;
+	}
+
+	return entry->second.bytecode;
+}
@@ -0,0 +1,56 @@
+
+//
+// ShaderBytecode.h
+//
+
+// Compiled shader (.cso) files memory mapped once and shared by every shader created from them.  Each file is mapped the first time it is requested and stays mapped for the lifetime of the store, so later requests for the same file (usually the same vertex shader used by several effects) return the same bytes without opening the file again.  The bytecode is hashed when it is mapped so identical shaders saved under different names can share their Direct3D objects (see ShaderLibrary).
+
+#pragma once
+#include <MappedFile.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+
+// Bytecode of a compiled shader, valid for the lifetime of the ShaderBytecodeStore that returned it
+struct ShaderBytecode {
+	const uint8_t						*data;
+	size_t								size;
+	uint64_t							hash;
+};
+
+struct ShaderBytecodeStats {
+	uint64_t							requests; // Calls to load()
+	uint64_t							requestedBytes; // Bytes a separate read per request would have read
+	uint32_t							fileLoads; // Files mapped
+	uint64_t							bytesRead; // Bytes of the mapped files
+	uint32_t							uniqueBytecodes; // Mapped files with different bytecode
+};
+
+
+class ShaderBytecodeStore {
+
+	struct MappedBytecode {
+		std::unique_ptr<MappedFile>		file;
+		ShaderBytecode					bytecode;
+	};
+
+	std::map<std::string, MappedBytecode>	files; // Keyed by filename
+	std::set<uint64_t>					hashes;
+	ShaderBytecodeStats					stats = {};
+
+public:
+
+	// Bytecode of filename, mapped on the first request.  countRequest is false when the bytecode is loaded again for another object of the same request (an input layout of a vertex shader) so the requests match the loads of a separate read per request.  Throws runtime_error if the file cannot be mapped.
+	ShaderBytecode load(const std::string& filename, bool countRequest = true);
+
+	ShaderBytecodeStats getStats() const { return stats; };
+};
+
+
+// 64 bit FNV-1a hash of size bytes, continuing from hash (chain calls to hash several blocks)
+uint64_t hashBytes(const void *data, size_t size, uint64_t hash = 14695981039346656037ull);
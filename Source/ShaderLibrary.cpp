@@ -0,0 +1,173 @@
+#include "stdafx.h"
+#include "ShaderLibrary.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+
+
+template <class Shader>
+static void releaseAll(map<uint64_t, Shader*>& objects) {
+
+	for (auto& entry : objects)
+		entry.second->Release();
+
+	objects.clear();
+}
+
+
+ShaderLibrary::~ShaderLibrary() {
+
+	releaseAll(vertexShaders);
+	releaseAll(pixelShaders);
+	releaseAll(geometryShaders);
+	releaseAll(hullShaders);
+	releaseAll(domainShaders);
+
+	for (auto& entry : inputLayouts)
+		entry.second->Release();
+}
+
+
+template <class Shader, class CreateShader>
+Shader *ShaderLibrary::getShader(map<uint64_t, Shader*>& shaders, const char *filename, CreateShader createShader) {
+
+	ShaderBytecode bytecode = bytecodes.load(filename);
+	auto entry = shaders.find(bytecode.hash);
+
+	if (entry != shaders.end()) {
+
+		shadersShared++;
+		entry->second->AddRef();
+		return entry->second;
+	}
+
+	Shader *shader = nullptr;
+	HRESULT hr = createShader(bytecode, &shader);
+
+	if (!SUCCEEDED(hr)) {
+
+		cout << "ShaderLibrary: cannot create shader " << filename << endl;
+		throw exception("Cannot create shader interface");
+	}
+
+	shadersCreated++;
+	shaders[bytecode.hash] = shader;
+
+	// One reference for the library and one for the caller
+	shader->AddRef();
+	return shader;
+}
+
+
+ID3D11VertexShader *ShaderLibrary::getVertexShader(const char *filename) {
+
+	return getShader(vertexShaders, filename, [this](const ShaderBytecode& bytecode, ID3D11VertexShader **shader) {
+		return device->CreateVertexShader(bytecode.data, bytecode.size, NULL, shader); });
+}
+
+
+ID3D11PixelShader *ShaderLibrary::getPixelShader(const char *filename) {
+
+	return getShader(pixelShaders, filename, [this](const ShaderBytecode& bytecode, ID3D11PixelShader **shader) {
+		return device->CreatePixelShader(bytecode.data, bytecode.size, NULL, shader); });
+}
+
+
+ID3D11GeometryShader *ShaderLibrary::getGeometryShader(const char *filename) {
+
+	return getShader(geometryShaders, filename, [this](const ShaderBytecode& bytecode, ID3D11GeometryShader **shader) {
+		return device->CreateGeometryShader(bytecode.data, bytecode.size, NULL, shader); });
+}
+
+
+ID3D11HullShader *ShaderLibrary::getHullShader(const char *filename) {
+
+	return getShader(hullShaders, filename, [this](const ShaderBytecode& bytecode, ID3D11HullShader **shader) {
+		return device->CreateHullShader(bytecode.data, bytecode.size, NULL, shader); });
+}
+
+
+ID3D11DomainShader *ShaderLibrary::getDomainShader(const char *filename) {
+
+	return getShader(domainShaders, filename, [this](const ShaderBytecode& bytecode, ID3D11DomainShader **shader) {
+		return device->CreateDomainShader(bytecode.data, bytecode.size, NULL, shader); });
+}
+
+
+// Hash of every field of the vertex description including the semantic names (the pointers differ between copies of a description)
+static uint64_t hashVertexDesc(const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements) {
+
+	uint64_t hash = hashBytes(&numVertexElements, sizeof(numVertexElements));
+
+	for (UINT i = 0; i < numVertexElements; ++i) {
+
+		const D3D11_INPUT_ELEMENT_DESC& element = vertexDesc[i];
+
+		hash = hashBytes(element.SemanticName, strlen(element.SemanticName) + 1, hash);
+		hash = hashBytes(&element.SemanticIndex, sizeof(element.SemanticIndex), hash);
+		hash = hashBytes(&element.Format, sizeof(element.Format), hash);
+		hash = hashBytes(&element.InputSlot, sizeof(element.InputSlot), hash);
+		hash = hashBytes(&element.AlignedByteOffset, sizeof(element.AlignedByteOffset), hash);
+		hash = hashBytes(&element.InputSlotClass, sizeof(element.InputSlotClass), hash);
+		hash = hashBytes(&element.InstanceDataStepRate, sizeof(element.InstanceDataStepRate), hash);
+	}
+
+	return hash;
+}
+
+
+ID3D11InputLayout *ShaderLibrary::getInputLayout(const char *vertexShaderFilename, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements) {
+
+	// The vertex shader was requested with its input layout
+	ShaderBytecode bytecode = bytecodes.load(vertexShaderFilename, false);
+	pair<uint64_t, uint64_t> key(bytecode.hash, hashVertexDesc(vertexDesc, numVertexElements));
+	auto entry = inputLayouts.find(key);
+
+	if (entry != inputLayouts.end()) {
+
+		inputLayoutsShared++;
+		entry->second->AddRef();
+		return entry->second;
+	}
+
+	ID3D11InputLayout *inputLayout = nullptr;
+	HRESULT hr = device->CreateInputLayout(vertexDesc, numVertexElements, bytecode.data, bytecode.size, &inputLayout);
+
+	if (!SUCCEEDED(hr)) {
+
+		cout << "ShaderLibrary: cannot create input layout for " << vertexShaderFilename << endl;
+		throw exception("Cannot create InputLayout interface");
+	}
+
+	inputLayoutsCreated++;
+	inputLayouts[key] = inputLayout;
+
+	inputLayout->AddRef();
+	return inputLayout;
+}
+
+
+const char *ShaderLibrary::getVariantFilename(const ShaderVariant& variant, ShaderType type) {
+
+	// The variants compiledShaderVariants lists are built by the project (see Shaders/ShaderPermutations.targets)
+	static const ShaderPermutationTable compiledVariants("Shaders\\cso\\");
+	const string *filename = compiledVariants.find(variant);
+
+	if (!filename || shaderFamilies[variant.family].type != type) {
+
+		cout << "ShaderLibrary: shader variant " << getShaderVariantName(variant) << " is not compiled as a " << (type == VertexShaderType ? "vertex" : "pixel") << " shader" << endl;
+		throw exception("Shader variant not compiled");
+	}
+
+	return filename->c_str();
+}
+
+
+void ShaderLibrary::reportStats() {
+
+	ShaderBytecodeStats s = bytecodes.getStats();
+
+	cout << "ShaderLibrary: " << s.requests << " shader requests, before = " << s.requests << " loads, " << fixed << setprecision(3) << s.requestedBytes / 1024.0 << " KB read, after = " << s.fileLoads << " loads, " << s.bytesRead / 1024.0 << " KB read (" << s.uniqueBytecodes << " unique bytecodes)" << endl;
+	cout << "ShaderLibrary: " << shadersCreated << " shaders and " << inputLayoutsCreated << " input layouts created, " << shadersShared << " shader and " << inputLayoutsShared << " input layout requests shared" << endl;
+	cout.unsetf(ios::floatfield);
+}
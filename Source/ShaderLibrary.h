@@ -0,0 +1,67 @@
+
+//
+// ShaderLibrary.h
+//
+
+// Shared shader and input layout objects created from compiled shader (.cso) files.  Each file is memory mapped once (see ShaderBytecodeStore) and each shader object is created once per bytecode, so effects using the same shaders (or the same bytecode saved under another name) share one ID3D11*Shader.  Input layouts are created once per vertex shader bytecode and vertex description.
+// The get methods return a new reference that the caller releases (as Effect does) - the library keeps its own reference until it is destroyed.
+
+#pragma once
+#include <d3d11_2.h>
+#include <map>
+#include <utility>
+#include <cstdint>
+#include <ShaderBytecode.h>
+#include <ShaderPermutation.h>
+
+
+class ShaderLibrary {
+
+	ID3D11Device						*device = nullptr;
+	ShaderBytecodeStore					bytecodes;
+
+	// Keyed by bytecode hash
+	std::map<uint64_t, ID3D11VertexShader*>		vertexShaders;
+	std::map<uint64_t, ID3D11PixelShader*>		pixelShaders;
+	std::map<uint64_t, ID3D11GeometryShader*>	geometryShaders;
+	std::map<uint64_t, ID3D11HullShader*>		hullShaders;
+	std::map<uint64_t, ID3D11DomainShader*>		domainShaders;
+
+	// Keyed by vertex shader bytecode hash and vertex description hash
+	std::map<std::pair<uint64_t, uint64_t>, ID3D11InputLayout*>	inputLayouts;
+
+	uint32_t							shadersCreated = 0;
+	uint32_t							shadersShared = 0;
+	uint32_t							inputLayoutsCreated = 0;
+	uint32_t							inputLayoutsShared = 0;
+
+	// Find or create the shader for the bytecode of filename
+	template <class Shader, class CreateShader>
+	Shader *getShader(std::map<uint64_t, Shader*>& shaders, const char *filename, CreateShader createShader);
+
+public:
+
+	ShaderLibrary(ID3D11Device *_device) : device(_device) {};
+	~ShaderLibrary();
+
+	ShaderLibrary(const ShaderLibrary&) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+	// Shared shader created from filename.  Throws an exception if the file cannot be loaded or the shader cannot be created.
+	ID3D11VertexShader *getVertexShader(const char *filename);
+	ID3D11PixelShader *getPixelShader(const char *filename);
+	ID3D11GeometryShader *getGeometryShader(const char *filename);
+	ID3D11HullShader *getHullShader(const char *filename);
+	ID3D11DomainShader *getDomainShader(const char *filename);
+
+	// Shared input layout of vertexDesc for the vertex shader in vertexShaderFilename
+	ID3D11InputLayout *getInputLayout(const char *vertexShaderFilename, const D3D11_INPUT_ELEMENT_DESC vertexDesc[], UINT numVertexElements);
+
+	// Compiled file of a shader variant of the given type (see ShaderPermutation.h), found in constant time.  Throws an exception if the variant is not compiled or is of another type.
+	static const char *getVariantFilename(const ShaderVariant& variant, ShaderType type);
+
+	ShaderBytecodeStats getStats() const { return bytecodes.getStats(); };
+
+	// Print the files and bytes read against a separate read per request and the objects created and shared
+	void reportStats();
+};
@@ -0,0 +1,129 @@
+
+#include "ShaderPermutation.h"
+#include <algorithm>
+#include <sstream>
+#include <cstring>
+
+using namespace std;
+
+
+static const char *axesTag = "// Permutation axes:";
+
+
+string getShaderVariantName(const ShaderVariant& variant) {
+
+	string name = shaderFamilies[variant.family].name;
+
+	for (uint32_t feature = 0; feature < numShaderFeatures; ++feature)
+		if (variant.key.has((ShaderFeature)(1u << feature)))
+			name += string("_") + shaderFeatureNames[feature].suffix;
+
+	return name;
+}
+
+
+string getShaderVariantDefines(const ShaderVariant& variant) {
+
+	string defines;
+
+	for (uint32_t feature = 0; feature < numShaderFeatures; ++feature)
+		if (variant.key.has((ShaderFeature)(1u << feature)))
+			defines += (defines.empty() ? "" : ";") + string(shaderFeatureNames[feature].define) + "=1";
+
+	return defines;
+}
+
+
+ShaderKey parseShaderAxes(const string& source) {
+
+	size_t start = source.find(axesTag);
+
+	if (start == string::npos)
+		return ShaderKey();
+
+	start += strlen(axesTag);
+	size_t end = source.find_first_of("\r\n", start);
+	istringstream line(source.substr(start, end == string::npos ? string::npos : end - start));
+	ShaderKey axes;
+	string define;
+
+	// Names are separated by spaces or commas
+	while (line >> define) {
+
+		define.erase(remove(define.begin(), define.end(), ','), define.end());
+
+		if (define.empty())
+			continue;
+
+		uint32_t feature = 0;
+
+		while (feature < numShaderFeatures && define != shaderFeatureNames[feature].define)
+			++feature;
+
+		if (feature == numShaderFeatures)
+			throw runtime_error("parseShaderAxes: unknown permutation axis " + define);
+
+		axes = axes | ShaderKey((ShaderFeature)(1u << feature));
+	}
+
+	return axes;
+}
+
+
+//
+// ShaderPermutationTable
+//
+
+ShaderPermutationTable::ShaderPermutationTable(const string& directory, const ShaderVariant *variants, size_t numVariants) {
+
+	// Every combination of each family's axes has a slot
+	uint32_t numSlots = 0;
+
+	for (uint32_t family = 0; family < NumShaderFamilies; ++family) {
+
+		families[family].first = numSlots;
+		families[family].axes = shaderFamilies[family].axes.getBits();
+		numSlots += getSlot(ShaderKey(families[family].axes), shaderFamilies[family].axes) + 1;
+	}
+
+	filenames.resize(numSlots);
+
+	for (size_t i = 0; i < numVariants; ++i) {
+
+		const ShaderVariant& variant = variants[i];
+
+		if (variant.family >= NumShaderFamilies || !variant.key.isSubsetOf(shaderFamilies[variant.family].axes))
+			throw runtime_error("ShaderPermutationTable: invalid shader variant");
+
+		filenames[families[variant.family].first + getSlot(variant.key, shaderFamilies[variant.family].axes)] = directory + getShaderVariantName(variant) + ".cso";
+	}
+}
+
+
+uint32_t ShaderPermutationTable::getSlot(ShaderKey key, ShaderKey axes) {
+
+	// Gather the key bits at the positions of the axes into the low bits
+	uint32_t slot = 0, bit = 1;
+
+	for (uint32_t mask = axes.getBits(); mask; mask &= mask - 1, bit <<= 1)
+		if (key.getBits() & mask & (0u - mask))
+			slot |= bit;
+
+	return slot;
+}
+
+
+const string *ShaderPermutationTable::find(const ShaderVariant& variant) const {
+
+	if (variant.family >= NumShaderFamilies)
+		return nullptr;
+
+	const FamilySlots& slots = families[variant.family];
+
+	if ((variant.key.getBits() & ~slots.axes) != 0)
+		return nullptr;
+
+	const string& filename = filenames[slots.first + getSlot(variant.key, ShaderKey(slots.axes))];
+
+	return filename.empty() ? nullptr : &filename;
+}
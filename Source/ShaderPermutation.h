@@ -0,0 +1,141 @@
+
+//
+// ShaderPermutation.h
+//
+
+// Compile time shader permutations.  Shaders that differ by a few features are written once - each HLSL file declares the features it can be compiled with (its permutation axes) on a "// Permutation axes:" line and tests them with #if.  A ShaderKey holds a set of features and a ShaderVariant names a family (HLSL file) and key.  Keys are constexpr so a variant with a feature its family does not declare fails to compile.
+// The variants the engine uses are listed in compiledShaderVariants.  The offline build compiles exactly these (Tools/ShaderPermutations writes the build rules) and ShaderPermutationTable finds the compiled file of a variant in constant time, so the GPU runs a specialised shader without branching on features at run time.
+
+#pragma once
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+
+
+// Feature bits of a ShaderKey
+enum ShaderFeature : uint32_t {
+	WindAnimation = 1 << 0, // Vertices sway with the scene wind (trees)
+	TextureColour = 1 << 1, // The base colour is the diffuse texture alone rather than the material colour times the texture (foliage)
+	DiffuseMap = 1 << 2, // The base colour is modulated by a diffuse map (reflection mapping)
+	SpecularMap = 1 << 3, // The reflection is modulated by a specular map (reflection mapping)
+	Instancing = 1 << 4 // World matrices are per-instance vertex data (see InstancedModel)
+};
+
+static const uint32_t numShaderFeatures = 5;
+
+// HLSL define and compiled file suffix of each feature in bit order
+struct ShaderFeatureName {
+	const char							*define;
+	const char							*suffix;
+};
+
+static const ShaderFeatureName shaderFeatureNames[numShaderFeatures] = {
+	{ "WIND_ANIMATION", "wind" }, { "TEXTURE_COLOUR", "texcolour" }, { "DIFFUSE_MAP", "diffmap" }, { "SPECULAR_MAP", "specmap" }, { "INSTANCED", "instanced" }
+};
+
+
+class ShaderKey {
+
+	uint32_t							bits;
+
+public:
+
+	constexpr ShaderKey() : bits(0) {};
+	constexpr ShaderKey(ShaderFeature feature) : bits(feature) {};
+	constexpr explicit ShaderKey(uint32_t _bits) : bits(_bits) {};
+
+	constexpr uint32_t getBits() const { return bits; };
+	constexpr bool has(ShaderFeature feature) const { return (bits & feature) != 0; };
+	constexpr bool isSubsetOf(ShaderKey other) const { return (bits & ~other.bits) == 0; };
+
+	constexpr ShaderKey operator|(ShaderKey other) const { return ShaderKey(bits | other.bits); };
+	constexpr bool operator==(ShaderKey other) const { return bits == other.bits; };
+	constexpr bool operator!=(ShaderKey other) const { return bits != other.bits; };
+};
+
+constexpr ShaderKey operator|(ShaderFeature a, ShaderFeature b) { return ShaderKey(a) | ShaderKey(b); }
+
+
+enum ShaderType : uint32_t {
+	VertexShaderType,
+	PixelShaderType
+};
+
+// HLSL file (Shaders/hlsl/<name>.hlsl) and the features it declares
+struct ShaderFamily {
+	const char							*name;
+	ShaderType							type;
+	ShaderKey							axes;
+};
+
+enum ShaderFamilyId : uint32_t {
+	PerPixelLightingVS,
+	PerPixelLightingPS,
+	ReflectionMapPS,
+	NumShaderFamilies
+};
+
+static constexpr ShaderFamily shaderFamilies[NumShaderFamilies] = {
+	{ "per_pixel_lighting_vs", VertexShaderType, WindAnimation | Instancing },
+	{ "per_pixel_lighting_ps", PixelShaderType, TextureColour },
+	{ "reflection_map_ps", PixelShaderType, DiffuseMap | SpecularMap }
+};
+
+struct ShaderVariant {
+	ShaderFamilyId						family;
+	ShaderKey							key;
+};
+
+// Variant of family with the features of key.  A key with a feature the family does not declare is a compile error in a constant expression (and throws logic_error otherwise).
+constexpr ShaderVariant shaderVariant(ShaderFamilyId family, ShaderKey key = ShaderKey()) {
+
+	return key.isSubsetOf(shaderFamilies[family].axes) ? ShaderVariant{ family, key } : throw std::logic_error("shaderVariant: the key has a feature the shader family does not declare");
+}
+
+
+// Variants used by the engine - add a variant here to have it compiled
+constexpr ShaderVariant modelVertexShader = shaderVariant(PerPixelLightingVS);
+constexpr ShaderVariant treeVertexShader = shaderVariant(PerPixelLightingVS, WindAnimation);
+constexpr ShaderVariant instancedModelVertexShader = shaderVariant(PerPixelLightingVS, Instancing);
+constexpr ShaderVariant instancedTreeVertexShader = shaderVariant(PerPixelLightingVS, WindAnimation | Instancing);
+constexpr ShaderVariant modelPixelShader = shaderVariant(PerPixelLightingPS);
+constexpr ShaderVariant treePixelShader = shaderVariant(PerPixelLightingPS, TextureColour);
+constexpr ShaderVariant reflectionMapPixelShader = shaderVariant(ReflectionMapPS);
+
+static constexpr ShaderVariant compiledShaderVariants[] = { modelVertexShader, treeVertexShader, instancedModelVertexShader, instancedTreeVertexShader, modelPixelShader, treePixelShader, reflectionMapPixelShader };
+
+
+// Compiled file name of a variant without directory or extension - the family name followed by the suffix of each feature (the family name alone for no features)
+std::string getShaderVariantName(const ShaderVariant& variant);
+
+// Defines a variant is compiled with (DEFINE=1 for each feature, separated by ';')
+std::string getShaderVariantDefines(const ShaderVariant& variant);
+
+// Features declared on the "// Permutation axes:" line of HLSL source (none if there is no such line).  Throws runtime_error for an unknown feature.
+ShaderKey parseShaderAxes(const std::string& source);
+
+
+// Compiled files of the variants, indexed by family and by the key's features compacted to the family's axes
+class ShaderPermutationTable {
+
+	struct FamilySlots {
+		uint32_t						first; // First slot of the family
+		uint32_t						axes;
+	};
+
+	FamilySlots							families[NumShaderFamilies];
+	std::vector<std::string>			filenames; // Empty for variants that are not compiled
+
+public:
+
+	// Files directory + name + ".cso" of the given variants
+	ShaderPermutationTable(const std::string& directory, const ShaderVariant *variants = compiledShaderVariants, size_t numVariants = sizeof(compiledShaderVariants) / sizeof(ShaderVariant));
+
+	// Slot of key among the 2^n combinations of n axes
+	static uint32_t getSlot(ShaderKey key, ShaderKey axes);
+
+	// Compiled file of variant, or null if it is not compiled
+	const std::string *find(const ShaderVariant& variant) const;
+};
@@ -0,0 +1,162 @@
+#include "stdafx.h"
+#include "StateCache.h"
+#include "StateTrackingContext.h"
+#include <iostream>
+#include <cstring>
+
+
+void PipelineState::bind(StateTrackingContext *context) const {
+
+	context->RSSetState(rasterizerState);
+	context->OMSetDepthStencilState(depthStencilState, stencilRef);
+	context->OMSetBlendState(blendState, blendFactor, sampleMask);
+	context->VSSetShader(vertexShader, 0, 0);
+	context->PSSetShader(pixelShader, 0, 0);
+	context->GSSetShader(geometryShader, 0, 0);
+	context->DSSetShader(domainShader, 0, 0);
+	context->HSSetShader(hullShader, 0, 0);
+	context->IASetInputLayout(inputLayout);
+}
+
+
+StateCache::StateCache(ID3D11Device *_device) : device(_device), cache([](StateType type, void *state) {
+
+	if (type == PipelineStateType)
+		delete (PipelineState*)state;
+	else
+		((IUnknown*)state)->Release();
+}) {}
+
+
+// Shared object for a description in canonical form (key) created from the caller's description, with a new reference for the caller
+template <class State, class Key>
+static State *getState(StateObjectCache& cache, StateType type, const Key& key, const StateObjectCache::CreateState& create, const char *error) {
+
+	State *state = (State*)cache.get(type, &key, sizeof(key), create);
+
+	if (!state) {
+
+		cout << "StateCache: " << error << endl;
+		throw exception(error);
+	}
+
+	state->AddRef();
+	return state;
+}
+
+
+ID3D11RasterizerState *StateCache::getRasterizerState(const D3D11_RASTERIZER_DESC& desc) {
+
+	// Every field is 32 bits so the description has no padding
+	return getState<ID3D11RasterizerState>(cache, RasterizerStateType, desc, [&]() -> void* {
+		ID3D11RasterizerState *state = nullptr;
+		return SUCCEEDED(device->CreateRasterizerState(&desc, &state)) ? state : nullptr; }, "Cannot create Rasterise state interface");
+}
+
+
+ID3D11DepthStencilState *StateCache::getDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc) {
+
+	// The stencil masks are followed by padding and the stencil fields are ignored while stencil is disabled
+	D3D11_DEPTH_STENCIL_DESC key;
+	memset(&key, 0, sizeof(key));
+
+	key.DepthEnable = desc.DepthEnable;
+	key.DepthWriteMask = desc.DepthWriteMask;
+	key.DepthFunc = desc.DepthFunc;
+	key.StencilEnable = desc.StencilEnable;
+
+	if (desc.StencilEnable) {
+
+		key.StencilReadMask = desc.StencilReadMask;
+		key.StencilWriteMask = desc.StencilWriteMask;
+		key.FrontFace = desc.FrontFace;
+		key.BackFace = desc.BackFace;
+	}
+
+	return getState<ID3D11DepthStencilState>(cache, DepthStencilStateType, key, [&]() -> void* {
+		ID3D11DepthStencilState *state = nullptr;
+		return SUCCEEDED(device->CreateDepthStencilState(&desc, &state)) ? state : nullptr; }, "Cannot create DepthStencil state interface");
+}
+
+
+ID3D11BlendState *StateCache::getBlendState(const D3D11_BLEND_DESC& desc) {
+
+	// The write masks are followed by padding, render targets 1 to 7 are ignored without independent blending and the blend factors are ignored while blending is disabled
+	D3D11_BLEND_DESC key;
+	memset(&key, 0, sizeof(key));
+
+	key.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+	key.IndependentBlendEnable = desc.IndependentBlendEnable;
+
+	int numRenderTargets = desc.IndependentBlendEnable ? 8 : 1;
+
+	for (int i = 0; i < numRenderTargets; ++i) {
+
+		const D3D11_RENDER_TARGET_BLEND_DESC& target = desc.RenderTarget[i];
+
+		key.RenderTarget[i].BlendEnable = target.BlendEnable;
+		key.RenderTarget[i].RenderTargetWriteMask = target.RenderTargetWriteMask;
+
+		if (target.BlendEnable) {
+
+			key.RenderTarget[i].SrcBlend = target.SrcBlend;
+			key.RenderTarget[i].DestBlend = target.DestBlend;
+			key.RenderTarget[i].BlendOp = target.BlendOp;
+			key.RenderTarget[i].SrcBlendAlpha = target.SrcBlendAlpha;
+			key.RenderTarget[i].DestBlendAlpha = target.DestBlendAlpha;
+			key.RenderTarget[i].BlendOpAlpha = target.BlendOpAlpha;
+		}
+	}
+
+	return getState<ID3D11BlendState>(cache, BlendStateType, key, [&]() -> void* {
+		ID3D11BlendState *state = nullptr;
+		return SUCCEEDED(device->CreateBlendState(&desc, &state)) ? state : nullptr; }, "Cannot create Blend state interface");
+}
+
+
+ID3D11SamplerState *StateCache::getSamplerState(const D3D11_SAMPLER_DESC& desc) {
+
+	// Every field is 32 bits so the description has no padding
+	return getState<ID3D11SamplerState>(cache, SamplerStateType, desc, [&]() -> void* {
+		ID3D11SamplerState *state = nullptr;
+		return SUCCEEDED(device->CreateSamplerState(&desc, &state)) ? state : nullptr; }, "Cannot create Sampler state interface");
+}
+
+
+const PipelineState *StateCache::getPipelineState(const PipelineState& desc) {
+
+	struct PipelineKey {
+		const void						*objects[9];
+		FLOAT							blendFactor[4];
+		UINT							sampleMask;
+		UINT							stencilRef;
+	};
+
+	PipelineKey key;
+	memset(&key, 0, sizeof(key));
+
+	const void *objects[] = { desc.inputLayout, desc.vertexShader, desc.hullShader, desc.domainShader, desc.geometryShader, desc.pixelShader, desc.rasterizerState, desc.depthStencilState, desc.blendState };
+	memcpy(key.objects, objects, sizeof(objects));
+	memcpy(key.blendFactor, desc.blendFactor, sizeof(key.blendFactor));
+	key.sampleMask = desc.sampleMask;
+	key.stencilRef = desc.stencilRef;
+
+	return (const PipelineState*)cache.get(PipelineStateType, &key, sizeof(key), [&]() -> void* {
+		PipelineState *state = new PipelineState(desc);
+		state->id = ++numPipelineStates;
+		return state; });
+}
+
+
+void StateCache::reportStats() {
+
+	const StateCacheStats& s = cache.getStats();
+	const char *names[] = { "rasterizer", "depth stencil", "blend", "sampler", "pipeline" };
+
+	cout << "StateCache:";
+
+	for (int type = 0; type < NumStateTypes; ++type)
+		cout << (type ? ", " : " ") << names[type] << " " << s.created[type] << " created of " << s.requests[type] << " requested";
+
+	cout << endl;
+}
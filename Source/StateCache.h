@@ -0,0 +1,59 @@
+
+//
+// StateCache.h
+//
+
+// Shared immutable rasterizer, depth-stencil, blend and sampler states.  Each distinct description is created once (see StateObjectCache) so effects and models asking for the same states share one object and can compare states by pointer.  The get methods return a new reference that the caller releases - the cache keeps its own reference until it is destroyed.
+// PipelineState is a lightweight handle to everything an Effect binds.  Handles are shared in the same way so equal pipelines have the same handle and id.
+
+#pragma once
+#include <d3d11_2.h>
+#include <StateObjectCache.h>
+
+class StateTrackingContext;
+
+
+// Shaders, input layout and fixed function states of a draw.  Handles returned by StateCache::getPipelineState hold no references - the objects must outlive the handle (they are owned by the effects, ShaderLibrary and StateCache).
+struct PipelineState {
+	ID3D11InputLayout					*inputLayout = nullptr;
+	ID3D11VertexShader					*vertexShader = nullptr;
+	ID3D11HullShader					*hullShader = nullptr;
+	ID3D11DomainShader					*domainShader = nullptr;
+	ID3D11GeometryShader				*geometryShader = nullptr;
+	ID3D11PixelShader					*pixelShader = nullptr;
+	ID3D11RasterizerState				*rasterizerState = nullptr;
+	ID3D11DepthStencilState				*depthStencilState = nullptr;
+	ID3D11BlendState					*blendState = nullptr;
+	FLOAT								blendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	UINT								sampleMask = 0xFFFFFFFF;
+	UINT								stencilRef = 0;
+	uint32_t							id = 0; // Unique per handle, assigned by StateCache::getPipelineState (1 upwards)
+
+	void bind(StateTrackingContext *context) const;
+};
+
+
+class StateCache {
+
+	ID3D11Device						*device = nullptr;
+	StateObjectCache					cache;
+	uint32_t							numPipelineStates = 0;
+
+public:
+
+	StateCache(ID3D11Device *_device);
+
+	// Shared state for desc.  Throws an exception if the state cannot be created.
+	ID3D11RasterizerState *getRasterizerState(const D3D11_RASTERIZER_DESC& desc);
+	ID3D11DepthStencilState *getDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& desc);
+	ID3D11BlendState *getBlendState(const D3D11_BLEND_DESC& desc);
+	ID3D11SamplerState *getSamplerState(const D3D11_SAMPLER_DESC& desc);
+
+	// Shared handle for the objects of desc (its id is ignored).  Valid for the lifetime of the cache.
+	const PipelineState *getPipelineState(const PipelineState& desc);
+
+	StateCacheStats getStats() const { return cache.getStats(); };
+
+	// Print the states created against the states requested
+	void reportStats();
+};
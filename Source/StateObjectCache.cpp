@@ -0,0 +1,45 @@
+
+#include "StateObjectCache.h"
+#include "ShaderBytecode.h"
+#include <cstring>
+
+using namespace std;
+
+
+StateObjectCache::~StateObjectCache() {
+
+	for (auto& bucket : entries)
+		for (Entry& entry : bucket.second)
+			release(entry.type, entry.state);
+}
+
+
+void *StateObjectCache::get(StateType type, const void *desc, size_t descBytes, const CreateState& create) {
+
+	stats.requests[type]++;
+
+	uint64_t hash = hashBytes(desc, descBytes, hashBytes(&type, sizeof(type)));
+	vector<Entry>& bucket = entries[hash];
+
+	for (const Entry& entry : bucket)
+		if (entry.type == type && entry.desc.size() == descBytes && memcmp(entry.desc.data(), desc, descBytes) == 0)
+			return entry.state;
+
+	void *state = create();
+
+	if (!state) {
+
+		stats.failed++;
+		return nullptr;
+	}
+
+	stats.created[type]++;
+
+	Entry entry;
+	entry.type = type;
+	entry.desc.assign((const uint8_t*)desc, (const uint8_t*)desc + descBytes);
+	entry.state = state;
+	bucket.push_back(move(entry));
+
+	return state;
+}
@@ -0,0 +1,66 @@
+
+//
+// StateObjectCache.h
+//
+
+// Shared immutable state objects keyed by a hash of their full description.  Each distinct description creates one object the first time it is requested and every later request for the same description (compared byte for byte, so hash collisions are harmless) returns the same object.  The objects are opaque to the cache - StateCache creates and releases Direct3D state objects through it and the tests use a mock device (see Tests/StateObjectCacheTests.cpp), so the hashing and sharing can be checked without a GPU.
+// Descriptions must be passed in a canonical form - padding and fields the object ignores set to zero - so that equal states have equal bytes (see StateCache.cpp).
+
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+
+enum StateType : uint32_t {
+	RasterizerStateType,
+	DepthStencilStateType,
+	BlendStateType,
+	SamplerStateType,
+	PipelineStateType,
+	NumStateTypes
+};
+
+struct StateCacheStats {
+	uint64_t							requests[NumStateTypes];
+	uint32_t							created[NumStateTypes];
+	uint32_t							failed; // Objects that could not be created (not cached)
+};
+
+
+class StateObjectCache {
+
+public:
+
+	// Create the object for a description not in the cache - returns null if it cannot be created
+	typedef std::function<void*()>		CreateState;
+	typedef std::function<void(StateType type, void *state)>	ReleaseState;
+
+private:
+
+	struct Entry {
+		StateType						type;
+		std::vector<uint8_t>			desc;
+		void							*state;
+	};
+
+	std::unordered_map<uint64_t, std::vector<Entry>>	entries; // Keyed by hash of type and description
+	ReleaseState						release;
+	StateCacheStats						stats = {};
+
+public:
+
+	// release is called once for every cached object when the cache is destroyed
+	StateObjectCache(const ReleaseState& _release) : release(_release) {};
+	~StateObjectCache();
+
+	StateObjectCache(const StateObjectCache&) = delete;
+	StateObjectCache& operator=(const StateObjectCache&) = delete;
+
+	// Shared object of type for the descBytes bytes of desc, created by create on the first request.  Returns null (and caches nothing) if create fails.
+	void *get(StateType type, const void *desc, size_t descBytes, const CreateState& create);
+
+	const StateCacheStats& getStats() const { return stats; };
+};
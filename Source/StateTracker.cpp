@@ -0,0 +1,211 @@
+
+#include "StateTracker.h"
+#include <cstring>
+
+using namespace std;
+
+
+uint64_t StateTrackerStats::getIssued() const {
+
+	uint64_t total = 0;
+
+	for (uint32_t type = 0; type < NumTrackedCallTypes; ++type)
+		total += issued[type];
+
+	return total;
+}
+
+
+uint64_t StateTrackerStats::getFiltered() const {
+
+	uint64_t total = 0;
+
+	for (uint32_t type = 0; type < NumTrackedCallTypes; ++type)
+		total += filtered[type];
+
+	return total;
+}
+
+
+TrackedValue makeTrackedValue(const void *object, uint64_t a, uint64_t b, uint64_t c) {
+
+	TrackedValue value = { { (uint64_t)(uintptr_t)object, a, b, c } };
+	return value;
+}
+
+
+static TrackedCallType callTypeOf(TrackedState state) {
+
+	switch (state) {
+
+	case TrackedInputLayout:
+	case TrackedPrimitiveTopology:
+	case TrackedIndexBuffer:
+		return InputAssemblerCalls;
+
+	case TrackedRasterizerState:
+	case TrackedDepthStencilState:
+	case TrackedBlendState:
+		return FixedFunctionCalls;
+
+	default:
+		return ShaderCalls;
+	}
+}
+
+static const TrackedCallType slotCallTypes[NumTrackedSlotTypes] = { ConstantBufferCalls, SamplerCalls, ShaderResourceCalls };
+
+
+StateTracker::StateTracker() {
+
+	for (uint32_t stage = 0; stage < NumTrackedStages; ++stage) {
+
+		for (uint32_t type = 0; type < NumTrackedSlotTypes; ++type) {
+
+			slots[stage][type].resize(trackedSlotCounts[type], nullptr);
+			slotsKnown[stage][type].resize(trackedSlotCounts[type], false);
+		}
+	}
+
+	memset(states, 0, sizeof(states));
+	memset(vertexBuffers, 0, sizeof(vertexBuffers));
+	invalidate();
+}
+
+
+void StateTracker::invalidate() {
+
+	for (bool& known : statesKnown)
+		known = false;
+
+	for (bool& known : vertexBuffersKnown)
+		known = false;
+
+	for (uint32_t stage = 0; stage < NumTrackedStages; ++stage)
+		for (uint32_t type = 0; type < NumTrackedSlotTypes; ++type)
+			slotsKnown[stage][type].assign(trackedSlotCounts[type], false);
+}
+
+
+void StateTracker::invalidateShaderResources() {
+
+	for (uint32_t stage = 0; stage < NumTrackedStages; ++stage)
+		slotsKnown[stage][TrackedShaderResources].assign(trackedSlotCounts[TrackedShaderResources], false);
+}
+
+
+void StateTracker::countCall(TrackedCallType type, bool issue, uint32_t numSlots, uint32_t numChanged) {
+
+	for (StateTrackerStats *s : { &stats, &frame }) {
+
+		if (issue)
+			s->issued[type]++;
+		else
+			s->filtered[type]++;
+
+		s->slotsIssued += numChanged;
+		s->slotsFiltered += numSlots - numChanged;
+	}
+}
+
+
+bool StateTracker::setState(TrackedState state, const TrackedValue& value) {
+
+	bool issue = !statesKnown[state] || memcmp(&states[state], &value, sizeof(value)) != 0;
+
+	states[state] = value;
+	statesKnown[state] = true;
+
+	countCall(callTypeOf(state), issue);
+	return issue;
+}
+
+
+bool StateTracker::setSlots(TrackedStage stage, TrackedSlots type, uint32_t start, uint32_t count, const void *const *objects, uint32_t& first, uint32_t& changed) {
+
+	first = start;
+	changed = count;
+
+	// Invalid ranges are left for Direct3D to reject and the shadow is unchanged
+	if (start > trackedSlotCounts[type] || count > trackedSlotCounts[type] - start) {
+
+		countCall(slotCallTypes[type], true, count, count);
+		return true;
+	}
+
+	vector<const void*>& shadow = slots[stage][type];
+	vector<bool>& known = slotsKnown[stage][type];
+
+	// Narrow the call to the range from the first to the last slot that differs - the unchanged slots in between are rebound with the same objects
+	uint32_t lo = count, hi = 0;
+
+	for (uint32_t i = 0; i < count; ++i) {
+
+		const void *object = objects ? objects[i] : nullptr;
+		uint32_t slot = start + i;
+
+		if (!known[slot] || shadow[slot] != object) {
+
+			if (lo == count)
+				lo = i;
+
+			hi = i;
+			shadow[slot] = object;
+			known[slot] = true;
+		}
+	}
+
+	bool issue = lo < count;
+
+	first = issue ? start + lo : start;
+	changed = issue ? hi - lo + 1 : 0;
+
+	countCall(slotCallTypes[type], issue, count, changed);
+	return issue;
+}
+
+
+bool StateTracker::setVertexBuffers(uint32_t start, uint32_t count, const void *const *buffers, const uint32_t *strides, const uint32_t *offsets, uint32_t& first, uint32_t& changed) {
+
+	first = start;
+	changed = count;
+
+	if (start > trackedVertexBufferSlots || count > trackedVertexBufferSlots - start) {
+
+		countCall(InputAssemblerCalls, true, count, count);
+		return true;
+	}
+
+	uint32_t lo = count, hi = 0;
+
+	for (uint32_t i = 0; i < count; ++i) {
+
+		VertexBufferSlot value = { buffers ? buffers[i] : nullptr, strides ? strides[i] : 0, offsets ? offsets[i] : 0 };
+		VertexBufferSlot& shadow = vertexBuffers[start + i];
+
+		if (!vertexBuffersKnown[start + i] || shadow.buffer != value.buffer || shadow.stride != value.stride || shadow.offset != value.offset) {
+
+			if (lo == count)
+				lo = i;
+
+			hi = i;
+			shadow = value;
+			vertexBuffersKnown[start + i] = true;
+		}
+	}
+
+	bool issue = lo < count;
+
+	first = issue ? start + lo : start;
+	changed = issue ? hi - lo + 1 : 0;
+
+	countCall(InputAssemblerCalls, issue, count, changed);
+	return issue;
+}
+
+
+void StateTracker::beginFrame() {
+
+	frameStats = frame;
+	frame = StateTrackerStats();
+}
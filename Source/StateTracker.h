@@ -0,0 +1,126 @@
+
+//
+// StateTracker.h
+//
+
+// Shadow copy of the state bound to a device context, used to drop redundant state calls.  Each set method compares the new state with the shadow, updates the shadow and returns whether the call must be issued - slot ranges (constant buffers, samplers, shader resources and vertex buffers) are narrowed to the slots that changed.  Unknown state (before the first call and after invalidate()) always differs so the first call after a reset is issued.  StateTrackingContext issues the calls to Direct3D and the tests to a recording mock context (see Tests/StateTrackerTests.cpp), so the filtering can be checked without a GPU.
+// Objects are compared by pointer - states and shaders shared through StateCache and ShaderLibrary compare equal whenever their descriptions do.
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+// Single valued pipeline state
+enum TrackedState : uint32_t {
+	TrackedInputLayout,
+	TrackedPrimitiveTopology,
+	TrackedIndexBuffer, // Buffer, format and offset
+	TrackedVertexShader,
+	TrackedHullShader,
+	TrackedDomainShader,
+	TrackedGeometryShader,
+	TrackedPixelShader,
+	TrackedComputeShader,
+	TrackedRasterizerState,
+	TrackedDepthStencilState, // State and stencil reference
+	TrackedBlendState, // State, blend factor and sample mask
+	NumTrackedStates
+};
+
+enum TrackedStage : uint32_t {
+	TrackedVertexStage,
+	TrackedHullStage,
+	TrackedDomainStage,
+	TrackedGeometryStage,
+	TrackedPixelStage,
+	NumTrackedStages
+};
+
+// Slot arrays of each stage (sized as in Direct3D 11)
+enum TrackedSlots : uint32_t {
+	TrackedConstantBuffers,
+	TrackedSamplers,
+	TrackedShaderResources,
+	NumTrackedSlotTypes
+};
+
+static const uint32_t trackedSlotCounts[NumTrackedSlotTypes] = { 14, 16, 128 };
+static const uint32_t trackedVertexBufferSlots = 32;
+
+// Calls are counted by the state they set
+enum TrackedCallType : uint32_t {
+	ShaderCalls,
+	FixedFunctionCalls, // Rasterizer, depth-stencil and blend states
+	InputAssemblerCalls,
+	ConstantBufferCalls,
+	SamplerCalls,
+	ShaderResourceCalls,
+	NumTrackedCallTypes
+};
+
+struct StateTrackerStats {
+	uint64_t							issued[NumTrackedCallTypes];
+	uint64_t							filtered[NumTrackedCallTypes];
+	uint64_t							slotsIssued; // Slots bound by the issued slot range calls
+	uint64_t							slotsFiltered; // Slots dropped from the issued and filtered slot range calls
+
+	uint64_t getIssued() const;
+	uint64_t getFiltered() const;
+};
+
+// Value of a single valued state - the object and up to three more fields
+struct TrackedValue {
+	uint64_t							words[4];
+};
+
+TrackedValue makeTrackedValue(const void *object, uint64_t a = 0, uint64_t b = 0, uint64_t c = 0);
+
+
+class StateTracker {
+
+	struct VertexBufferSlot {
+		const void						*buffer;
+		uint32_t						stride;
+		uint32_t						offset;
+	};
+
+	TrackedValue						states[NumTrackedStates];
+	bool								statesKnown[NumTrackedStates];
+	std::vector<const void*>			slots[NumTrackedStages][NumTrackedSlotTypes];
+	std::vector<bool>					slotsKnown[NumTrackedStages][NumTrackedSlotTypes];
+	VertexBufferSlot					vertexBuffers[trackedVertexBufferSlots];
+	bool								vertexBuffersKnown[trackedVertexBufferSlots];
+
+	StateTrackerStats					stats = {}; // Since the tracker was created
+	StateTrackerStats					frame = {}; // Since beginFrame
+	StateTrackerStats					frameStats = {}; // Of the last complete frame
+
+	void countCall(TrackedCallType type, bool issue, uint32_t numSlots = 0, uint32_t numChanged = 0);
+
+public:
+
+	StateTracker();
+
+	// Forget all state - the next call of every kind is issued.  Call whenever the context may have been changed without the tracker.
+	void invalidate();
+
+	// Forget the shader resources of every stage.  Call when render targets change - Direct3D unbinds resources that become outputs.
+	void invalidateShaderResources();
+
+	// Returns true if state must be set to value
+	bool setState(TrackedState state, const TrackedValue& value);
+
+	// Returns true if any of count slots from start must be set to objects.  first and changed are set to the range of slots that differ (objects[first - start] is the first object to bind).  Ranges beyond the slot count are issued in full.
+	bool setSlots(TrackedStage stage, TrackedSlots type, uint32_t start, uint32_t count, const void *const *objects, uint32_t& first, uint32_t& changed);
+
+	// As setSlots for vertex buffers with their strides and offsets
+	bool setVertexBuffers(uint32_t start, uint32_t count, const void *const *buffers, const uint32_t *strides, const uint32_t *offsets, uint32_t& first, uint32_t& changed);
+
+	// Start counting a new frame (getFrameStats returns the frame that ended)
+	void beginFrame();
+
+	const StateTrackerStats& getStats() const { return stats; };
+	const StateTrackerStats& getFrameStats() const { return frameStats; };
+};
@@ -0,0 +1,268 @@
+#include "stdafx.h"
+#include "StateTrackingContext.h"
+#include <iostream>
+#include <cstring>
+
+
+void StateTrackingContext::beginFrame() {
+
+	tracker.invalidate();
+	tracker.beginFrame();
+
+	frameDraws = draws;
+	frameMaps = maps;
+	draws = 0;
+	maps = 0;
+}
+
+
+// Issue the changed sub-range of a slot range call through set(first, count, objects)
+template <class Object, class Set>
+void StateTrackingContext::setSlots(TrackedStage stage, TrackedSlots type, UINT startSlot, UINT numObjects, Object *const *objects, const Set& set) {
+
+	uint32_t first, changed;
+
+	if (tracker.setSlots(stage, type, startSlot, numObjects, (const void *const *)objects, first, changed))
+		set(first, changed, objects ? objects + (first - startSlot) : nullptr);
+}
+
+
+//
+// Input assembler
+//
+
+void StateTrackingContext::IASetInputLayout(ID3D11InputLayout *inputLayout) {
+
+	if (tracker.setState(TrackedInputLayout, makeTrackedValue(inputLayout)))
+		context->IASetInputLayout(inputLayout);
+}
+
+
+void StateTrackingContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) {
+
+	if (tracker.setState(TrackedPrimitiveTopology, makeTrackedValue(nullptr, topology)))
+		context->IASetPrimitiveTopology(topology);
+}
+
+
+void StateTrackingContext::IASetIndexBuffer(ID3D11Buffer *indexBuffer, DXGI_FORMAT format, UINT offset) {
+
+	if (tracker.setState(TrackedIndexBuffer, makeTrackedValue(indexBuffer, format, offset)))
+		context->IASetIndexBuffer(indexBuffer, format, offset);
+}
+
+
+void StateTrackingContext::IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *vertexBuffers, const UINT *strides, const UINT *offsets) {
+
+	uint32_t first, changed;
+
+	if (tracker.setVertexBuffers(startSlot, numBuffers, (const void *const *)vertexBuffers, strides, offsets, first, changed)) {
+
+		UINT skip = first - startSlot;
+		context->IASetVertexBuffers(first, changed, vertexBuffers ? vertexBuffers + skip : nullptr, strides ? strides + skip : nullptr, offsets ? offsets + skip : nullptr);
+	}
+}
+
+
+//
+// Shaders
+//
+
+void StateTrackingContext::VSSetShader(ID3D11VertexShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (tracker.setState(TrackedVertexShader, makeTrackedValue(shader, (uintptr_t)classInstances, numClassInstances)))
+		context->VSSetShader(shader, classInstances, numClassInstances);
+}
+
+
+void StateTrackingContext::HSSetShader(ID3D11HullShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (tracker.setState(TrackedHullShader, makeTrackedValue(shader, (uintptr_t)classInstances, numClassInstances)))
+		context->HSSetShader(shader, classInstances, numClassInstances);
+}
+
+
+void StateTrackingContext::DSSetShader(ID3D11DomainShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (tracker.setState(TrackedDomainShader, makeTrackedValue(shader, (uintptr_t)classInstances, numClassInstances)))
+		context->DSSetShader(shader, classInstances, numClassInstances);
+}
+
+
+void StateTrackingContext::GSSetShader(ID3D11GeometryShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (tracker.setState(TrackedGeometryShader, makeTrackedValue(shader, (uintptr_t)classInstances, numClassInstances)))
+		context->GSSetShader(shader, classInstances, numClassInstances);
+}
+
+
+void StateTrackingContext::PSSetShader(ID3D11PixelShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (tracker.setState(TrackedPixelShader, makeTrackedValue(shader, (uintptr_t)classInstances, numClassInstances)))
+		context->PSSetShader(shader, classInstances, numClassInstances);
+}
+
+
+void StateTrackingContext::CSSetShader(ID3D11ComputeShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (tracker.setState(TrackedComputeShader, makeTrackedValue(shader, (uintptr_t)classInstances, numClassInstances)))
+		context->CSSetShader(shader, classInstances, numClassInstances);
+}
+
+
+//
+// Fixed function states
+//
+
+void StateTrackingContext::RSSetState(ID3D11RasterizerState *rasterizerState) {
+
+	if (tracker.setState(TrackedRasterizerState, makeTrackedValue(rasterizerState)))
+		context->RSSetState(rasterizerState);
+}
+
+
+void StateTrackingContext::OMSetDepthStencilState(ID3D11DepthStencilState *depthStencilState, UINT stencilRef) {
+
+	if (tracker.setState(TrackedDepthStencilState, makeTrackedValue(depthStencilState, stencilRef)))
+		context->OMSetDepthStencilState(depthStencilState, stencilRef);
+}
+
+
+void StateTrackingContext::OMSetBlendState(ID3D11BlendState *blendState, const FLOAT blendFactor[4], UINT sampleMask) {
+
+	// A null blend factor is a factor of one
+	static const FLOAT one[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	uint64_t factor[2];
+	memcpy(factor, blendFactor ? blendFactor : one, sizeof(factor));
+
+	if (tracker.setState(TrackedBlendState, makeTrackedValue(blendState, factor[0], factor[1], sampleMask)))
+		context->OMSetBlendState(blendState, blendFactor, sampleMask);
+}
+
+
+//
+// Constant buffers
+//
+
+void StateTrackingContext::VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	setSlots(TrackedVertexStage, TrackedConstantBuffers, startSlot, numBuffers, constantBuffers, [this](UINT first, UINT count, ID3D11Buffer *const *objects) { context->VSSetConstantBuffers(first, count, objects); });
+}
+
+
+void StateTrackingContext::HSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	setSlots(TrackedHullStage, TrackedConstantBuffers, startSlot, numBuffers, constantBuffers, [this](UINT first, UINT count, ID3D11Buffer *const *objects) { context->HSSetConstantBuffers(first, count, objects); });
+}
+
+
+void StateTrackingContext::DSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	setSlots(TrackedDomainStage, TrackedConstantBuffers, startSlot, numBuffers, constantBuffers, [this](UINT first, UINT count, ID3D11Buffer *const *objects) { context->DSSetConstantBuffers(first, count, objects); });
+}
+
+
+void StateTrackingContext::GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	setSlots(TrackedGeometryStage, TrackedConstantBuffers, startSlot, numBuffers, constantBuffers, [this](UINT first, UINT count, ID3D11Buffer *const *objects) { context->GSSetConstantBuffers(first, count, objects); });
+}
+
+
+void StateTrackingContext::PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	setSlots(TrackedPixelStage, TrackedConstantBuffers, startSlot, numBuffers, constantBuffers, [this](UINT first, UINT count, ID3D11Buffer *const *objects) { context->PSSetConstantBuffers(first, count, objects); });
+}
+
+
+//
+// Samplers
+//
+
+void StateTrackingContext::VSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers) {
+
+	setSlots(TrackedVertexStage, TrackedSamplers, startSlot, numSamplers, samplers, [this](UINT first, UINT count, ID3D11SamplerState *const *objects) { context->VSSetSamplers(first, count, objects); });
+}
+
+
+void StateTrackingContext::HSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers) {
+
+	setSlots(TrackedHullStage, TrackedSamplers, startSlot, numSamplers, samplers, [this](UINT first, UINT count, ID3D11SamplerState *const *objects) { context->HSSetSamplers(first, count, objects); });
+}
+
+
+void StateTrackingContext::DSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers) {
+
+	setSlots(TrackedDomainStage, TrackedSamplers, startSlot, numSamplers, samplers, [this](UINT first, UINT count, ID3D11SamplerState *const *objects) { context->DSSetSamplers(first, count, objects); });
+}
+
+
+void StateTrackingContext::GSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers) {
+
+	setSlots(TrackedGeometryStage, TrackedSamplers, startSlot, numSamplers, samplers, [this](UINT first, UINT count, ID3D11SamplerState *const *objects) { context->GSSetSamplers(first, count, objects); });
+}
+
+
+void StateTrackingContext::PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers) {
+
+	setSlots(TrackedPixelStage, TrackedSamplers, startSlot, numSamplers, samplers, [this](UINT first, UINT count, ID3D11SamplerState *const *objects) { context->PSSetSamplers(first, count, objects); });
+}
+
+
+//
+// Shader resources
+//
+
+void StateTrackingContext::VSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views) {
+
+	setSlots(TrackedVertexStage, TrackedShaderResources, startSlot, numViews, views, [this](UINT first, UINT count, ID3D11ShaderResourceView *const *objects) { context->VSSetShaderResources(first, count, objects); });
+}
+
+
+void StateTrackingContext::HSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views) {
+
+	setSlots(TrackedHullStage, TrackedShaderResources, startSlot, numViews, views, [this](UINT first, UINT count, ID3D11ShaderResourceView *const *objects) { context->HSSetShaderResources(first, count, objects); });
+}
+
+
+void StateTrackingContext::DSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views) {
+
+	setSlots(TrackedDomainStage, TrackedShaderResources, startSlot, numViews, views, [this](UINT first, UINT count, ID3D11ShaderResourceView *const *objects) { context->DSSetShaderResources(first, count, objects); });
+}
+
+
+void StateTrackingContext::GSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views) {
+
+	setSlots(TrackedGeometryStage, TrackedShaderResources, startSlot, numViews, views, [this](UINT first, UINT count, ID3D11ShaderResourceView *const *objects) { context->GSSetShaderResources(first, count, objects); });
+}
+
+
+void StateTrackingContext::PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views) {
+
+	setSlots(TrackedPixelStage, TrackedShaderResources, startSlot, numViews, views, [this](UINT first, UINT count, ID3D11ShaderResourceView *const *objects) { context->PSSetShaderResources(first, count, objects); });
+}
+
+
+//
+// Output merger
+//
+
+void StateTrackingContext::OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) {
+
+	context->OMSetRenderTargets(numViews, renderTargetViews, depthStencilView);
+	tracker.invalidateShaderResources();
+}
+
+
+void StateTrackingContext::reportStats() {
+
+	const StateTrackerStats& s = tracker.getFrameStats();
+	const char *names[] = { "shaders", "fixed function", "input assembler", "constant buffers", "samplers", "resources" };
+
+	cout << "StateTrackingContext: " << s.getIssued() << " state calls issued, " << s.getFiltered() << " filtered last frame (";
+
+	for (uint32_t type = 0; type < NumTrackedCallTypes; ++type)
+		cout << (type ? ", " : "") << names[type] << " " << s.issued[type] << "/" << s.issued[type] + s.filtered[type];
+
+	cout << ")" << endl;
+	cout << "StateTrackingContext: " << frameDraws << " draws, " << frameMaps << " Maps last frame" << endl;
+}
@@ -0,0 +1,96 @@
+
+//
+// StateTrackingContext.h
+//
+
+// Device context wrapper used by the render path.  State calls are checked against a shadow of the bound state (see StateTracker) and only reach Direct3D when they change it, so consecutive draws with the same effect, buffers, samplers and textures bind them once.  Slot range calls are narrowed to the slots that changed.  Other calls are passed straight through (draws and Maps are counted).
+// Methods have the names and parameters of the ID3D11DeviceContext methods they wrap.  Code that changes state through getContext() must call invalidate() afterwards.
+
+#pragma once
+#include <d3d11_2.h>
+#include <StateTracker.h>
+
+
+class StateTrackingContext {
+
+	ID3D11DeviceContext					*context = nullptr;
+	StateTracker						tracker;
+
+	// Draw and Map calls of the frame being built and of the last complete frame
+	uint32_t							draws = 0, maps = 0;
+	uint32_t							frameDraws = 0, frameMaps = 0;
+
+	template <class Object, class Set>
+	void setSlots(TrackedStage stage, TrackedSlots type, UINT startSlot, UINT numObjects, Object *const *objects, const Set& set);
+
+public:
+
+	// The context must outlive the wrapper
+	StateTrackingContext(ID3D11DeviceContext *_context) : context(_context) {};
+
+	ID3D11DeviceContext *getContext() { return context; };
+
+	// Forget the shadowed state so the next call of every kind is issued
+	void invalidate() { tracker.invalidate(); };
+
+	// Start a new frame - the state is forgotten (the system and window code bind state directly) and the frame counters are rolled
+	void beginFrame();
+
+	// Tracked state - class instances are compared by pointer
+	void IASetInputLayout(ID3D11InputLayout *inputLayout);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	void IASetIndexBuffer(ID3D11Buffer *indexBuffer, DXGI_FORMAT format, UINT offset);
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *vertexBuffers, const UINT *strides, const UINT *offsets);
+
+	void VSSetShader(ID3D11VertexShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void HSSetShader(ID3D11HullShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void DSSetShader(ID3D11DomainShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void GSSetShader(ID3D11GeometryShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void PSSetShader(ID3D11PixelShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void CSSetShader(ID3D11ComputeShader *shader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+
+	void RSSetState(ID3D11RasterizerState *rasterizerState);
+	void OMSetDepthStencilState(ID3D11DepthStencilState *depthStencilState, UINT stencilRef);
+	void OMSetBlendState(ID3D11BlendState *blendState, const FLOAT blendFactor[4], UINT sampleMask);
+
+	void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void HSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void DSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+
+	void VSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers);
+	void HSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers);
+	void DSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers);
+	void GSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers);
+	void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers);
+
+	void VSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views);
+	void HSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views);
+	void DSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views);
+	void GSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views);
+	void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *views);
+
+	// Untracked - changing the render targets forgets the shader resources as Direct3D unbinds resources bound as outputs
+	void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView);
+	void OMGetRenderTargets(UINT numViews, ID3D11RenderTargetView **renderTargetViews, ID3D11DepthStencilView **depthStencilView) { context->OMGetRenderTargets(numViews, renderTargetViews, depthStencilView); };
+	void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *viewports) { context->RSSetViewports(numViewports, viewports); };
+	void RSGetViewports(UINT *numViewports, D3D11_VIEWPORT *viewports) { context->RSGetViewports(numViewports, viewports); };
+	void ClearRenderTargetView(ID3D11RenderTargetView *renderTargetView, const FLOAT colour[4]) { context->ClearRenderTargetView(renderTargetView, colour); };
+	void ClearDepthStencilView(ID3D11DepthStencilView *depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil) { context->ClearDepthStencilView(depthStencilView, clearFlags, depth, stencil); };
+	HRESULT Map(ID3D11Resource *resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE *mappedResource) { maps++; return context->Map(resource, subresource, mapType, mapFlags, mappedResource); };
+	void Unmap(ID3D11Resource *resource, UINT subresource) { context->Unmap(resource, subresource); };
+	void Draw(UINT vertexCount, UINT startVertex) { draws++; context->Draw(vertexCount, startVertex); };
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex) { draws++; context->DrawIndexed(indexCount, startIndex, baseVertex); };
+	void DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertex, UINT startInstance) { draws++; context->DrawInstanced(vertexCountPerInstance, instanceCount, startVertex, startInstance); };
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) { draws++; context->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndex, baseVertex, startInstance); };
+
+	// Calls issued and filtered in the last complete frame and since the wrapper was created
+	const StateTrackerStats& getFrameStats() const { return tracker.getFrameStats(); };
+	const StateTrackerStats& getStats() const { return tracker.getStats(); };
+	uint32_t getFrameDraws() const { return frameDraws; };
+	uint32_t getFrameMaps() const { return frameMaps; };
+
+	// Print the calls issued against filtered and the draws and Maps in the last frame
+	void reportStats();
+};
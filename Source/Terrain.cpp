@@ -44,8 +44,9 @@ HRESULT Terrain::init(ID3D11Device *device, ID3D11DeviceContext* context, int _w
 	device->CreateTexture2D(&StagedDesc, NULL, &grassHeightStage);
 	device->CreateTexture2D(&StagedDesc, NULL, &grassNormalStage);
 
-	context->CopyResource(grassHeightStage, static_cast<ID3D11Resource*>(tex_height));
-	context->CopyResource(grassNormalStage, static_cast<ID3D11Resource*>(tex_normal));
+	// Only the top level is read - the textures have mip chains so CopyResource cannot be used
+	context->CopySubresourceRegion(grassHeightStage, 0, 0, 0, 0, static_cast<ID3D11Resource*>(tex_height), 0, nullptr);
+	context->CopySubresourceRegion(grassNormalStage, 0, 0, 0, 0, static_cast<ID3D11Resource*>(tex_normal), 0, nullptr);
 
 	// Lock the memory
 	D3D11_MAPPED_SUBRESOURCE MappingDescHeight;
@@ -113,6 +114,8 @@ HRESULT Terrain::init(ID3D11Device *device, ID3D11DeviceContext* context, int _w
 
 		HRESULT hr = device->CreateBuffer(&vertexDesc, &vertexData, &vertexBuffer);
 
+		setLocalBounds(computeBounds(&vertices[0].pos.x, width * height, sizeof(ExtendedVertexStruct)));
+
 		// Unlock the memory
 		context->Unmap(grassHeightStage, 0);
 		context->Unmap(grassNormalStage, 0);
@@ -230,7 +233,7 @@ Terrain::~Terrain()
 }
 
 
-void Terrain::render(ID3D11DeviceContext *context) {
+void Terrain::render(StateTrackingContext *context) {
 
 	context->PSSetConstantBuffers(0, 1, &cBufferModelGPU);
 	context->VSSetConstantBuffers(0, 1, &cBufferModelGPU);
@@ -262,6 +265,9 @@ void Terrain::render(ID3D11DeviceContext *context) {
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	// Draw Mesh
-	context->DrawIndexed(numInd, 0, 0);
+	if (numInstances > 1)
+		context->DrawIndexedInstanced(numInd, numInstances, 0, 0, 0);
+	else
+		context->DrawIndexed(numInd, 0, 0);
 }
 
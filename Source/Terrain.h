@@ -11,6 +11,7 @@ class Terrain : public BaseModel
 
 	int width, height;
 	UINT numInd = 0;
+	UINT numInstances = 1;
 	ExtendedVertexStruct *vertices;
 	UINT*indices;
 
@@ -18,7 +19,10 @@ public:
 	Terrain(ID3D11Device *device, ID3D11DeviceContext*context, int width, int height, ID3D11Texture2D*tex_height, ID3D11Texture2D*tex_normal,  Effect *_effect, Material *_materials[] = nullptr, int _numMaterials = 0, ID3D11ShaderResourceView **textures = nullptr, int numTextures = 0) : BaseModel(device, _effect, _materials, _numMaterials, textures, numTextures){ init(device, context,width,height, tex_height, tex_normal); };
 	float CalculateYValue(float x, float z);
 	float CalculateYValueWorld(float x, float z);
-	void render(ID3D11DeviceContext *context);
+	// Draw the terrain count times in one instanced draw (the grass shells - see grass_vs.hlsl)
+	void setNumInstances(UINT count){ numInstances = count; };
+	UINT getNumInstances(){ return numInstances; };
+	void render(StateTrackingContext *context);
 	HRESULT init(ID3D11Device *device){ return S_OK; };
 	HRESULT init(ID3D11Device *device, ID3D11DeviceContext* context,int _width,int _height, ID3D11Texture2D*tex_height, ID3D11Texture2D*tex_normal);
 	~Terrain();
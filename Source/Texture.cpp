@@ -2,8 +2,13 @@
 #include "Texture.h"
 #include <iostream>
 #include <exception>
-#include <DirectXTK\DDSTextureLoader.h>
 #include <DirectXTK\WICTextureLoader.h>
+#include <MipGenerator.h>
+#include <DDSFile.h>
+#include <MappedFile.h>
+#include <wincodec.h>
+#include <thread>
+#include <stdexcept>
 
 //using namespace std;
 //using namespace DirectX;
@@ -18,10 +23,45 @@ Texture::Texture(ID3D11Device *device, const std::wstring& filename)
 
 	try
 	{
-		if (0 == ext.compare(L".bmp") || 0 == ext.compare(L".jpg") || 0 == ext.compare(L".png") || 0 == ext.compare(L".tif"))
-			hr = DirectX::CreateWICTextureFromFile(device, filename.c_str(), &resource, &SRV);
-		else if (0 == ext.compare(L".dds"))
-			hr = DirectX::CreateDDSTextureFromFile(device, filename.c_str(), &resource, &SRV);
+		if (0 == ext.compare(L".bmp") || 0 == ext.compare(L".jpg") || 0 == ext.compare(L".png") || 0 == ext.compare(L".tif")) {
+
+			// Decoded here rather than by CreateWICTextureFromFile so the mip chain is generated on the CPU with the filter suited to the texture
+			ImageData image;
+			IWICImagingFactory *factory = nullptr;
+
+			hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+
+			if (SUCCEEDED(hr))
+				hr = decodeWICImage(factory, filename, image);
+
+			if (factory)
+				factory->Release();
+
+			if (!SUCCEEDED(hr))
+				throw exception("Cannot decode texture file");
+
+			MipOptions options = getDefaultMipOptions(string(filename.begin(), filename.end()));
+			options.numThreads = max(1u, thread::hardware_concurrency());
+
+			ID3D11Texture2D *texture2D = nullptr;
+			hr = createTexture(device, generateMipChain(image, options), &texture2D, &SRV);
+			resource = texture2D;
+		}
+		else if (0 == ext.compare(L".dds")) {
+
+			// Mapped rather than read into a buffer - the file is unmapped when it goes out of scope once the texture has been created
+			MappedFile file(string(filename.begin(), filename.end()));
+
+			if (!file.isValid())
+				throw exception("Cannot open dds file");
+
+			ID3D11Texture2D *texture2D = nullptr;
+			hr = createDDSTexture(device, file.getData(), file.getSize(), &texture2D, &SRV);
+			resource = texture2D;
+
+			if (!SUCCEEDED(hr))
+				throw exception("Cannot create texture from dds file");
+		}
 		else throw exception("Texture file format not supported");
 	}
 	catch (exception& e)
@@ -34,6 +74,322 @@ Texture::Texture(ID3D11Device *device, const std::wstring& filename)
 }
 
 
+Texture::Texture(ID3D11Device *device, const vector<wstring>& filenames, const AtlasOptions& options, vector<AtlasEntry>& entries)
+{
+	try
+	{
+		vector<string> names;
+
+		for (const wstring& filename : filenames)
+			names.push_back(string(filename.begin(), filename.end()));
+
+		// The files are decoded in parallel - the atlas generates the mips of each file itself
+		unsigned int numThreads = max(1u, thread::hardware_concurrency());
+		vector<DecodedTexture> decoded = decodeTextures(names, decodeWICFile, numThreads, false);
+		vector<ImageData> images;
+
+		for (DecodedTexture& file : decoded) {
+
+			if (!file.succeeded || file.mips.empty())
+				throw exception(("Cannot decode atlas texture file " + file.filename).c_str());
+
+			images.push_back(move(file.mips[0]));
+		}
+
+		AtlasOptions atlasOptions = options;
+		atlasOptions.numThreads = numThreads;
+
+		TextureAtlas atlas = buildTextureAtlas(images, names, atlasOptions);
+		entries = atlas.entries;
+
+		HRESULT hr;
+
+		if (atlas.slices.size() == 1)
+			hr = createTexture(device, atlas.slices[0], &texture, &SRV);
+		else
+			hr = createTextureArray(device, atlas.slices, &texture, &SRV);
+
+		if (!SUCCEEDED(hr))
+			throw exception("Cannot create atlas texture");
+	}
+	catch (exception& e)
+	{
+		cout << "Texture atlas was not loaded:\n";
+		cout << e.what() << endl;
+	}
+}
+
+
+HRESULT Texture::decodeWICImage(IWICImagingFactory *factory, const wstring& filename, ImageData& image) {
+
+	if (!factory)
+		return E_NOINTERFACE;
+
+	IWICBitmapDecoder *decoder = nullptr;
+	IWICBitmapFrameDecode *frame = nullptr;
+	IWICFormatConverter *converter = nullptr;
+	UINT width = 0, height = 0;
+
+	HRESULT hr = factory->CreateDecoderFromFilename(filename.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder);
+
+	if (SUCCEEDED(hr))
+		hr = decoder->GetFrame(0, &frame);
+
+	if (SUCCEEDED(hr))
+		hr = frame->GetSize(&width, &height);
+
+	if (SUCCEEDED(hr))
+		hr = factory->CreateFormatConverter(&converter);
+
+	if (SUCCEEDED(hr))
+		hr = converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+
+	if (SUCCEEDED(hr)) {
+
+		image.width = width;
+		image.height = height;
+		image.pixels.resize((size_t)width * height * 4);
+		hr = converter->CopyPixels(nullptr, width * 4, (UINT)image.pixels.size(), image.pixels.data());
+	}
+
+	if (converter)
+		converter->Release();
+	if (frame)
+		frame->Release();
+	if (decoder)
+		decoder->Release();
+
+	return hr;
+}
+
+
+void Texture::decodeWICFile(const string& filename, ImageData& image) {
+
+	// Decode threads join the multithreaded apartment.  The main thread is already initialised (RPC_E_CHANGED_MODE) and keeps its apartment.
+	HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	IWICImagingFactory *factory = nullptr;
+	HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+
+	if (SUCCEEDED(hr))
+		hr = decodeWICImage(factory, wstring(filename.begin(), filename.end()), image);
+
+	if (factory)
+		factory->Release();
+
+	if (SUCCEEDED(comResult))
+		CoUninitialize();
+
+	if (!SUCCEEDED(hr))
+		throw runtime_error("Cannot decode texture file " + filename);
+}
+
+
+vector<Texture*> Texture::loadTextures(ID3D11Device *device, const vector<wstring>& filenames) {
+
+	vector<string> names;
+
+	for (const wstring& filename : filenames)
+		names.push_back(string(filename.begin(), filename.end()));
+
+	// Decode phase - no Direct3D calls
+	vector<DecodedTexture> decoded = decodeTextures(names, decodeWICFile, max(1u, thread::hardware_concurrency()));
+
+	// Upload phase on this thread
+	vector<Texture*> textures;
+
+	for (DecodedTexture& file : decoded) {
+
+		ID3D11Texture2D *texture = nullptr;
+		ID3D11ShaderResourceView *SRV = nullptr;
+		HRESULT hr = E_FAIL;
+
+		if (file.succeeded && file.ddsFile) {
+
+			hr = createDDSTexture(device, file.ddsFile->getData(), file.ddsFile->getSize(), &texture, &SRV);
+			file.ddsFile.reset();
+		}
+		else if (file.succeeded)
+			hr = createTexture(device, file.mips, &texture, &SRV);
+
+		if (!SUCCEEDED(hr)) {
+
+			cout << "Texture was not loaded:\n";
+			cout << (file.succeeded ? "Cannot create texture " + file.filename : file.error) << endl;
+
+			if (texture)
+				texture->Release();
+			if (SRV)
+				SRV->Release();
+
+			texture = nullptr;
+			SRV = nullptr;
+		}
+
+		textures.push_back(new Texture(texture, SRV));
+	}
+
+	return textures;
+}
+
+
+HRESULT Texture::createTexture(ID3D11Device *device, const vector<ImageData>& mips, ID3D11Texture2D **texture, ID3D11ShaderResourceView **SRV) {
+
+	if (mips.empty())
+		return E_INVALIDARG;
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D11_TEXTURE2D_DESC));
+	texDesc.Width = mips[0].width;
+	texDesc.Height = mips[0].height;
+	texDesc.MipLevels = (UINT)mips.size();
+	texDesc.ArraySize = 1;
+	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	vector<D3D11_SUBRESOURCE_DATA> texData(mips.size());
+
+	for (size_t i = 0; i < mips.size(); ++i) {
+
+		texData[i].pSysMem = mips[i].pixels.data();
+		texData[i].SysMemPitch = mips[i].width * 4;
+		texData[i].SysMemSlicePitch = 0;
+	}
+
+	HRESULT hr = device->CreateTexture2D(&texDesc, texData.data(), texture);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(*texture, nullptr, SRV);
+
+	return hr;
+}
+
+
+HRESULT Texture::createDDSTexture(ID3D11Device *device, const uint8_t *data, size_t size, ID3D11Texture2D **texture, ID3D11ShaderResourceView **SRV, uint32_t firstLevel) {
+
+	DDSInfo info;
+	vector<DDSSubresource> subresources;
+
+	try
+	{
+		info = readDDSInfo(data, size);
+		subresources = getDDSSubresources(info, size);
+	}
+	catch (runtime_error&)
+	{
+		return E_INVALIDARG;
+	}
+
+	if (info.depth > 1 || firstLevel >= info.mipLevels)
+		return E_INVALIDARG;
+
+	uint32_t mipLevels = info.mipLevels - firstLevel;
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D11_TEXTURE2D_DESC));
+	texDesc.Width = max(1u, info.width >> firstLevel);
+	texDesc.Height = max(1u, info.height >> firstLevel);
+	texDesc.MipLevels = mipLevels;
+	texDesc.ArraySize = info.arraySize;
+	texDesc.Format = (DXGI_FORMAT)info.format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texDesc.MiscFlags = info.isCubeMap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	// Every kept mip level of every slice / face points into the file
+	vector<D3D11_SUBRESOURCE_DATA> texData;
+
+	for (uint32_t slice = 0; slice < info.arraySize; ++slice) {
+
+		for (uint32_t level = firstLevel; level < info.mipLevels; ++level) {
+
+			const DDSSubresource& subresource = subresources[slice * info.mipLevels + level];
+			D3D11_SUBRESOURCE_DATA levelData = { data + subresource.offset, subresource.rowPitch, subresource.slicePitch };
+			texData.push_back(levelData);
+		}
+	}
+
+	HRESULT hr = device->CreateTexture2D(&texDesc, texData.data(), texture);
+
+	if (!SUCCEEDED(hr))
+		return hr;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	ZeroMemory(&srvDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+	srvDesc.Format = texDesc.Format;
+
+	if (info.isCubeMap && info.arraySize > 6) {
+
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+		srvDesc.TextureCubeArray.MipLevels = mipLevels;
+		srvDesc.TextureCubeArray.NumCubes = info.arraySize / 6;
+	}
+	else if (info.isCubeMap) {
+
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = mipLevels;
+	}
+	else if (info.arraySize > 1) {
+
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = mipLevels;
+		srvDesc.Texture2DArray.ArraySize = info.arraySize;
+	}
+	else {
+
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = mipLevels;
+	}
+
+	return device->CreateShaderResourceView(*texture, &srvDesc, SRV);
+}
+
+
+HRESULT Texture::createTextureArray(ID3D11Device *device, const vector<vector<ImageData>>& slices, ID3D11Texture2D **texture, ID3D11ShaderResourceView **SRV) {
+
+	if (slices.empty() || slices[0].empty())
+		return E_INVALIDARG;
+
+	const vector<ImageData>& mips = slices[0];
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	ZeroMemory(&texDesc, sizeof(D3D11_TEXTURE2D_DESC));
+	texDesc.Width = mips[0].width;
+	texDesc.Height = mips[0].height;
+	texDesc.MipLevels = (UINT)mips.size();
+	texDesc.ArraySize = (UINT)slices.size();
+	texDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	// Subresources are ordered by slice then level
+	vector<D3D11_SUBRESOURCE_DATA> texData;
+
+	for (const vector<ImageData>& slice : slices) {
+
+		if (slice.size() != mips.size())
+			return E_INVALIDARG;
+
+		for (const ImageData& mip : slice) {
+
+			D3D11_SUBRESOURCE_DATA data = { mip.pixels.data(), mip.width * 4, 0 };
+			texData.push_back(data);
+		}
+	}
+
+	HRESULT hr = device->CreateTexture2D(&texDesc, texData.data(), texture);
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(*texture, nullptr, SRV);
+
+	return hr;
+}
+
+
 Texture::~Texture()
 {
 	
@@ -3,6 +3,11 @@
 #include <vector>
 #include <cstdint>
 #include <d3d11_2.h>
+#include <ImageData.h>
+#include <TextureAtlas.h>
+#include <TextureDecoder.h>
+
+struct IWICImagingFactory;
 
 
 
@@ -15,9 +20,34 @@ class Texture
 	ID3D11RenderTargetView					*RTV = nullptr;
 public:
 
+	// bmp, jpg, png and tif files are decoded on the CPU and given a full mip chain (see MipGenerator.h).  dds files are memory mapped and loaded with the mips they contain (see createDDSTexture).
 	Texture(ID3D11Device *device, const std::wstring& filename);
+
+	// Decode several image files and pack them into one atlas texture (see TextureAtlas.h) so the objects using them bind the same resource view.  entries receives where each file was placed, in the order of filenames.  An atlas with one slice is viewed as a Texture2D, otherwise as a Texture2DArray.
+	Texture(ID3D11Device *device, const std::vector<std::wstring>& filenames, const AtlasOptions& options, std::vector<AtlasEntry>& entries);
+
+	// Adopt a texture and resource view created elsewhere (for example by an AssetStreamer).  The Texture takes ownership of the caller's references.
+	Texture(ID3D11Texture2D *_texture, ID3D11ShaderResourceView *_SRV) : texture(_texture), SRV(_SRV) {};
 	ID3D11ShaderResourceView *getShaderResourceView(){ return SRV; };
 	ID3D11Texture2D* getTexture() { return texture; };
 	~Texture();
+
+	// Decode an image file to RGBA8 with WIC
+	static HRESULT decodeWICImage(IWICImagingFactory *factory, const std::wstring& filename, ImageData& image);
+
+	// ImageDecoder (see TextureDecoder.h) using WIC - safe to call from any thread.  Throws std::runtime_error if the file cannot be decoded.
+	static void decodeWICFile(const std::string& filename, ImageData& image);
+
+	// Load several texture files at once.  The files are decoded and given mip chains on a pool of threads (see decodeTextures) and only the GPU textures are created on the calling thread.  Returns a Texture for each file in the order of filenames - files that cannot be loaded give a Texture without a resource view.
+	static std::vector<Texture*> loadTextures(ID3D11Device *device, const std::vector<std::wstring>& filenames);
+
+	// Create an R8G8B8A8_UNORM texture and resource view from a mip chain (largest level first)
+	static HRESULT createTexture(ID3D11Device *device, const std::vector<ImageData>& mips, ID3D11Texture2D **texture, ID3D11ShaderResourceView **SRV);
+
+	// Create a texture (2D, array, cube map or cube map array) and resource view from a dds file held in memory - usually a MappedFile, which can be unmapped as soon as this returns.  The subresource data points straight into data so the pixels are not copied to the heap first.  Levels more detailed than firstLevel are left out (see TextureStreamer).  Returns E_INVALIDARG if the file is invalid or truncated, or has a format (see DDSInfo::format) or dimension (volume) a Texture cannot hold.
+	static HRESULT createDDSTexture(ID3D11Device *device, const uint8_t *data, size_t size, ID3D11Texture2D **texture, ID3D11ShaderResourceView **SRV, uint32_t firstLevel = 0);
+
+	// Create an R8G8B8A8_UNORM texture array from the mip chains of its slices (each with the same size and number of levels)
+	static HRESULT createTextureArray(ID3D11Device *device, const std::vector<std::vector<ImageData>>& slices, ID3D11Texture2D **texture, ID3D11ShaderResourceView **SRV);
 };
 
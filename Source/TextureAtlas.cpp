@@ -0,0 +1,426 @@
+
+#include "TextureAtlas.h"
+#include "MipGenerator.h"
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+using namespace std;
+
+
+// Horizontal run of the top edge of the packed area in a slice.  The runs of a slice cover its full width in order of x.
+struct SkylineSegment {
+	uint32_t							x;
+	uint32_t							y;
+	uint32_t							width;
+};
+
+// A source padded with its border and rounded up to the alignment, and where it was packed
+struct AtlasRegion {
+	uint32_t							width;
+	uint32_t							height;
+	uint32_t							slice;
+	uint32_t							x;
+	uint32_t							y;
+};
+
+
+const char *getLayoutName(AtlasLayout layout) {
+
+	return layout == AtlasLayout::Array ? "array" : "rectangles";
+}
+
+
+const AtlasEntry *TextureAtlas::find(const string& name) const {
+
+	for (const AtlasEntry& entry : entries)
+		if (entry.name == name)
+			return &entry;
+
+	return nullptr;
+}
+
+
+static uint32_t roundUp(uint32_t value, uint32_t alignment) {
+
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+
+// Lowest (then leftmost) position where a width x height rectangle fits on the skyline.  Returns false if it does not fit below sliceHeight.
+static bool findSkylinePosition(const vector<SkylineSegment>& skyline, uint32_t sliceWidth, uint32_t sliceHeight, uint32_t width, uint32_t height, size_t& bestIndex, uint32_t& bestX, uint32_t& bestY) {
+
+	bool found = false;
+
+	for (size_t i = 0; i < skyline.size(); ++i) {
+
+		uint32_t x = skyline[i].x;
+
+		if (x + width > sliceWidth)
+			break;
+
+		// The rectangle rests on the highest segment it spans
+		uint32_t y = 0;
+		uint32_t spanned = 0;
+
+		for (size_t j = i; spanned < width; ++j) {
+
+			y = max(y, skyline[j].y);
+			spanned += skyline[j].width;
+		}
+
+		if (y + height > sliceHeight)
+			continue;
+
+		if (!found || y < bestY) {
+
+			found = true;
+			bestIndex = i;
+			bestX = x;
+			bestY = y;
+		}
+	}
+
+	return found;
+}
+
+
+static void addSkylineRectangle(vector<SkylineSegment>& skyline, size_t index, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+
+	skyline.insert(skyline.begin() + index, { x, y + height, width });
+
+	// Trim the segments now under the rectangle
+	for (size_t i = index + 1; i < skyline.size() && skyline[i].x < x + width;) {
+
+		uint32_t covered = x + width - skyline[i].x;
+
+		if (covered >= skyline[i].width) {
+
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+
+		skyline[i].x += covered;
+		skyline[i].width -= covered;
+		break;
+	}
+
+	// Merge neighbours at the same height
+	for (size_t i = 0; i + 1 < skyline.size();) {
+
+		if (skyline[i].y == skyline[i + 1].y) {
+
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+			++i;
+	}
+}
+
+
+// Pack regions (in the order of order) into sliceWidth x sliceHeight slices - each region goes into the first slice with room.  Returns the number of slices and sets usedWidth and usedHeight to the extent of the packed regions.
+static uint32_t packRegions(vector<AtlasRegion>& regions, const vector<size_t>& order, uint32_t sliceWidth, uint32_t sliceHeight, uint32_t& usedWidth, uint32_t& usedHeight) {
+
+	vector<vector<SkylineSegment>> skylines;
+	usedWidth = 0;
+	usedHeight = 0;
+
+	for (size_t index : order) {
+
+		AtlasRegion& region = regions[index];
+		size_t segment = 0;
+		uint32_t slice = 0;
+
+		for (; slice < skylines.size(); ++slice)
+			if (findSkylinePosition(skylines[slice], sliceWidth, sliceHeight, region.width, region.height, segment, region.x, region.y))
+				break;
+
+		if (slice == skylines.size()) {
+
+			skylines.push_back(vector<SkylineSegment>(1, { 0, 0, sliceWidth }));
+			findSkylinePosition(skylines[slice], sliceWidth, sliceHeight, region.width, region.height, segment, region.x, region.y);
+		}
+
+		region.slice = slice;
+		addSkylineRectangle(skylines[slice], segment, region.x, region.y, region.width, region.height);
+
+		usedWidth = max(usedWidth, region.x + region.width);
+		usedHeight = max(usedHeight, region.y + region.height);
+	}
+
+	return (uint32_t)skylines.size();
+}
+
+
+// Copy image into a width x height target offset by border texels and repeat its edge texels out to the edges of the target
+static void copyWithBorder(const ImageData& image, uint32_t border, uint32_t width, uint32_t height, ImageData& target) {
+
+	target.width = width;
+	target.height = height;
+	target.pixels.resize((size_t)width * height * 4);
+
+	for (uint32_t y = 0; y < height; ++y) {
+
+		uint32_t sourceY = (uint32_t)min<int64_t>(max<int64_t>((int64_t)y - border, 0), image.height - 1);
+		const uint8_t *sourceRow = &image.pixels[(size_t)sourceY * image.width * 4];
+		uint8_t *targetRow = &target.pixels[(size_t)y * width * 4];
+
+		for (uint32_t x = 0; x < width; ++x) {
+
+			uint32_t sourceX = (uint32_t)min<int64_t>(max<int64_t>((int64_t)x - border, 0), image.width - 1);
+			memcpy(targetRow + (size_t)x * 4, sourceRow + (size_t)sourceX * 4, 4);
+		}
+	}
+}
+
+
+static void blit(const ImageData& source, ImageData& target, uint32_t x, uint32_t y) {
+
+	for (uint32_t row = 0; row < source.height; ++row)
+		memcpy(&target.pixels[((size_t)(y + row) * target.width + x) * 4], &source.pixels[(size_t)row * source.width * 4], (size_t)source.width * 4);
+}
+
+
+static TextureAtlas buildRectangleAtlas(const vector<ImageData>& images, const vector<string>& names, const AtlasOptions& options) {
+
+	// A border of 2^(levels - 1) texels leaves one border texel around each source in the smallest kept level and aligning regions to the same size means each level halves them exactly
+	uint32_t levels = max(1u, options.mipLevels);
+	uint32_t border = 1u << (levels - 1);
+	uint32_t alignment = border * (options.blockAligned ? 4 : 1);
+	uint32_t maxSize = options.maxSize / alignment * alignment;
+
+	vector<AtlasRegion> regions(images.size());
+
+	for (size_t i = 0; i < images.size(); ++i) {
+
+		regions[i].width = roundUp(images[i].width + 2 * border, alignment);
+		regions[i].height = roundUp(images[i].height + 2 * border, alignment);
+
+		if (regions[i].width > maxSize || regions[i].height > maxSize)
+			throw runtime_error("Texture " + names[i] + " with its border is larger than the atlas");
+	}
+
+	// Tallest first keeps the skyline flat
+	vector<size_t> order(images.size());
+
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+
+	stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return regions[a].height != regions[b].height ? regions[a].height > regions[b].height : regions[a].width > regions[b].width; });
+
+	// If everything fits in one slice try every slice width and keep the smallest (then squarest) area.  Otherwise fill maxSize slices.
+	uint32_t usedWidth, usedHeight;
+	uint32_t numSlices = packRegions(regions, order, maxSize, maxSize, usedWidth, usedHeight);
+
+	if (numSlices == 1) {
+
+		uint32_t bestWidth = maxSize;
+		uint64_t bestArea = (uint64_t)usedWidth * usedHeight;
+		uint32_t bestSide = max(usedWidth, usedHeight);
+		uint32_t minWidth = 0;
+
+		for (const AtlasRegion& region : regions)
+			minWidth = max(minWidth, region.width);
+
+		for (uint32_t sliceWidth = minWidth; sliceWidth < maxSize; sliceWidth += alignment) {
+
+			uint32_t width, height;
+
+			if (packRegions(regions, order, sliceWidth, maxSize, width, height) != 1)
+				continue;
+
+			uint64_t area = (uint64_t)width * height;
+
+			if (area < bestArea || (area == bestArea && max(width, height) < bestSide)) {
+
+				bestWidth = sliceWidth;
+				bestArea = area;
+				bestSide = max(width, height);
+			}
+		}
+
+		packRegions(regions, order, bestWidth, maxSize, usedWidth, usedHeight);
+	}
+
+	TextureAtlas atlas;
+	atlas.layout = AtlasLayout::Rectangles;
+	atlas.width = max(usedWidth, alignment);
+	atlas.height = max(usedHeight, alignment);
+	atlas.slices.resize(numSlices);
+
+	// Space not covered by a source is transparent black
+	for (vector<ImageData>& slice : atlas.slices) {
+
+		slice.resize(levels);
+
+		for (uint32_t level = 0; level < levels; ++level) {
+
+			slice[level].width = atlas.width >> level;
+			slice[level].height = atlas.height >> level;
+			slice[level].pixels.assign((size_t)slice[level].width * slice[level].height * 4, 0);
+		}
+	}
+
+	for (size_t i = 0; i < images.size(); ++i) {
+
+		const AtlasRegion& region = regions[i];
+
+		// Each source is filtered on its own so the filter width and the options for its name (sRGB, alpha coverage) do not affect its neighbours
+		ImageData padded;
+		copyWithBorder(images[i], border, region.width, region.height, padded);
+
+		MipOptions mipOptions = getDefaultMipOptions(names[i]);
+		mipOptions.numThreads = options.numThreads;
+
+		vector<ImageData> mips = generateMipChain(padded, mipOptions);
+
+		for (uint32_t level = 0; level < levels; ++level)
+			blit(mips[level], atlas.slices[region.slice][level], region.x >> level, region.y >> level);
+
+		AtlasEntry entry;
+		entry.name = names[i];
+		entry.slice = region.slice;
+		entry.x = region.x + border;
+		entry.y = region.y + border;
+		entry.width = images[i].width;
+		entry.height = images[i].height;
+		entry.scaleOffset[0] = (float)entry.width / atlas.width;
+		entry.scaleOffset[1] = (float)entry.height / atlas.height;
+		entry.scaleOffset[2] = (float)entry.x / atlas.width;
+		entry.scaleOffset[3] = (float)entry.y / atlas.height;
+
+		atlas.entries.push_back(entry);
+	}
+
+	return atlas;
+}
+
+
+static TextureAtlas buildArrayAtlas(const vector<ImageData>& images, const vector<string>& names, const AtlasOptions& options) {
+
+	TextureAtlas atlas;
+	atlas.layout = AtlasLayout::Array;
+
+	for (const ImageData& image : images) {
+
+		atlas.width = max(atlas.width, image.width);
+		atlas.height = max(atlas.height, image.height);
+	}
+
+	if (options.blockAligned) {
+
+		atlas.width = roundUp(atlas.width, 4);
+		atlas.height = roundUp(atlas.height, 4);
+	}
+
+	for (size_t i = 0; i < images.size(); ++i) {
+
+		MipOptions mipOptions = getDefaultMipOptions(names[i]);
+		mipOptions.numThreads = options.numThreads;
+
+		if (images[i].width == atlas.width && images[i].height == atlas.height)
+			atlas.slices.push_back(generateMipChain(images[i], mipOptions));
+		else
+			atlas.slices.push_back(generateMipChain(resizeImage(images[i], atlas.width, atlas.height), mipOptions));
+
+		AtlasEntry entry = { names[i], (uint32_t)i, 0, 0, atlas.width, atlas.height, { 1.0f, 1.0f, 0.0f, 0.0f } };
+		atlas.entries.push_back(entry);
+	}
+
+	return atlas;
+}
+
+
+TextureAtlas buildTextureAtlas(const vector<ImageData>& images, const vector<string>& names, const AtlasOptions& options) {
+
+	if (images.size() != names.size())
+		throw runtime_error("Every texture in an atlas needs a name");
+
+	for (size_t i = 0; i < images.size(); ++i)
+		if (images[i].width == 0 || images[i].height == 0 || images[i].pixels.size() != (size_t)images[i].width * images[i].height * 4)
+			throw runtime_error("Invalid image for atlas " + names[i]);
+
+	if (images.empty())
+		return TextureAtlas();
+
+	return options.layout == AtlasLayout::Array ? buildArrayAtlas(images, names, options) : buildRectangleAtlas(images, names, options);
+}
+
+
+float getPackingEfficiency(const TextureAtlas& atlas, const vector<ImageData>& images) {
+
+	uint64_t sourceTexels = 0;
+
+	for (const ImageData& image : images)
+		sourceTexels += (uint64_t)image.width * image.height;
+
+	uint64_t atlasTexels = (uint64_t)atlas.width * atlas.height * atlas.slices.size();
+
+	return atlasTexels > 0 ? (float)((double)sourceTexels / atlasTexels) : 0.0f;
+}
+
+
+void writeAtlasTable(const string& filename, const TextureAtlas& atlas) {
+
+	ofstream file(filename);
+
+	if (!file)
+		throw runtime_error("Cannot create atlas table " + filename);
+
+	file << "# " << getLayoutName(atlas.layout) << " atlas, " << atlas.width << "x" << atlas.height << " x " << atlas.slices.size() << (atlas.slices.size() == 1 ? " slice" : " slices") << endl;
+	file << "# slice x y width height scaleU scaleV offsetU offsetV name" << endl;
+	file << setprecision(9);
+
+	for (const AtlasEntry& entry : atlas.entries) {
+
+		file << entry.slice << " " << entry.x << " " << entry.y << " " << entry.width << " " << entry.height;
+
+		for (float value : entry.scaleOffset)
+			file << " " << value;
+
+		file << " " << entry.name << endl;
+	}
+
+	if (!file)
+		throw runtime_error("Cannot write atlas table " + filename);
+}
+
+
+vector<AtlasEntry> readAtlasTable(const string& filename) {
+
+	ifstream file(filename);
+
+	if (!file)
+		throw runtime_error("Cannot open atlas table " + filename);
+
+	vector<AtlasEntry> entries;
+	string line;
+
+	while (getline(file, line)) {
+
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		// Names are the rest of the line so they may contain spaces
+		istringstream fields(line);
+		AtlasEntry entry;
+
+		fields >> entry.slice >> entry.x >> entry.y >> entry.width >> entry.height >> entry.scaleOffset[0] >> entry.scaleOffset[1] >> entry.scaleOffset[2] >> entry.scaleOffset[3];
+		fields >> ws;
+		getline(fields, entry.name);
+
+		if (fields.fail() || entry.name.empty())
+			throw runtime_error("Invalid line in atlas table " + filename + ": " + line);
+
+		entries.push_back(entry);
+	}
+
+	return entries;
+}
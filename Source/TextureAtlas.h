@@ -0,0 +1,57 @@
+
+//
+// TextureAtlas.h
+//
+
+// Packs small textures (sprites, particles, foliage) into a shared texture so objects drawn with different textures bind the same resource view and can be batched.  Each source is found again through an AtlasEntry - a texture array slice and a scale / offset applied to its texture coordinates.
+//   Rectangles - sources keep their size and are packed into as few slices as possible with a skyline packer.  Every source is surrounded by a border of its own edge texels and aligned so that none of the kept mip levels mixes texels of neighbouring sources, and bilinear filtering at the edge of a source only reads its border.  The mip chain of each source is generated separately (with the options for its name, see getDefaultMipOptions) and copied into the slice levels.
+//   Array - every source is resized to the size of the largest and given its own slice with a full mip chain.  Suits textures of similar size that tile or need every mip level (foliage).
+
+#pragma once
+#include <ImageData.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+enum class AtlasLayout { Rectangles, Array };
+
+struct AtlasOptions {
+	AtlasLayout							layout = AtlasLayout::Rectangles;
+	uint32_t							maxSize = 2048; // Largest slice width and height (Rectangles).  Sources that do not fit start another slice.
+	uint32_t							mipLevels = 4; // Levels kept by Rectangles atlases.  Each extra level doubles the border and alignment of every source.
+	bool								blockAligned = true; // Keep each source on whole 4x4 blocks in every kept level so the atlas can be block compressed
+	unsigned int						numThreads = 1; // Mip generation
+};
+
+// Where one source texture was placed.  Texture coordinates (u, v) of the source become (u * scaleOffset[0] + scaleOffset[2], v * scaleOffset[1] + scaleOffset[3]) in array slice "slice".
+struct AtlasEntry {
+	std::string							name;
+	uint32_t							slice;
+	uint32_t							x, y, width, height; // Texels covered by the source in the top level of the slice (excluding the border)
+	float								scaleOffset[4];
+};
+
+struct TextureAtlas {
+	AtlasLayout							layout = AtlasLayout::Rectangles;
+	uint32_t							width = 0; // Of every slice
+	uint32_t							height = 0;
+	std::vector<std::vector<ImageData>>	slices; // Mip chain of each slice, largest first.  Every slice has the same number of levels.
+	std::vector<AtlasEntry>				entries; // In the order of the source images
+
+	// Entry for a source name or null
+	const AtlasEntry *find(const std::string& name) const;
+};
+
+
+const char *getLayoutName(AtlasLayout layout);
+
+// Pack images (named by names, usually their file names) into an atlas.  Throws std::runtime_error if an image is larger than options.maxSize.
+TextureAtlas buildTextureAtlas(const std::vector<ImageData>& images, const std::vector<std::string>& names, const AtlasOptions& options = AtlasOptions());
+
+// Fraction of the top level texels of all slices covered by source texels (0 - 1).  Resized sources in Array atlases count at their original size.
+float getPackingEfficiency(const TextureAtlas& atlas, const std::vector<ImageData>& images);
+
+// Remapping table of an atlas as text - one line per entry: slice x y width height scaleU scaleV offsetU offsetV name.  Throws std::runtime_error if the file cannot be written or read.
+void writeAtlasTable(const std::string& filename, const TextureAtlas& atlas);
+std::vector<AtlasEntry> readAtlasTable(const std::string& filename);
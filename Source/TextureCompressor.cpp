@@ -0,0 +1,949 @@
+
+#include "TextureCompressor.h"
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <atomic>
+
+using namespace std;
+
+
+// BC7 interpolation weights (in 64ths) for 4 bit indices
+static const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// Iterations of least squares endpoint refinement
+static const int refineIterations = 2;
+
+
+const char *getFormatName(BlockFormat format) {
+
+	switch (format) {
+
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC3: return "BC3";
+	case BlockFormat::BC4: return "BC4";
+	case BlockFormat::BC5: return "BC5";
+	default: return "BC7";
+	}
+}
+
+
+uint32_t getDXGIFormat(BlockFormat format) {
+
+	switch (format) {
+
+	case BlockFormat::BC1: return 71; // DXGI_FORMAT_BC1_UNORM
+	case BlockFormat::BC3: return 77; // DXGI_FORMAT_BC3_UNORM
+	case BlockFormat::BC4: return 80; // DXGI_FORMAT_BC4_UNORM
+	case BlockFormat::BC5: return 83; // DXGI_FORMAT_BC5_UNORM
+	default: return 98; // DXGI_FORMAT_BC7_UNORM
+	}
+}
+
+
+uint32_t getBlockBytes(BlockFormat format) {
+
+	return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+
+uint32_t getChannelMask(BlockFormat format) {
+
+	switch (format) {
+
+	case BlockFormat::BC1: return 0x7;
+	case BlockFormat::BC4: return 0x1;
+	case BlockFormat::BC5: return 0x3;
+	default: return 0xf;
+	}
+}
+
+
+//
+// Shared helpers
+//
+
+static inline int clampInt(int value, int low, int high) {
+
+	return value < low ? low : (value > high ? high : value);
+}
+
+
+// Mean and principal axis of count points of the given dimension (3 or 4) by power iteration on the covariance matrix.  The axis is zero if the points are all equal.
+static void principalAxis(const float *points, int count, int dimension, float mean[4], float axis[4]) {
+
+	float covariance[4][4] = {};
+
+	for (int j = 0; j < dimension; ++j) {
+
+		mean[j] = 0.0f;
+
+		for (int i = 0; i < count; ++i)
+			mean[j] += points[i * dimension + j];
+
+		mean[j] /= count;
+	}
+
+	for (int i = 0; i < count; ++i)
+		for (int j = 0; j < dimension; ++j)
+			for (int k = j; k < dimension; ++k)
+				covariance[j][k] += (points[i * dimension + j] - mean[j]) * (points[i * dimension + k] - mean[k]);
+
+	for (int j = 0; j < dimension; ++j)
+		for (int k = 0; k < j; ++k)
+			covariance[j][k] = covariance[k][j];
+
+	// Start from the row of the largest variance so the iteration converges to the dominant axis
+	int largest = 0;
+
+	for (int j = 1; j < dimension; ++j)
+		if (covariance[j][j] > covariance[largest][largest])
+			largest = j;
+
+	for (int j = 0; j < dimension; ++j)
+		axis[j] = covariance[largest][j];
+
+	for (int iteration = 0; iteration < 8; ++iteration) {
+
+		float next[4] = {};
+		float length = 0.0f;
+
+		for (int j = 0; j < dimension; ++j) {
+
+			for (int k = 0; k < dimension; ++k)
+				next[j] += covariance[j][k] * axis[k];
+
+			length += next[j] * next[j];
+		}
+
+		if (length < 1e-12f) {
+
+			for (int j = 0; j < dimension; ++j)
+				axis[j] = 0.0f;
+
+			return;
+		}
+
+		length = 1.0f / sqrt(length);
+
+		for (int j = 0; j < dimension; ++j)
+			axis[j] = next[j] * length;
+	}
+}
+
+
+// Extent of the points along axis - endpoints are mean + axis * low and mean + axis * high
+static void projectExtent(const float *points, int count, int dimension, const float mean[4], const float axis[4], float& low, float& high) {
+
+	low = FLT_MAX;
+	high = -FLT_MAX;
+
+	for (int i = 0; i < count; ++i) {
+
+		float t = 0.0f;
+
+		for (int j = 0; j < dimension; ++j)
+			t += (points[i * dimension + j] - mean[j]) * axis[j];
+
+		low = min(low, t);
+		high = max(high, t);
+	}
+
+	if (low > high)
+		low = high = 0.0f;
+}
+
+
+// Least squares endpoints for points interpolated with weights (0 = endpoint 0, 1 = endpoint 1).  Returns false if the weights are degenerate.
+static bool leastSquaresEndpoints(const float *points, const float *weights, int count, int dimension, float endpoint0[4], float endpoint1[4]) {
+
+	float a = 0.0f, b = 0.0f, c = 0.0f;
+	float x0[4] = {}, x1[4] = {};
+
+	for (int i = 0; i < count; ++i) {
+
+		float t = weights[i];
+		float s = 1.0f - t;
+
+		a += s * s;
+		b += s * t;
+		c += t * t;
+
+		for (int j = 0; j < dimension; ++j) {
+
+			x0[j] += s * points[i * dimension + j];
+			x1[j] += t * points[i * dimension + j];
+		}
+	}
+
+	float determinant = a * c - b * b;
+
+	if (fabs(determinant) < 1e-6f)
+		return false;
+
+	for (int j = 0; j < dimension; ++j) {
+
+		endpoint0[j] = (c * x0[j] - b * x1[j]) / determinant;
+		endpoint1[j] = (a * x1[j] - b * x0[j]) / determinant;
+	}
+
+	return true;
+}
+
+
+// Little endian bit stream for BC7 blocks
+struct BitWriter {
+
+	uint8_t								*data;
+	uint32_t							position = 0;
+
+	void write(uint32_t value, uint32_t numBits) {
+
+		for (uint32_t i = 0; i < numBits; ++i, ++position)
+			data[position >> 3] |= (uint8_t)(((value >> i) & 1) << (position & 7));
+	}
+};
+
+struct BitReader {
+
+	const uint8_t						*data;
+	uint32_t							position = 0;
+
+	uint32_t read(uint32_t numBits) {
+
+		uint32_t value = 0;
+
+		for (uint32_t i = 0; i < numBits; ++i, ++position)
+			value |= (uint32_t)((data[position >> 3] >> (position & 7)) & 1) << i;
+
+		return value;
+	}
+};
+
+
+//
+// BC1 colour blocks (also the colour half of BC3)
+//
+
+static uint16_t packRGB565(const float colour[3]) {
+
+	int r = clampInt((int)(colour[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+	int g = clampInt((int)(colour[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+	int b = clampInt((int)(colour[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+
+static void unpackRGB565(uint16_t value, int colour[3]) {
+
+	int r = (value >> 11) & 31;
+	int g = (value >> 5) & 63;
+	int b = value & 31;
+
+	colour[0] = (r << 3) | (r >> 2);
+	colour[1] = (g << 2) | (g >> 4);
+	colour[2] = (b << 3) | (b >> 2);
+}
+
+
+// Four colour palette - BC1 blocks with colour0 <= colour1 use three colours and transparent black instead (BC3 colour blocks never do)
+static void colourPalette(uint16_t colour0, uint16_t colour1, bool allowThreeColour, int palette[4][4]) {
+
+	unpackRGB565(colour0, palette[0]);
+	unpackRGB565(colour1, palette[1]);
+	palette[0][3] = palette[1][3] = 255;
+
+	if (allowThreeColour && colour0 <= colour1) {
+
+		for (int j = 0; j < 3; ++j) {
+
+			palette[2][j] = (palette[0][j] + palette[1][j]) / 2;
+			palette[3][j] = 0;
+		}
+
+		palette[2][3] = 255;
+		palette[3][3] = 0;
+	}
+	else {
+
+		for (int j = 0; j < 3; ++j) {
+
+			palette[2][j] = (2 * palette[0][j] + palette[1][j]) / 3;
+			palette[3][j] = (palette[0][j] + 2 * palette[1][j]) / 3;
+		}
+
+		palette[2][3] = palette[3][3] = 255;
+	}
+}
+
+
+// Nearest four colour palette entries for the block.  Returns the squared RGB error.
+static int fitColourIndices(const float points[48], uint16_t colour0, uint16_t colour1, uint32_t& indices) {
+
+	int palette[4][4];
+	colourPalette(colour0, colour1, false, palette);
+
+	int error = 0;
+	indices = 0;
+
+	for (int i = 0; i < 16; ++i) {
+
+		int bestIndex = 0, bestError = INT32_MAX;
+
+		for (int k = 0; k < 4; ++k) {
+
+			int e = 0;
+
+			for (int j = 0; j < 3; ++j) {
+
+				int d = (int)points[i * 3 + j] - palette[k][j];
+				e += d * d;
+			}
+
+			if (e < bestError) {
+
+				bestError = e;
+				bestIndex = k;
+			}
+		}
+
+		indices |= (uint32_t)bestIndex << (2 * i);
+		error += bestError;
+	}
+
+	return error;
+}
+
+
+static void compressColourBlock(const uint8_t texels[64], uint8_t *block) {
+
+	float points[48];
+
+	for (int i = 0; i < 16; ++i)
+		for (int j = 0; j < 3; ++j)
+			points[i * 3 + j] = texels[i * 4 + j];
+
+	float mean[4], axis[4], low, high;
+	principalAxis(points, 16, 3, mean, axis);
+	projectExtent(points, 16, 3, mean, axis, low, high);
+
+	float endpoint0[3], endpoint1[3];
+
+	for (int j = 0; j < 3; ++j) {
+
+		endpoint0[j] = mean[j] + axis[j] * high;
+		endpoint1[j] = mean[j] + axis[j] * low;
+	}
+
+	uint16_t colour0 = packRGB565(endpoint0);
+	uint16_t colour1 = packRGB565(endpoint1);
+	uint32_t indices;
+	int error = fitColourIndices(points, colour0, colour1, indices);
+
+	// Refit the endpoints to the chosen indices (index 2 is 1/3 of the way to colour1, index 3 is 2/3)
+	static const float indexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	for (int iteration = 0; iteration < refineIterations && error > 0; ++iteration) {
+
+		float weights[16];
+
+		for (int i = 0; i < 16; ++i)
+			weights[i] = indexWeights[(indices >> (2 * i)) & 3];
+
+		if (!leastSquaresEndpoints(points, weights, 16, 3, endpoint0, endpoint1))
+			break;
+
+		uint16_t refined0 = packRGB565(endpoint0);
+		uint16_t refined1 = packRGB565(endpoint1);
+		uint32_t refinedIndices;
+		int refinedError = fitColourIndices(points, refined0, refined1, refinedIndices);
+
+		if (refinedError >= error)
+			break;
+
+		colour0 = refined0;
+		colour1 = refined1;
+		indices = refinedIndices;
+		error = refinedError;
+	}
+
+	// colour0 > colour1 selects the four colour palette.  Swapping the endpoints exchanges indices 0 <-> 1 and 2 <-> 3.
+	if (colour0 < colour1) {
+
+		swap(colour0, colour1);
+		indices ^= 0x55555555;
+	}
+	else if (colour0 == colour1)
+		indices = 0;
+
+	block[0] = (uint8_t)colour0;
+	block[1] = (uint8_t)(colour0 >> 8);
+	block[2] = (uint8_t)colour1;
+	block[3] = (uint8_t)(colour1 >> 8);
+
+	for (int i = 0; i < 4; ++i)
+		block[4 + i] = (uint8_t)(indices >> (8 * i));
+}
+
+
+static void decompressColourBlock(const uint8_t *block, bool allowThreeColour, uint8_t texels[64]) {
+
+	uint16_t colour0 = (uint16_t)(block[0] | (block[1] << 8));
+	uint16_t colour1 = (uint16_t)(block[2] | (block[3] << 8));
+	uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+
+	int palette[4][4];
+	colourPalette(colour0, colour1, allowThreeColour, palette);
+
+	for (int i = 0; i < 16; ++i) {
+
+		const int *colour = palette[(indices >> (2 * i)) & 3];
+
+		for (int j = 0; j < 4; ++j)
+			texels[i * 4 + j] = (uint8_t)colour[j];
+	}
+}
+
+
+//
+// BC4 single channel blocks (alpha of BC3, red and green of BC5)
+//
+
+// Eight value palette when value0 > value1, otherwise six values with 0 and 255
+static void channelPalette(int value0, int value1, int palette[8]) {
+
+	palette[0] = value0;
+	palette[1] = value1;
+
+	if (value0 > value1) {
+
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+	}
+	else {
+
+		for (int i = 1; i < 5; ++i)
+			palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+
+// Nearest palette entries for the values.  Returns the squared error.
+static int fitChannelIndices(const uint8_t values[16], int value0, int value1, uint64_t& indices) {
+
+	int palette[8];
+	channelPalette(value0, value1, palette);
+
+	int error = 0;
+	indices = 0;
+
+	for (int i = 0; i < 16; ++i) {
+
+		int bestIndex = 0, bestError = INT32_MAX;
+
+		for (int k = 0; k < 8; ++k) {
+
+			int d = values[i] - palette[k];
+
+			if (d * d < bestError) {
+
+				bestError = d * d;
+				bestIndex = k;
+			}
+		}
+
+		indices |= (uint64_t)bestIndex << (3 * i);
+		error += bestError;
+	}
+
+	return error;
+}
+
+
+// Encode 16 values of one channel (stride bytes apart) as an 8 byte BC4 block
+static void compressChannelBlock(const uint8_t *texels, int stride, uint8_t *block) {
+
+	uint8_t values[16];
+	int low = 255, high = 0;
+	int innerLow = 255, innerHigh = 0; // Ignoring 0 and 255, which the six value palette holds exactly
+
+	for (int i = 0; i < 16; ++i) {
+
+		values[i] = texels[i * stride];
+		low = min(low, (int)values[i]);
+		high = max(high, (int)values[i]);
+
+		if (values[i] != 0 && values[i] != 255) {
+
+			innerLow = min(innerLow, (int)values[i]);
+			innerHigh = max(innerHigh, (int)values[i]);
+		}
+	}
+
+	int value0 = high, value1 = low;
+	uint64_t indices = 0;
+	int error = 0;
+
+	if (high > low) {
+
+		error = fitChannelIndices(values, high, low, indices);
+
+		// Insetting the range by 1/16 trades exact extremes for finer steps between them
+		int inset = (high - low) / 16;
+
+		if (inset > 0) {
+
+			uint64_t insetIndices;
+			int insetError = fitChannelIndices(values, high - inset, low + inset, insetIndices);
+
+			if (insetError < error) {
+
+				value0 = high - inset;
+				value1 = low + inset;
+				indices = insetIndices;
+				error = insetError;
+			}
+		}
+
+		// Six value mode for blocks mixing 0 / 255 with intermediate values (alpha edges)
+		if (error > 0 && innerLow <= innerHigh && (low == 0 || high == 255)) {
+
+			uint64_t sixIndices;
+			int sixError = fitChannelIndices(values, innerLow, innerHigh, sixIndices);
+
+			if (sixError < error) {
+
+				value0 = innerLow;
+				value1 = innerHigh;
+				indices = sixIndices;
+				error = sixError;
+			}
+		}
+	}
+
+	block[0] = (uint8_t)value0;
+	block[1] = (uint8_t)value1;
+
+	for (int i = 0; i < 6; ++i)
+		block[2 + i] = (uint8_t)(indices >> (8 * i));
+}
+
+
+static void decompressChannelBlock(const uint8_t *block, uint8_t *texels, int stride) {
+
+	int palette[8];
+	channelPalette(block[0], block[1], palette);
+
+	uint64_t indices = 0;
+
+	for (int i = 0; i < 6; ++i)
+		indices |= (uint64_t)block[2 + i] << (8 * i);
+
+	for (int i = 0; i < 16; ++i)
+		texels[i * stride] = (uint8_t)palette[(indices >> (3 * i)) & 7];
+}
+
+
+//
+// BC7 mode 6 blocks
+//
+
+struct BC7Endpoints {
+	int									quantised[2][4]; // 7 bits
+	int									pBit[2];
+	int									value[2][4]; // 8 bit expanded endpoints
+};
+
+
+static void quantiseBC7Endpoints(const float endpoint0[4], const float endpoint1[4], int pBit0, int pBit1, BC7Endpoints& endpoints) {
+
+	const float *source[2] = { endpoint0, endpoint1 };
+	int pBits[2] = { pBit0, pBit1 };
+
+	for (int e = 0; e < 2; ++e) {
+
+		endpoints.pBit[e] = pBits[e];
+
+		for (int j = 0; j < 4; ++j) {
+
+			endpoints.quantised[e][j] = clampInt((int)floor((source[e][j] - pBits[e]) * 0.5f + 0.5f), 0, 127);
+			endpoints.value[e][j] = (endpoints.quantised[e][j] << 1) | pBits[e];
+		}
+	}
+}
+
+
+static inline int interpolateBC7(int value0, int value1, int weight) {
+
+	return ((64 - weight) * value0 + weight * value1 + 32) >> 6;
+}
+
+
+// Indices for the endpoints by projecting each texel onto the endpoint line and checking the neighbouring weights.  Returns the squared RGBA error.
+static int fitBC7Indices(const float points[64], const BC7Endpoints& endpoints, uint8_t indices[16]) {
+
+	int palette[16][4];
+
+	for (int k = 0; k < 16; ++k)
+		for (int j = 0; j < 4; ++j)
+			palette[k][j] = interpolateBC7(endpoints.value[0][j], endpoints.value[1][j], bc7Weights[k]);
+
+	float direction[4], lengthSquared = 0.0f;
+
+	for (int j = 0; j < 4; ++j) {
+
+		direction[j] = (float)(endpoints.value[1][j] - endpoints.value[0][j]);
+		lengthSquared += direction[j] * direction[j];
+	}
+
+	int error = 0;
+
+	for (int i = 0; i < 16; ++i) {
+
+		float t = 0.0f;
+
+		if (lengthSquared > 0.0f) {
+
+			for (int j = 0; j < 4; ++j)
+				t += (points[i * 4 + j] - endpoints.value[0][j]) * direction[j];
+
+			t /= lengthSquared;
+		}
+
+		int guess = clampInt((int)(t * 15.0f + 0.5f), 0, 15);
+		int bestIndex = guess, bestError = INT32_MAX;
+
+		for (int k = max(0, guess - 1); k <= min(15, guess + 1); ++k) {
+
+			int e = 0;
+
+			for (int j = 0; j < 4; ++j) {
+
+				int d = (int)points[i * 4 + j] - palette[k][j];
+				e += d * d;
+			}
+
+			if (e < bestError) {
+
+				bestError = e;
+				bestIndex = k;
+			}
+		}
+
+		indices[i] = (uint8_t)bestIndex;
+		error += bestError;
+	}
+
+	return error;
+}
+
+
+// Try the four p-bit combinations for the endpoints and keep the best if it improves on bestError
+static void fitBC7Block(const float points[64], const float endpoint0[4], const float endpoint1[4], BC7Endpoints& bestEndpoints, uint8_t bestIndices[16], int& bestError) {
+
+	for (int p = 0; p < 4; ++p) {
+
+		BC7Endpoints endpoints;
+		uint8_t indices[16];
+
+		quantiseBC7Endpoints(endpoint0, endpoint1, p & 1, p >> 1, endpoints);
+		int error = fitBC7Indices(points, endpoints, indices);
+
+		if (error < bestError) {
+
+			bestEndpoints = endpoints;
+			memcpy(bestIndices, indices, 16);
+			bestError = error;
+		}
+	}
+}
+
+
+static void compressBC7Block(const uint8_t texels[64], uint8_t *block) {
+
+	float points[64];
+
+	for (int i = 0; i < 64; ++i)
+		points[i] = texels[i];
+
+	float mean[4], axis[4], low, high;
+	principalAxis(points, 16, 4, mean, axis);
+	projectExtent(points, 16, 4, mean, axis, low, high);
+
+	float endpoint0[4], endpoint1[4];
+
+	for (int j = 0; j < 4; ++j) {
+
+		endpoint0[j] = mean[j] + axis[j] * low;
+		endpoint1[j] = mean[j] + axis[j] * high;
+	}
+
+	BC7Endpoints endpoints;
+	uint8_t indices[16];
+	int error = INT32_MAX;
+
+	fitBC7Block(points, endpoint0, endpoint1, endpoints, indices, error);
+
+	for (int iteration = 0; iteration < refineIterations && error > 0; ++iteration) {
+
+		float weights[16];
+
+		for (int i = 0; i < 16; ++i)
+			weights[i] = bc7Weights[indices[i]] / 64.0f;
+
+		if (!leastSquaresEndpoints(points, weights, 16, 4, endpoint0, endpoint1))
+			break;
+
+		int previousError = error;
+		fitBC7Block(points, endpoint0, endpoint1, endpoints, indices, error);
+
+		if (error >= previousError)
+			break;
+	}
+
+	// The most significant bit of the first (anchor) index is implicitly 0 - swap the endpoints if it is set
+	if (indices[0] & 8) {
+
+		for (int j = 0; j < 4; ++j)
+			swap(endpoints.quantised[0][j], endpoints.quantised[1][j]);
+
+		swap(endpoints.pBit[0], endpoints.pBit[1]);
+
+		for (int i = 0; i < 16; ++i)
+			indices[i] = (uint8_t)(15 - indices[i]);
+	}
+
+	memset(block, 0, 16);
+
+	BitWriter writer = { block };
+	writer.write(1 << 6, 7); // Mode 6
+
+	for (int j = 0; j < 4; ++j) {
+
+		writer.write(endpoints.quantised[0][j], 7);
+		writer.write(endpoints.quantised[1][j], 7);
+	}
+
+	writer.write(endpoints.pBit[0], 1);
+	writer.write(endpoints.pBit[1], 1);
+	writer.write(indices[0], 3);
+
+	for (int i = 1; i < 16; ++i)
+		writer.write(indices[i], 4);
+}
+
+
+static void decompressBC7Block(const uint8_t *block, uint8_t texels[64]) {
+
+	BitReader reader = { block };
+
+	if (reader.read(7) != (1 << 6))
+		throw runtime_error("Only BC7 mode 6 blocks can be decoded");
+
+	int value[2][4];
+
+	for (int j = 0; j < 4; ++j) {
+
+		value[0][j] = reader.read(7) << 1;
+		value[1][j] = reader.read(7) << 1;
+	}
+
+	int pBit0 = reader.read(1);
+	int pBit1 = reader.read(1);
+
+	for (int j = 0; j < 4; ++j) {
+
+		value[0][j] |= pBit0;
+		value[1][j] |= pBit1;
+	}
+
+	for (int i = 0; i < 16; ++i) {
+
+		int index = reader.read(i == 0 ? 3 : 4);
+
+		for (int j = 0; j < 4; ++j)
+			texels[i * 4 + j] = (uint8_t)interpolateBC7(value[0][j], value[1][j], bc7Weights[index]);
+	}
+}
+
+
+//
+// Blocks and images
+//
+
+void compressBlock(BlockFormat format, const uint8_t texels[64], uint8_t *block) {
+
+	switch (format) {
+
+	case BlockFormat::BC1:
+		compressColourBlock(texels, block);
+		break;
+
+	case BlockFormat::BC3:
+		compressChannelBlock(texels + 3, 4, block);
+		compressColourBlock(texels, block + 8);
+		break;
+
+	case BlockFormat::BC4:
+		compressChannelBlock(texels, 4, block);
+		break;
+
+	case BlockFormat::BC5:
+		compressChannelBlock(texels, 4, block);
+		compressChannelBlock(texels + 1, 4, block + 8);
+		break;
+
+	case BlockFormat::BC7:
+		compressBC7Block(texels, block);
+		break;
+	}
+}
+
+
+void decompressBlock(BlockFormat format, const uint8_t *block, uint8_t texels[64]) {
+
+	switch (format) {
+
+	case BlockFormat::BC1:
+		decompressColourBlock(block, true, texels);
+		break;
+
+	case BlockFormat::BC3:
+		decompressColourBlock(block + 8, false, texels);
+		decompressChannelBlock(block, texels + 3, 4);
+		break;
+
+	case BlockFormat::BC4:
+	case BlockFormat::BC5:
+		for (int i = 0; i < 16; ++i) {
+
+			texels[i * 4 + 1] = texels[i * 4 + 2] = 0;
+			texels[i * 4 + 3] = 255;
+		}
+
+		decompressChannelBlock(block, texels, 4);
+
+		if (format == BlockFormat::BC5)
+			decompressChannelBlock(block + 8, texels + 1, 4);
+		break;
+
+	case BlockFormat::BC7:
+		decompressBC7Block(block, texels);
+		break;
+	}
+}
+
+
+vector<uint8_t> compressImage(const ImageData& image, BlockFormat format, unsigned int numThreads) {
+
+	if (image.width == 0 || image.height == 0 || image.pixels.size() != (size_t)image.width * image.height * 4)
+		throw runtime_error("Invalid image for block compression");
+
+	uint32_t blocksWide = (image.width + 3) / 4;
+	uint32_t blocksHigh = (image.height + 3) / 4;
+	uint32_t blockBytes = getBlockBytes(format);
+
+	vector<uint8_t> blocks((size_t)blocksWide * blocksHigh * blockBytes);
+
+	// Rows of blocks are handed out to the threads in order
+	atomic<uint32_t> nextRow(0);
+
+	auto compressRows = [&]() {
+
+		uint8_t texels[64];
+
+		for (uint32_t by = nextRow++; by < blocksHigh; by = nextRow++) {
+
+			for (uint32_t bx = 0; bx < blocksWide; ++bx) {
+
+				for (uint32_t i = 0; i < 16; ++i) {
+
+					uint32_t x = min(bx * 4 + (i & 3), image.width - 1);
+					uint32_t y = min(by * 4 + (i >> 2), image.height - 1);
+
+					memcpy(texels + i * 4, &image.pixels[((size_t)y * image.width + x) * 4], 4);
+				}
+
+				compressBlock(format, texels, &blocks[((size_t)by * blocksWide + bx) * blockBytes]);
+			}
+		}
+	};
+
+	numThreads = max(1u, min(numThreads, blocksHigh));
+
+	vector<thread> workers;
+
+	for (unsigned int t = 1; t < numThreads; ++t)
+		workers.push_back(thread(compressRows));
+
+	compressRows();
+
+	for (thread& worker : workers)
+		worker.join();
+
+	return blocks;
+}
+
+
+void decompressImage(const uint8_t *blocks, uint32_t width, uint32_t height, BlockFormat format, ImageData& image) {
+
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+	uint32_t blockBytes = getBlockBytes(format);
+
+	image.width = width;
+	image.height = height;
+	image.pixels.resize((size_t)width * height * 4);
+
+	uint8_t texels[64];
+
+	for (uint32_t by = 0; by < blocksHigh; ++by) {
+
+		for (uint32_t bx = 0; bx < blocksWide; ++bx) {
+
+			decompressBlock(format, blocks + ((size_t)by * blocksWide + bx) * blockBytes, texels);
+
+			for (uint32_t i = 0; i < 16; ++i) {
+
+				uint32_t x = bx * 4 + (i & 3);
+				uint32_t y = by * 4 + (i >> 2);
+
+				if (x < width && y < height)
+					memcpy(&image.pixels[((size_t)y * width + x) * 4], texels + i * 4, 4);
+			}
+		}
+	}
+}
+
+
+double computePSNR(const ImageData& a, const ImageData& b, uint32_t channelMask) {
+
+	if (a.width != b.width || a.height != b.height || a.pixels.size() != b.pixels.size())
+		throw runtime_error("Cannot compare images of different sizes");
+
+	double squaredError = 0.0;
+	size_t count = 0;
+
+	for (size_t i = 0; i < a.pixels.size(); ++i) {
+
+		if (!(channelMask & (1 << (i & 3))))
+			continue;
+
+		double d = (double)a.pixels[i] - b.pixels[i];
+		squaredError += d * d;
+		++count;
+	}
+
+	if (count == 0 || squaredError == 0.0)
+		return numeric_limits<double>::infinity();
+
+	return 10.0 * log10(255.0 * 255.0 * count / squaredError);
+}
@@ -0,0 +1,44 @@
+
+//
+// TextureCompressor.h
+//
+
+// CPU block compression of RGBA8 images into the BC formats sampled directly by the GPU.  Every 4x4 block is encoded independently so images are compressed in parallel by rows of blocks.
+//   BC1 - opaque colour, 4 bits per pixel.  Endpoints lie on the principal axis of the block colours and are refined by least squares
+//   BC3 - BC1 colour with a separate BC4 alpha block, 8 bits per pixel
+//   BC4 - one channel (red), 4 bits per pixel.  Used for height / displacement maps
+//   BC5 - two channels (red and green), 8 bits per pixel.  Used for tangent space normal maps with z reconstructed in the shader
+//   BC7 - colour and alpha, 8 bits per pixel.  Only mode 6 (one subset, 7 bit RGBA endpoints with p-bits and 4 bit indices) is encoded, which suits smooth alpha such as foliage masks
+// Decoders for the same formats are used to measure quality.
+
+#pragma once
+#include <ImageData.h>
+#include <vector>
+#include <cstdint>
+
+
+enum class BlockFormat { BC1, BC3, BC4, BC5, BC7 };
+
+const char *getFormatName(BlockFormat format);
+
+// DXGI_FORMAT (UNORM) written to dds files
+uint32_t getDXGIFormat(BlockFormat format);
+
+// Bytes per 4x4 block (8 or 16)
+uint32_t getBlockBytes(BlockFormat format);
+
+// Channels stored by the format (bit 0 = red ... bit 3 = alpha) for computePSNR
+uint32_t getChannelMask(BlockFormat format);
+
+// Encode / decode one block.  texels are 16 RGBA8 texels in row order.  BC4 and BC5 encode red (and green) only and decode to (r, 0, 0, 255) / (r, g, 0, 255) as the GPU does.
+void compressBlock(BlockFormat format, const uint8_t texels[64], uint8_t *block);
+void decompressBlock(BlockFormat format, const uint8_t *block, uint8_t texels[64]);
+
+// Compress image on numThreads threads and return the blocks in row order.  Partial blocks at the right and bottom edges repeat the edge texels.  The result does not depend on numThreads.
+std::vector<uint8_t> compressImage(const ImageData& image, BlockFormat format, unsigned int numThreads = 1);
+
+// Decode width x height texels of blocks into image
+void decompressImage(const uint8_t *blocks, uint32_t width, uint32_t height, BlockFormat format, ImageData& image);
+
+// Peak signal to noise ratio in dB of b against a over the channels in channelMask.  Returns infinity if the images are identical.
+double computePSNR(const ImageData& a, const ImageData& b, uint32_t channelMask = 0xf);
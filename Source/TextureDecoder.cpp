@@ -0,0 +1,122 @@
+
+#include "TextureDecoder.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+using namespace std;
+
+
+size_t DecodedTexture::getSizeBytes() const {
+
+	size_t bytes = ddsFile ? ddsFile->getSize() : 0;
+
+	for (const ImageData& mip : mips)
+		bytes += mip.getSizeBytes();
+
+	return bytes;
+}
+
+
+static bool isDDS(const string& filename) {
+
+	if (filename.length() < 4)
+		return false;
+
+	string ext = filename.substr(filename.length() - 4);
+
+	for (char& c : ext)
+		c = (char)tolower((unsigned char)c);
+
+	return ext == ".dds";
+}
+
+
+static void decodeTexture(DecodedTexture& result, const ImageDecoder& decoder, bool generateMips) {
+
+	auto start = chrono::steady_clock::now();
+
+	try
+	{
+		if (isDDS(result.filename)) {
+
+			result.ddsFile.reset(new MappedFile(result.filename));
+
+			if (!result.ddsFile->isValid())
+				throw runtime_error("Cannot open dds file " + result.filename);
+		}
+		else {
+
+			result.mips.resize(1);
+			decoder(result.filename, result.mips[0]);
+
+			// Files are already decoded in parallel so each mip chain is generated on one thread
+			if (generateMips) {
+
+				MipOptions options = getDefaultMipOptions(result.filename);
+				options.numThreads = 1;
+
+				result.mips = generateMipChain(result.mips[0], options);
+			}
+		}
+
+		result.succeeded = true;
+	}
+	catch (exception& e)
+	{
+		result.error = e.what();
+		result.mips.clear();
+		result.ddsFile.reset();
+	}
+
+	result.decodeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+vector<DecodedTexture> decodeTextures(const vector<string>& filenames, const ImageDecoder& decoder, unsigned int numThreads, bool generateMips) {
+
+	vector<DecodedTexture> results(filenames.size());
+
+	// Largest files first so one big texture does not finish last on its own
+	vector<pair<streamoff, size_t>> order;
+
+	for (size_t i = 0; i < filenames.size(); ++i) {
+
+		results[i].filename = filenames[i];
+
+		ifstream file(filenames[i], ios::binary | ios::ate);
+		order.push_back(make_pair(file ? (streamoff)file.tellg() : 0, i));
+	}
+
+	stable_sort(order.begin(), order.end(), [](const pair<streamoff, size_t>& a, const pair<streamoff, size_t>& b) { return a.first > b.first; });
+
+	numThreads = (unsigned int)min<size_t>(max(1u, numThreads), max<size_t>(1, filenames.size()));
+
+	atomic<size_t> next(0);
+
+	auto work = [&]() {
+
+		for (size_t i = next++; i < order.size(); i = next++)
+			decodeTexture(results[order[i].second], decoder, generateMips);
+	};
+
+	if (numThreads == 1) {
+
+		work();
+		return results;
+	}
+
+	vector<thread> workers;
+
+	for (unsigned int t = 0; t < numThreads; ++t)
+		workers.push_back(thread(work));
+
+	for (thread& worker : workers)
+		worker.join();
+
+	return results;
+}
@@ -0,0 +1,35 @@
+
+//
+// TextureDecoder.h
+//
+
+// CPU half of texture loading.  decodeTextures decodes a batch of image files and generates their mip chains on a pool of threads so the textures created at start up are not decoded one after another on the main thread - only the upload (creating the GPU textures from the decoded data, see Texture::loadTextures) has to run on the thread that owns the device.  dds files are already in their GPU layout so they are only memory mapped.
+// The image decoder is passed in so the same code runs with WIC in the application and with ImageImporter in the tools.
+
+#pragma once
+#include <ImageData.h>
+#include <MappedFile.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+
+// Decode filename into image as RGBA8.  Called on the decode threads at the same time for different files - throws std::runtime_error on failure.
+typedef std::function<void(const std::string& filename, ImageData& image)> ImageDecoder;
+
+struct DecodedTexture {
+	std::string							filename;
+	bool								succeeded = false;
+	std::string							error; // Reason the file could not be decoded
+	std::vector<ImageData>				mips; // Mip chain (largest first) of decoded images - only the top level if mips were not generated
+	std::unique_ptr<MappedFile>			ddsFile; // Mapping of a dds file, uploaded as it is
+	double								decodeSeconds = 0.0;
+
+	size_t getSizeBytes() const;
+};
+
+
+// Decode every file (largest first) on numThreads threads and generate the mip chains with the options for each file name (see getDefaultMipOptions) unless generateMips is false (images packed into an atlas).  Results are in the order of filenames and do not depend on numThreads.  Failures are reported in the results rather than thrown.
+std::vector<DecodedTexture> decodeTextures(const std::vector<std::string>& filenames, const ImageDecoder& decoder, unsigned int numThreads, bool generateMips = true);
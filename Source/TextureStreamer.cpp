@@ -0,0 +1,187 @@
+#include "stdafx.h"
+#include "TextureStreamer.h"
+#include <Texture.h>
+#include <DDSFile.h>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <stdexcept>
+
+
+TextureStreamer::~TextureStreamer() {
+
+	for (auto& entry : textures) {
+
+		if (entry.second->texture)
+			entry.second->texture->Release();
+		if (entry.second->SRV)
+			entry.second->SRV->Release();
+
+		delete entry.second;
+	}
+}
+
+
+HRESULT TextureStreamer::createLevels(StreamedTexture *streamed, uint32_t topLevel) {
+
+	ID3D11Texture2D *texture = nullptr;
+	ID3D11ShaderResourceView *SRV = nullptr;
+
+	HRESULT hr = Texture::createDDSTexture(device, streamed->file->getData(), streamed->file->getSize(), &texture, &SRV, topLevel);
+
+	if (!SUCCEEDED(hr)) {
+
+		if (texture)
+			texture->Release();
+		if (SRV)
+			SRV->Release();
+
+		wcout << L"TextureStreamer: cannot create level " << topLevel << L" of " << streamed->filename << endl;
+		return hr;
+	}
+
+	// The owner takes its own reference to the new view before the old one is released
+	if (streamed->onViewChanged)
+		streamed->onViewChanged(SRV);
+
+	if (streamed->texture)
+		streamed->texture->Release();
+	if (streamed->SRV)
+		streamed->SRV->Release();
+
+	streamed->texture = texture;
+	streamed->SRV = SRV;
+
+	return S_OK;
+}
+
+
+static bool isWholeBlocks(uint32_t size) {
+
+	return size >= 4 && (size % 4) == 0;
+}
+
+
+uint32_t TextureStreamer::addTexture(const wstring& filename, ViewCallback onViewChanged) {
+
+	unique_ptr<MappedFile> file(new MappedFile(string(filename.begin(), filename.end())));
+
+	if (!file->isValid())
+		return 0;
+
+	uint32_t id = 0;
+
+	try
+	{
+		DDSInfo info = readDDSInfo(file->getData(), file->getSize());
+		vector<DDSSubresource> subresources = getDDSSubresources(info, file->getSize());
+
+		// Each level of every array slice / cube face
+		vector<size_t> levelBytes(info.mipLevels, 0);
+
+		for (size_t i = 0; i < subresources.size(); ++i)
+			levelBytes[i % info.mipLevels] += (size_t)subresources[i].slicePitch * subresources[i].depth;
+
+		// Block compressed textures need a top level that is a whole number of blocks
+		bool blockCompressed;
+		getDXGIFormatBytes(info.format, blockCompressed);
+
+		uint32_t maxTopLevel = UINT32_MAX;
+
+		if (blockCompressed) {
+
+			maxTopLevel = 0;
+
+			while (maxTopLevel + 1 < info.mipLevels && isWholeBlocks(info.width >> (maxTopLevel + 1)) && isWholeBlocks(info.height >> (maxTopLevel + 1)))
+				++maxTopLevel;
+		}
+
+		// Volume textures are not Texture2Ds
+		if (info.depth > 1)
+			return 0;
+
+		id = residency.addTexture(info.width, info.height, levelBytes, maxTopLevel);
+	}
+	catch (runtime_error& e)
+	{
+		wcout << L"TextureStreamer: cannot stream " << filename << endl;
+		cout << e.what() << endl;
+		return 0;
+	}
+
+	StreamedTexture *streamed = new StreamedTexture();
+	streamed->filename = filename;
+	streamed->file = move(file);
+	streamed->onViewChanged = onViewChanged;
+
+	if (!SUCCEEDED(createLevels(streamed, residency.getResidentLevel(id)))) {
+
+		residency.removeTexture(id);
+		delete streamed;
+		return 0;
+	}
+
+	textures[id] = streamed;
+	return id;
+}
+
+
+void TextureStreamer::removeTexture(uint32_t texture) {
+
+	auto entry = textures.find(texture);
+
+	if (entry == textures.end())
+		return;
+
+	residency.removeTexture(texture);
+
+	if (entry->second->texture)
+		entry->second->texture->Release();
+	if (entry->second->SRV)
+		entry->second->SRV->Release();
+
+	delete entry->second;
+	textures.erase(entry);
+}
+
+
+void TextureStreamer::update() {
+
+	auto start = chrono::steady_clock::now();
+
+	residency.update(loads, evictions);
+
+	// A texture is never both loaded and evicted in one update so each one is recreated at most once
+	for (const MipRequest& eviction : evictions)
+		createLevels(textures[eviction.texture], eviction.level + 1);
+
+	for (const MipRequest& load : loads) {
+
+		if (SUCCEEDED(createLevels(textures[load.texture], load.level)))
+			residency.loaded(load.texture, load.level);
+		else
+			residency.loadFailed(load.texture, load.level);
+	}
+
+	uploadMsLastFrame = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	maxUploadMs = max(maxUploadMs, uploadMsLastFrame);
+}
+
+
+ID3D11ShaderResourceView *TextureStreamer::getShaderResourceView(uint32_t texture) {
+
+	auto entry = textures.find(texture);
+
+	return entry != textures.end() ? entry->second->SRV : nullptr;
+}
+
+
+void TextureStreamer::reportStats() {
+
+	MipStreamingStats s = residency.getStats();
+
+	cout << "TextureStreamer: " << s.numTextures << " textures, resident = " << s.residentBytes / 1024 << " KB of " << s.fullBytes / 1024 << " KB with every level, budget = " << residency.getOptions().budgetBytes / 1024 << " KB" << endl;
+	cout << "TextureStreamer: " << s.missingLevels << " levels missing, " << s.surplusLevels << " levels cached beyond need, " << s.totalLoads << " loads, " << s.totalEvictions << " evictions" << endl;
+	cout << "TextureStreamer: last update " << fixed << setprecision(3) << uploadMsLastFrame << "ms (residency " << s.updateMs << "ms), max = " << maxUploadMs << "ms per frame" << endl;
+	cout.unsetf(ios::floatfield);
+}
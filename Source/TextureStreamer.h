@@ -0,0 +1,76 @@
+
+//
+// TextureStreamer.h
+//
+
+// Mip level streaming of dds textures (usually textures cooked with full mip chains by the AssetCooker).  Each texture is memory mapped and created with only its startup levels.  Every frame the objects using a texture request the level they need (see MipResidency::requestView) and update() recreates the textures whose levels the MipResidency decided to load or evict with their new most detailed level.  Levels are uploaded straight from the mapped file (see Texture::createDDSTexture) so the GPU only holds the resident levels and nothing is copied on the heap.
+// Owners are given the resource view of each texture through its callback whenever it is recreated and must stop using the previous view, which is released.
+
+#pragma once
+#include <d3d11_2.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include <MipResidency.h>
+#include <MappedFile.h>
+
+
+class TextureStreamer {
+
+public:
+
+	typedef std::function<void(ID3D11ShaderResourceView*)>	ViewCallback;
+
+private:
+
+	struct StreamedTexture {
+		std::wstring					filename;
+		std::unique_ptr<MappedFile>		file;
+		ID3D11Texture2D					*texture = nullptr;
+		ID3D11ShaderResourceView		*SRV = nullptr;
+		ViewCallback					onViewChanged;
+	};
+
+	ID3D11Device						*device = nullptr;
+	MipResidency						residency;
+	std::map<uint32_t, StreamedTexture*>	textures; // Keyed by MipResidency texture id
+	std::vector<MipRequest>				loads;
+	std::vector<MipRequest>				evictions;
+
+	// Main thread time spent recreating textures
+	double								uploadMsLastFrame = 0.0;
+	double								maxUploadMs = 0.0;
+
+	// Recreate the texture with levels topLevel and coarser and pass the new view to its owner
+	HRESULT createLevels(StreamedTexture *streamed, uint32_t topLevel);
+
+public:
+
+	TextureStreamer(ID3D11Device *_device, const MipStreamingOptions& options = MipStreamingOptions()) : device(_device), residency(options) {};
+	~TextureStreamer();
+
+	// Map a dds file and create its startup levels.  onViewChanged is called with the first view before addTexture returns and again each time levels are loaded or evicted.  Returns the texture id or 0 if the file is not a valid dds file (the caller should load the texture another way).
+	uint32_t addTexture(const std::wstring& filename, ViewCallback onViewChanged);
+
+	// Release a texture and unmap its file
+	void removeTexture(uint32_t texture);
+
+	// Call before the objects of the frame request their levels
+	void beginFrame() { residency.beginFrame(); };
+
+	// Record a use of the texture this frame (see MipResidency::requestView)
+	void requestView(uint32_t texture, float uvDensity, float distance, float screenScale) { residency.requestView(texture, uvDensity, distance, screenScale); };
+
+	// Load and evict the levels decided by the MipResidency for this frame.  Call once per frame on the main thread after the requests.
+	void update();
+
+	ID3D11ShaderResourceView *getShaderResourceView(uint32_t texture);
+	MipStreamingStats getStats() { return residency.getStats(); };
+	void setBudget(size_t budgetBytes) { residency.setBudget(budgetBytes); };
+
+	// Print the resident, full and budget sizes, missing levels and load / eviction counts
+	void reportStats();
+};
@@ -61,7 +61,7 @@ HRESULT Triangle::init(ID3D11Device *device) {
 
 
 
-void Triangle::render(ID3D11DeviceContext *context) {
+void Triangle::render(StateTrackingContext *context) {
 
 	// Validate object before rendering 
 	if (!context || !vertexBuffer )
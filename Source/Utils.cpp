@@ -17,6 +17,19 @@ HRESULT mapCbuffer(ID3D11DeviceContext *context,void *cBufferCPU, ID3D11Buffer *
 	return hr;
 }
 
+// Mapping does not change the bound state - the wrapper passes the Map straight through and counts it
+HRESULT mapCbuffer(StateTrackingContext *context, void *cBufferCPU, ID3D11Buffer *cBufferGPU, int buffSize)
+{
+	D3D11_MAPPED_SUBRESOURCE res;
+	HRESULT hr = context->Map(cBufferGPU, 0, D3D11_MAP_WRITE_DISCARD, 0, &res);
+
+	if (SUCCEEDED(hr)) {
+		memcpy(res.pData, cBufferCPU, buffSize);
+		context->Unmap(cBufferGPU, 0);
+	}
+	return hr;
+}
+
 // from terrain tutorial
 // Helper Generates random number between -1.0 and +1.0
 float randM1P1()
@@ -29,65 +42,27 @@ float randM1P1()
 	return r / 6;
 }
 
-// Helper to load a compiled shader
+// Helper to load a compiled shader into a block allocated with malloc (freed by the caller).  Effects share shaders loaded once through a ShaderLibrary instead.
 uint32_t LoadShader(const char *filename, char **bytecode)
 {
+	// Validate parameters
+	if (!filename || !bytecode)
+		throw exception("loadCSO: Invalid parameters");
 
-	ifstream	*fp = nullptr;
-	uint32_t shaderBytes = -1;
-	cout << "loading shader" << endl;
-
-	try
-	{
-		// Validate parameters
-		if (!filename)
-			throw exception("loadCSO: Invalid parameters");
-
-		// Open file
-		fp = new ifstream(filename, ios::in | ios::binary);
-
-		if (!fp->is_open())
-			throw exception("loadCSO: Cannot open file");
-
-		// Get file size
-		fp->seekg(0, ios::end);
-		shaderBytes = (uint32_t)fp->tellg();
+	ifstream file(filename, ios::in | ios::binary | ios::ate);
 
-		// Create blob object to store bytecode (exceptions propagate up if any occur)
-		//memBlock = new DXBlob(size);
-		cout << "allocating shader memory bytes = " << shaderBytes << endl;
-		*bytecode = (char*)malloc(shaderBytes);
-		// Read binary data into blob object
-		fp->seekg(0, ios::beg);
-		fp->read(*bytecode, shaderBytes);
+	if (!file.is_open()) {
 
-		// Close file and release local resources
-		fp->close();
-		delete fp;
-
-		// Return DXBlob - ownership implicity passed to caller
-		//*bytecode = memBlock;
-		cout << "Done: shader memory bytes = " << shaderBytes << endl;
+		cout << "loadCSO: Cannot open file " << filename << endl;
+		throw exception("loadCSO: Cannot open file");
 	}
-	catch (exception& e)
-	{
-		cout << e.what() << endl;
-
-		// Cleanup local resources
-		if (fp) {
 
-			if (fp->is_open())
-				fp->close();
+	uint32_t shaderBytes = (uint32_t)file.tellg();
 
-			delete fp;
-		}
+	*bytecode = (char*)malloc(shaderBytes);
+	file.seekg(0, ios::beg);
+	file.read(*bytecode, shaderBytes);
 
-		if (bytecode)
-			delete bytecode;
-
-		// Re-throw exception
-		throw;
-	}
 	return shaderBytes;
 }
 
@@ -2,6 +2,7 @@
 #include <d3d11_2.h>
 #include <DirectXMath.h>
 #include <DirectXPackedVector.h>
+#include <MeshQuantiser.h>
 
 struct BasicVertexStruct {
 	DirectX::XMFLOAT3					pos;
@@ -34,6 +35,34 @@ static const D3D11_INPUT_ELEMENT_DESC extVertexDesc[] = {
 	{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 32, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 };
 
+// Vertex input descriptor based on QuantisedVertexStruct (see MeshQuantiser.h).  Model shaders decode position with the dequantisation constants in the model cbuffer and unpack the octahedral normal
+static const D3D11_INPUT_ELEMENT_DESC quantisedVertexDesc[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+// Per-instance data of an InstancedModel - the world matrix and its inverse transpose (as in the model cbuffer)
+struct InstanceStruct {
+	DirectX::XMFLOAT4X4					worldMatrix;
+	DirectX::XMFLOAT4X4					worldITMatrix;
+};
+
+// quantisedVertexDesc with InstanceStruct rows in slot 1 stepped once per instance (for the INSTANCED model shader variants)
+static const D3D11_INPUT_ELEMENT_DESC instancedQuantisedVertexDesc[] = {
+	{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLDIT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLDIT", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLDIT", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	{ "WORLDIT", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+};
+
 struct ParticleVertexStruct {
 	DirectX::XMFLOAT3 pos;
 	DirectX::XMFLOAT3 posL;
@@ -54,10 +83,12 @@ struct FlareVertexStruct {
 	DirectX::XMFLOAT3 pos;
 	DirectX::XMFLOAT3 posL;
 	DirectX::PackedVector::XMCOLOR		colour;
+	DirectX::XMFLOAT4 texRect; // Texture coordinate scale (xy) and offset (zw) of the flare in an atlas (see TextureAtlas.h)
 };
 
 static const D3D11_INPUT_ELEMENT_DESC flareVertexDesc[] = {
 { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 { "LPOS", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+{ "TEXRECT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 28, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 };
@@ -0,0 +1,95 @@
+// Bounds tests - the SIMD local bounds reduction and world bounds refresh against the scalar references
+
+#include "EngineTests.h"
+#include "TestScenes.h"
+#include <Bounds.h>
+#include <algorithm>
+#include <random>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+
+// Relative difference of two bounds (0 if they match)
+static float boundsDifference(const Bounds& a, const Bounds& b) {
+
+	float scale = 1.0f, diff = 0.0f;
+
+	for (int i = 0; i < 3; ++i) {
+
+		scale = max(scale, fabsf(a.boxCentre[i]) + fabsf(a.boxExtents[i]));
+		diff = max(diff, fabsf(a.boxCentre[i] - b.boxCentre[i]));
+		diff = max(diff, fabsf(a.boxExtents[i] - b.boxExtents[i]));
+		diff = max(diff, fabsf(a.sphereCentre[i] - b.sphereCentre[i]));
+	}
+
+	diff = max(diff, fabsf(a.sphereRadius - b.sphereRadius));
+
+	return diff / scale;
+}
+
+
+bool testBounds(size_t numObjects) {
+
+	const float tolerance = 1e-5f;
+
+	mt19937 random(1234);
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	bool passed = true;
+
+	// Local bounds - min / max reduction over a large vertex buffer
+	vector<MeshVertex> vertices(1000000);
+
+	for (MeshVertex& v : vertices)
+		for (int i = 0; i < 3; ++i)
+			v.pos[i] = unit(random) * (10.0f + 5.0f * i);
+
+	float reductionDifference = boundsDifference(computeBoundsScalar(vertices[0].pos, vertices.size(), sizeof(MeshVertex)), computeBounds(vertices.data(), vertices.size()));
+
+	// Tightly packed positions exercise the partial load of the last vertex
+	vector<float> packed(3 * 1001);
+
+	for (float& f : packed)
+		f = unit(random);
+
+	float packedDifference = boundsDifference(computeBoundsScalar(packed.data(), 1001, 3 * sizeof(float)), computeBounds(packed.data(), 1001, 3 * sizeof(float)));
+
+	cout << "Bounds of " << vertices.size() << " vertices: max difference = " << reductionDifference << ", of 1001 packed positions: " << packedDifference << endl;
+
+	if (reductionDifference > tolerance || packedDifference > tolerance) {
+
+		cout << "  The SIMD reduction differs from the scalar reduction" << endl;
+		passed = false;
+	}
+
+	// World bounds - the batch and single object refresh against projecting the 8 corners
+	vector<Bounds> local, world(numObjects), single(numObjects);
+	vector<float> matrices;
+	randomTransformedBounds(numObjects, random, local, matrices);
+
+	transformBounds(local.data(), matrices.data(), world.data(), numObjects);
+
+	for (size_t i = 0; i < numObjects; ++i)
+		single[i] = transformBounds(local[i], &matrices[i * 16]);
+
+	float refreshDifference = 0.0f, singleDifference = 0.0f;
+
+	for (size_t i = 0; i < numObjects; ++i) {
+
+		Bounds reference = transformBoundsCorners(local[i], &matrices[i * 16]);
+		refreshDifference = max(refreshDifference, boundsDifference(reference, world[i]));
+		singleDifference = max(singleDifference, boundsDifference(reference, single[i]));
+	}
+
+	cout << "World bounds refresh of " << numObjects << " objects: max difference = " << refreshDifference << ", one object at a time: " << singleDifference << endl;
+
+	if (refreshDifference > tolerance || singleDifference > tolerance) {
+
+		cout << "  The world bounds differ from the transformed corners" << endl;
+		passed = false;
+	}
+
+	return passed;
+}
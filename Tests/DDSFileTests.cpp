@@ -0,0 +1,379 @@
+
+// DDSFile tests - layouts are checked against files built here from the dds header definitions (see dds.h) rather than the reader's own tables
+
+#include "EngineTests.h"
+#include <DDSFile.h>
+#include <MappedFile.h>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+// Header flags (see dds.h)
+static const uint32_t DDSFlagsTexture = 0x00001007; // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+static const uint32_t DDSFlagMipMapCount = 0x00020000;
+static const uint32_t DDSFlagDepth = 0x00800000;
+static const uint32_t DDSPixelFormatFourCC = 0x00000004;
+static const uint32_t DDSPixelFormatRGBA = 0x00000041; // DDPF_RGB | DDPF_ALPHAPIXELS
+static const uint32_t DDSPixelFormatRGB = 0x00000040;
+static const uint32_t DDSCapsTexture = 0x00001000;
+static const uint32_t DDSCapsComplex = 0x00000008;
+static const uint32_t DDSCapsMipMap = 0x00400000;
+static const uint32_t DDSCaps2CubeMap = 0x00000200;
+static const uint32_t DDSCaps2CubeMapAllFaces = 0x0000fc00;
+static const uint32_t DDSCaps2Volume = 0x00200000;
+
+
+static uint32_t makeFourCC(char a, char b, char c, char d) {
+
+	return (uint32_t)(uint8_t)a | ((uint32_t)(uint8_t)b << 8) | ((uint32_t)(uint8_t)c << 16) | ((uint32_t)(uint8_t)d << 24);
+}
+
+
+// A dds file in memory with a legacy header and dataBytes of pixel data
+static vector<uint8_t> makeLegacyDDS(const DDSPixelFormat& pf, uint32_t width, uint32_t height, uint32_t depth, uint32_t mipLevels, uint32_t caps2, size_t dataBytes) {
+
+	DDSHeader header;
+	memset(&header, 0, sizeof(DDSHeader));
+
+	header.size = sizeof(DDSHeader);
+	header.flags = DDSFlagsTexture | DDSFlagMipMapCount | (depth > 1 ? DDSFlagDepth : 0);
+	header.width = width;
+	header.height = height;
+	header.depth = depth;
+	header.mipMapCount = mipLevels;
+	header.ddspf = pf;
+	header.ddspf.size = sizeof(DDSPixelFormat);
+	header.caps = DDSCapsTexture | DDSCapsComplex | DDSCapsMipMap;
+	header.caps2 = caps2;
+
+	vector<uint8_t> file(4 + sizeof(DDSHeader) + dataBytes);
+	memcpy(file.data(), &DDSMagic, sizeof(uint32_t));
+	memcpy(file.data() + 4, &header, sizeof(DDSHeader));
+
+	return file;
+}
+
+
+// Subresources must follow each other from the end of the header to the end of the file
+static bool checkLayout(const string& name, const DDSInfo& info, const vector<DDSSubresource>& subresources, size_t size) {
+
+	size_t offset = info.dataOffset;
+
+	for (const DDSSubresource& subresource : subresources) {
+
+		if (subresource.offset != offset) {
+
+			cout << "  " << name << ": subresource at " << subresource.offset << " instead of " << offset << endl;
+			return false;
+		}
+
+		offset += (size_t)subresource.slicePitch * subresource.depth;
+	}
+
+	if (offset != size) {
+
+		cout << "  " << name << ": subresources end at " << offset << " of " << size << " bytes" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+static bool checkLegacyLayouts() {
+
+	struct LegacyCase {
+		const char						*name;
+		DDSPixelFormat					pf;
+		uint32_t						width, height, depth, mipLevels, caps2;
+		uint32_t						format; // Expected DXGI_FORMAT, 0 if the file must be rejected
+		uint32_t						numSubresources;
+		size_t							dataBytes;
+	};
+
+	const DDSPixelFormat dxt5 = { 0, DDSPixelFormatFourCC, makeFourCC('D', 'X', 'T', '5'), 0, 0, 0, 0, 0 };
+	const DDSPixelFormat dxt1 = { 0, DDSPixelFormatFourCC, makeFourCC('D', 'X', 'T', '1'), 0, 0, 0, 0, 0 };
+	const DDSPixelFormat bgra = { 0, DDSPixelFormatRGBA, 0, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
+	const DDSPixelFormat bgrx = { 0, DDSPixelFormatRGB, 0, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0 };
+	const DDSPixelFormat rgba = { 0, DDSPixelFormatRGBA, 0, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 };
+	const DDSPixelFormat b5g6r5 = { 0, DDSPixelFormatRGB, 0, 16, 0xf800, 0x07e0, 0x001f, 0 };
+	const DDSPixelFormat bgr = { 0, DDSPixelFormatRGB, 0, 24, 0xff0000, 0x00ff00, 0x0000ff, 0 };
+
+	// Data sizes worked out by hand
+	const LegacyCase cases[] = {
+		{ "DXT5 128x64, 8 levels", dxt5, 128, 64, 1, 8, 0, 77, 8, 8192 + 2048 + 512 + 128 + 32 + 16 * 3 },
+		{ "DXT1 100x60", dxt1, 100, 60, 1, 1, 0, 71, 1, 25 * 15 * 8 },
+		{ "B8G8R8A8 256x256, 9 levels", bgra, 256, 256, 1, 9, 0, 87, 9, 4 * (65536 + 16384 + 4096 + 1024 + 256 + 64 + 16 + 4 + 1) },
+		{ "B8G8R8X8 16x16 cube map, 5 levels", bgrx, 16, 16, 1, 5, DDSCaps2CubeMap | DDSCaps2CubeMapAllFaces, 88, 30, 6 * 4 * (256 + 64 + 16 + 4 + 1) },
+		{ "R8G8B8A8 8x8x4 volume, 3 levels", rgba, 8, 8, 4, 3, DDSCaps2Volume, 28, 3, 4 * (8 * 8 * 4 + 4 * 4 * 2 + 2 * 2) },
+		{ "B5G6R5 10x6", b5g6r5, 10, 6, 1, 1, 0, 85, 1, 10 * 6 * 2 },
+		{ "24 bit RGB 8x8", bgr, 8, 8, 1, 1, 0, 0, 0, 8 * 8 * 3 },
+	};
+
+	bool passed = true;
+
+	for (const LegacyCase& c : cases) {
+
+		vector<uint8_t> file = makeLegacyDDS(c.pf, c.width, c.height, c.depth, c.mipLevels, c.caps2, c.dataBytes);
+		DDSInfo info = readDDSInfo(file.data(), file.size());
+
+		if (info.format != c.format) {
+
+			cout << "  " << c.name << ": format " << info.format << " instead of " << c.format << endl;
+			passed = false;
+			continue;
+		}
+
+		if (c.format == 0) {
+
+			try
+			{
+				getDDSSubresources(info, file.size());
+
+				cout << "  " << c.name << ": unsupported format accepted" << endl;
+				passed = false;
+			}
+			catch (exception&) {}
+
+			continue;
+		}
+
+		vector<DDSSubresource> subresources = getDDSSubresources(info, file.size());
+
+		if (subresources.size() != c.numSubresources) {
+
+			cout << "  " << c.name << ": " << subresources.size() << " subresources instead of " << c.numSubresources << endl;
+			passed = false;
+		}
+		else
+			passed &= checkLayout(c.name, info, subresources, file.size());
+
+		// One byte short of the last subresource
+		try
+		{
+			getDDSSubresources(info, file.size() - 1);
+
+			cout << "  " << c.name << ": truncated file accepted" << endl;
+			passed = false;
+		}
+		catch (exception&) {}
+	}
+
+	// Headers cut short
+	vector<uint8_t> file = makeLegacyDDS(bgra, 4, 4, 1, 1, 0, 64);
+
+	for (size_t size : { (size_t)0, (size_t)4, 4 + sizeof(DDSHeader) - 1, 4 + sizeof(DDSHeader) }) {
+
+		try
+		{
+			readDDSInfo(file.data(), size);
+
+			cout << "  " << size << " byte dds file accepted" << endl;
+			passed = false;
+		}
+		catch (exception&) {}
+	}
+
+	return passed;
+}
+
+
+// Write files with the cooker's writers and find every level's data again through the mapping
+static bool checkWrittenLayouts() {
+
+	const string filename = "test.dds";
+	bool passed = true;
+
+	// R8G8B8A8 mip chain of odd sizes
+	vector<ImageData> mips;
+
+	for (uint32_t width = 37, height = 19; ; width = max(1u, width / 2), height = max(1u, height / 2)) {
+
+		ImageData mip;
+		mip.width = width;
+		mip.height = height;
+		mip.pixels.resize((size_t)width * height * 4);
+
+		for (size_t i = 0; i < mip.pixels.size(); ++i)
+			mip.pixels[i] = (uint8_t)(i * 7 + mips.size() * 31);
+
+		mips.push_back(mip);
+
+		if (width == 1 && height == 1)
+			break;
+	}
+
+	// BC1 texture array of 3 slices, 4 levels each
+	vector<vector<vector<uint8_t>>> slices(3);
+
+	for (size_t slice = 0; slice < slices.size(); ++slice) {
+
+		for (uint32_t level = 0; level < 4; ++level) {
+
+			vector<uint8_t> blocks((size_t)((max(1u, 64u >> level) + 3) / 4) * ((max(1u, 40u >> level) + 3) / 4) * 8);
+
+			for (size_t i = 0; i < blocks.size(); ++i)
+				blocks[i] = (uint8_t)(i * 13 + slice * 17 + level * 5);
+
+			slices[slice].push_back(blocks);
+		}
+	}
+
+	for (int test = 0; test < 2; ++test) {
+
+		const char *name = test == 0 ? "R8G8B8A8 37x19 mip chain" : "BC1 64x40 array of 3";
+
+		if (test == 0)
+			writeDDS(filename, mips);
+		else
+			writeDDS(filename, 64, 40, 71, 8, slices);
+
+		{
+			MappedFile file(filename);
+
+			if (!file.isValid()) {
+
+				cout << "  cannot map " << filename << endl;
+				passed = false;
+				break;
+			}
+
+			DDSInfo info = readDDSInfo(file.getData(), file.getSize());
+			vector<DDSSubresource> subresources = getDDSSubresources(info, file.getSize());
+
+			vector<const vector<uint8_t>*> expected;
+
+			if (test == 0) {
+
+				for (const ImageData& mip : mips)
+					expected.push_back(&mip.pixels);
+			}
+			else {
+
+				for (const vector<vector<uint8_t>>& slice : slices)
+					for (const vector<uint8_t>& level : slice)
+						expected.push_back(&level);
+			}
+
+			if (info.format != (test == 0 ? 28u : 71u) || subresources.size() != expected.size()) {
+
+				cout << "  " << name << ": format " << info.format << ", " << subresources.size() << " subresources" << endl;
+				passed = false;
+				continue;
+			}
+
+			passed &= checkLayout(name, info, subresources, file.getSize());
+
+			for (size_t i = 0; i < subresources.size(); ++i) {
+
+				const DDSSubresource& subresource = subresources[i];
+				uint32_t rows = test == 0 ? subresource.height : (subresource.height + 3) / 4;
+
+				if (subresource.rowPitch * rows != expected[i]->size() || subresource.offset + expected[i]->size() > file.getSize() || memcmp(file.getData() + subresource.offset, expected[i]->data(), expected[i]->size()) != 0) {
+
+					cout << "  " << name << ": subresource " << i << " does not hold the data written" << endl;
+					passed = false;
+					break;
+				}
+			}
+		}
+	}
+
+	remove(filename.c_str());
+
+	return passed;
+}
+
+
+bool testDDSLoading(const vector<string>& filenames) {
+
+	bool passed = checkLegacyLayouts() & checkWrittenLayouts();
+
+	// Every byte is summed as the GPU upload reads every byte of the subresource data
+	double mappedSeconds = 1e9, readSeconds = 1e9;
+	size_t bytes = 0, largest = 0, numSubresources = 0;
+
+	for (int run = 0; run < 3; ++run) {
+
+		uint64_t mappedSum = 0, readSum = 0;
+		bytes = largest = numSubresources = 0;
+
+		auto start = chrono::steady_clock::now();
+
+		for (const string& filename : filenames) {
+
+			MappedFile file(filename);
+
+			if (!file.isValid()) {
+
+				cout << "  cannot map " << filename << endl;
+				return false;
+			}
+
+			try
+			{
+				DDSInfo info = readDDSInfo(file.getData(), file.getSize());
+				vector<DDSSubresource> subresources = getDDSSubresources(info, file.getSize());
+
+				for (const DDSSubresource& subresource : subresources) {
+
+					const uint8_t *data = file.getData() + subresource.offset;
+
+					for (size_t i = 0; i < (size_t)subresource.slicePitch * subresource.depth; ++i)
+						mappedSum += data[i];
+				}
+
+				numSubresources += subresources.size();
+			}
+			catch (exception& e)
+			{
+				cout << "  " << filename << ": " << e.what() << endl;
+				return false;
+			}
+
+			bytes += file.getSize();
+			largest = max(largest, file.getSize());
+		}
+
+		mappedSeconds = min(mappedSeconds, secondsSince(start));
+
+		start = chrono::steady_clock::now();
+
+		for (const string& filename : filenames) {
+
+			ifstream file(filename, ios::binary | ios::ate);
+			vector<uint8_t> buffer((size_t)file.tellg());
+
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+
+			DDSInfo info = readDDSInfo(buffer.data(), buffer.size());
+
+			for (const DDSSubresource& subresource : getDDSSubresources(info, buffer.size()))
+				for (size_t i = 0; i < (size_t)subresource.slicePitch * subresource.depth; ++i)
+					readSum += buffer[subresource.offset + i];
+		}
+
+		readSeconds = min(readSeconds, secondsSince(start));
+
+		if (mappedSum != readSum) {
+
+			cout << "  mapped and read files differ" << endl;
+			passed = false;
+		}
+	}
+
+	cout << fixed << setprecision(2);
+	cout << filenames.size() << " dds files, " << bytes / 1024 << " KB, " << numSubresources << " subresources" << endl;
+	cout << "  mapped: " << mappedSeconds * 1000.0 << " ms, 0 KB copied; read into a buffer: " << readSeconds * 1000.0 << " ms, " << bytes / 1024 << " KB copied (" << largest / 1024 << " KB peak heap)" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return passed;
+}
@@ -0,0 +1,94 @@
+
+//
+// EngineTests.cpp
+//
+
+// Test driver registered with CTest - each CTest test runs one named test from the repository root so the files under Resources and Shaders are found.  The tests and the mock Direct3D objects they use are only built here, never into the application.
+//
+// Usage: EngineTests [test names]   (all tests are run if no names are given)
+
+#include "EngineTests.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <exception>
+
+using namespace std;
+
+
+struct EngineTest {
+	const char							*name;
+	const char							*description;
+	function<bool()>					run;
+};
+
+
+int main(int argc, char **argv) {
+
+	vector<EngineTest> tests = {
+		{ "dds", "Subresource layouts of written, legacy and truncated dds files and mapped against buffered loading of the dds textures", []() { return testDDSLoading({ "Resources/Textures/Waves.dds", "Resources/Textures/WoodCrate01.dds" }); } },
+		{ "statecache", "Sharing of state objects with equal descriptions through StateObjectCache with a mock device", []() { return testStateCache(); } },
+		{ "statetracking", "State calls of the scene and of random call sequences filtered by StateTracker against unfiltered calls to a mock context", []() { return testStateTracker(); } },
+		{ "shaderpermutations", "Permutation axes of the HLSL files and lookup of the compiled shader variants by key against by name", []() { return testShaderPermutations("Shaders/hlsl"); } },
+		{ "renderqueue", "Radix sort checks, key order and state changes of the scene draw list and 10k random draws in submission and sorted order", []() { return testRenderQueue(); } },
+		{ "culling", "Vector and scalar frustum culling of 10k, 100k and 1M object boxes and spheres from 8 random cameras, checking the vector result against the scalar reference", []() { return testFrustumCulling({ 10000, 100000, 1000000 }); } },
+		{ "bounds", "SIMD local bounds of 1M vertices and world bounds refresh of 100k transformed objects against the scalar references", []() { return testBounds(100000); } },
+		{ "meshlets", "Triangle partition of the castle and shark meshlets and their draw ranges and normal cone culling from orbiting cameras", []() { return testMeshlets({ "Resources/Models/castle.3DS", "Resources/Models/Shark.obj" }); } },
+		{ "texturecompression", "Constant blocks, threaded against single threaded compression and PSNR of an opaque and an alpha texture in every block format", []() { return testTextureCompression({ "Resources/Models/Bridge/Brick_DIFFUSE.jpg", "Resources/Textures/tree.tif" }); } },
+		{ "mips", "Box / Kaiser / Lanczos SSE against scalar and threaded mips, constant images and alpha coverage of an opaque and a foliage texture", []() { return testMipGeneration({ "Resources/Models/Bridge/Brick_DIFFUSE.jpg", "Resources/Textures/tree.tif" }); } },
+		{ "texturedecode", "Serial against parallel decode and mip generation of every texture under Resources/Textures", []() { return testTextureDecode("Resources/Textures"); } },
+		{ "mipstreaming", "Level estimates and budget, eviction and settling of the mip residency of 1000 streamed textures while the camera crosses the scene", []() { return testMipResidency(1000); } },
+		{ "atlas", "Placement, bleeding and remapping tables of rectangle and array atlases of the scene sprites and of a set of flare sprites", []() { return testTextureAtlas({ "flares/divine.png", "flares/extendring.png", "Fire.tif", "smoke.tif" }) & testTextureAtlas({ "flares/aura.png", "flares/corona.png", "flares/hexagon.png", "flares/iris.png", "flares/nova.png", "flares/pollen.png", "flares/ring.png", "flares/sparkle.png", "flares/star.png", "flares/sun.png", "fur.png", "tree.tif" }); } },
+		{ "shaderbytecode", "Shared mappings, hashes and statistics of a shader bytecode store loading generated shader files", []() { return testShaderBytecode(); } },
+		{ "bvh", "Frustum, ray and sphere queries of a BVH over 100k moving objects against testing every object through refits, insertions, removals and background rebuilds", []() { return testSceneBVH(100000); } },
+	};
+
+	vector<string> selected(argv + 1, argv + argc);
+
+	if (!selected.empty() && (selected[0] == "-h" || selected[0] == "--help")) {
+
+		cout << "Usage: EngineTests [test names]" << endl;
+
+		for (const EngineTest& test : tests)
+			cout << "  " << test.name << " - " << test.description << endl;
+
+		return 0;
+	}
+
+	bool passed = true;
+	int numRun = 0;
+
+	for (const EngineTest& test : tests) {
+
+		bool run = selected.empty();
+
+		for (const string& name : selected)
+			run |= (name == test.name);
+
+		if (!run)
+			continue;
+
+		cout << endl << "== " << test.name << " ==" << endl;
+
+		try
+		{
+			passed &= test.run();
+		}
+		catch (exception& e)
+		{
+			cout << "  " << e.what() << endl;
+			passed = false;
+		}
+
+		++numRun;
+	}
+
+	if (numRun == 0) {
+
+		cout << "No test matches the given names (see --help)" << endl;
+		return 1;
+	}
+
+	return passed ? 0 : 2;
+}
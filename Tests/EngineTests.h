@@ -0,0 +1,65 @@
+
+//
+// EngineTests.h
+//
+
+// Checks of the platform independent engine code run by EngineTests (see CMakeLists.txt).  Each test returns false if a check fails and prints what it measured.
+
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Subresource layouts of written, legacy, cube map, volume and truncated dds files, then mapping the dds files in filenames and finding their subresources against reading them into a heap buffer
+bool testDDSLoading(const std::vector<std::string>& filenames);
+
+// Request the states of a scene of numObjects objects (a few shared descriptions and some unique ones) from a cache with a mock device and check every description creates exactly one object, equal descriptions share it, failed objects are not cached and every object is released.  Reports the created and requested objects and the request time.
+bool testStateCache(uint32_t numObjects = 10000);
+
+// Replay the state calls of a frame of the scene (effects binding every stage, models rebinding their buffers, samplers and textures, render target changes) and of random call sequences through a StateTracker to a recording mock context and to an unfiltered mock.  Checks the bound state of both mocks is identical at every call and reports the calls issued and filtered.
+bool testStateTracker(uint32_t numRandomCalls = 100000);
+
+// Check the permutation axes declared by the HLSL files in hlslDirectory against shaderFamilies, every compiled variant is found and every other key of each family is not, and compare numLookups lookups against finding the file name in a map.
+bool testShaderPermutations(const std::string& hlslDirectory, uint32_t numLookups = 1000000);
+
+// Sort random draw lists with the radix sort and std::stable_sort and check they agree, check the key order (passes, state grouping, front to back opaque and back to front transparent draws) and compare the state changes of the scene's draw list and of numDraws random draws in submission and sorted order.
+bool testRenderQueue(uint32_t numDraws = 10000);
+
+// Cull random scenes of each object count from cameras looking around the scene with cullBounds and cullBoundsScalar.  Checks both give the same visibility and that every culled box lies behind a plane, and reports the culling rate of each.
+bool testFrustumCulling(const std::vector<size_t>& objectCounts);
+
+// Check the SIMD bounds reduction of 1M vertices and of packed positions against computeBoundsScalar, and the batched and single world bounds refresh of numObjects randomly transformed objects against projecting the 8 corners.  Reports the largest differences.
+bool testBounds(size_t numObjects = 100000);
+
+// Build the meshlets of each model (obj or 3ds) and check every SubMesh keeps its triangles and the meshlets cover every index once, then cull them from cameras orbiting the model and check the draw ranges cover exactly the visible meshlets and no triangle facing the camera is culled by a normal cone.
+bool testMeshlets(const std::vector<std::string>& filenames);
+
+// Check every block format reproduces a constant block, then compress each image into every format and check the threaded blocks equal the single threaded blocks and the PSNR is plausible (above 20 dB).  Reports the PSNR of each format.
+bool testTextureCompression(const std::vector<std::string>& filenames);
+
+// Check every filter keeps a constant image constant, then generate the mips of each image with every filter and check the SSE chain is within 1 of the scalar chain, the threaded chain equals the single threaded chain and alpha scaling keeps the coverage of each level within 5% of the top level.
+bool testMipGeneration(const std::vector<std::string>& filenames);
+
+// Pack the textures under Resources/Textures (named relative to it) in both atlas layouts and check the rectangle layout keeps the sources and their borders apart with exact copies in the top level and no bleeding between neighbours in the mips, and that the remapping table of both layouts reproduces the entries.
+bool testTextureAtlas(const std::vector<std::string>& names);
+
+// Decode every texture under directory (with mips) on 1 and 4 threads and check every file decodes and the parallel results equal the serial results
+bool testTextureDecode(const std::string& directory);
+
+// Check the uv density and mip level estimates, then move a camera through a scene of numTextures streamed textures and check the residency stays within a 16 MB budget, only evicts levels finer than the startup levels and settles with no missing level that a less needed level could make room for.  Also checks an unlimited budget loads every needed level and lowering the budget evicts down to it in one update.
+bool testMipResidency(uint32_t numTextures = 1000);
+
+// Load generated shader files (one a copy of another under a different name) through a ShaderBytecodeStore and check each request returns the file's bytes, each file is mapped once, hashes are equal only for equal bytecode, the statistics count the requests and a missing file throws
+bool testShaderBytecode();
+
+// Build a BVH over numObjects random objects and check frustum, ray and sphere queries against testing every object after building, refitting moving objects until the tree is rebuilt, adding and removing objects and during and after a background rebuild
+bool testSceneBVH(size_t numObjects = 100000);
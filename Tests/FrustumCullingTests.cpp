@@ -0,0 +1,131 @@
+// FrustumCulling tests - the vector culling of random scenes against the scalar reference, with every culled box checked to lie behind a plane
+
+#include "EngineTests.h"
+#include <FrustumCulling.h>
+#include <Meshlet.h>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+using namespace std;
+
+
+// True if every corner of the box is behind one of the planes
+static bool boxBehindPlane(const CullingBounds& bounds, size_t i, const float planes[6][4]) {
+
+	for (int p = 0; p < 6; ++p) {
+
+		double length = sqrt((double)planes[p][0] * planes[p][0] + (double)planes[p][1] * planes[p][1] + (double)planes[p][2] * planes[p][2]);
+		bool allBehind = true;
+
+		for (int corner = 0; corner < 8 && allBehind; ++corner) {
+
+			double x = bounds.centreX[i] + (corner & 1 ? bounds.extentX[i] : -bounds.extentX[i]);
+			double y = bounds.centreY[i] + (corner & 2 ? bounds.extentY[i] : -bounds.extentY[i]);
+			double z = bounds.centreZ[i] + (corner & 4 ? bounds.extentZ[i] : -bounds.extentZ[i]);
+
+			// A corner within rounding of the plane counts as behind
+			allBehind = (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3]) / length < 1e-3;
+		}
+
+		if (allBehind)
+			return true;
+	}
+
+	return false;
+}
+
+
+bool testFrustumCulling(const vector<size_t>& objectCounts) {
+
+	bool passed = true;
+	const int numViews = 8;
+
+	cout << "vector width " << getCullingWidth() << endl;
+
+	for (size_t count : objectCounts) {
+
+		// Objects of 0.5 to 5 units scattered through a 1000 unit cube, a few of them not yet loaded
+		mt19937 random(1);
+		uniform_real_distribution<float> position(-500.0f, 500.0f), size(0.25f, 2.5f), unit(-1.0f, 1.0f);
+		CullingBounds bounds;
+		bounds.resize(count);
+
+		for (size_t i = 0; i < count; ++i) {
+
+			float centre[3] = { position(random), position(random) * 0.1f, position(random) };
+			float extents[3] = { size(random), size(random), size(random) };
+			float corners[8][3];
+
+			for (int corner = 0; corner < 8; ++corner)
+				for (int a = 0; a < 3; ++a)
+					corners[corner][a] = corner & (1 << a) ? centre[a] + extents[a] : centre[a] - extents[a];
+
+			bounds.set(i, random() % 1000 ? computeBounds(&corners[0][0], 8, 3 * sizeof(float)) : emptyBounds());
+		}
+
+		VisibilitySet visibility, reference;
+		double seconds[2][2] = { { 1e9, 1e9 }, { 1e9, 1e9 } };
+		size_t visible[2] = {};
+
+		for (int view = 0; view < numViews; ++view) {
+
+			float eye[3] = { unit(random) * 400.0f, 5.0f, unit(random) * 400.0f };
+			float target[3] = { eye[0] + unit(random), eye[1] + unit(random) * 0.2f, eye[2] + unit(random) };
+			float viewMatrix[16], proj[16], viewProj[16], planes[6][4];
+			lookAtLH(eye, target, viewMatrix);
+			perspectiveFovLH(1.0472f, 16.0f / 9.0f, 0.1f, 300.0f, proj);
+			multiplyMatrices(viewMatrix, proj, viewProj);
+			extractFrustumPlanes(viewProj, planes);
+
+			for (uint32_t shape = CullBoxes; shape <= CullSpheres; ++shape) {
+
+				// Best of 3 for each view
+				double simdSeconds = 1e9, scalarSeconds = 1e9;
+
+				for (int run = 0; run < 3; ++run) {
+
+					auto start = chrono::steady_clock::now();
+					cullBounds(bounds, planes, (CullShape)shape, visibility);
+					simdSeconds = min(simdSeconds, secondsSince(start));
+
+					start = chrono::steady_clock::now();
+					cullBoundsScalar(bounds, planes, (CullShape)shape, reference);
+					scalarSeconds = min(scalarSeconds, secondsSince(start));
+				}
+
+				seconds[shape][0] = min(seconds[shape][0], scalarSeconds);
+				seconds[shape][1] = min(seconds[shape][1], simdSeconds);
+				visible[shape] += visibility.countVisible();
+
+				if (visibility.getWords() != reference.getWords()) {
+
+					cout << "  " << count << " objects: vector and scalar visibility differ" << endl;
+					passed = false;
+				}
+
+				// Culling is conservative - a culled box lies behind a plane (spheres contain the boxes so are checked the same way)
+				for (size_t i = 0; i < count; i += max(count / 10000, (size_t)1))
+					if (!visibility.isVisible(i) && !boxBehindPlane(bounds, i, planes)) {
+
+						cout << "  " << count << " objects: object " << i << " culled while in front of every plane" << endl;
+						passed = false;
+						break;
+					}
+			}
+		}
+
+		cout << fixed << setprecision(2);
+		cout << count << " objects, " << numViews << " views" << endl;
+
+		for (uint32_t shape = CullBoxes; shape <= CullSpheres; ++shape)
+			cout << "  " << (shape == CullBoxes ? "boxes" : "spheres") << ": " << 100.0 * visible[shape] / (count * numViews) << "% visible, scalar " << seconds[shape][0] * 1000.0 << " ms, vector " << seconds[shape][1] * 1000.0 << " ms (" << count / seconds[shape][1] / 1e6 << " M objects/s)" << endl;
+
+		cout.unsetf(ios::floatfield);
+	}
+
+	return passed;
+}
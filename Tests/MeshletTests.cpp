@@ -0,0 +1,174 @@
+// Meshlet tests - the triangle partition of built meshlets and the visible ranges and normal cone culling of orbiting cameras
+
+#include "EngineTests.h"
+#include "TestScenes.h"
+#include <Meshlet.h>
+#include <algorithm>
+#include <iostream>
+#include <exception>
+#include <cmath>
+
+using namespace std;
+
+
+static inline float dot3(const float a[3], const float b[3]) {
+
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline float length3(const float a[3]) {
+
+	return sqrtf(dot3(a, a));
+}
+
+
+// Triangles of an index range rotated so the smallest index is first (the winding is kept) and sorted
+static vector<uint64_t> sortedTriangles(const uint32_t *indices, uint32_t indexCount) {
+
+	vector<uint64_t> keys;
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+
+		uint32_t r = (indices[i] <= indices[i + 1] && indices[i] <= indices[i + 2]) ? 0 : (indices[i + 1] <= indices[i + 2] ? 1 : 2);
+		uint64_t a = indices[i + r], b = indices[i + (r + 1) % 3], c = indices[i + (r + 2) % 3];
+		keys.push_back((a << 42) | (b << 21) | c);
+	}
+
+	sort(keys.begin(), keys.end());
+	return keys;
+}
+
+
+// Number of triangles of meshlets culled by their normal cone from eye that face the camera
+static uint32_t countFacingConeCulled(const MeshData& mesh, const float eye[3]) {
+
+	uint32_t facing = 0;
+
+	for (const Meshlet& meshlet : mesh.meshlets) {
+
+		float toCentre[3] = { meshlet.centre[0] - eye[0], meshlet.centre[1] - eye[1], meshlet.centre[2] - eye[2] };
+
+		if (meshlet.coneCutoff >= 1.0f || dot3(toCentre, meshlet.coneAxis) < meshlet.coneCutoff * length3(toCentre) + meshlet.radius)
+			continue;
+
+		const MeshVertex *vertices = &mesh.vertices[mesh.lods[0].subMeshes[meshlet.subMesh].baseVertex];
+
+		for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+
+			const float *a = vertices[mesh.indices[i]].pos, *b = vertices[mesh.indices[i + 1]].pos, *c = vertices[mesh.indices[i + 2]].pos;
+			float e0[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] }, e1[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			float vertexNormal[3];
+
+			for (int j = 0; j < 3; ++j)
+				vertexNormal[j] = vertices[mesh.indices[i]].normal[j] + vertices[mesh.indices[i + 1]].normal[j] + vertices[mesh.indices[i + 2]].normal[j];
+
+			float sign = dot3(n, vertexNormal) < 0.0f ? -1.0f : 1.0f;
+			float toTriangle[3] = { a[0] - eye[0], a[1] - eye[1], a[2] - eye[2] };
+
+			if (sign * dot3(n, toTriangle) < -1e-4f * length3(n) * length3(toTriangle))
+				++facing;
+		}
+	}
+
+	return facing;
+}
+
+
+static bool testMeshletModel(const string& filename) {
+
+	MeshData mesh;
+	importTestModel(filename, mesh);
+
+	// Keep the original triangles to check the reordered index ranges
+	vector<vector<uint64_t>> original;
+
+	for (const SubMesh& subMesh : mesh.lods[0].subMeshes)
+		original.push_back(sortedTriangles(&mesh.indices[subMesh.firstIndex], subMesh.indexCount));
+
+	MeshletBuildStats buildStats = buildMeshlets(mesh);
+
+	bool passed = true;
+
+	cout << filename << ": " << buildStats.numTriangles << " triangles -> " << buildStats.numMeshlets << " meshlets" << endl;
+
+	// Every triangle of each SubMesh must still be present exactly once
+	for (size_t s = 0; s < original.size(); ++s) {
+
+		const SubMesh& subMesh = mesh.lods[0].subMeshes[s];
+
+		if (original[s] != sortedTriangles(&mesh.indices[subMesh.firstIndex], subMesh.indexCount)) {
+
+			cout << "  SubMesh " << s << " does not hold its original triangles" << endl;
+			passed = false;
+		}
+	}
+
+	uint32_t coveredIndices = 0;
+
+	for (const Meshlet& meshlet : mesh.meshlets)
+		coveredIndices += meshlet.indexCount;
+
+	if (coveredIndices != buildStats.numTriangles * 3) {
+
+		cout << "  The meshlets cover " << coveredIndices << " of " << buildStats.numTriangles * 3 << " indices" << endl;
+		passed = false;
+	}
+
+	// The merged ranges must cover exactly the visible meshlets and the normal cones must only cull triangles facing away
+	const int numViews = 64;
+	uint32_t rangeMismatches = 0, facingCulled = 0;
+
+	for (bool inside : { false, true }) {
+
+		for (const TestView& view : orbitViews(mesh, inside, numViews)) {
+
+			MeshletCullStats stats;
+			vector<IndexRange> ranges;
+			cullMeshlets(mesh.meshlets.data(), mesh.meshlets.size(), mesh.lods[0].subMeshes.data(), view.planes, view.eye, ranges, &stats);
+
+			uint32_t rangeTriangles = 0;
+
+			for (const IndexRange& range : ranges)
+				rangeTriangles += range.indexCount / 3;
+
+			rangeMismatches += rangeTriangles != stats.visibleTriangles;
+			facingCulled += countFacingConeCulled(mesh, view.eye);
+		}
+	}
+
+	if (rangeMismatches) {
+
+		cout << "  The draw ranges of " << rangeMismatches << " of " << 2 * numViews << " views do not cover the visible meshlets" << endl;
+		passed = false;
+	}
+
+	if (facingCulled) {
+
+		cout << "  " << facingCulled << " triangles facing the camera were culled by their normal cone" << endl;
+		passed = false;
+	}
+
+	return passed;
+}
+
+
+bool testMeshlets(const vector<string>& filenames) {
+
+	bool passed = true;
+
+	for (const string& filename : filenames) {
+
+		try
+		{
+			passed &= testMeshletModel(filename);
+		}
+		catch (exception& e)
+		{
+			cout << "Cannot import " << filename << ": " << e.what() << endl;
+			passed = false;
+		}
+	}
+
+	return passed;
+}
@@ -0,0 +1,161 @@
+// MipGenerator tests - the SSE filters against the scalar filters, threaded against single threaded generation, constant images and alpha coverage
+
+#include "EngineTests.h"
+#include <MipGenerator.h>
+#include <ImageImporter.h>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+
+
+static const MipFilter testFilters[] = { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos };
+
+
+// Largest difference of any channel between two mip chains
+static int chainDifference(const vector<ImageData>& a, const vector<ImageData>& b) {
+
+	if (a.size() != b.size())
+		return 256;
+
+	int difference = 0;
+
+	for (size_t level = 0; level < a.size(); ++level) {
+
+		if (a[level].pixels.size() != b[level].pixels.size())
+			return 256;
+
+		for (size_t i = 0; i < a[level].pixels.size(); ++i)
+			difference = max(difference, abs(a[level].pixels[i] - b[level].pixels[i]));
+	}
+
+	return difference;
+}
+
+
+// Every filter must keep a constant image constant (the weights sum to 1)
+static bool testConstantImage() {
+
+	bool passed = true;
+
+	ImageData constant;
+	constant.width = 67;
+	constant.height = 45;
+	constant.pixels.resize((size_t)constant.width * constant.height * 4);
+
+	for (size_t i = 0; i < constant.pixels.size(); ++i)
+		constant.pixels[i] = (uint8_t)(40 + 50 * (i & 3));
+
+	for (MipFilter filter : testFilters) {
+
+		MipOptions options;
+		options.filter = filter;
+
+		vector<ImageData> mips = generateMipChain(constant, options);
+		int difference = 0;
+
+		for (const ImageData& mip : mips)
+			for (size_t i = 0; i < mip.pixels.size(); ++i)
+				difference = max(difference, abs(mip.pixels[i] - constant.pixels[i & 3]));
+
+		if (difference > 1) {
+
+			cout << "The " << getFilterName(filter) << " filter does not preserve a constant image" << endl;
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+static bool testMipImage(const string& filename) {
+
+	bool passed = true;
+
+	ImageData image;
+	importImage(filename, image);
+
+	MipOptions options = getDefaultMipOptions(filename);
+
+	cout << fixed << setprecision(2);
+	cout << filename << ": " << image.width << "x" << image.height << ", " << getMipLevelCount(image.width, image.height) << " levels" << endl;
+
+	for (MipFilter filter : testFilters) {
+
+		options.filter = filter;
+		options.numThreads = 1;
+
+		vector<ImageData> mips = generateMipChain(image, options);
+		vector<ImageData> scalarMips = generateMipChainScalar(image, options);
+
+		// 4 threads so the threaded result is checked on small machines
+		options.numThreads = 4;
+		vector<ImageData> threadedMips = generateMipChain(image, options);
+
+		// Summation order is the same so only rounding at the 8 bit conversion may differ
+		if (chainDifference(mips, scalarMips) > 1) {
+
+			cout << "  " << getFilterName(filter) << ": SSE and scalar mips differ" << endl;
+			passed = false;
+		}
+
+		if (chainDifference(mips, threadedMips) != 0) {
+
+			cout << "  " << getFilterName(filter) << ": threaded mips differ from single threaded mips" << endl;
+			passed = false;
+		}
+	}
+
+	// Alpha coverage of each level with and without scaling
+	if (getAlphaCoverage(image, 1.0f) < 1.0f) {
+
+		MipOptions coverageOptions = options;
+		coverageOptions.filter = MipFilter::Kaiser;
+		coverageOptions.alphaCoverageReference = 0.5f;
+
+		MipOptions plainOptions = coverageOptions;
+		plainOptions.alphaCoverageReference = 0.0f;
+
+		vector<ImageData> mips = generateMipChain(image, coverageOptions);
+		vector<ImageData> plainMips = generateMipChain(image, plainOptions);
+
+		float target = getAlphaCoverage(image, 0.5f);
+
+		cout << "  Alpha coverage (alpha >= 0.5) by level, unscaled -> scaled:";
+
+		for (size_t level = 0; level < mips.size(); ++level) {
+
+			float coverage = getAlphaCoverage(mips[level], 0.5f);
+
+			cout << " " << getAlphaCoverage(plainMips[level], 0.5f) << "->" << coverage;
+
+			// Small levels cannot match closely
+			if ((size_t)mips[level].width * mips[level].height >= 256 && fabs(coverage - target) > 0.05f) {
+
+				cout << endl << "  Alpha coverage is not preserved in level " << level;
+				passed = false;
+			}
+		}
+
+		cout << endl;
+	}
+
+	cout.unsetf(ios::floatfield);
+
+	return passed;
+}
+
+
+bool testMipGeneration(const vector<string>& filenames) {
+
+	bool passed = testConstantImage();
+
+	for (const string& filename : filenames)
+		passed &= testMipImage(filename);
+
+	return passed;
+}
@@ -0,0 +1,206 @@
+// MipResidency tests - the level estimates and the residency invariants while a camera crosses a scene of streamed textures
+
+#include "EngineTests.h"
+#include "TestScenes.h"
+#include <MipResidency.h>
+#include <algorithm>
+#include <random>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+
+static bool checkEstimates() {
+
+	bool passed = true;
+
+	// 2 x 2 quad with texture coordinates 0 - 1
+	MeshVertex quad[4] = {};
+	float corners[4][2] = { { 0.0f, 0.0f }, { 2.0f, 0.0f }, { 2.0f, 2.0f }, { 0.0f, 2.0f } };
+
+	for (int i = 0; i < 4; ++i) {
+
+		quad[i].pos[0] = corners[i][0];
+		quad[i].pos[2] = corners[i][1];
+		quad[i].texCoord[0] = corners[i][0] * 0.5f;
+		quad[i].texCoord[1] = corners[i][1] * 0.5f;
+	}
+
+	vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
+	vector<SubMesh> subMeshes = { { 0, 4, 0, 6 } };
+
+	float density = computeUVDensity(quad, indices, subMeshes);
+
+	if (fabs(density - 0.5f) > 1e-5f) {
+
+		cout << "  uv density of a 2 x 2 quad is " << density << " instead of 0.5" << endl;
+		passed = false;
+	}
+
+	// 512 texels per world unit seen at 512 pixels per world unit (distance 1) is level 0, each doubling of distance is one level coarser
+	float distances[] = { 0.5f, 1.0f, 2.0f, 16.0f };
+	float levels[] = { -1.0f, 0.0f, 1.0f, 4.0f };
+
+	for (int i = 0; i < 4; ++i) {
+
+		float level = estimateMipLevel(density, 1024, 1024, distances[i], 512.0f);
+
+		if (fabs(level - levels[i]) > 1e-4f) {
+
+			cout << "  level at distance " << distances[i] << " is " << level << " instead of " << levels[i] << endl;
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+
+// Check a settled residency - no missing level could be loaded by evicting the levels needed less than it, and every texture keeps its startup levels
+static bool checkSettled(MipResidency& residency, const vector<uint32_t>& ids, const vector<vector<size_t>>& levelBytes) {
+
+	const MipStreamingOptions& options = residency.getOptions();
+	MipStreamingStats stats = residency.getStats();
+	size_t free = options.budgetBytes - min(options.budgetBytes, stats.residentBytes + stats.loadingBytes);
+
+	for (size_t i = 0; i < ids.size(); ++i) {
+
+		uint32_t resident = residency.getResidentLevel(ids[i]);
+		uint32_t needed = residency.getNeededLevel(ids[i]);
+
+		if (resident > residency.getStartupLevel(ids[i])) {
+
+			cout << "  texture " << i << " is missing a startup level" << endl;
+			return false;
+		}
+
+		if (resident <= needed)
+			continue;
+
+		// Budget the greedy update could free for level resident - 1 of texture i
+		float priority = (float)(resident - 1) - (float)needed;
+		size_t available = free;
+
+		for (size_t j = 0; j < ids.size(); ++j) {
+
+			if (j == i)
+				continue;
+
+			uint32_t neededJ = residency.getNeededLevel(ids[j]);
+
+			for (uint32_t level = residency.getResidentLevel(ids[j]); level < residency.getStartupLevel(ids[j]); ++level)
+				if ((float)level - (float)neededJ < priority - mipEvictionHysteresis - 1.0f)
+					available += levelBytes[j][level];
+		}
+
+		if (available >= levelBytes[i][resident - 1]) {
+
+			cout << "  texture " << i << " is missing level " << resident - 1 << " while less needed levels are resident" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+bool testMipResidency(uint32_t numTextures) {
+
+	bool passed = checkEstimates();
+
+	mt19937 random(1234);
+	StreamedScene scene = randomStreamedScene(numTextures, random);
+
+	MipStreamingOptions options;
+	options.budgetBytes = 16 * 1024 * 1024;
+
+	MipResidency residency(options);
+	vector<uint32_t> ids = addStreamedTextures(residency, scene);
+
+	size_t startupBytes = residency.getStats().residentBytes;
+
+	// The camera crosses the area then stays still until the residency settles.  Loads complete in the frame after they are requested.
+	vector<MipRequest> loads, evictions, pending;
+	const int moveFrames = 300, settleFrames = 600;
+
+	for (int frame = 0; frame < moveFrames + settleFrames; ++frame) {
+
+		float camera[2];
+		getStreamedCamera(frame, moveFrames, camera);
+
+		for (const MipRequest& load : pending)
+			residency.loaded(load.texture, load.level);
+
+		residency.beginFrame();
+		requestStreamedViews(residency, scene, ids, camera);
+		residency.update(loads, evictions);
+
+		MipStreamingStats stats = residency.getStats();
+
+		if (stats.residentBytes + stats.loadingBytes > options.budgetBytes) {
+
+			cout << "  frame " << frame << ": " << (stats.residentBytes + stats.loadingBytes) / 1024 << " KB resident or loading over a budget of " << options.budgetBytes / 1024 << " KB" << endl;
+			passed = false;
+			break;
+		}
+
+		for (const MipRequest& eviction : evictions) {
+
+			bool loadedToo = false;
+
+			for (const MipRequest& load : loads)
+				loadedToo |= load.texture == eviction.texture;
+
+			if (loadedToo || eviction.level >= residency.getStartupLevel(eviction.texture)) {
+
+				cout << "  frame " << frame << ": invalid eviction of level " << eviction.level << " of texture " << eviction.texture << endl;
+				passed = false;
+			}
+		}
+
+		pending = loads;
+	}
+
+	for (const MipRequest& load : pending)
+		residency.loaded(load.texture, load.level);
+
+	MipStreamingStats settled = residency.getStats();
+	passed &= checkSettled(residency, ids, scene.levelBytes);
+
+	// With every level fitting the budget nothing is missing once settled
+	residency.setBudget(scene.fullBytes);
+
+	for (int frame = 0; frame < settleFrames; ++frame) {
+
+		residency.beginFrame();
+		residency.update(loads, evictions);
+
+		for (const MipRequest& load : loads)
+			residency.loaded(load.texture, load.level);
+	}
+
+	MipStreamingStats unlimited = residency.getStats();
+
+	if (unlimited.missingLevels != 0) {
+
+		cout << "  " << unlimited.missingLevels << " levels missing with an unlimited budget" << endl;
+		passed = false;
+	}
+
+	// Lowering the budget evicts down to it in one update
+	residency.setBudget(startupBytes + (scene.fullBytes - startupBytes) / 10);
+	residency.update(loads, evictions);
+
+	MipStreamingStats lowered = residency.getStats();
+
+	if (lowered.residentBytes > residency.getOptions().budgetBytes) {
+
+		cout << "  " << lowered.residentBytes / 1024 << " KB resident after lowering the budget to " << residency.getOptions().budgetBytes / 1024 << " KB" << endl;
+		passed = false;
+	}
+
+	cout << numTextures << " textures on " << scene.objects.size() << " objects, budget " << options.budgetBytes / (1024 * 1024) << " MB: " << settled.totalLoads << " loads, " << settled.totalEvictions << " evictions, " << settled.missingLevels << " levels missing once settled" << endl;
+
+	return passed;
+}
@@ -0,0 +1,236 @@
+// RenderQueue tests - the radix sort against std::stable_sort, the order the keys define and the state changes of the scene's draw list and of random draws
+
+#include "EngineTests.h"
+#include <RenderQueue.h>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <utility>
+#include <iostream>
+#include <iomanip>
+#include <set>
+
+using namespace std;
+
+
+// Draw of the test scenes
+struct TestDraw {
+	RenderPass							pass;
+	uint32_t							pipeline;
+	uint32_t							textureSet;
+	float								depth;
+};
+
+
+// Sort the draws through a queue and check the order the keys define.  Returns false if a check fails.
+static bool checkQueueOrder(RenderQueue& queue, const vector<TestDraw>& draws) {
+
+	queue.clear();
+
+	for (size_t i = 0; i < draws.size(); ++i) {
+
+		DrawPacket packet = { (uint32_t)i, 0, 0 };
+		queue.submit(makeRenderKey(draws[i].pass, draws[i].pipeline, draws[i].textureSet, draws[i].depth), packet);
+	}
+
+	queue.sort();
+
+	if (queue.size() != draws.size())
+		return false;
+
+	// Pipelines and states (pipeline and texture set) already drawn and left in the current pass
+	set<uint32_t> endedPipelines;
+	set<pair<uint32_t, uint32_t>> endedStates;
+
+	for (size_t i = 1; i < queue.size(); ++i) {
+
+		const TestDraw& a = draws[queue.getPacket(i - 1).object];
+		const TestDraw& b = draws[queue.getPacket(i).object];
+		bool sameState = (a.pipeline == b.pipeline && a.textureSet == b.textureSet);
+		uint32_t depthA = quantiseRenderDepth(a.depth), depthB = quantiseRenderDepth(b.depth);
+
+		if (a.pass > b.pass)
+			return false;
+
+		if (a.pass != b.pass) {
+
+			endedPipelines.clear();
+			endedStates.clear();
+			continue;
+		}
+
+		// Opaque draws are grouped by pipeline, then by texture set, and front to back within a group (the groups may be in any order), transparent draws are back to front
+		if (a.pass != TransparentPass) {
+
+			if (a.pipeline != b.pipeline)
+				endedPipelines.insert(a.pipeline);
+
+			if (!sameState)
+				endedStates.insert(make_pair(a.pipeline, a.textureSet));
+
+			if (endedPipelines.count(b.pipeline) || endedStates.count(make_pair(b.pipeline, b.textureSet)) || (sameState && depthA > depthB))
+				return false;
+		}
+
+		if (a.pass == TransparentPass && depthA < depthB)
+			return false;
+
+		// Equal keys keep their submission order
+		if (queue.getKey(i - 1) == queue.getKey(i) && queue.getPacket(i - 1).object > queue.getPacket(i).object)
+			return false;
+	}
+
+	return true;
+}
+
+
+bool testRenderQueue(uint32_t numDraws) {
+
+	bool passed = true;
+	mt19937 random(1);
+
+	// The radix sort orders the same as a stable comparison sort, with few distinct keys and with random keys
+	for (size_t count : { (size_t)0, (size_t)1, (size_t)2, (size_t)17, (size_t)1000, (size_t)numDraws }) {
+
+		for (int distinct : { 4, 0 }) {
+
+			vector<uint64_t> pool(distinct);
+
+			for (uint64_t& key : pool)
+				key = ((uint64_t)random() << 32 | random()) & ~1023ull;
+
+			vector<uint64_t> keys(count), keyScratch(count);
+			vector<uint32_t> values(count), valueScratch(count);
+			vector<pair<uint64_t, uint32_t>> expected(count);
+
+			for (size_t i = 0; i < count; ++i) {
+
+				keys[i] = distinct ? pool[random() % distinct] : ((uint64_t)random() << 32 | random());
+				values[i] = (uint32_t)i;
+				expected[i] = make_pair(keys[i], values[i]);
+			}
+
+			stable_sort(expected.begin(), expected.end(), [](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+			radixSortRenderKeys(keys.data(), values.data(), count, keyScratch.data(), valueScratch.data());
+
+			for (size_t i = 0; i < count; ++i)
+				if (keys[i] != expected[i].first || values[i] != expected[i].second) {
+
+					cout << "  radix sort of " << count << " keys differs from std::stable_sort at " << i << endl;
+					passed = false;
+					break;
+				}
+		}
+	}
+
+	// Depth quantisation keeps the order
+	for (int i = 0; i < 100000; ++i) {
+
+		float a = (float)(random() % 1000000) / 1000.0f, b = a * (1.0f + (float)(random() % 1000) / 1000.0f);
+
+		if (quantiseRenderDepth(a) > quantiseRenderDepth(b)) {
+
+			cout << "  depth " << a << " quantises after " << b << endl;
+			passed = false;
+			break;
+		}
+	}
+
+	if (quantiseRenderDepth(-1.0f) != 0 || quantiseRenderDepth(0.0f) != 0 || quantiseRenderDepth(1e30f) > (1u << renderKeyDepthBits) - 1) {
+
+		cout << "  depths at or behind the eye or at infinity are out of range" << endl;
+		passed = false;
+	}
+
+	// The scene's draw list in its hand written order - sky box, orb, glowing orb (its glow then the orb), knight, shark, water, castle, grass (the shells are instanced), trees (instanced) and particles
+	vector<TestDraw> scene = {
+		{ SkyPass, 1, 1, 500.0f }, { OpaquePass, 2, 1, 21.0f }, { TransparentPass, 3, 2, 22.5f }, { TransparentPass, 3, 2, 22.5f }, { OpaquePass, 3, 3, 12.0f }, { OpaquePass, 4, 4, 19.0f },
+		{ OpaquePass, 5, 5, 8.0f }, { OpaquePass, 3, 6, 28.0f }, { OpaquePass, 6, 7, 0.0f }, { OpaquePass, 8, 8, 38.0f },
+		{ TransparentPass, 7, 9, 6.0f }, { TransparentPass, 7, 9, 6.5f } };
+
+	RenderQueue queue;
+
+	if (!checkQueueOrder(queue, scene)) {
+
+		cout << "  scene draws are out of key order" << endl;
+		passed = false;
+	}
+
+	// The orb's glow and the orb have equal keys, so the orb must be drawn straight after its glow
+	for (size_t i = 0; i < queue.size(); ++i)
+		if (queue.getPacket(i).object == 2 && (i + 1 == queue.size() || queue.getPacket(i + 1).object != 3)) {
+
+			cout << "  the glowing orb is not drawn after its glow" << endl;
+			passed = false;
+		}
+
+	RenderQueueStats sceneStats = queue.getStats();
+
+	// The scene is submitted grouped by hand, so sorting it must not add state changes
+	if (sceneStats.pipelineChanges > sceneStats.submittedPipelineChanges || sceneStats.textureSetChanges > sceneStats.submittedTextureSetChanges) {
+
+		cout << "  sorting the scene draws adds state changes" << endl;
+		passed = false;
+	}
+
+	// Random draws with a few pipelines and many texture sets, best of 3
+	vector<TestDraw> draws(numDraws);
+
+	for (TestDraw& draw : draws) {
+
+		uint32_t r = random() % 100;
+		draw.pass = r < 80 ? OpaquePass : (r < 85 ? SkyPass : TransparentPass);
+		draw.pipeline = random() % 32;
+		draw.textureSet = random() % 256;
+		draw.depth = (float)(random() % 100000) / 100.0f;
+	}
+
+	if (!checkQueueOrder(queue, draws)) {
+
+		cout << "  random draws are out of key order" << endl;
+		passed = false;
+	}
+
+	RenderQueueStats randomStats = queue.getStats();
+
+	// Radix sort against std::stable_sort of the same keys and indices, best of 3
+	double radixSeconds = 1e9, stableSeconds = 1e9;
+	vector<uint64_t> randomKeys(numDraws), keys(numDraws), keyScratch(numDraws);
+	vector<uint32_t> values(numDraws), valueScratch(numDraws);
+
+	for (uint32_t i = 0; i < numDraws; ++i)
+		randomKeys[i] = makeRenderKey(draws[i].pass, draws[i].pipeline, draws[i].textureSet, draws[i].depth);
+
+	for (int run = 0; run < 3; ++run) {
+
+		keys = randomKeys;
+
+		for (uint32_t i = 0; i < numDraws; ++i)
+			values[i] = i;
+
+		auto start = chrono::steady_clock::now();
+		radixSortRenderKeys(keys.data(), values.data(), numDraws, keyScratch.data(), valueScratch.data());
+		radixSeconds = min(radixSeconds, secondsSince(start));
+
+		vector<pair<uint64_t, uint32_t>> pairs(numDraws);
+
+		for (uint32_t i = 0; i < numDraws; ++i)
+			pairs[i] = make_pair(randomKeys[i], i);
+
+		start = chrono::steady_clock::now();
+		stable_sort(pairs.begin(), pairs.end(), [](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+		stableSeconds = min(stableSeconds, secondsSince(start));
+	}
+
+	cout << fixed << setprecision(2);
+	cout << "scene: " << sceneStats.draws << " draws" << endl;
+	cout << "  before: " << sceneStats.submittedPipelineChanges << " pipeline changes, " << sceneStats.submittedTextureSetChanges << " texture changes" << endl;
+	cout << "  after: " << sceneStats.pipelineChanges << " pipeline changes, " << sceneStats.textureSetChanges << " texture changes" << endl;
+	cout << numDraws << " random draws" << endl;
+	cout << "  before: " << randomStats.submittedPipelineChanges << " pipeline changes, " << randomStats.submittedTextureSetChanges << " texture changes" << endl;
+	cout << "  after: " << randomStats.pipelineChanges << " pipeline changes, " << randomStats.textureSetChanges << " texture changes" << endl;
+	cout << "  radix sort: " << radixSeconds * 1000.0 << " ms, std::stable_sort: " << stableSeconds * 1000.0 << " ms" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return passed;
+}
@@ -0,0 +1,184 @@
+// SceneBVH tests - frustum, ray and sphere queries against testing every object after building, refitting, adding and removing objects and background rebuilds
+
+#include "EngineTests.h"
+#include "TestScenes.h"
+#include <SceneBVH.h>
+#include <algorithm>
+#include <random>
+#include <iostream>
+
+using namespace std;
+
+
+// Compare numQueries of each kind with the reference and count the ray hits and sphere results.  Returns false if a result differs.
+static bool checkQueries(const SceneBVH& bvh, const ReferenceObjects& reference, mt19937& random, int numQueries, const char *stage, size_t& numFound) {
+
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	VisibilitySet visibility, referenceVisibility;
+	vector<uint32_t> found, referenceFound;
+
+	for (int q = 0; q < numQueries; ++q) {
+
+		float planes[6][4];
+		randomFrustum(random, planes);
+		bvh.queryFrustum(planes, visibility);
+		reference.queryFrustum(planes, referenceVisibility);
+
+		if (visibility.getWords() != referenceVisibility.getWords()) {
+
+			cout << "  " << stage << ": frustum query differs from culling every object" << endl;
+			return false;
+		}
+
+		float origin[3] = { unit(random) * 500.0f, unit(random) * 50.0f, unit(random) * 500.0f };
+		float direction[3] = { unit(random), unit(random) * 0.1f, unit(random) };
+		float distance, referenceDistance;
+		uint32_t hit = bvh.queryRay(origin, direction, 1000.0f, distance);
+		uint32_t referenceHit = reference.queryRay(origin, direction, 1000.0f, referenceDistance);
+
+		// Objects hit at the same distance may be found in either order
+		if ((hit == bvhNoObject) != (referenceHit == bvhNoObject) || (hit != bvhNoObject && distance != referenceDistance)) {
+
+			cout << "  " << stage << ": ray query differs from testing every object" << endl;
+			return false;
+		}
+
+		bvh.querySphere(origin, 20.0f, found);
+		reference.querySphere(origin, 20.0f, referenceFound);
+		sort(found.begin(), found.end());
+
+		if (found != referenceFound) {
+
+			cout << "  " << stage << ": sphere query differs from testing every object" << endl;
+			return false;
+		}
+
+		numFound += (hit != bvhNoObject) + found.size();
+	}
+
+	return true;
+}
+
+
+// Move numMoved random live objects by up to distance along each axis
+static void moveObjects(SceneBVH& bvh, ReferenceObjects& reference, mt19937& random, size_t numMoved, float distance) {
+
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	uniform_int_distribution<size_t> anyObject(0, reference.bounds.size() - 1);
+
+	for (size_t i = 0; i < numMoved; ++i) {
+
+		uint32_t id = (uint32_t)anyObject(random);
+		Bounds& b = reference.bounds[id];
+
+		if (b.isEmpty() || !reference.live[id])
+			continue;
+
+		for (int a = 0; a < 3; ++a)
+			b.boxCentre[a] = b.sphereCentre[a] = b.boxCentre[a] + unit(random) * distance;
+
+		bvh.setBounds(id, b);
+	}
+}
+
+
+bool testSceneBVH(size_t numObjects) {
+
+	bool passed = true;
+	size_t numFound = 0;
+	mt19937 random(1);
+
+	ReferenceObjects reference;
+	SceneBVH bvh;
+	bvh.setBackgroundRebuild(false);
+
+	for (size_t i = 0; i < numObjects; ++i) {
+
+		// A few objects have not been loaded yet
+		reference.bounds.push_back(random() % 1000 ? randomBounds(random) : emptyBounds());
+		reference.live.push_back(true);
+		bvh.insert(reference.bounds.back());
+	}
+
+	bvh.rebuild();
+	SceneBVHStats built = bvh.getStats();
+
+	passed &= checkQueries(bvh, reference, random, 32, "built", numFound);
+
+	// Move 1% of the objects a short way each frame, refitting the tree, until it has loosened enough to be rebuilt
+	int frames = 0;
+
+	for (; frames < 1000 && bvh.getStats().builds == built.builds; ++frames) {
+
+		moveObjects(bvh, reference, random, numObjects / 100, 20.0f);
+		bvh.refit();
+
+		if (frames == 0)
+			passed &= checkQueries(bvh, reference, random, 32, "refitted", numFound);
+	}
+
+	if (bvh.getStats().builds == built.builds) {
+
+		cout << "  the tree was not rebuilt after " << frames << " frames of moving objects" << endl;
+		passed = false;
+	}
+
+	passed &= checkQueries(bvh, reference, random, 32, "rebuilt after refitting", numFound);
+
+	// Add and remove objects, then rebuild in the background while objects keep moving
+	uniform_int_distribution<size_t> anyObject(0, numObjects - 1);
+
+	for (size_t i = 0; i < numObjects / 10; ++i) {
+
+		reference.bounds.push_back(randomBounds(random));
+		reference.live.push_back(true);
+		bvh.insert(reference.bounds.back());
+	}
+
+	for (size_t i = 0; i < numObjects / 100; ++i) {
+
+		uint32_t id = (uint32_t)anyObject(random);
+		reference.live[id] = false;
+		bvh.remove(id);
+	}
+
+	passed &= checkQueries(bvh, reference, random, 8, "added", numFound);
+
+	bvh.setBackgroundRebuild(true);
+	SceneBVHStats before = bvh.getStats();
+	frames = 0;
+
+	while (bvh.getStats().backgroundBuilds == before.backgroundBuilds && frames < 100000) {
+
+		moveObjects(bvh, reference, random, numObjects / 100, 1.0f);
+		bvh.refit();
+		frames++;
+
+		if (frames % 16 == 0 && !checkQueries(bvh, reference, random, 1, "rebuilding", numFound)) {
+
+			passed = false;
+			break;
+		}
+	}
+
+	SceneBVHStats after = bvh.getStats();
+
+	if (after.backgroundBuilds == before.backgroundBuilds) {
+
+		cout << "  the background rebuild was not installed" << endl;
+		passed = false;
+	}
+
+	passed &= checkQueries(bvh, reference, random, 32, "rebuilt", numFound);
+
+	cout << after.objects << " objects, " << after.builds << " builds (" << after.backgroundBuilds << " in the background), " << numFound << " objects found by the checked ray and sphere queries" << endl;
+
+	// Queries that find nothing would pass trivially
+	if (numFound == 0) {
+
+		cout << "  no ray or sphere query found an object" << endl;
+		passed = false;
+	}
+
+	return passed;
+}
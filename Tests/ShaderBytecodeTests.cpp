@@ -0,0 +1,106 @@
+// ShaderBytecode tests - shared mappings, hashes and statistics of a store loading generated shader files
+
+#include "EngineTests.h"
+#include <ShaderBytecode.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+
+bool testShaderBytecode() {
+
+	bool passed = true;
+
+	// Three files where the last is a copy of the first saved under another name, requested the way several effects share a vertex shader
+	filesystem::path directory = filesystem::temp_directory_path();
+	vector<vector<char>> contents = { vector<char>(1000, 'a'), vector<char>(3000, 'b'), vector<char>(1000, 'a') };
+	vector<string> files;
+
+	contents[1][1234] = 'c';
+
+	for (size_t i = 0; i < contents.size(); ++i) {
+
+		files.push_back((directory / ("test_shader_" + to_string(i) + ".cso")).string());
+
+		ofstream file(files.back(), ios::binary);
+		file.write(contents[i].data(), contents[i].size());
+	}
+
+	const size_t requests[] = { 0, 1, 0, 2, 1, 0 };
+	uint64_t requestedBytes = 0;
+
+	ShaderBytecodeStore store;
+	vector<ShaderBytecode> loaded;
+
+	for (size_t file : requests) {
+
+		loaded.push_back(store.load(files[file]));
+		requestedBytes += contents[file].size();
+	}
+
+	// An input layout loads its vertex shader again without counting a request
+	ShaderBytecode layoutBytecode = store.load(files[1], false);
+
+	for (size_t i = 0; i < loaded.size(); ++i) {
+
+		const vector<char>& expected = contents[requests[i]];
+
+		if (loaded[i].size != expected.size() || memcmp(loaded[i].data, expected.data(), expected.size()) != 0) {
+
+			cout << "  request " << i << ": bytecode differs from the file" << endl;
+			passed = false;
+		}
+
+		for (size_t j = 0; j < i; ++j) {
+
+			if (requests[j] == requests[i] && loaded[j].data != loaded[i].data) {
+
+				cout << "  " << files[requests[i]] << " was mapped more than once" << endl;
+				passed = false;
+			}
+
+			if ((loaded[j].hash == loaded[i].hash) != (contents[requests[j]] == contents[requests[i]])) {
+
+				cout << "  requests " << j << " and " << i << ": hashes do not match the bytecode" << endl;
+				passed = false;
+			}
+		}
+	}
+
+	if (layoutBytecode.data != loaded[1].data) {
+
+		cout << "  an uncounted load mapped the file again" << endl;
+		passed = false;
+	}
+
+	ShaderBytecodeStats stats = store.getStats();
+
+	cout << stats.requests << " requests, " << stats.fileLoads << " files mapped, " << stats.uniqueBytecodes << " unique bytecodes, " << stats.bytesRead << " of " << stats.requestedBytes << " bytes read" << endl;
+
+	if (stats.requests != 6 || stats.requestedBytes != requestedBytes || stats.fileLoads != 3 || stats.bytesRead != 5000 || stats.uniqueBytecodes != 2) {
+
+		cout << "  store statistics do not match the requests" << endl;
+		passed = false;
+	}
+
+	for (const string& file : files)
+		filesystem::remove(file);
+
+	// A missing file must throw rather than return empty bytecode
+	try
+	{
+		store.load((directory / "test_shader_missing.cso").string());
+
+		cout << "  loading a missing file did not throw" << endl;
+		passed = false;
+	}
+	catch (runtime_error&)
+	{
+	}
+
+	return passed;
+}
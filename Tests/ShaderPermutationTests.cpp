@@ -0,0 +1,150 @@
+// ShaderPermutation tests - the axes declared by the HLSL files and the lookup of every compiled variant and every other key, and the time of a lookup by key against by name
+
+#include "EngineTests.h"
+#include <ShaderPermutation.h>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+bool testShaderPermutations(const string& hlslDirectory, uint32_t numLookups) {
+
+	bool passed = true;
+	const size_t numCompiled = sizeof(compiledShaderVariants) / sizeof(ShaderVariant);
+
+	// Compile time checks of the key type
+	static_assert(treeVertexShader.key.has(WindAnimation) && !modelVertexShader.key.has(WindAnimation), "ShaderKey features");
+	static_assert((DiffuseMap | SpecularMap).isSubsetOf(shaderFamilies[ReflectionMapPS].axes), "ShaderKey subsets");
+	static_assert(!ShaderKey(WindAnimation).isSubsetOf(shaderFamilies[PerPixelLightingPS].axes), "ShaderKey subsets");
+
+	// The axes each HLSL file declares match its family
+	for (uint32_t family = 0; family < NumShaderFamilies; ++family) {
+
+		string filename = hlslDirectory + "/" + shaderFamilies[family].name + ".hlsl";
+		ifstream file(filename, ios::binary);
+
+		if (!file) {
+
+			cout << "  cannot read " << filename << endl;
+			passed = false;
+			continue;
+		}
+
+		stringstream source;
+		source << file.rdbuf();
+
+		try
+		{
+			if (parseShaderAxes(source.str()) != shaderFamilies[family].axes) {
+
+				cout << "  " << filename << ": declared permutation axes do not match the shader family" << endl;
+				passed = false;
+			}
+		}
+		catch (exception& e)
+		{
+			cout << "  " << filename << ": " << e.what() << endl;
+			passed = false;
+		}
+	}
+
+	// Every compiled variant is found under a unique name and every other key of each family is not found
+	ShaderPermutationTable table("Shaders/cso/");
+	map<string, const ShaderVariant*> names;
+	uint32_t numKeys = 0;
+
+	for (size_t i = 0; i < numCompiled; ++i) {
+
+		const ShaderVariant& variant = compiledShaderVariants[i];
+		string name = getShaderVariantName(variant);
+		const string *filename = table.find(variant);
+
+		if (!filename || *filename != "Shaders/cso/" + name + ".cso") {
+
+			cout << "  " << name << ": compiled variant not found" << endl;
+			passed = false;
+		}
+
+		if (!names.insert(make_pair(name, &variant)).second) {
+
+			cout << "  " << name << ": variant compiled more than once" << endl;
+			passed = false;
+		}
+	}
+
+	for (uint32_t family = 0; family < NumShaderFamilies; ++family) {
+
+		for (uint32_t bits = 0; bits < (1u << numShaderFeatures); ++bits) {
+
+			ShaderVariant variant = { (ShaderFamilyId)family, ShaderKey(bits) };
+			bool compiled = false;
+
+			for (size_t i = 0; i < numCompiled; ++i)
+				compiled |= (compiledShaderVariants[i].family == variant.family && compiledShaderVariants[i].key == variant.key);
+
+			if ((table.find(variant) != nullptr) != compiled) {
+
+				cout << "  " << shaderFamilies[family].name << " key " << bits << (compiled ? ": compiled variant not found" : ": found but not compiled") << endl;
+				passed = false;
+			}
+
+			if (variant.key.isSubsetOf(shaderFamilies[family].axes))
+				++numKeys;
+		}
+	}
+
+	try
+	{
+		shaderVariant(PerPixelLightingPS, WindAnimation);
+		cout << "  a variant with an undeclared feature was accepted" << endl;
+		passed = false;
+	}
+	catch (logic_error&)
+	{
+	}
+
+	// Lookups of the compiled variants by name (as the effects found their files before) against by key, best of 3
+	map<string, string> filenamesByName;
+
+	for (size_t i = 0; i < numCompiled; ++i)
+		filenamesByName[getShaderVariantName(compiledShaderVariants[i])] = *table.find(compiledShaderVariants[i]);
+
+	double nameSeconds = 1e9, keySeconds = 1e9;
+	size_t nameLength = 0, keyLength = 0;
+
+	for (int run = 0; run < 3; ++run) {
+
+		auto start = chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < numLookups; ++i)
+			nameLength += filenamesByName.find(getShaderVariantName(compiledShaderVariants[i % numCompiled]))->second.size();
+
+		nameSeconds = min(nameSeconds, secondsSince(start));
+
+		start = chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < numLookups; ++i)
+			keyLength += table.find(compiledShaderVariants[i % numCompiled])->size();
+
+		keySeconds = min(keySeconds, secondsSince(start));
+	}
+
+	if (nameLength != keyLength) {
+
+		cout << "  lookups by name and by key found different files" << endl;
+		passed = false;
+	}
+
+	cout << fixed << setprecision(2);
+	cout << NumShaderFamilies << " shader families, " << numKeys << " valid keys, " << numCompiled << " variants compiled" << endl;
+	cout << "  " << numLookups << " lookups by name: " << nameSeconds * 1e9 / numLookups << " ns per lookup" << endl;
+	cout << "  " << numLookups << " lookups by key: " << keySeconds * 1e9 / numLookups << " ns per lookup" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return passed;
+}
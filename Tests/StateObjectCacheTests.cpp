@@ -0,0 +1,179 @@
+// StateObjectCache tests - a mock device stands in for Direct3D so the hashing, sharing and release of the cached objects can be checked without a GPU
+
+#include "EngineTests.h"
+#include <StateObjectCache.h>
+#include <map>
+#include <set>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+// Stands in for a Direct3D device - each object is a heap allocated serial number
+struct MockStateDevice {
+
+	uint64_t							creates = 0;
+	set<void*>							live;
+	uint32_t							doubleReleases = 0;
+
+	void *create() {
+
+		void *state = new uint64_t(creates++);
+		live.insert(state);
+		return state;
+	}
+
+	void release(void *state) {
+
+		if (live.erase(state) == 0) {
+
+			doubleReleases++;
+			return;
+		}
+
+		delete (uint64_t*)state;
+	}
+};
+
+// The size of a rasterizer description (ten 32 bit fields)
+struct MockStateDesc {
+	uint32_t							fields[10];
+};
+
+static const uint32_t invalidStateField = 0xFFFFFFFF;
+
+
+bool testStateCache(uint32_t numObjects) {
+
+	bool passed = true;
+
+	// Most objects use one of a few shared states per type (the default and customised effect states, the linear and clamped samplers) and some use a state of their own
+	const uint32_t sharedPerType = 6;
+	const StateType types[] = { RasterizerStateType, DepthStencilStateType, BlendStateType, SamplerStateType };
+
+	struct Request {
+		StateType						type;
+		MockStateDesc					desc;
+	};
+
+	vector<Request> requests;
+	mt19937 random(1);
+
+	for (uint32_t i = 0; i < numObjects; ++i) {
+
+		for (StateType type : types) {
+
+			Request request = {};
+			request.type = type;
+
+			// The same description bytes are used for every type so the type must be part of the key
+			uint32_t variant = (random() % 10 == 0) ? sharedPerType + i : (uint32_t)(random() % sharedPerType);
+
+			for (uint32_t f = 0; f < 10; ++f)
+				request.desc.fields[f] = (variant * 2654435761u) ^ f;
+
+			// A few descriptions the device rejects
+			if (i % 1000 == 999)
+				request.desc.fields[0] = invalidStateField;
+
+			requests.push_back(request);
+		}
+	}
+
+	MockStateDevice device;
+	StateCacheStats stats = {};
+	double seconds = 0.0;
+	set<void*> distinctObjects;
+
+	{
+		StateObjectCache cache([&device](StateType, void *state) { device.release(state); });
+
+		map<pair<StateType, vector<uint32_t>>, void*> expected;
+		uint32_t expectedFailures = 0;
+		vector<void*> results(requests.size());
+		uint64_t attempts = 0;
+
+		auto start = chrono::steady_clock::now();
+
+		for (size_t i = 0; i < requests.size(); ++i) {
+
+			const MockStateDesc& desc = requests[i].desc;
+
+			results[i] = cache.get(requests[i].type, &desc, sizeof(desc), [&device, &desc, &attempts]() {
+				attempts++;
+				return desc.fields[0] == invalidStateField ? nullptr : device.create(); });
+		}
+
+		seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		for (size_t i = 0; i < requests.size(); ++i) {
+
+			const MockStateDesc& desc = requests[i].desc;
+
+			if (desc.fields[0] == invalidStateField) {
+
+				expectedFailures++;
+
+				if (results[i]) {
+
+					cout << "  request " << i << ": a state the device rejected was returned" << endl;
+					passed = false;
+				}
+
+				continue;
+			}
+
+			pair<StateType, vector<uint32_t>> key(requests[i].type, vector<uint32_t>(desc.fields, desc.fields + 10));
+			auto found = expected.find(key);
+
+			if (found == expected.end())
+				expected[key] = results[i];
+			else if (found->second != results[i]) {
+
+				cout << "  request " << i << ": an equal description returned a different state" << endl;
+				passed = false;
+			}
+
+			distinctObjects.insert(results[i]);
+		}
+
+		stats = cache.getStats();
+
+		uint32_t created = 0;
+		uint64_t requested = 0;
+
+		for (StateType type : types) {
+
+			created += stats.created[type];
+			requested += stats.requests[type];
+		}
+
+		if (distinctObjects.size() != expected.size() || created != expected.size() || device.creates != created || attempts != created + expectedFailures || stats.failed != expectedFailures || requested != requests.size()) {
+
+			cout << "  " << created << " states created for " << expected.size() << " distinct descriptions (" << distinctObjects.size() << " distinct states, " << stats.failed << " of " << expectedFailures << " failures)" << endl;
+			passed = false;
+		}
+	}
+
+	if (!device.live.empty() || device.doubleReleases != 0) {
+
+		cout << "  " << device.live.size() << " states not released and " << device.doubleReleases << " released twice by the cache" << endl;
+		passed = false;
+	}
+
+	const char *names[] = { "rasterizer", "depth stencil", "blend", "sampler" };
+
+	cout << numObjects << " objects, " << requests.size() << " state requests" << endl;
+
+	for (StateType type : types)
+		cout << "  " << names[type] << ": " << stats.created[type] << " created of " << stats.requests[type] << " requested" << endl;
+
+	cout << fixed << setprecision(2);
+	cout << "  " << stats.failed << " failed, " << seconds * 1e9 / requests.size() << " ns per request" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return passed;
+}
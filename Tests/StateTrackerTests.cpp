@@ -0,0 +1,623 @@
+// StateTracker tests - the calls of the scene and random call sequences are replayed to a recording mock context directly and through a tracker, and the state bound by both must match after every call
+
+#include "EngineTests.h"
+#include <StateTracker.h>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+// Stands in for a Direct3D device context - records the calls made and applies them to a model of the bound state, including the hazard rules for resources bound as both shader input and render target
+struct MockContext {
+
+	TrackedValue						states[NumTrackedStates];
+	vector<const void*>					slots[NumTrackedStages][NumTrackedSlotTypes];
+	const void							*vertexBuffers[trackedVertexBufferSlots];
+	uint32_t							strides[trackedVertexBufferSlots];
+	uint32_t							offsets[trackedVertexBufferSlots];
+	const void							*renderTarget = nullptr;
+	uint64_t							stateCalls = 0;
+	uint64_t							draws = 0;
+
+	MockContext() {
+
+		memset(states, 0, sizeof(states));
+		memset(vertexBuffers, 0, sizeof(vertexBuffers));
+		memset(strides, 0, sizeof(strides));
+		memset(offsets, 0, sizeof(offsets));
+
+		for (uint32_t stage = 0; stage < NumTrackedStages; ++stage)
+			for (uint32_t type = 0; type < NumTrackedSlotTypes; ++type)
+				slots[stage][type].resize(trackedSlotCounts[type], nullptr);
+	}
+
+	void setState(TrackedState state, const TrackedValue& value) {
+
+		stateCalls++;
+		states[state] = value;
+	}
+
+	// Out of range calls are ignored and a resource that is the current render target is bound as null (as Direct3D does)
+	void setSlots(TrackedStage stage, TrackedSlots type, uint32_t start, uint32_t count, const void *const *objects) {
+
+		stateCalls++;
+
+		if (start > trackedSlotCounts[type] || count > trackedSlotCounts[type] - start)
+			return;
+
+		for (uint32_t i = 0; i < count; ++i) {
+
+			const void *object = objects[i];
+
+			if (type == TrackedShaderResources && object && object == renderTarget)
+				object = nullptr;
+
+			slots[stage][type][start + i] = object;
+		}
+	}
+
+	void setVertexBuffers(uint32_t start, uint32_t count, const void *const *buffers, const uint32_t *_strides, const uint32_t *_offsets) {
+
+		stateCalls++;
+
+		if (start > trackedVertexBufferSlots || count > trackedVertexBufferSlots - start)
+			return;
+
+		for (uint32_t i = 0; i < count; ++i) {
+
+			vertexBuffers[start + i] = buffers[i];
+			strides[start + i] = _strides[i];
+			offsets[start + i] = _offsets[i];
+		}
+	}
+
+	// Resources bound for reading are unbound when they become the render target
+	void setRenderTarget(const void *target) {
+
+		stateCalls++;
+		renderTarget = target;
+
+		if (!target)
+			return;
+
+		for (uint32_t stage = 0; stage < NumTrackedStages; ++stage)
+			for (const void *& object : slots[stage][TrackedShaderResources])
+				if (object == target)
+					object = nullptr;
+	}
+
+	void draw() {
+
+		draws++;
+	}
+
+	bool sameState(const MockContext& other) const {
+
+		if (memcmp(states, other.states, sizeof(states)) != 0 || renderTarget != other.renderTarget)
+			return false;
+
+		if (memcmp(vertexBuffers, other.vertexBuffers, sizeof(vertexBuffers)) != 0 || memcmp(strides, other.strides, sizeof(strides)) != 0 || memcmp(offsets, other.offsets, sizeof(offsets)) != 0)
+			return false;
+
+		for (uint32_t stage = 0; stage < NumTrackedStages; ++stage)
+			for (uint32_t type = 0; type < NumTrackedSlotTypes; ++type)
+				if (slots[stage][type] != other.slots[stage][type])
+					return false;
+
+		return true;
+	}
+};
+
+
+// Filters calls to a mock context in the same way StateTrackingContext filters calls to Direct3D
+struct TrackedMockContext {
+
+	MockContext							context;
+	StateTracker						tracker;
+
+	void setState(TrackedState state, const TrackedValue& value) {
+
+		if (tracker.setState(state, value))
+			context.setState(state, value);
+	}
+
+	void setSlots(TrackedStage stage, TrackedSlots type, uint32_t start, uint32_t count, const void *const *objects) {
+
+		uint32_t first, changed;
+
+		if (tracker.setSlots(stage, type, start, count, objects, first, changed))
+			context.setSlots(stage, type, first, changed, objects + (first - start));
+	}
+
+	void setVertexBuffers(uint32_t start, uint32_t count, const void *const *buffers, const uint32_t *strides, const uint32_t *offsets) {
+
+		uint32_t first, changed;
+
+		if (tracker.setVertexBuffers(start, count, buffers, strides, offsets, first, changed))
+			context.setVertexBuffers(first, changed, buffers + (first - start), strides + (first - start), offsets + (first - start));
+	}
+
+	void setRenderTarget(const void *target) {
+
+		context.setRenderTarget(target);
+		tracker.invalidateShaderResources();
+	}
+
+	void draw() {
+
+		context.draw();
+	}
+
+	// The application may bind state directly between frames
+	void beginFrame() {
+
+		tracker.invalidate();
+		tracker.beginFrame();
+	}
+};
+
+
+enum MockCallType {
+	MockSetState,
+	MockSetSlots,
+	MockSetVertexBuffers,
+	MockSetRenderTarget,
+	MockDraw,
+	MockBeginFrame,
+	MockInvalidate // Tracker only (the context is unchanged)
+};
+
+struct MockCall {
+	MockCallType						type;
+	TrackedState						state;
+	TrackedValue						value;
+	TrackedStage						stage;
+	TrackedSlots						slotType;
+	uint32_t							start;
+	vector<const void*>					objects;
+	vector<uint32_t>					strides;
+	vector<uint32_t>					offsets;
+};
+
+
+static void replay(MockContext& context, const MockCall& call) {
+
+	switch (call.type) {
+
+	case MockSetState: context.setState(call.state, call.value); break;
+	case MockSetSlots: context.setSlots(call.stage, call.slotType, call.start, (uint32_t)call.objects.size(), call.objects.data()); break;
+	case MockSetVertexBuffers: context.setVertexBuffers(call.start, (uint32_t)call.objects.size(), call.objects.data(), call.strides.data(), call.offsets.data()); break;
+	case MockSetRenderTarget: context.setRenderTarget(call.objects[0]); break;
+	case MockDraw: context.draw(); break;
+	default: break;
+	}
+}
+
+static void replay(TrackedMockContext& context, const MockCall& call) {
+
+	switch (call.type) {
+
+	case MockSetState: context.setState(call.state, call.value); break;
+	case MockSetSlots: context.setSlots(call.stage, call.slotType, call.start, (uint32_t)call.objects.size(), call.objects.data()); break;
+	case MockSetVertexBuffers: context.setVertexBuffers(call.start, (uint32_t)call.objects.size(), call.objects.data(), call.strides.data(), call.offsets.data()); break;
+	case MockSetRenderTarget: context.setRenderTarget(call.objects[0]); break;
+	case MockDraw: context.draw(); break;
+	case MockBeginFrame: context.beginFrame(); break;
+	case MockInvalidate: context.tracker.invalidate(); break;
+	}
+}
+
+
+// Builds the calls of a frame of the scene - each effect binds all of its pipeline (Effect::bindPipeline) and each model its constant buffers, sampler, textures and buffers before drawing
+struct MockSceneBuilder {
+
+	vector<MockCall>					calls;
+	uintptr_t							numObjects = 0;
+
+	// Distinct fake pointer
+	const void *newObject() {
+
+		return (const void*)(++numObjects * 64);
+	}
+
+	struct Effect {
+		const void						*objects[9]; // Input layout, shaders (vertex, hull, domain, geometry, pixel), rasterizer, depth-stencil and blend states
+		uint32_t						blendMask;
+	};
+
+	struct Model {
+		const Effect					*effect;
+		const void						*cbuffer;
+		const void						*sampler;
+		vector<const void*>				textures;
+		const void						*vertexBuffer;
+		const void						*indexBuffer;
+		uint32_t						topology;
+		const void						*instanceBuffer; // Bound after the vertex buffer (see MeshAsset::renderInstanced)
+	};
+
+	Effect newEffect(bool tessellated = false) {
+
+		Effect effect = {};
+
+		effect.objects[0] = newObject();
+		effect.objects[1] = newObject();
+		effect.objects[5] = newObject();
+
+		if (tessellated) {
+
+			effect.objects[2] = newObject();
+			effect.objects[3] = newObject();
+		}
+
+		effect.blendMask = 0xFFFFFFFF;
+		return effect;
+	}
+
+	void setState(TrackedState state, const TrackedValue& value) {
+
+		MockCall call = {};
+		call.type = MockSetState;
+		call.state = state;
+		call.value = value;
+		calls.push_back(call);
+	}
+
+	void setSlots(TrackedStage stage, TrackedSlots type, uint32_t start, const vector<const void*>& objects) {
+
+		MockCall call = {};
+		call.type = MockSetSlots;
+		call.stage = stage;
+		call.slotType = type;
+		call.start = start;
+		call.objects = objects;
+		calls.push_back(call);
+	}
+
+	void setVertexBuffers(const vector<const void*>& buffers, const vector<uint32_t>& strides) {
+
+		MockCall call = {};
+		call.type = MockSetVertexBuffers;
+		call.objects = buffers;
+		call.strides = strides;
+		call.offsets.resize(buffers.size(), 0);
+		calls.push_back(call);
+	}
+
+	void setRenderTarget(const void *target) {
+
+		MockCall call = {};
+		call.type = MockSetRenderTarget;
+		call.objects = { target };
+		calls.push_back(call);
+	}
+
+	void simpleCall(MockCallType type) {
+
+		MockCall call = {};
+		call.type = type;
+		calls.push_back(call);
+	}
+
+	void bindEffect(const Effect& effect) {
+
+		const TrackedState order[] = { TrackedRasterizerState, TrackedDepthStencilState, TrackedBlendState, TrackedVertexShader, TrackedPixelShader, TrackedGeometryShader, TrackedDomainShader, TrackedHullShader, TrackedInputLayout };
+		const uint32_t objectIndex[] = { 6, 7, 8, 1, 5, 4, 3, 2, 0 };
+
+		for (uint32_t i = 0; i < 9; ++i) {
+
+			uint64_t a = 0, b = 0;
+
+			// Blend factor bits and sample mask
+			if (order[i] == TrackedBlendState) {
+
+				a = 0x3F8000003F800000ull;
+				b = 0x3F8000003F800000ull | ((uint64_t)effect.blendMask << 32);
+			}
+
+			setState(order[i], makeTrackedValue(effect.objects[objectIndex[i]], a, b));
+		}
+	}
+
+	void render(const Model& model, uint32_t numDraws = 1) {
+
+		bindEffect(*model.effect);
+
+		if (model.cbuffer) {
+
+			setSlots(TrackedVertexStage, TrackedConstantBuffers, 0, { model.cbuffer });
+			setSlots(TrackedPixelStage, TrackedConstantBuffers, 0, { model.cbuffer });
+		}
+
+		if (!model.textures.empty()) {
+
+			setSlots(TrackedPixelStage, TrackedShaderResources, 0, model.textures);
+			setSlots(TrackedPixelStage, TrackedSamplers, 0, { model.sampler });
+		}
+
+		if (model.instanceBuffer)
+			setVertexBuffers({ model.vertexBuffer, model.instanceBuffer }, { 32, 128 });
+		else
+			setVertexBuffers({ model.vertexBuffer }, { 32 });
+
+		if (model.indexBuffer)
+			setState(TrackedIndexBuffer, makeTrackedValue(model.indexBuffer, 42)); // DXGI_FORMAT_R32_UINT
+
+		setState(TrackedPrimitiveTopology, makeTrackedValue(nullptr, model.topology));
+
+		for (uint32_t i = 0; i < numDraws; ++i)
+			simpleCall(MockDraw);
+	}
+
+	// As Scene::renderScene with the glow (BlurUtility) and the flares
+	void buildFrames(uint32_t numFrames) {
+
+		const void *backBuffer = newObject();
+		const void *sceneBuffers[] = { newObject(), newObject() }; // Camera, light and scene constant buffers (slots 1 to 3)
+		const void *lightBuffer = newObject();
+		const void *linearSampler = newObject();
+		const void *depthTexture = newObject();
+
+		Effect skyEffect = newEffect(), lightingEffect = newEffect(), reflectionEffect = newEffect(), oceanEffect = newEffect(true), grassEffect = newEffect(), instancedTreeEffect = newEffect(), fireEffect = newEffect(), flareEffect = newEffect();
+		Effect blurEffects[] = { newEffect(), newEffect(), newEffect(), newEffect() };
+		fireEffect.objects[8] = newObject();
+		flareEffect.objects[8] = fireEffect.objects[8];
+
+		auto newModel = [&](const Effect& effect, uint32_t numTextures, bool indexed) {
+
+			Model model = { &effect, newObject(), linearSampler, {}, newObject(), indexed ? newObject() : nullptr, 4, nullptr };
+
+			for (uint32_t i = 0; i < numTextures; ++i)
+				model.textures.push_back(newObject());
+
+			return model;
+		};
+
+		Model box = newModel(skyEffect, 1, true), orb0 = newModel(reflectionEffect, 2, true), orb1 = newModel(lightingEffect, 1, true);
+		Model knight = newModel(lightingEffect, 1, true), shark = newModel(lightingEffect, 1, true), castle = newModel(lightingEffect, 1, true);
+		Model water = newModel(oceanEffect, 2, true), grass = newModel(grassEffect, 2, true), fire = newModel(fireEffect, 1, true), smoke = newModel(fireEffect, 1, true);
+
+		// The grass shells are instances of the terrain and the trees instances of one mesh, each drawn with one instanced draw
+		Model trees = newModel(instancedTreeEffect, 1, true);
+		trees.instanceBuffer = newObject();
+
+		Model quad = newModel(blurEffects[0], 0, false);
+		quad.topology = 5;
+
+		vector<Model> flares;
+
+		for (uint32_t i = 0; i < 8; ++i) {
+
+			Model flare = newModel(flareEffect, 1, false);
+			flare.cbuffer = nullptr;
+			flare.topology = 5;
+			flare.textures[0] = (i % 2) ? flares.front().textures[0] : flare.textures[0];
+			flares.push_back(flare);
+		}
+
+		const void *blurTargets[] = { newObject(), newObject(), newObject() };
+
+		for (uint32_t frame = 0; frame < numFrames; ++frame) {
+
+			simpleCall(MockBeginFrame);
+
+			// Scene::updateScene
+			setSlots(TrackedVertexStage, TrackedConstantBuffers, 1, { sceneBuffers[0] });
+			setSlots(TrackedPixelStage, TrackedConstantBuffers, 1, { sceneBuffers[0] });
+			setSlots(TrackedVertexStage, TrackedConstantBuffers, 2, { lightBuffer });
+			setSlots(TrackedPixelStage, TrackedConstantBuffers, 2, { lightBuffer });
+			setSlots(TrackedVertexStage, TrackedConstantBuffers, 3, { sceneBuffers[1] });
+			setSlots(TrackedPixelStage, TrackedConstantBuffers, 3, { sceneBuffers[1] });
+
+			render(box);
+			render(orb0);
+
+			// Glow around orb1 - depth copy and blur passes into their own targets, then blended into the back buffer
+			for (uint32_t pass = 0; pass < 4; ++pass) {
+
+				setRenderTarget(pass < 3 ? blurTargets[pass] : backBuffer);
+				setSlots(TrackedPixelStage, TrackedShaderResources, 0, { pass == 0 ? depthTexture : blurTargets[pass - 1] });
+
+				quad.effect = &blurEffects[pass];
+				render(quad);
+			}
+
+			setSlots(TrackedPixelStage, TrackedShaderResources, 0, { nullptr });
+			render(orb1);
+			render(knight);
+			render(shark);
+			render(water);
+			render(castle);
+
+			render(grass);
+			render(trees);
+			render(fire);
+			render(smoke);
+
+			// Scene::DrawFlare - the depth buffer is read by the vertex shader while it is not bound for output
+			setRenderTarget(nullptr);
+			setSlots(TrackedVertexStage, TrackedShaderResources, 1, { depthTexture });
+
+			for (const Model& flare : flares)
+				render(flare);
+
+			setSlots(TrackedVertexStage, TrackedShaderResources, 1, { nullptr });
+			setRenderTarget(backBuffer);
+		}
+	}
+
+	// Random calls from small pools of objects (so many are redundant), including invalid slot ranges, resources bound as render targets and tracker resets
+	void buildRandom(uint32_t numCalls, uint32_t seed) {
+
+		mt19937 random(seed);
+		vector<const void*> pool;
+
+		pool.push_back(nullptr);
+
+		for (uint32_t i = 0; i < 6; ++i)
+			pool.push_back(newObject());
+
+		auto pick = [&]() { return pool[random() % pool.size()]; };
+
+		for (uint32_t i = 0; i < numCalls; ++i) {
+
+			uint32_t r = random() % 100;
+
+			if (r < 35) {
+
+				TrackedState state = (TrackedState)(random() % NumTrackedStates);
+				setState(state, makeTrackedValue(pick(), random() % 2, 0, random() % 2));
+			}
+			else if (r < 75) {
+
+				TrackedSlots type = (TrackedSlots)(random() % NumTrackedSlotTypes);
+				uint32_t start = (random() % 4 == 0) ? trackedSlotCounts[type] - 1 - random() % 3 : random() % 4;
+				vector<const void*> objects(random() % 5);
+
+				for (const void *& object : objects)
+					object = pick();
+
+				setSlots((TrackedStage)(random() % NumTrackedStages), type, start, objects);
+			}
+			else if (r < 88) {
+
+				uint32_t start = (random() % 8 == 0) ? trackedVertexBufferSlots - 1 : random() % 3;
+				uint32_t count = random() % 3;
+
+				MockCall call = {};
+				call.type = MockSetVertexBuffers;
+				call.start = start;
+
+				for (uint32_t j = 0; j < count; ++j) {
+
+					call.objects.push_back(pick());
+					call.strides.push_back(16 + 16 * (random() % 2));
+					call.offsets.push_back(random() % 2);
+				}
+
+				calls.push_back(call);
+			}
+			else if (r < 95)
+				setRenderTarget(pick());
+			else if (r < 97)
+				simpleCall(MockInvalidate);
+			else
+				simpleCall(MockDraw);
+		}
+	}
+};
+
+
+// Replay calls directly and through a tracker, checking the bound state after every call.  Returns the number of mismatches.
+static uint32_t checkCalls(const vector<MockCall>& calls, MockContext& direct, TrackedMockContext& tracked) {
+
+	uint32_t mismatches = 0;
+
+	for (size_t i = 0; i < calls.size(); ++i) {
+
+		replay(direct, calls[i]);
+		replay(tracked, calls[i]);
+
+		if (!direct.sameState(tracked.context) || direct.draws != tracked.context.draws) {
+
+			if (mismatches++ < 5)
+				cout << "  call " << i << " (type " << calls[i].type << "): the filtered context differs from the unfiltered context" << endl;
+
+			// Continue from the correct state
+			tracked.context = direct;
+			tracked.tracker.invalidate();
+		}
+	}
+
+	return mismatches;
+}
+
+
+bool testStateTracker(uint32_t numRandomCalls) {
+
+	bool passed = true;
+	const uint32_t numFrames = 10;
+
+	MockSceneBuilder scene;
+	scene.buildFrames(numFrames);
+
+	MockContext direct;
+	TrackedMockContext tracked;
+
+	if (checkCalls(scene.calls, direct, tracked) != 0)
+		passed = false;
+
+	// Frame counters are rolled by the next beginFrame
+	tracked.beginFrame();
+	StateTrackerStats frame = tracked.tracker.getFrameStats();
+	uint64_t framesIssued = tracked.context.stateCalls, framesDirect = direct.stateCalls, renderTargetCalls = 0;
+
+	for (const MockCall& call : scene.calls)
+		renderTargetCalls += (call.type == MockSetRenderTarget);
+
+	// Render target changes are not tracked
+	if (frame.getIssued() + frame.getFiltered() != (framesDirect - renderTargetCalls) / numFrames) {
+
+		cout << "  " << frame.getIssued() << " issued and " << frame.getFiltered() << " filtered calls counted of " << framesDirect / numFrames << " in the frame" << endl;
+		passed = false;
+	}
+
+	MockSceneBuilder fuzz;
+	fuzz.buildRandom(numRandomCalls, 1);
+
+	MockContext fuzzDirect;
+	TrackedMockContext fuzzTracked;
+	uint32_t fuzzMismatches = checkCalls(fuzz.calls, fuzzDirect, fuzzTracked);
+
+	if (fuzzMismatches != 0) {
+
+		cout << "  " << fuzzMismatches << " of " << fuzz.calls.size() << " random calls left a different state" << endl;
+		passed = false;
+	}
+
+	// Time of the filtered scene calls against the unfiltered calls (best of 3)
+	double directSeconds = 1e9, trackedSeconds = 1e9;
+
+	for (int run = 0; run < 3; ++run) {
+
+		MockContext timedDirect;
+		TrackedMockContext timedTracked;
+
+		auto start = chrono::steady_clock::now();
+
+		for (const MockCall& call : scene.calls)
+			replay(timedDirect, call);
+
+		auto middle = chrono::steady_clock::now();
+
+		for (const MockCall& call : scene.calls)
+			replay(timedTracked, call);
+
+		auto end = chrono::steady_clock::now();
+
+		directSeconds = min(directSeconds, chrono::duration<double>(middle - start).count());
+		trackedSeconds = min(trackedSeconds, chrono::duration<double>(end - middle).count());
+	}
+
+	const char *names[] = { "shaders", "fixed function states", "input assembler", "constant buffers", "samplers", "shader resources" };
+
+	cout << "Scene frame: " << frame.getIssued() << " state calls issued, " << frame.getFiltered() << " filtered (" << framesIssued / numFrames << " of " << framesDirect / numFrames << " context calls per frame)" << endl;
+
+	for (uint32_t type = 0; type < NumTrackedCallTypes; ++type)
+		cout << "  " << names[type] << ": " << frame.issued[type] << " issued, " << frame.filtered[type] << " filtered" << endl;
+
+	cout << "  " << frame.slotsIssued << " slots bound, " << frame.slotsFiltered << " dropped" << endl;
+
+	cout << fixed << setprecision(2);
+	cout << "  " << directSeconds * 1e9 / scene.calls.size() << " ns per unfiltered call, " << trackedSeconds * 1e9 / scene.calls.size() << " ns per filtered call (mock context)" << endl;
+	cout.unsetf(ios::floatfield);
+
+	const StateTrackerStats& fuzzStats = fuzzTracked.tracker.getStats();
+	cout << numRandomCalls << " random calls: " << fuzzStats.getIssued() << " issued, " << fuzzStats.getFiltered() << " filtered, " << fuzzMismatches << " state differences" << endl;
+
+	return passed;
+}
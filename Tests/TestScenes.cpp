@@ -0,0 +1,325 @@
+// TestScenes - generated scenes shared by the tests and the benchmarks
+
+#include "TestScenes.h"
+#include <ObjImporter.h>
+#include <Importer3DS.h>
+#include <ImageImporter.h>
+#include <filesystem>
+#include <system_error>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+
+void randomTransformedBounds(size_t numObjects, mt19937& random, vector<Bounds>& local, vector<float>& matrices) {
+
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	local.resize(numObjects);
+	matrices.resize(numObjects * 16);
+
+	for (size_t i = 0; i < numObjects; ++i) {
+
+		for (int j = 0; j < 3; ++j) {
+
+			local[i].boxCentre[j] = unit(random);
+			local[i].boxExtents[j] = 1.0f + unit(random) * 0.5f;
+			local[i].sphereCentre[j] = local[i].boxCentre[j];
+		}
+
+		local[i].sphereRadius = sqrtf(local[i].boxExtents[0] * local[i].boxExtents[0] + local[i].boxExtents[1] * local[i].boxExtents[1] + local[i].boxExtents[2] * local[i].boxExtents[2]);
+
+		// Rotation from a random unit quaternion with a non-uniform scale
+		float q[4] = { unit(random), unit(random), unit(random), unit(random) };
+		float len = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]) + 1e-6f;
+
+		for (float& f : q)
+			f /= len;
+
+		float x = q[0], y = q[1], z = q[2], w = q[3];
+		float rotation[3][3] = {
+			{ 1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y) },
+			{ 2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x) },
+			{ 2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y) } };
+
+		float *m = &matrices[i * 16];
+
+		for (int row = 0; row < 3; ++row) {
+
+			float scale = 1.25f + unit(random) * 0.75f;
+
+			for (int col = 0; col < 3; ++col)
+				m[row * 4 + col] = rotation[row][col] * scale;
+
+			m[row * 4 + 3] = 0.0f;
+			m[12 + row] = unit(random) * 1000.0f;
+		}
+
+		m[15] = 1.0f;
+	}
+}
+
+
+void importTestModel(const string& filename, MeshData& mesh) {
+
+	string ext = filename.size() >= 4 ? filename.substr(filename.size() - 4) : string();
+
+	for (char& c : ext)
+		c = (char)tolower((unsigned char)c);
+
+	if (ext == ".obj")
+		importOBJ(filename, mesh, true);
+	else
+		import3DS(filename, mesh);
+}
+
+
+vector<ImageData> importTestTextures(const vector<string>& names) {
+
+	vector<ImageData> images(names.size());
+
+	for (size_t i = 0; i < names.size(); ++i) {
+
+		try
+		{
+			importImage("Resources/Textures/" + names[i], images[i]);
+		}
+		catch (exception& e)
+		{
+			throw runtime_error("Cannot import " + names[i] + ": " + e.what());
+		}
+	}
+
+	return images;
+}
+
+
+vector<string> listTestTextures(const string& directory) {
+
+	vector<string> filenames;
+	error_code error;
+
+	for (filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+
+		string ext = it->path().extension().string();
+
+		for (char& c : ext)
+			c = (char)tolower((unsigned char)c);
+
+		if (it->is_regular_file(error) && (ext == ".dds" || canImportImage(ext)))
+			filenames.push_back(it->path().generic_string());
+	}
+
+	if (error)
+		throw runtime_error("Cannot list " + directory + ": " + error.message() + " (run from the repository root)");
+
+	sort(filenames.begin(), filenames.end());
+
+	return filenames;
+}
+
+
+vector<TestView> orbitViews(const MeshData& mesh, bool inside, int numViews) {
+
+	Bounds bounds = emptyBounds();
+
+	for (const Meshlet& meshlet : mesh.meshlets) {
+
+		Bounds meshletBounds = emptyBounds();
+
+		for (int i = 0; i < 3; ++i) {
+
+			meshletBounds.boxCentre[i] = meshletBounds.sphereCentre[i] = meshlet.centre[i];
+			meshletBounds.boxExtents[i] = meshlet.radius;
+		}
+
+		meshletBounds.sphereRadius = meshlet.radius;
+		bounds = mergeBounds(bounds, meshletBounds);
+	}
+
+	float proj[16];
+	perspectiveFovLH(0.25f * 3.14159265f, 16.0f / 9.0f, 0.01f * bounds.sphereRadius, 100.0f * bounds.sphereRadius, proj);
+
+	vector<TestView> views(numViews);
+
+	for (int view = 0; view < numViews; ++view) {
+
+		float angle = 2.0f * 3.14159265f * view / numViews;
+		float height = sinf(angle * 3.0f) * 0.5f;
+		const float *c = bounds.sphereCentre;
+		float r = bounds.sphereRadius * (inside ? 0.5f : 3.0f);
+
+		float *eye = views[view].eye;
+		eye[0] = c[0] + r * cosf(angle);
+		eye[1] = c[1] + r * height;
+		eye[2] = c[2] + r * sinf(angle);
+
+		float target[3] = { c[0], c[1], c[2] };
+
+		if (inside) {
+
+			target[0] = eye[0] - r * sinf(angle);
+			target[1] = eye[1];
+			target[2] = eye[2] + r * cosf(angle);
+		}
+
+		float viewMatrix[16], viewProj[16];
+		lookAtLH(eye, target, viewMatrix);
+		multiplyMatrices(viewMatrix, proj, viewProj);
+		extractFrustumPlanes(viewProj, views[view].planes);
+	}
+
+	return views;
+}
+
+
+StreamedScene randomStreamedScene(uint32_t numTextures, mt19937& random) {
+
+	uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	StreamedScene scene;
+	scene.levelBytes.resize(numTextures);
+	scene.sizes.resize(numTextures);
+
+	for (uint32_t i = 0; i < numTextures; ++i) {
+
+		uint32_t size = 256u << (random() % 5);
+		uint32_t blockBytes = (random() % 2) ? 8 : 16;
+
+		for (uint32_t level = 0; (size >> level) > 0; ++level) {
+
+			uint32_t blocks = (max(1u, size >> level) + 3) / 4;
+			scene.levelBytes[i].push_back((size_t)blocks * blocks * blockBytes);
+			scene.fullBytes += scene.levelBytes[i].back();
+		}
+
+		scene.sizes[i] = size;
+	}
+
+	for (uint32_t i = 0; i < numTextures * 2; ++i)
+		scene.objects.push_back({ i % numTextures, { unit(random) * 400.0f - 200.0f, unit(random) * 400.0f - 200.0f }, 0.02f + unit(random) * 0.3f });
+
+	scene.screenScale = 1080.0f * 1.7320508f * 0.5f;
+
+	return scene;
+}
+
+
+vector<uint32_t> addStreamedTextures(MipResidency& residency, const StreamedScene& scene) {
+
+	vector<uint32_t> ids;
+
+	for (size_t i = 0; i < scene.sizes.size(); ++i)
+		ids.push_back(residency.addTexture(scene.sizes[i], scene.sizes[i], scene.levelBytes[i]));
+
+	return ids;
+}
+
+
+void getStreamedCamera(int frame, int moveFrames, float camera[2]) {
+
+	float t = min(1.0f, (float)frame / moveFrames);
+
+	camera[0] = -180.0f + 360.0f * t;
+	camera[1] = -100.0f + 200.0f * t;
+}
+
+
+void requestStreamedViews(MipResidency& residency, const StreamedScene& scene, const vector<uint32_t>& ids, const float camera[2]) {
+
+	for (const StreamedObject& object : scene.objects) {
+
+		float dx = object.position[0] - camera[0], dy = object.position[1] - camera[1];
+		residency.requestView(ids[object.texture], object.uvDensity, max(1.0f, sqrtf(dx * dx + dy * dy)), scene.screenScale);
+	}
+}
+
+
+uint32_t ReferenceObjects::queryRay(const float origin[3], const float direction[3], float maxDistance, float& distance) const {
+
+	float inverseDirection[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+	uint32_t nearest = bvhNoObject;
+	distance = maxDistance;
+
+	for (uint32_t id = 0; id < bounds.size(); ++id) {
+
+		const Bounds& b = bounds[id];
+		float boxMin[3] = { b.boxCentre[0] - b.boxExtents[0], b.boxCentre[1] - b.boxExtents[1], b.boxCentre[2] - b.boxExtents[2] };
+		float boxMax[3] = { b.boxCentre[0] + b.boxExtents[0], b.boxCentre[1] + b.boxExtents[1], b.boxCentre[2] + b.boxExtents[2] };
+		float entry;
+
+		if (live[id] && !b.isEmpty() && rayHitsBox(origin, inverseDirection, boxMin, boxMax, distance, entry) && (entry < distance || nearest == bvhNoObject)) {
+
+			nearest = id;
+			distance = entry;
+		}
+	}
+
+	return nearest;
+}
+
+
+void ReferenceObjects::querySphere(const float centre[3], float radius, vector<uint32_t>& found) const {
+
+	found.clear();
+
+	for (uint32_t id = 0; id < bounds.size(); ++id) {
+
+		const Bounds& b = bounds[id];
+		float boxMin[3] = { b.boxCentre[0] - b.boxExtents[0], b.boxCentre[1] - b.boxExtents[1], b.boxCentre[2] - b.boxExtents[2] };
+		float boxMax[3] = { b.boxCentre[0] + b.boxExtents[0], b.boxCentre[1] + b.boxExtents[1], b.boxCentre[2] + b.boxExtents[2] };
+
+		if (live[id] && !b.isEmpty() && sphereHitsBox(centre, radius, boxMin, boxMax))
+			found.push_back(id);
+	}
+}
+
+
+void ReferenceObjects::queryFrustum(const float planes[6][4], VisibilitySet& visibility) const {
+
+	CullingBounds culling;
+	culling.resize(bounds.size());
+
+	for (size_t i = 0; i < bounds.size(); ++i)
+		culling.set(i, bounds[i]);
+
+	cullBoundsScalar(culling, planes, CullBoxes, visibility);
+
+	for (uint32_t id = 0; id < bounds.size(); ++id)
+		if (!live[id] && visibility.isVisible(id))
+			visibility.data()[id >> 6] &= ~(1ull << (id & 63));
+}
+
+
+Bounds randomBounds(mt19937& random) {
+
+	uniform_real_distribution<float> position(-500.0f, 500.0f), size(0.25f, 2.5f);
+	Bounds bounds;
+
+	bounds.boxCentre[0] = bounds.sphereCentre[0] = position(random);
+	bounds.boxCentre[1] = bounds.sphereCentre[1] = position(random) * 0.1f;
+	bounds.boxCentre[2] = bounds.sphereCentre[2] = position(random);
+
+	for (float& e : bounds.boxExtents)
+		e = size(random);
+
+	bounds.sphereRadius = sqrtf(bounds.boxExtents[0] * bounds.boxExtents[0] + bounds.boxExtents[1] * bounds.boxExtents[1] + bounds.boxExtents[2] * bounds.boxExtents[2]);
+
+	return bounds;
+}
+
+
+void randomFrustum(mt19937& random, float planes[6][4]) {
+
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	float eye[3] = { unit(random) * 400.0f, 5.0f, unit(random) * 400.0f };
+	float target[3] = { eye[0] + unit(random), eye[1] + unit(random) * 0.2f, eye[2] + unit(random) };
+	float viewMatrix[16], proj[16], viewProj[16];
+
+	lookAtLH(eye, target, viewMatrix);
+	perspectiveFovLH(1.0472f, 16.0f / 9.0f, 0.1f, 300.0f, proj);
+	multiplyMatrices(viewMatrix, proj, viewProj);
+	extractFrustumPlanes(viewProj, planes);
+}
@@ -0,0 +1,84 @@
+//
+// TestScenes.h
+//
+
+// Generated scenes, models and cameras shared by the EngineTests and the Benchmarks so both check and time the same data.  Every generator is deterministic for a given random engine state.
+
+#pragma once
+#include <Bounds.h>
+#include <Meshlet.h>
+#include <MeshData.h>
+#include <ImageData.h>
+#include <MipResidency.h>
+#include <SceneBVH.h>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// Eye position and frustum planes of a camera
+struct TestView {
+	float								eye[3];
+	float								planes[6][4];
+};
+
+// Object of a streaming scene using one texture, seen from a camera moving over the ground plane
+struct StreamedObject {
+	uint32_t							texture;
+	float								position[2];
+	float								uvDensity;
+};
+
+struct StreamedScene {
+	std::vector<std::vector<size_t>>	levelBytes; // Of each level of each texture
+	std::vector<uint32_t>				sizes; // Width and height of each texture
+	size_t								fullBytes = 0; // Every level of every texture
+	std::vector<StreamedObject>			objects;
+	float								screenScale; // See MipResidency::requestView
+};
+
+// Brute force queries over every object with the same box tests as SceneBVH
+struct ReferenceObjects {
+	std::vector<Bounds>					bounds; // Indexed by object id
+	std::vector<bool>					live;
+
+	uint32_t queryRay(const float origin[3], const float direction[3], float maxDistance, float& distance) const;
+	void querySphere(const float centre[3], float radius, std::vector<uint32_t>& found) const;
+
+	// Scalar culling of every object with the removed objects cleared
+	void queryFrustum(const float planes[6][4], VisibilitySet& visibility) const;
+};
+
+
+// Local bounds of about 2 units near the origin and world matrices with a random rotation, a non-uniform scale of 0.5 to 2 and a translation within 1000 units, one matrix (16 floats) per object
+void randomTransformedBounds(size_t numObjects, std::mt19937& random, std::vector<Bounds>& local, std::vector<float>& matrices);
+
+// Import a model (obj or 3ds by extension) with the importers the cooker uses.  Throws std::runtime_error if it cannot be read.
+void importTestModel(const std::string& filename, MeshData& mesh);
+
+// Import the textures under Resources/Textures named by their path relative to it (as in an atlas table).  Throws std::runtime_error naming the texture if one cannot be read.
+std::vector<ImageData> importTestTextures(const std::vector<std::string>& names);
+
+// Every file under directory that this build can decode (and dds files) in name order.  Throws std::runtime_error if the directory cannot be listed.
+std::vector<std::string> listTestTextures(const std::string& directory);
+
+// numViews cameras orbiting the meshlets of mesh - outside the model looking at its centre (mostly back face culling) or inside its bounds looking along the orbit (mostly frustum culling)
+std::vector<TestView> orbitViews(const MeshData& mesh, bool inside, int numViews);
+
+// numTextures streamed textures of 256 - 4096 texels with BC1 or BC7 level sizes on twice as many objects scattered over a 400 x 400 unit area, seen in a 1080 pixel viewport with a 60 degree field of view
+StreamedScene randomStreamedScene(uint32_t numTextures, std::mt19937& random);
+
+// Register the textures of scene with residency and return their ids
+std::vector<uint32_t> addStreamedTextures(MipResidency& residency, const StreamedScene& scene);
+
+// Camera position on frame of a walk crossing the scene in moveFrames frames and then standing still
+void getStreamedCamera(int frame, int moveFrames, float camera[2]);
+
+// Request the view of every object of scene from camera
+void requestStreamedViews(MipResidency& residency, const StreamedScene& scene, const std::vector<uint32_t>& ids, const float camera[2]);
+
+// Box of 0.5 to 5 units somewhere in a 1000 x 100 x 1000 unit scene
+Bounds randomBounds(std::mt19937& random);
+
+// Frustum planes of a camera at eye height somewhere in the scene of randomBounds looking in a random direction
+void randomFrustum(std::mt19937& random, float planes[6][4]);
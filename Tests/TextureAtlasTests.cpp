@@ -0,0 +1,148 @@
+// TextureAtlas tests - placement and exact copies of the sources, bleeding between neighbours in the mips and the remapping table
+
+#include "EngineTests.h"
+#include "TestScenes.h"
+#include <TextureAtlas.h>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+
+// Sources (with their borders) must not overlap or leave the slice and the top level must hold exact copies of the sources
+static bool checkPlacement(const TextureAtlas& atlas, const vector<ImageData>& images, uint32_t border) {
+
+	for (size_t i = 0; i < atlas.entries.size(); ++i) {
+
+		const AtlasEntry& a = atlas.entries[i];
+
+		if (a.x < border || a.y < border || a.x + a.width + border > atlas.width || a.y + a.height + border > atlas.height || a.slice >= atlas.slices.size()) {
+
+			cout << "  " << a.name << " is outside the atlas" << endl;
+			return false;
+		}
+
+		for (size_t j = i + 1; j < atlas.entries.size(); ++j) {
+
+			const AtlasEntry& b = atlas.entries[j];
+
+			if (a.slice == b.slice && a.x < b.x + b.width + 2 * border && b.x < a.x + a.width + 2 * border && a.y < b.y + b.height + 2 * border && b.y < a.y + a.height + 2 * border) {
+
+				cout << "  " << a.name << " overlaps " << b.name << endl;
+				return false;
+			}
+		}
+
+		const ImageData& top = atlas.slices[a.slice][0];
+
+		for (uint32_t y = 0; y < a.height; ++y)
+			if (memcmp(&top.pixels[((size_t)(a.y + y) * top.width + a.x) * 4], &images[i].pixels[(size_t)y * a.width * 4], (size_t)a.width * 4) != 0) {
+
+				cout << "  " << a.name << " is not copied exactly into the atlas" << endl;
+				return false;
+			}
+	}
+
+	return true;
+}
+
+
+// Pack constant images of the same sizes and check that every texel a bilinear filter can read for each source (the source and its border) keeps the source colour in every level
+static bool checkBleeding(const vector<ImageData>& images, const vector<string>& names, const AtlasOptions& options, uint32_t border) {
+
+	vector<ImageData> constants(images.size());
+
+	for (size_t i = 0; i < images.size(); ++i) {
+
+		constants[i].width = images[i].width;
+		constants[i].height = images[i].height;
+		constants[i].pixels.resize(images[i].pixels.size());
+
+		uint8_t colour[4] = { (uint8_t)(37 * i + 20), (uint8_t)(255 - 53 * i), (uint8_t)(91 * i + 7), 255 };
+
+		for (size_t p = 0; p < constants[i].pixels.size(); ++p)
+			constants[i].pixels[p] = colour[p & 3];
+	}
+
+	TextureAtlas atlas = buildTextureAtlas(constants, names, options);
+
+	for (size_t i = 0; i < atlas.entries.size(); ++i) {
+
+		const AtlasEntry& entry = atlas.entries[i];
+
+		for (size_t level = 0; level < atlas.slices[entry.slice].size(); ++level) {
+
+			const ImageData& mip = atlas.slices[entry.slice][level];
+			int difference = 0;
+
+			for (uint32_t y = (entry.y - border) >> level; y < (entry.y + entry.height + border) >> level; ++y)
+				for (uint32_t x = (entry.x - border) >> level; x < (entry.x + entry.width + border) >> level; ++x)
+					for (int c = 0; c < 4; ++c)
+						difference = max(difference, abs(mip.pixels[((size_t)y * mip.width + x) * 4 + c] - constants[i].pixels[c]));
+
+			// sRGB conversion may round a constant colour by 1
+			if (difference > 1) {
+
+				cout << "  " << entry.name << " is mixed with its neighbours in level " << level << endl;
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+// The table must reproduce the entries
+static bool checkTable(const TextureAtlas& atlas) {
+
+	string tableFile = (filesystem::temp_directory_path() / "test.atlas").string();
+	writeAtlasTable(tableFile, atlas);
+	vector<AtlasEntry> entries = readAtlasTable(tableFile);
+	filesystem::remove(tableFile);
+
+	bool same = entries.size() == atlas.entries.size();
+
+	for (size_t i = 0; same && i < entries.size(); ++i)
+		same = entries[i].name == atlas.entries[i].name && entries[i].slice == atlas.entries[i].slice && entries[i].x == atlas.entries[i].x && entries[i].y == atlas.entries[i].y && memcmp(entries[i].scaleOffset, atlas.entries[i].scaleOffset, sizeof(entries[i].scaleOffset)) == 0;
+
+	if (!same)
+		cout << "  The atlas table does not reproduce the entries" << endl;
+
+	return same;
+}
+
+
+bool testTextureAtlas(const vector<string>& names) {
+
+	bool passed = true;
+
+	vector<ImageData> images = importTestTextures(names);
+
+	cout << images.size() << " textures" << endl;
+
+	for (AtlasLayout layout : { AtlasLayout::Rectangles, AtlasLayout::Array }) {
+
+		AtlasOptions options;
+		options.layout = layout;
+
+		TextureAtlas atlas = buildTextureAtlas(images, names, options);
+
+		cout << "  " << getLayoutName(layout) << ": " << atlas.width << "x" << atlas.height << " x " << atlas.slices.size() << endl;
+
+		if (layout == AtlasLayout::Rectangles) {
+
+			uint32_t border = 1u << (max(1u, options.mipLevels) - 1);
+
+			passed &= checkPlacement(atlas, images, border);
+			passed &= checkBleeding(images, names, options, border);
+		}
+
+		passed &= checkTable(atlas);
+	}
+
+	return passed;
+}
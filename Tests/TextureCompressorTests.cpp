@@ -0,0 +1,97 @@
+// TextureCompressor tests - constant blocks, threaded against single threaded compression and a lower bound on the quality of real textures
+
+#include "EngineTests.h"
+#include <TextureCompressor.h>
+#include <ImageImporter.h>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+
+using namespace std;
+
+
+static const BlockFormat testFormats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 };
+
+
+// Constant blocks must be reproduced to within endpoint precision
+static bool testConstantBlocks() {
+
+	bool passed = true;
+	uint8_t constant[64], block[16], decoded[64];
+
+	for (int i = 0; i < 16; ++i) {
+
+		constant[i * 4 + 0] = 201;
+		constant[i * 4 + 1] = 77;
+		constant[i * 4 + 2] = 18;
+		constant[i * 4 + 3] = 140;
+	}
+
+	for (BlockFormat format : testFormats) {
+
+		compressBlock(format, constant, block);
+		decompressBlock(format, block, decoded);
+
+		for (int i = 0; i < 64; ++i) {
+
+			// 565 colour endpoints and BC7 endpoints sharing a p-bit across channels cannot hold every colour
+			bool colour = (i & 3) != 3;
+			int tolerance = format == BlockFormat::BC7 ? 1 : ((format == BlockFormat::BC1 || format == BlockFormat::BC3) && colour ? 4 : 0);
+
+			if ((getChannelMask(format) & (1 << (i & 3))) && abs(decoded[i] - constant[i]) > tolerance) {
+
+				cout << getFormatName(format) << " does not reproduce a constant block" << endl;
+				passed = false;
+				break;
+			}
+		}
+	}
+
+	return passed;
+}
+
+
+bool testTextureCompression(const vector<string>& filenames) {
+
+	bool passed = testConstantBlocks();
+
+	cout << fixed << setprecision(2);
+
+	for (const string& filename : filenames) {
+
+		ImageData image;
+		importImage(filename, image);
+
+		cout << filename << ": " << image.width << "x" << image.height << endl;
+
+		for (BlockFormat format : testFormats) {
+
+			// 4 threads so the threaded result is checked on small machines
+			vector<uint8_t> blocks = compressImage(image, format, 1);
+			vector<uint8_t> threadedBlocks = compressImage(image, format, 4);
+
+			ImageData result;
+			decompressImage(blocks.data(), image.width, image.height, format, result);
+			double psnr = computePSNR(image, result, getChannelMask(format));
+
+			cout << "  " << getFormatName(format) << ": " << psnr << " dB" << endl;
+
+			if (threadedBlocks != blocks) {
+
+				cout << "  Threaded compression differs from single threaded compression" << endl;
+				passed = false;
+			}
+
+			// Well below any real texture - catches broken block layouts rather than measuring quality
+			if (psnr < 20.0) {
+
+				cout << "  PSNR is implausibly low" << endl;
+				passed = false;
+			}
+		}
+	}
+
+	cout.unsetf(ios::floatfield);
+
+	return passed;
+}
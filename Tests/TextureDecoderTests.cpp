@@ -0,0 +1,48 @@
+// TextureDecoder tests - every texture decodes and the parallel results equal the serial results
+
+#include "EngineTests.h"
+#include "TestScenes.h"
+#include <TextureDecoder.h>
+#include <ImageImporter.h>
+#include <iostream>
+
+using namespace std;
+
+
+bool testTextureDecode(const string& directory) {
+
+	bool passed = true;
+
+	vector<string> filenames = listTestTextures(directory);
+
+	// 4 threads so the threaded result is checked on small machines
+	const unsigned int numThreads = 4;
+
+	vector<DecodedTexture> serial = decodeTextures(filenames, importImage, 1);
+	vector<DecodedTexture> parallel = decodeTextures(filenames, importImage, numThreads);
+
+	cout << filenames.size() << " textures" << endl;
+
+	for (size_t i = 0; i < filenames.size(); ++i) {
+
+		if (!serial[i].succeeded) {
+
+			cout << "  " << filenames[i] << ": " << serial[i].error << endl;
+			passed = false;
+			continue;
+		}
+
+		bool same = parallel[i].succeeded && serial[i].mips.size() == parallel[i].mips.size() && (serial[i].ddsFile != nullptr) == (parallel[i].ddsFile != nullptr);
+
+		for (size_t level = 0; same && level < serial[i].mips.size(); ++level)
+			same = serial[i].mips[level].pixels == parallel[i].mips[level].pixels;
+
+		if (!same) {
+
+			cout << "  " << filenames[i] << " decodes differently on " << numThreads << " threads" << endl;
+			passed = false;
+		}
+	}
+
+	return passed;
+}
@@ -0,0 +1,631 @@
+
+//
+// AssetCooker.cpp
+//
+
+// Headless asset cooker.  Converts the models and textures under an input directory (Resources by default) into cooked binary formats in parallel using only the platform independent parts of the engine (see CMakeLists.txt):
+//   obj and 3ds models are imported, simplified into the LOD chain, split into meshlets and quantised into .mesh files (see CookedMesh.h) that MeshAsset loads directly
+//   bmp and tif textures (png and jpg when built with libpng / libjpeg) are decoded, given a full mip chain and block compressed into .dds files (see chooseTextureFormat)
+//   uncompressed 32 bit dds textures are recompressed the same way - other dds textures (already compressed, cube maps) are validated and copied
+//   groups of small textures (see atlasGroups) are also packed into block compressed atlases with a remapping table (see TextureAtlas.h)
+// Other files are skipped.  The directory structure of the input is kept.  A timing report is printed for every asset and can also be written as CSV.
+//
+// Usage: AssetCooker [-j threads] [--bc3] [--report report.csv] [input directory] [output directory]
+//   --bc3 compresses textures with alpha as BC3 instead of BC7
+
+#include <MeshData.h>
+#include <MeshQuantiser.h>
+#include <MeshSimplifier.h>
+#include <Meshlet.h>
+#include <ObjImporter.h>
+#include <Importer3DS.h>
+#include <CookedMesh.h>
+#include <ImageImporter.h>
+#include <DDSFile.h>
+#include <MipGenerator.h>
+#include <TextureCompressor.h>
+#include <TextureAtlas.h>
+#include <MappedFile.h>
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#include <cmath>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+
+// Matches MeshAsset::numLODs so cooked meshes have the same LOD chain as meshes imported at run time
+static const int numLODs = 4;
+
+enum class AssetType { Model, Texture, DDS, Atlas };
+
+// Texture formats chosen by name before falling back to the alpha test in chooseTextureFormat.  Names are compared in lower case.
+struct TextureRule {
+	const char							*name;
+	bool								compress; // Otherwise RGBA8 with mips
+	BlockFormat							format;
+};
+
+static const TextureRule textureRules[] = {
+	{ "heightmap", false, BlockFormat::BC1 }, // Terrain heights and normals are read back on the CPU as RGBA8
+	{ "normalmap", false, BlockFormat::BC1 },
+	{ "_normal", true, BlockFormat::BC5 }, // Tangent space normal maps (z is reconstructed in the shader)
+	{ "waves", true, BlockFormat::BC5 }, // Ocean normal map
+	{ "_disp", true, BlockFormat::BC4 }, // Displacement (height) maps
+};
+
+// Textures with alpha use BC3 instead of BC7 (--bc3)
+static bool alphaAsBC3 = false;
+
+// Small textures drawn by the same kind of object are packed into one texture so the objects can share a texture bind.  Sources are relative to the input directory and are named that way in the .atlas table written next to the .dds file.  Groups whose sources are not all present are skipped.
+struct AtlasGroup {
+	const char							*output; // Relative to the output directory, without extension
+	AtlasLayout							layout;
+	vector<const char*>					sources;
+};
+
+static const AtlasGroup atlasGroups[] = {
+	{ "Textures/sprites", AtlasLayout::Rectangles, { "Textures/flares/divine.png", "Textures/flares/extendring.png", "Textures/Fire.tif", "Textures/smoke.tif" } }, // Flares and particle systems
+	{ "Textures/foliage", AtlasLayout::Array, { "Textures/tree.tif", "Textures/fur.png" } }, // Alpha tested foliage and fur shells
+};
+
+struct CookJob {
+	fs::path							source; // The atlas output name (relative to the input directory) for atlas jobs
+	fs::path							output;
+	AssetType							type;
+	const AtlasGroup					*atlas = nullptr;
+	fs::path							inputDir; // Atlas sources are relative to it
+
+	// Results
+	bool								succeeded = false;
+	string								message;
+	uintmax_t							inputBytes = 0;
+	uintmax_t							outputBytes = 0;
+	double								loadSeconds = 0.0; // Import / decode
+	double								processSeconds = 0.0; // LOD generation, meshlets and quantisation / mips and block compression
+	double								writeSeconds = 0.0;
+
+	double getTotalSeconds() const { return loadSeconds + processSeconds + writeSeconds; };
+};
+
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static uintmax_t getInputBytes(const CookJob& job) {
+
+	if (job.type != AssetType::Atlas)
+		return fs::file_size(job.source);
+
+	uintmax_t bytes = 0;
+
+	for (const char *source : job.atlas->sources)
+		bytes += fs::file_size(job.inputDir / source);
+
+	return bytes;
+}
+
+static string lowerExtension(const fs::path& path) {
+
+	string ext = path.extension().string();
+
+	for (char& c : ext)
+		c = (char)tolower((unsigned char)c);
+
+	return ext;
+}
+
+
+static void cookModel(CookJob& job) {
+
+	auto start = chrono::steady_clock::now();
+
+	MeshData mesh;
+
+	// OBJ files are mirrored in x to match the handedness used by the application (see MeshAsset::loadModelOBJ)
+	if (lowerExtension(job.source) == ".obj")
+		importOBJ(job.source.string(), mesh, true);
+	else
+		import3DS(job.source.string(), mesh);
+
+	job.loadSeconds = secondsSince(start);
+	start = chrono::steady_clock::now();
+
+	generateLODs(mesh, numLODs);
+	buildMeshlets(mesh);
+
+	vector<QuantisedVertexStruct> vertices;
+	QuantisationParams dequantisation = quantiseMesh(mesh, vertices);
+
+	job.processSeconds = secondsSince(start);
+	start = chrono::steady_clock::now();
+
+	writeCookedMesh(job.output.string(), mesh, vertices, dequantisation);
+
+	job.writeSeconds = secondsSince(start);
+
+	uint32_t numTriangles = 0;
+	for (const SubMesh& subMesh : mesh.lods[0].subMeshes)
+		numTriangles += subMesh.indexCount / 3;
+
+	job.message = to_string(numTriangles) + " triangles, " + to_string(vertices.size()) + " vertices, " + to_string(mesh.lods.size()) + " LODs, " + to_string(mesh.meshlets.size()) + " meshlets";
+}
+
+
+// Pick the block format for a texture.  Returns false if the texture should stay uncompressed (RGBA8).
+static bool hasAlpha(const ImageData& image) {
+
+	for (size_t i = 3; i < image.pixels.size(); i += 4)
+		if (image.pixels[i] != 255)
+			return true;
+
+	return false;
+}
+
+static bool chooseTextureFormat(const fs::path& source, const ImageData& image, BlockFormat& format, string& reason) {
+
+	string name = source.stem().string();
+
+	for (char& c : name)
+		c = (char)tolower((unsigned char)c);
+
+	for (const TextureRule& rule : textureRules) {
+
+		if (name.find(rule.name) != string::npos) {
+
+			format = rule.format;
+			reason = string("name matches ") + rule.name;
+
+			if (!rule.compress)
+				return false;
+
+			break;
+		}
+	}
+
+	if (reason.empty())
+		format = hasAlpha(image) ? (alphaAsBC3 ? BlockFormat::BC3 : BlockFormat::BC7) : BlockFormat::BC1;
+
+	return true;
+}
+
+
+// Generate the mip chain, compress it and write the dds file.  The message reports the format, the PSNR of the top level and the encode throughput (texels of every level per second).
+static void compressTexture(CookJob& job, const ImageData& image) {
+
+	auto start = chrono::steady_clock::now();
+
+	BlockFormat format;
+	string reason;
+	bool compress = chooseTextureFormat(job.source, image, format, reason);
+
+	ostringstream message;
+	message << image.width << "x" << image.height << " ";
+
+	// Direct3D requires the top level of a block compressed texture to be a whole number of blocks so other sizes are rounded up
+	ImageData resized;
+	const ImageData *source = &image;
+
+	if (compress && (image.width % 4 != 0 || image.height % 4 != 0)) {
+
+		resized = resizeImage(image, (image.width + 3) & ~3u, (image.height + 3) & ~3u);
+		source = &resized;
+
+		message << "-> " << resized.width << "x" << resized.height << " ";
+	}
+
+	// Filtering follows the naming convention of the application's texture loader (sRGB colour, normal maps and alpha tested foliage)
+	MipOptions mipOptions = getDefaultMipOptions(job.source.string());
+
+	if (compress && format == BlockFormat::BC5)
+		mipOptions.normalMap = true;
+
+	vector<ImageData> mips = generateMipChain(*source, mipOptions);
+
+	if (!compress) {
+
+		job.processSeconds = secondsSince(start);
+		start = chrono::steady_clock::now();
+
+		writeDDS(job.output.string(), mips);
+
+		job.writeSeconds = secondsSince(start);
+
+		message << "RGBA8, " << mips.size() << " mips (" << reason << ")";
+		job.message = message.str();
+		return;
+	}
+
+	// Assets are already cooked in parallel so each texture is compressed on one thread
+	auto encodeStart = chrono::steady_clock::now();
+
+	vector<vector<uint8_t>> levels;
+	size_t numTexels = 0;
+
+	for (const ImageData& mip : mips) {
+
+		levels.push_back(compressImage(mip, format, 1));
+		numTexels += (size_t)mip.width * mip.height;
+	}
+
+	double encodeSeconds = secondsSince(encodeStart);
+
+	ImageData decoded;
+	decompressImage(levels[0].data(), source->width, source->height, format, decoded);
+	double psnr = computePSNR(*source, decoded, getChannelMask(format));
+
+	job.processSeconds = secondsSince(start);
+	start = chrono::steady_clock::now();
+
+	writeDDS(job.output.string(), source->width, source->height, getDXGIFormat(format), getBlockBytes(format), levels);
+
+	job.writeSeconds = secondsSince(start);
+
+	message << getFormatName(format) << ", " << mips.size() << " mips, " << fixed << setprecision(1);
+
+	if (isinf(psnr))
+		message << "lossless";
+	else
+		message << psnr << " dB";
+
+	message << ", " << numTexels / 1e6 / max(encodeSeconds, 1e-9) << " MPix/s";
+
+	if (!reason.empty())
+		message << " (" << reason << ")";
+
+	job.message = message.str();
+}
+
+
+static void cookTexture(CookJob& job) {
+
+	auto start = chrono::steady_clock::now();
+
+	ImageData image;
+	importImage(job.source.string(), image);
+
+	job.loadSeconds = secondsSince(start);
+
+	compressTexture(job, image);
+}
+
+
+// Pack the group into an atlas, compress every level of every slice and write the dds file and the remapping table.  The message reports the packing efficiency and the texture binds replaced by the atlas.
+static void cookAtlas(CookJob& job) {
+
+	auto start = chrono::steady_clock::now();
+
+	vector<ImageData> images(job.atlas->sources.size());
+	vector<string> names;
+
+	for (size_t i = 0; i < images.size(); ++i) {
+
+		importImage((job.inputDir / job.atlas->sources[i]).string(), images[i]);
+		names.push_back(job.atlas->sources[i]);
+	}
+
+	job.loadSeconds = secondsSince(start);
+	start = chrono::steady_clock::now();
+
+	AtlasOptions options;
+	options.layout = job.atlas->layout;
+
+	TextureAtlas atlas = buildTextureAtlas(images, names, options);
+
+	// Space between the sources of a rectangle atlas is transparent so the format follows the sources
+	BlockFormat format = any_of(images.begin(), images.end(), hasAlpha) ? (alphaAsBC3 ? BlockFormat::BC3 : BlockFormat::BC7) : BlockFormat::BC1;
+
+	vector<vector<vector<uint8_t>>> slices;
+
+	for (const vector<ImageData>& slice : atlas.slices) {
+
+		slices.push_back(vector<vector<uint8_t>>());
+
+		for (const ImageData& mip : slice)
+			slices.back().push_back(compressImage(mip, format, 1));
+	}
+
+	job.processSeconds = secondsSince(start);
+	start = chrono::steady_clock::now();
+
+	writeDDS(job.output.string(), atlas.width, atlas.height, getDXGIFormat(format), getBlockBytes(format), slices);
+
+	fs::path table = job.output;
+	writeAtlasTable(table.replace_extension(".atlas").string(), atlas);
+
+	job.writeSeconds = secondsSince(start);
+
+	ostringstream message;
+	message << images.size() << " textures -> " << getLayoutName(atlas.layout) << " atlas of " << atlas.width << "x" << atlas.height << " x " << atlas.slices.size() << ", " << getFormatName(format) << ", ";
+	message << atlas.slices[0].size() << " mips, " << fixed << setprecision(1) << getPackingEfficiency(atlas, images) * 100.0f << "% packed, " << images.size() << " texture binds -> 1";
+
+	job.message = message.str();
+}
+
+
+// Uncompressed 32 bit dds textures are recompressed like other textures.  Compressed textures and cube maps are copied.
+static void cookDDS(CookJob& job) {
+
+	auto start = chrono::steady_clock::now();
+
+	MappedFile file(job.source.string());
+
+	if (!file.isValid())
+		throw runtime_error("Cannot open dds file " + job.source.string());
+
+	DDSInfo info = readDDSInfo(file.getData(), file.getSize());
+
+	if (info.fourCC == 0 && info.dxgiFormat == 0 && !info.isCubeMap && info.depth == 1) {
+
+		ImageData image;
+		readDDSImage(file.getData(), file.getSize(), image);
+
+		job.loadSeconds = secondsSince(start);
+
+		compressTexture(job, image);
+		return;
+	}
+
+	job.loadSeconds = secondsSince(start);
+	start = chrono::steady_clock::now();
+
+	ofstream output(job.output, ios::binary);
+	output.write(reinterpret_cast<const char*>(file.getData()), file.getSize());
+
+	if (!output)
+		throw runtime_error("Cannot write dds file " + job.output.string());
+
+	job.writeSeconds = secondsSince(start);
+	job.message = to_string(info.width) + "x" + to_string(info.height) + ", " + to_string(info.mipLevels) + " mips (copied)";
+}
+
+
+static void cook(CookJob& job) {
+
+	try
+	{
+		job.inputBytes = getInputBytes(job);
+
+		fs::create_directories(job.output.parent_path());
+
+		switch (job.type) {
+
+		case AssetType::Model: cookModel(job); break;
+		case AssetType::Texture: cookTexture(job); break;
+		case AssetType::DDS: cookDDS(job); break;
+		case AssetType::Atlas: cookAtlas(job); break;
+		}
+
+		job.outputBytes = fs::file_size(job.output);
+		job.succeeded = true;
+	}
+	catch (exception& e)
+	{
+		job.message = e.what();
+	}
+}
+
+
+// Find every asset under inputDir that can be cooked.  Output names replace the extension (.mesh / .dds) - if two sources would share an output name (Bridge.obj and bridge.3DS) the source extension is kept in the name.
+static vector<CookJob> findJobs(const fs::path& inputDir, const fs::path& outputDir) {
+
+	vector<CookJob> jobs;
+
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(inputDir)) {
+
+		if (!entry.is_regular_file())
+			continue;
+
+		string ext = lowerExtension(entry.path());
+
+		CookJob job;
+		job.source = entry.path();
+
+		if (ext == ".obj" || ext == ".3ds")
+			job.type = AssetType::Model;
+		else if (ext == ".dds")
+			job.type = AssetType::DDS;
+		else if (canImportImage(ext))
+			job.type = AssetType::Texture;
+		else
+			continue;
+
+		job.output = outputDir / fs::relative(entry.path(), inputDir);
+		job.output.replace_extension(job.type == AssetType::Model ? ".mesh" : ".dds");
+
+		jobs.push_back(job);
+	}
+
+	// Output names are compared without case as cooked assets are also used on Windows
+	map<string, int> outputCount;
+
+	auto foldedOutput = [](const CookJob& job) {
+
+		string name = job.output.string();
+
+		for (char& c : name)
+			c = (char)tolower((unsigned char)c);
+
+		return name;
+	};
+
+	for (const CookJob& job : jobs)
+		outputCount[foldedOutput(job)]++;
+
+	for (CookJob& job : jobs)
+		if (outputCount[foldedOutput(job)] > 1)
+			job.output.replace_filename(job.source.stem().string() + "_" + lowerExtension(job.source).substr(1) + job.output.extension().string());
+
+	for (const AtlasGroup& group : atlasGroups) {
+
+		CookJob job;
+		job.source = inputDir / group.output;
+		job.output = outputDir / (string(group.output) + ".dds");
+		job.type = AssetType::Atlas;
+		job.atlas = &group;
+		job.inputDir = inputDir;
+
+		if (all_of(group.sources.begin(), group.sources.end(), [&](const char *source) { return fs::is_regular_file(inputDir / source); }))
+			jobs.push_back(job);
+	}
+
+	sort(jobs.begin(), jobs.end(), [](const CookJob& a, const CookJob& b) { return a.source < b.source; });
+
+	return jobs;
+}
+
+
+static const char *typeName(AssetType type) {
+
+	switch (type) {
+
+	case AssetType::Model: return "model";
+	case AssetType::Texture: return "texture";
+	case AssetType::Atlas: return "atlas";
+	default: return "dds";
+	}
+}
+
+
+static void printReport(const vector<CookJob>& jobs, const fs::path& inputDir, unsigned int numThreads, double wallSeconds) {
+
+	cout << endl << left << setw(48) << "Asset" << setw(9) << "Type" << right << setw(10) << "In KB" << setw(10) << "Out KB" << setw(10) << "Load ms" << setw(12) << "Process ms" << setw(10) << "Write ms" << setw(10) << "Total ms" << "  Result" << endl;
+
+	double totalSeconds = 0.0;
+	uintmax_t totalIn = 0, totalOut = 0;
+	int numFailed = 0;
+
+	cout << fixed << setprecision(1);
+
+	for (const CookJob& job : jobs) {
+
+		cout << left << setw(48) << fs::relative(job.source, inputDir).string() << setw(9) << typeName(job.type) << right << setw(10) << job.inputBytes / 1024 << setw(10) << job.outputBytes / 1024;
+		cout << setw(10) << job.loadSeconds * 1000.0 << setw(12) << job.processSeconds * 1000.0 << setw(10) << job.writeSeconds * 1000.0 << setw(10) << job.getTotalSeconds() * 1000.0;
+		cout << "  " << (job.succeeded ? "" : "FAILED: ") << job.message << endl;
+
+		totalSeconds += job.getTotalSeconds();
+		totalIn += job.inputBytes;
+		totalOut += job.outputBytes;
+		numFailed += job.succeeded ? 0 : 1;
+	}
+
+	cout << endl << "Cooked " << jobs.size() - numFailed << " of " << jobs.size() << " assets (" << totalIn / 1024 << " KB -> " << totalOut / 1024 << " KB) on " << numThreads << " threads" << endl;
+	cout << "Asset time = " << totalSeconds * 1000.0 << "ms, wall time = " << wallSeconds * 1000.0 << "ms, parallel speedup = " << (wallSeconds > 0.0 ? totalSeconds / wallSeconds : 0.0) << "x" << endl;
+	cout.unsetf(ios::floatfield);
+}
+
+
+static void writeCSVReport(const string& filename, const vector<CookJob>& jobs, const fs::path& inputDir) {
+
+	ofstream csv(filename);
+
+	if (!csv) {
+
+		cout << "Cannot write report " << filename << endl;
+		return;
+	}
+
+	csv << "asset,type,input_bytes,output_bytes,load_ms,process_ms,write_ms,total_ms,succeeded,message" << endl;
+
+	for (const CookJob& job : jobs) {
+
+		string message = job.message;
+		replace(message.begin(), message.end(), ',', ';');
+
+		csv << fs::relative(job.source, inputDir).string() << "," << typeName(job.type) << "," << job.inputBytes << "," << job.outputBytes << ",";
+		csv << job.loadSeconds * 1000.0 << "," << job.processSeconds * 1000.0 << "," << job.writeSeconds * 1000.0 << "," << job.getTotalSeconds() * 1000.0 << ",";
+		csv << (job.succeeded ? 1 : 0) << "," << message << endl;
+	}
+}
+
+
+int main(int argc, char **argv) {
+
+	fs::path inputDir = "Resources";
+	fs::path outputDir = "Cooked";
+	string reportFile;
+	unsigned int numThreads = max(1u, thread::hardware_concurrency());
+
+	vector<string> positional;
+
+	for (int i = 1; i < argc; ++i) {
+
+		string arg = argv[i];
+
+		if (arg == "-j" && i + 1 < argc)
+			numThreads = max(1, atoi(argv[++i]));
+		else if (arg == "--bc3")
+			alphaAsBC3 = true;
+		else if (arg == "--report" && i + 1 < argc)
+			reportFile = argv[++i];
+		else if (arg == "-h" || arg == "--help") {
+
+			cout << "Usage: AssetCooker [-j threads] [--bc3] [--report report.csv] [input directory] [output directory]" << endl;
+			return 0;
+		}
+		else
+			positional.push_back(arg);
+	}
+
+	if (positional.size() > 0)
+		inputDir = positional[0];
+	if (positional.size() > 1)
+		outputDir = positional[1];
+
+	if (!fs::is_directory(inputDir)) {
+
+		cout << "Input directory " << inputDir.string() << " not found" << endl;
+		return 1;
+	}
+
+	vector<CookJob> jobs = findJobs(inputDir, outputDir);
+
+	// Largest assets first so one big model does not finish last on its own
+	vector<size_t> order(jobs.size());
+
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+
+	sort(order.begin(), order.end(), [&](size_t a, size_t b) { return getInputBytes(jobs[a]) > getInputBytes(jobs[b]); });
+
+	numThreads = (unsigned int)min<size_t>(numThreads, max<size_t>(1, jobs.size()));
+
+	auto start = chrono::steady_clock::now();
+
+	atomic<size_t> nextJob(0);
+	vector<thread> workers;
+
+	for (unsigned int t = 0; t < numThreads; ++t)
+		workers.push_back(thread([&]() {
+
+			for (size_t i = nextJob++; i < order.size(); i = nextJob++)
+				cook(jobs[order[i]]);
+		}));
+
+	for (thread& worker : workers)
+		worker.join();
+
+	double wallSeconds = secondsSince(start);
+
+	printReport(jobs, inputDir, numThreads, wallSeconds);
+
+	if (!reportFile.empty())
+		writeCSVReport(reportFile, jobs, inputDir);
+
+	bool failed = any_of(jobs.begin(), jobs.end(), [](const CookJob& job) { return !job.succeeded; });
+
+	return failed ? 2 : 0;
+}
@@ -0,0 +1,108 @@
+
+//
+// Benchmarks.cpp
+//
+
+// Headless benchmarks of the platform independent engine code (see CMakeLists.txt).  The benchmarks only time and report - the checks of the same code are the EngineTests run by ctest.  The exit code is non-zero if a benchmark cannot run.
+//
+// Usage: Benchmarks [benchmark names]   (all benchmarks are run if no names are given).  Run from the repository root so the models under Resources are found.
+
+#include "Benchmarks.h"
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+
+struct Benchmark {
+	const char							*name;
+	const char							*description;
+	function<bool()>					run;
+};
+
+
+// The shaders requested at startup by the Scene effects and the BlurUtility, in order
+static bool benchmarkStartupShaders() {
+
+	const char *effects[][2] = {
+		{ "basic_colour_vs", "basic_colour_ps" }, { "basic_lighting_vs", "basic_colour_ps" }, { "per_pixel_lighting_vs", "per_pixel_lighting_ps" }, { "sky_box_vs", "sky_box_ps" },
+		{ "per_pixel_lighting_vs", "reflection_map_ps" }, { "ocean_vs", "ocean_ps" }, { "grass_vs", "grass_ps" }, { "per_pixel_lighting_vs_wind", "per_pixel_lighting_ps_texcolour" },
+		{ "per_pixel_lighting_vs_wind_instanced", "per_pixel_lighting_ps_texcolour" }, { "fire_vs", "fire_ps" }, { "fire_vs", "fire_ps" }, { "flare_vs", "flare_ps" },
+		{ "screen_quad_vs", "per_pixel_lighting_vs" }, { "convolve_u_ps", "convolve_v_ps" }, { "emissive_ps", "copy_ps" }, { "copy_depth_ps", "basic_colour_vs" }, { "basic_colour_ps", nullptr }
+	};
+
+	vector<string> filenames;
+
+	for (auto& effect : effects)
+		for (const char *shader : effect)
+			if (shader)
+				filenames.push_back(string("Shaders/cso/") + shader + ".cso");
+
+	// The shaders are compiled by the DX11Proj.vcxproj build (they are not committed)
+	for (const string& filename : filenames)
+		if (!filesystem::exists(filename)) {
+
+			cout << "Skipped: " << filename << " is not compiled (build DX11Proj.vcxproj first)" << endl;
+			return true;
+		}
+
+	return benchmarkShaderBytecode(filenames);
+}
+
+
+int main(int argc, char **argv) {
+
+	vector<Benchmark> benchmarks = {
+		{ "bounds", "Local bounds reduction and world bounds refresh of 100k objects", []() { return benchmarkBounds(100000); } },
+		{ "meshlets", "Meshlet build time and culled triangle ratios of the castle and shark", []() { return benchmarkMeshlets("Resources/Models/castle.3DS") & benchmarkMeshlets("Resources/Models/Shark.obj"); } },
+		{ "texturecompression", "BC1 / BC3 / BC4 / BC5 / BC7 encode throughput and PSNR of an opaque and an alpha texture", []() { return benchmarkTextureCompression("Resources/Models/Bridge/Brick_DIFFUSE.jpg") & benchmarkTextureCompression("Resources/Textures/tree.tif"); } },
+		{ "mips", "Box / Kaiser / Lanczos mip generation throughput of an opaque and a foliage texture", []() { return benchmarkMipGeneration("Resources/Models/Bridge/Brick_DIFFUSE.jpg") & benchmarkMipGeneration("Resources/Textures/tree.tif"); } },
+		{ "texturedecode", "Serial and parallel decode and mip generation wall time of every texture under Resources/Textures", []() { return benchmarkTextureDecode("Resources/Textures"); } },
+		{ "atlas", "Rectangle and array atlas packing efficiency of the scene sprites and of a set of flare sprites", []() { return benchmarkTextureAtlas({ "flares/divine.png", "flares/extendring.png", "Fire.tif", "smoke.tif" }) & benchmarkTextureAtlas({ "flares/aura.png", "flares/corona.png", "flares/hexagon.png", "flares/iris.png", "flares/nova.png", "flares/pollen.png", "flares/ring.png", "flares/sparkle.png", "flares/star.png", "flares/sun.png", "fur.png", "tree.tif" }); } },
+		{ "shaders", "Compiled shader files and bytes read by the startup effects with a separate read per request and with each file mapped once", []() { return benchmarkStartupShaders(); } },
+		{ "bvh", "Binned SAH build, refit and background rebuild of a BVH over 100k moving objects and its frustum, ray and sphere queries against testing every object", []() { return benchmarkSceneBVH(100000); } },
+		{ "import", "Native OBJ and 3DS import time of the scene models and a synthetic 1M triangle OBJ", []() { return benchmarkImport({ "Resources/Models/Shark.obj", "Resources/Models/Bridge.obj", "Resources/Models/logs.obj" }, { "Resources/Models/castle.3DS", "Resources/Models/knight.3DS", "Resources/Models/tree.3DS", "Resources/Models/sphere.3ds", "Resources/Models/bridge.3DS" }); } },
+		{ "mipstreaming", "Mip residency decisions for 1000 streamed textures within a 16 MB budget while the camera crosses the scene", []() { return benchmarkMipResidency(1000); } },
+	};
+
+	vector<string> selected(argv + 1, argv + argc);
+
+	if (!selected.empty() && (selected[0] == "-h" || selected[0] == "--help")) {
+
+		cout << "Usage: Benchmarks [benchmark names]" << endl;
+
+		for (const Benchmark& benchmark : benchmarks)
+			cout << "  " << benchmark.name << " - " << benchmark.description << endl;
+
+		return 0;
+	}
+
+	bool passed = true;
+	int numRun = 0;
+
+	for (const Benchmark& benchmark : benchmarks) {
+
+		bool run = selected.empty();
+
+		for (const string& name : selected)
+			run |= (name == benchmark.name);
+
+		if (!run)
+			continue;
+
+		cout << endl << "== " << benchmark.name << " ==" << endl;
+		passed &= benchmark.run();
+		++numRun;
+	}
+
+	if (numRun == 0) {
+
+		cout << "No benchmark matches the given names (see --help)" << endl;
+		return 1;
+	}
+
+	return passed ? 0 : 2;
+}
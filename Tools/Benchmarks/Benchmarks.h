@@ -0,0 +1,42 @@
+//
+// Benchmarks.h
+//
+
+// Benchmarks run by Benchmarks.cpp.  Each times the engine code on the scene's assets or a generated scene and prints what it measured - the checks of the same code are the EngineTests (see Tests/EngineTests.h, which also supplies secondsSince).  Each returns false if it cannot run.
+
+#pragma once
+#include <EngineTests.h>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+// Time the SIMD local bounds reduction of 1M vertices and the world bounds refresh of numObjects objects (batched, lazy and by projecting the 8 corners)
+bool benchmarkBounds(size_t numObjects = 100000);
+
+// Import a model (obj or 3ds), time buildMeshlets and report the triangles culled and the draw ranges from cameras orbiting the model
+bool benchmarkMeshlets(const std::string& filename);
+
+// Compress an image into every format on 1 and all hardware threads and report throughput, compression ratio and PSNR
+bool benchmarkTextureCompression(const std::string& filename);
+
+// Import an image and time each mip filter with the scalar and SSE paths on 1 and all hardware threads in megapixels (of the top level) per second
+bool benchmarkMipGeneration(const std::string& filename);
+
+// Time packing the textures under Resources/Textures (named relative to it) in both atlas layouts and report packing efficiency, size and texture binds saved against separate textures with full mip chains
+bool benchmarkTextureAtlas(const std::vector<std::string>& names);
+
+// Decode every texture under directory (with mips) on 1 thread and on every hardware thread and report the wall time of each and the sum of the per file decode times
+bool benchmarkTextureDecode(const std::string& directory);
+
+// Time MipResidency::update() for numTextures streamed textures within a 16 MB budget while a camera crosses the scene and report the loads, evictions and settled residency
+bool benchmarkMipResidency(uint32_t numTextures = 1000);
+
+// Load each file the way the effects were created at startup (a separate read of every request) and through a ShaderBytecodeStore and compare the files read, bytes read and time taken
+bool benchmarkShaderBytecode(const std::vector<std::string>& filenames);
+
+// Build a BVH over numObjects random objects and compare the build, refit and background rebuild times and the frustum, ray and sphere query times with testing every object (and with cullBounds)
+bool benchmarkSceneBVH(size_t numObjects = 100000);
+
+// Average time of the native OBJ importer over the OBJ files and a synthetic OBJ of numSyntheticTriangles triangles (written to the temporary directory), and of the native 3DS importer over the 3DS files with its peak working memory
+bool benchmarkImport(const std::vector<std::string>& objFilenames, const std::vector<std::string>& filenames3DS, uint32_t numSyntheticTriangles = 1000000);
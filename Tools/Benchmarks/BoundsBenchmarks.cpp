@@ -0,0 +1,87 @@
+// Bounds benchmarks - the SIMD local bounds reduction and world bounds refresh against the scalar references
+
+#include "Benchmarks.h"
+#include <TestScenes.h>
+#include <Bounds.h>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+bool benchmarkBounds(size_t numObjects) {
+
+	const int numRepeats = 20;
+
+	mt19937 random(1234);
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	cout << fixed << setprecision(3);
+
+	// Local bounds - min / max reduction over a large vertex buffer
+	vector<MeshVertex> vertices(1000000);
+
+	for (MeshVertex& v : vertices)
+		for (int i = 0; i < 3; ++i)
+			v.pos[i] = unit(random) * (10.0f + 5.0f * i);
+
+	auto start = chrono::steady_clock::now();
+	computeBoundsScalar(vertices[0].pos, vertices.size(), sizeof(MeshVertex));
+	double scalarSeconds = secondsSince(start);
+
+	start = chrono::steady_clock::now();
+	computeBounds(vertices.data(), vertices.size());
+	double simdSeconds = secondsSince(start);
+
+	cout << "Bounds of " << vertices.size() << " vertices: scalar = " << scalarSeconds * 1000.0 << "ms, SIMD = " << simdSeconds * 1000.0 << "ms (" << (simdSeconds > 0.0 ? scalarSeconds / simdSeconds : 0.0) << "x)" << endl;
+
+	// World bounds - random scale, rotation and translation per object
+	vector<Bounds> local, world(numObjects), reference(numObjects);
+	vector<float> matrices;
+	randomTransformedBounds(numObjects, random, local, matrices);
+
+	double cornerSeconds = 0.0, simdRefreshSeconds = 0.0, lazySeconds = 0.0;
+
+	for (int repeat = 0; repeat < numRepeats; ++repeat) {
+
+		start = chrono::steady_clock::now();
+
+		for (size_t i = 0; i < numObjects; ++i)
+			reference[i] = transformBoundsCorners(local[i], &matrices[i * 16]);
+
+		cornerSeconds += secondsSince(start);
+
+		start = chrono::steady_clock::now();
+		transformBounds(local.data(), matrices.data(), world.data(), numObjects);
+		simdRefreshSeconds += secondsSince(start);
+	}
+
+	// Lazy refresh where 1 in 10 objects moved since the last frame (see BaseModel::getWorldBounds)
+	vector<uint8_t> dirty(numObjects);
+
+	for (size_t i = 0; i < numObjects; ++i)
+		dirty[i] = (random() % 10) == 0;
+
+	for (int repeat = 0; repeat < numRepeats; ++repeat) {
+
+		start = chrono::steady_clock::now();
+
+		for (size_t i = 0; i < numObjects; ++i)
+			if (dirty[i])
+				world[i] = transformBounds(local[i], &matrices[i * 16]);
+
+		lazySeconds += secondsSince(start);
+	}
+
+	cornerSeconds /= numRepeats;
+	simdRefreshSeconds /= numRepeats;
+	lazySeconds /= numRepeats;
+
+	cout << "World bounds refresh of " << numObjects << " objects: 8 corners = " << cornerSeconds * 1000.0 << "ms, SIMD = " << simdRefreshSeconds * 1000.0 << "ms (" << simdRefreshSeconds * 1e9 / numObjects << "ns per object, ";
+	cout << (simdRefreshSeconds > 0.0 ? cornerSeconds / simdRefreshSeconds : 0.0) << "x), lazy with 10% moved = " << lazySeconds * 1000.0 << "ms" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
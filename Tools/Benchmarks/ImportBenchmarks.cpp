@@ -0,0 +1,97 @@
+// Import benchmarks - the native OBJ and 3DS importers the application and the cooker use for .obj and .3ds files
+
+#include "Benchmarks.h"
+#include <ObjImporter.h>
+#include <Importer3DS.h>
+#include <MeshData.h>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+
+using namespace std;
+
+
+static const int numImportRuns = 5;
+
+
+static bool benchmarkOBJ(const string& filename) {
+
+	ObjImportStats stats = {};
+	auto start = chrono::steady_clock::now();
+
+	for (int run = 0; run < numImportRuns; ++run) {
+
+		MeshData meshData;
+		importOBJ(filename, meshData, true, &stats);
+	}
+
+	double seconds = secondsSince(start) / numImportRuns;
+
+	cout << filename << ": " << stats.numTriangles << " triangles, " << stats.numVertices << " vertices" << endl;
+	cout << "  " << seconds * 1000.0 << " ms on " << stats.numThreads << " threads (parse " << stats.parseSeconds * 1000.0 << " ms, merge " << stats.mergeSeconds * 1000.0 << " ms, weld " << stats.weldSeconds * 1000.0 << " ms)" << endl;
+
+	return true;
+}
+
+
+static bool benchmark3DS(const string& filename) {
+
+	Import3DSStats stats = {};
+	auto start = chrono::steady_clock::now();
+
+	for (int run = 0; run < numImportRuns; ++run) {
+
+		MeshData meshData;
+		import3DS(filename, meshData, &stats);
+	}
+
+	double seconds = secondsSince(start) / numImportRuns;
+
+	cout << filename << ": " << stats.numTriangles << " triangles, " << stats.numVertices << " vertices" << endl;
+	cout << "  " << seconds * 1000.0 << " ms, peak working memory " << stats.peakBytes / 1024 << " KB" << endl;
+
+	return true;
+}
+
+
+bool benchmarkImport(const vector<string>& objFilenames, const vector<string>& filenames3DS, uint32_t numSyntheticTriangles) {
+
+	bool passed = true;
+
+	cout << fixed << setprecision(2);
+
+	try
+	{
+		for (const string& filename : objFilenames)
+			passed &= benchmarkOBJ(filename);
+
+		// Written outside the repository and removed afterwards
+		string synthetic = (filesystem::temp_directory_path() / "synthetic_import.obj").string();
+		writeSyntheticOBJ(synthetic, numSyntheticTriangles);
+
+		try
+		{
+			passed &= benchmarkOBJ(synthetic);
+		}
+		catch (exception&)
+		{
+			filesystem::remove(synthetic);
+			throw;
+		}
+
+		filesystem::remove(synthetic);
+
+		for (const string& filename : filenames3DS)
+			passed &= benchmark3DS(filename);
+	}
+	catch (exception& e)
+	{
+		cout << "  " << e.what() << endl;
+		passed = false;
+	}
+
+	cout.unsetf(ios::floatfield);
+
+	return passed;
+}
@@ -0,0 +1,67 @@
+// Meshlet benchmarks - build time and the triangles culled from cameras orbiting a model
+
+#include "Benchmarks.h"
+#include <TestScenes.h>
+#include <Meshlet.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+
+using namespace std;
+
+
+bool benchmarkMeshlets(const string& filename) {
+
+	MeshData mesh;
+
+	try
+	{
+		importTestModel(filename, mesh);
+	}
+	catch (exception& e)
+	{
+		cout << "Cannot import " << filename << ": " << e.what() << endl;
+		return false;
+	}
+
+	MeshletBuildStats buildStats = buildMeshlets(mesh);
+
+	cout << fixed << setprecision(2);
+	cout << filename << ": " << buildStats.numTriangles << " triangles -> " << buildStats.numMeshlets << " meshlets (" << buildStats.averageTriangles << " triangles each, average cone cutoff " << buildStats.averageConeCutoff << ") in " << buildStats.seconds * 1000.0 << "ms" << endl;
+
+	const int numViews = 64;
+
+	for (bool inside : { false, true }) {
+
+		MeshletCullStats total = {};
+		vector<IndexRange> ranges;
+		double seconds = 0.0;
+
+		for (const TestView& view : orbitViews(mesh, inside, numViews)) {
+
+			MeshletCullStats stats;
+			ranges.clear();
+
+			auto start = chrono::steady_clock::now();
+			cullMeshlets(mesh.meshlets.data(), mesh.meshlets.size(), mesh.lods[0].subMeshes.data(), view.planes, view.eye, ranges, &stats);
+			seconds += secondsSince(start);
+
+			total.frustumCulled += stats.frustumCulled;
+			total.backfaceCulled += stats.backfaceCulled;
+			total.numTriangles += stats.numTriangles;
+			total.visibleTriangles += stats.visibleTriangles;
+			total.numRanges += stats.numRanges;
+		}
+
+		float culled = total.numTriangles ? 100.0f * (total.numTriangles - total.visibleTriangles) / total.numTriangles : 0.0f;
+		float meshletCount = (float)mesh.meshlets.size() * numViews;
+
+		cout << "  " << (inside ? "inside" : "outside") << " views: " << culled << "% of triangles culled (frustum " << 100.0f * total.frustumCulled / meshletCount << "%, back face " << 100.0f * total.backfaceCulled / meshletCount << "% of meshlets), ";
+		cout << (float)total.numRanges / numViews << " draw ranges, " << seconds * 1e6 / numViews << "us per cull" << endl;
+	}
+
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
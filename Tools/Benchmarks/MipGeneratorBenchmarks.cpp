@@ -0,0 +1,72 @@
+// MipGenerator benchmarks - throughput of each filter with the scalar and SSE paths on 1 and all hardware threads
+
+#include "Benchmarks.h"
+#include <MipGenerator.h>
+#include <ImageImporter.h>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+
+using namespace std;
+
+
+bool benchmarkMipGeneration(const string& filename) {
+
+	static const MipFilter filters[] = { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos };
+
+	ImageData image;
+
+	try
+	{
+		importImage(filename, image);
+	}
+	catch (exception& e)
+	{
+		cout << "Cannot import " << filename << ": " << e.what() << endl;
+		return false;
+	}
+
+	unsigned int numThreads = max(1u, thread::hardware_concurrency());
+	double megaPixels = (double)image.width * image.height / 1e6;
+
+	MipOptions options = getDefaultMipOptions(filename);
+
+	cout << fixed << setprecision(2);
+	cout << filename << ": " << image.width << "x" << image.height << ", " << getMipLevelCount(image.width, image.height) << " levels, " << (options.normalMap ? "normal map" : (options.sRGB ? "sRGB" : "linear")) << endl;
+
+	for (MipFilter filter : filters) {
+
+		options.filter = filter;
+
+		// Best of 3 runs so the first run does not include building the colour tables or page faults
+		double simdSeconds = 1e9, scalarSeconds = 1e9, threadedSeconds = 1e9;
+
+		for (int run = 0; run < 3; ++run) {
+
+			options.numThreads = 1;
+
+			auto start = chrono::steady_clock::now();
+			generateMipChain(image, options);
+			simdSeconds = min(simdSeconds, secondsSince(start));
+
+			start = chrono::steady_clock::now();
+			generateMipChainScalar(image, options);
+			scalarSeconds = min(scalarSeconds, secondsSince(start));
+
+			options.numThreads = numThreads;
+
+			start = chrono::steady_clock::now();
+			generateMipChain(image, options);
+			threadedSeconds = min(threadedSeconds, secondsSince(start));
+		}
+
+		cout << "  " << setw(7) << getFilterName(filter) << ": " << megaPixels / scalarSeconds << " MPix/s scalar, " << megaPixels / simdSeconds << " MPix/s SSE, " << megaPixels / threadedSeconds << " MPix/s SSE on " << numThreads << " threads" << endl;
+	}
+
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
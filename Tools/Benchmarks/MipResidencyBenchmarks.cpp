@@ -0,0 +1,63 @@
+// MipResidency benchmarks - update time, loads and evictions while a camera crosses a scene of streamed textures
+
+#include "Benchmarks.h"
+#include <TestScenes.h>
+#include <MipResidency.h>
+#include <algorithm>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+bool benchmarkMipResidency(uint32_t numTextures) {
+
+	mt19937 random(1234);
+	StreamedScene scene = randomStreamedScene(numTextures, random);
+
+	MipStreamingOptions options;
+	options.budgetBytes = 16 * 1024 * 1024;
+
+	MipResidency residency(options);
+	vector<uint32_t> ids = addStreamedTextures(residency, scene);
+
+	size_t startupBytes = residency.getStats().residentBytes;
+
+	// The camera crosses the area then stays still until the residency settles.  Loads complete in the frame after they are requested.
+	vector<MipRequest> loads, evictions, pending;
+	double totalMs = 0.0, maxMs = 0.0;
+	const int moveFrames = 300, settleFrames = 600;
+
+	for (int frame = 0; frame < moveFrames + settleFrames; ++frame) {
+
+		float camera[2];
+		getStreamedCamera(frame, moveFrames, camera);
+
+		for (const MipRequest& load : pending)
+			residency.loaded(load.texture, load.level);
+
+		residency.beginFrame();
+		requestStreamedViews(residency, scene, ids, camera);
+		residency.update(loads, evictions);
+
+		MipStreamingStats stats = residency.getStats();
+		totalMs += stats.updateMs;
+		maxMs = max(maxMs, stats.updateMs);
+
+		pending = loads;
+	}
+
+	for (const MipRequest& load : pending)
+		residency.loaded(load.texture, load.level);
+
+	MipStreamingStats settled = residency.getStats();
+
+	cout << fixed << setprecision(2);
+	cout << numTextures << " textures on " << scene.objects.size() << " objects, " << scene.fullBytes / (1024 * 1024) << " MB with every level, " << startupBytes / 1024 << " KB of startup levels, budget " << options.budgetBytes / (1024 * 1024) << " MB" << endl;
+	cout << "  update: " << totalMs * 1000.0 / (moveFrames + settleFrames) << " us average, " << maxMs * 1000.0 << " us max; " << settled.totalLoads << " loads, " << settled.totalEvictions << " evictions" << endl;
+	cout << "  settled: " << settled.residentBytes / (1024 * 1024) << " MB resident, " << settled.missingLevels << " levels missing, " << settled.surplusLevels << " levels cached beyond need" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
@@ -0,0 +1,212 @@
+// SceneBVH benchmarks - build, query, refit and background rebuild times against testing every object
+
+#include "Benchmarks.h"
+#include <TestScenes.h>
+#include <SceneBVH.h>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+bool benchmarkSceneBVH(size_t numObjects) {
+
+	mt19937 random(1);
+	uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	ReferenceObjects reference;
+	SceneBVH bvh;
+	bvh.setBackgroundRebuild(false);
+
+	for (size_t i = 0; i < numObjects; ++i) {
+
+		// A few objects have not been loaded yet
+		reference.bounds.push_back(random() % 1000 ? randomBounds(random) : emptyBounds());
+		reference.live.push_back(true);
+		bvh.insert(reference.bounds.back());
+	}
+
+	// Build (best of 3)
+	double buildSeconds = 1e9;
+
+	for (int run = 0; run < 3; ++run) {
+
+		auto start = chrono::steady_clock::now();
+		bvh.rebuild();
+		buildSeconds = min(buildSeconds, secondsSince(start));
+	}
+
+	SceneBVHStats built = bvh.getStats();
+	cout << fixed << setprecision(2);
+	cout << numObjects << " objects: build " << buildSeconds * 1000.0 << " ms, " << built.nodes << " nodes, " << built.pending << " objects without bounds outside the tree" << endl;
+
+	// Query times against testing every object (and flat vector culling for frusta)
+	const int numQueries = 1000;
+	vector<float> queries(numQueries * 6);
+
+	for (float& v : queries)
+		v = unit(random);
+
+	CullingBounds culling;
+	culling.resize(numObjects);
+
+	for (size_t i = 0; i < numObjects; ++i)
+		culling.set(i, reference.bounds[i]);
+
+	VisibilitySet visibility;
+	vector<uint32_t> found;
+	float planes[16][6][4];
+
+	for (auto& p : planes)
+		randomFrustum(random, p);
+
+	double seconds[3][2] = { { 1e9, 1e9 }, { 1e9, 1e9 }, { 1e9, 1e9 } };
+	double flatCullSeconds = 1e9;
+	size_t results[3][2] = {}; // Visible objects, hits and objects found, so no query is optimised away
+
+	for (int run = 0; run < 3; ++run) {
+
+		auto start = chrono::steady_clock::now();
+
+		for (auto& p : planes) {
+
+			bvh.queryFrustum(p, visibility);
+			results[0][0] += visibility.getWords()[0];
+		}
+
+		seconds[0][0] = min(seconds[0][0], secondsSince(start) / 16);
+		start = chrono::steady_clock::now();
+
+		for (auto& p : planes)
+			cullBounds(culling, p, CullBoxes, visibility);
+
+		flatCullSeconds = min(flatCullSeconds, secondsSince(start) / 16);
+		start = chrono::steady_clock::now();
+
+		for (auto& p : planes) {
+
+			cullBoundsScalar(culling, p, CullBoxes, visibility);
+			results[0][1] += visibility.getWords()[0];
+		}
+
+		seconds[0][1] = min(seconds[0][1], secondsSince(start) / 16);
+
+		for (int version = 0; version < 2; ++version) {
+
+			// Picking rays and proximity spheres from points in the scene
+			start = chrono::steady_clock::now();
+
+			for (int q = 0; q < (version ? numQueries / 100 : numQueries); ++q) {
+
+				const float *v = &queries[q * 6];
+				float origin[3] = { v[0] * 500.0f, v[1] * 50.0f, v[2] * 500.0f }, direction[3] = { v[3], v[4] * 0.1f, v[5] }, distance;
+
+				uint32_t hit = version ? reference.queryRay(origin, direction, 1000.0f, distance) : bvh.queryRay(origin, direction, 1000.0f, distance);
+				results[1][version] += hit != bvhNoObject;
+			}
+
+			seconds[1][version] = min(seconds[1][version], secondsSince(start) / (version ? numQueries / 100 : numQueries));
+			start = chrono::steady_clock::now();
+
+			for (int q = 0; q < (version ? numQueries / 100 : numQueries); ++q) {
+
+				const float *v = &queries[q * 6];
+				float centre[3] = { v[0] * 500.0f, v[1] * 50.0f, v[2] * 500.0f };
+
+				if (version)
+					reference.querySphere(centre, 20.0f, found);
+				else
+					bvh.querySphere(centre, 20.0f, found);
+
+				results[2][version] += found.size();
+			}
+
+			seconds[2][version] = min(seconds[2][version], secondsSince(start) / (version ? numQueries / 100 : numQueries));
+		}
+	}
+
+	const char *queryNames[] = { "frustum", "ray", "sphere" };
+
+	for (int q = 0; q < 3; ++q)
+		cout << "  " << queryNames[q] << " query: " << seconds[q][0] * 1e6 << " us, testing every object " << seconds[q][1] * 1e6 << " us (" << seconds[q][1] / seconds[q][0] << "x)" << endl;
+
+	cout << "  flat vector culling (cullBounds): " << flatCullSeconds * 1e6 << " us" << endl;
+
+	// Move 1% of the objects a short way each frame, refitting the tree, until it has loosened enough to be rebuilt
+	uniform_int_distribution<size_t> anyObject(0, numObjects - 1);
+	double refitSeconds = 0.0;
+	int frames = 0, refitFrames = 0;
+	float costRatio = 1.0f;
+
+	for (; frames < 1000; ++frames) {
+
+		for (size_t i = 0; i < numObjects / 100; ++i) {
+
+			uint32_t id = (uint32_t)anyObject(random);
+			Bounds& b = reference.bounds[id];
+
+			if (b.isEmpty())
+				continue;
+
+			for (int a = 0; a < 3; ++a)
+				b.boxCentre[a] = b.sphereCentre[a] = b.boxCentre[a] + unit(random) * 20.0f;
+
+			bvh.setBounds(id, b);
+		}
+
+		costRatio = bvh.getStats().costRatio;
+		auto start = chrono::steady_clock::now();
+		bvh.refit();
+		double seconds = secondsSince(start);
+
+		// The frame that rebuilds is not a refit
+		if (bvh.getStats().builds > built.builds)
+			break;
+
+		refitSeconds += seconds;
+		refitFrames++;
+	}
+
+	cout << "  refit " << refitSeconds * 1000.0 / max(refitFrames, 1) << " ms a frame moving 1% of the objects, " << frames << " frames until the cost reached " << costRatio << " x the built cost" << endl;
+
+	// Add objects, then rebuild in the background while objects keep moving
+	for (size_t i = 0; i < numObjects / 10; ++i)
+		bvh.insert(randomBounds(random));
+
+	bvh.setBackgroundRebuild(true);
+	SceneBVHStats before = bvh.getStats();
+	auto start = chrono::steady_clock::now();
+	double blockedSeconds = 0.0;
+	frames = 0;
+
+	while (bvh.getStats().backgroundBuilds == before.backgroundBuilds && frames < 100000) {
+
+		for (size_t i = 0; i < numObjects / 100; ++i) {
+
+			uint32_t id = (uint32_t)anyObject(random);
+			Bounds& b = reference.bounds[id];
+
+			if (b.isEmpty())
+				continue;
+
+			for (int a = 0; a < 3; ++a)
+				b.boxCentre[a] = b.sphereCentre[a] = b.boxCentre[a] + unit(random);
+
+			bvh.setBounds(id, b);
+		}
+
+		auto refitStart = chrono::steady_clock::now();
+		bvh.refit();
+		blockedSeconds = max(blockedSeconds, secondsSince(refitStart));
+		frames++;
+	}
+
+	SceneBVHStats after = bvh.getStats();
+	cout << "  background rebuild of " << after.objects << " objects installed after " << frames << " frames (" << secondsSince(start) * 1000.0 << " ms), slowest refit " << blockedSeconds * 1000.0 << " ms, " << after.pending << " objects outside the tree" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
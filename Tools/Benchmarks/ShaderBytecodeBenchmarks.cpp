@@ -0,0 +1,78 @@
+// ShaderBytecode benchmarks - files and bytes read by a separate read of every shader request against a ShaderBytecodeStore
+
+#include "Benchmarks.h"
+#include <ShaderBytecode.h>
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+
+using namespace std;
+
+
+// Read filename into a new heap block as every shader was loaded before the store
+static vector<char> readShader(const string& filename) {
+
+	ifstream file(filename, ios::binary | ios::ate);
+
+	if (!file)
+		throw runtime_error("Cannot open shader " + filename);
+
+	vector<char> bytecode((size_t)file.tellg());
+	file.seekg(0, ios::beg);
+	file.read(bytecode.data(), bytecode.size());
+
+	return bytecode;
+}
+
+
+bool benchmarkShaderBytecode(const vector<string>& filenames) {
+
+	// Best of 3 runs so the first run does not include reading the files from disk
+	double readSeconds = 1e9, storeSeconds = 1e9;
+	uint64_t readBytes = 0;
+	ShaderBytecodeStats stats = {};
+
+	try
+	{
+		for (int run = 0; run < 3; ++run) {
+
+			auto start = chrono::steady_clock::now();
+			vector<vector<char>> read;
+			readBytes = 0;
+
+			for (const string& filename : filenames) {
+
+				read.push_back(readShader(filename));
+				readBytes += read.back().size();
+			}
+
+			readSeconds = min(readSeconds, secondsSince(start));
+
+			start = chrono::steady_clock::now();
+			ShaderBytecodeStore store;
+
+			for (const string& filename : filenames)
+				store.load(filename);
+
+			storeSeconds = min(storeSeconds, secondsSince(start));
+			stats = store.getStats();
+		}
+	}
+	catch (exception& e)
+	{
+		cout << "  " << e.what() << endl;
+		return false;
+	}
+
+	cout << fixed << setprecision(2);
+	cout << filenames.size() << " shader requests" << endl;
+	cout << "  before: " << filenames.size() << " loads, " << readBytes / 1024.0 << " KB read, " << readSeconds * 1000.0 << " ms" << endl;
+	cout << "  after: " << stats.fileLoads << " loads, " << stats.bytesRead / 1024.0 << " KB read, " << stats.uniqueBytecodes << " unique bytecodes, " << storeSeconds * 1000.0 << " ms" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
@@ -0,0 +1,78 @@
+// TextureAtlas benchmarks - packing time, efficiency and size of the rectangle and array layouts against separate textures
+
+#include "Benchmarks.h"
+#include <TestScenes.h>
+#include <TextureAtlas.h>
+#include <MipGenerator.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+
+using namespace std;
+
+
+static size_t getChainBytes(const vector<ImageData>& mips) {
+
+	size_t bytes = 0;
+
+	for (const ImageData& mip : mips)
+		bytes += mip.getSizeBytes();
+
+	return bytes;
+}
+
+
+bool benchmarkTextureAtlas(const vector<string>& names) {
+
+	vector<ImageData> images;
+
+	try
+	{
+		images = importTestTextures(names);
+	}
+	catch (exception& e)
+	{
+		cout << e.what() << endl;
+		return false;
+	}
+
+	size_t separateBytes = 0;
+
+	for (size_t i = 0; i < images.size(); ++i)
+		separateBytes += getChainBytes(generateMipChain(images[i], getDefaultMipOptions(names[i])));
+
+	cout << fixed << setprecision(2);
+	cout << images.size() << " textures, " << separateBytes / 1024 << " KB with full mip chains" << endl;
+
+	for (AtlasLayout layout : { AtlasLayout::Rectangles, AtlasLayout::Array }) {
+
+		AtlasOptions options;
+		options.layout = layout;
+
+		// Best of 3 runs
+		TextureAtlas atlas;
+		double seconds = 1e9;
+
+		for (int run = 0; run < 3; ++run) {
+
+			auto start = chrono::steady_clock::now();
+			atlas = buildTextureAtlas(images, names, options);
+			seconds = min(seconds, secondsSince(start));
+		}
+
+		size_t atlasBytes = 0;
+
+		for (const vector<ImageData>& slice : atlas.slices)
+			atlasBytes += getChainBytes(slice);
+
+		cout << "  " << setw(10) << getLayoutName(layout) << ": " << atlas.width << "x" << atlas.height << " x " << atlas.slices.size() << (atlas.slices.size() == 1 ? " slice, " : " slices, ") << atlas.slices[0].size() << " levels, ";
+		cout << getPackingEfficiency(atlas, images) * 100.0f << "% packing efficiency, " << atlasBytes / 1024 << " KB, " << seconds * 1000.0 << " ms, ";
+		cout << images.size() << " texture binds -> 1" << endl;
+	}
+
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
@@ -0,0 +1,59 @@
+// TextureCompressor benchmarks - encode throughput on 1 and all hardware threads, compression ratio and PSNR of each format
+
+#include "Benchmarks.h"
+#include <TextureCompressor.h>
+#include <ImageImporter.h>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+
+using namespace std;
+
+
+bool benchmarkTextureCompression(const string& filename) {
+
+	static const BlockFormat formats[] = { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC4, BlockFormat::BC5, BlockFormat::BC7 };
+
+	ImageData image;
+
+	try
+	{
+		importImage(filename, image);
+	}
+	catch (exception& e)
+	{
+		cout << "Cannot import " << filename << ": " << e.what() << endl;
+		return false;
+	}
+
+	unsigned int numThreads = max(1u, thread::hardware_concurrency());
+	double megaPixels = (double)image.width * image.height / 1e6;
+
+	cout << fixed << setprecision(2);
+	cout << filename << ": " << image.width << "x" << image.height << endl;
+
+	for (BlockFormat format : formats) {
+
+		auto start = chrono::steady_clock::now();
+		vector<uint8_t> blocks = compressImage(image, format, 1);
+		double singleSeconds = secondsSince(start);
+
+		start = chrono::steady_clock::now();
+		compressImage(image, format, numThreads);
+		double threadedSeconds = secondsSince(start);
+
+		ImageData result;
+		decompressImage(blocks.data(), image.width, image.height, format, result);
+		double psnr = computePSNR(image, result, getChannelMask(format));
+
+		cout << "  " << getFormatName(format) << ": " << psnr << " dB, " << blocks.size() / 1024 << " KB (" << (double)image.getSizeBytes() / blocks.size() << ":1), ";
+		cout << megaPixels / singleSeconds << " MPix/s on 1 thread, " << megaPixels / threadedSeconds << " MPix/s on " << numThreads << " threads" << endl;
+	}
+
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
@@ -0,0 +1,63 @@
+// TextureDecoder benchmarks - serial against parallel decode and mip generation wall time
+
+#include "Benchmarks.h"
+#include <TestScenes.h>
+#include <TextureDecoder.h>
+#include <ImageImporter.h>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <exception>
+
+using namespace std;
+
+
+bool benchmarkTextureDecode(const string& directory) {
+
+	vector<string> filenames;
+
+	try
+	{
+		filenames = listTestTextures(directory);
+	}
+	catch (exception& e)
+	{
+		cout << e.what() << endl;
+		return false;
+	}
+
+	unsigned int numThreads = max(1u, thread::hardware_concurrency());
+
+	// Best of 3 runs so the first run does not include reading the files from disk
+	vector<DecodedTexture> serial;
+	double serialSeconds = 1e9, parallelSeconds = 1e9;
+
+	for (int run = 0; run < 3; ++run) {
+
+		auto start = chrono::steady_clock::now();
+		serial = decodeTextures(filenames, importImage, 1);
+		serialSeconds = min(serialSeconds, secondsSince(start));
+
+		start = chrono::steady_clock::now();
+		decodeTextures(filenames, importImage, numThreads);
+		parallelSeconds = min(parallelSeconds, secondsSince(start));
+	}
+
+	double decodeSeconds = 0.0;
+	size_t bytes = 0;
+
+	for (const DecodedTexture& texture : serial) {
+
+		decodeSeconds += texture.decodeSeconds;
+		bytes += texture.getSizeBytes();
+	}
+
+	cout << fixed << setprecision(2);
+	cout << filenames.size() << " textures, " << bytes / (1024 * 1024) << " MB decoded with mips (" << decodeSeconds * 1000.0 << " ms of decoding)" << endl;
+	cout << "  serial: " << serialSeconds * 1000.0 << " ms, " << numThreads << " threads: " << parallelSeconds * 1000.0 << " ms (" << serialSeconds / parallelSeconds << "x)" << endl;
+	cout.unsetf(ios::floatfield);
+
+	return true;
+}
@@ -0,0 +1,96 @@
+
+//
+// ShaderPermutations.cpp
+//
+
+// Offline shader permutation build step.  Checks the permutation axes declared by each HLSL family file against ShaderPermutation.h and writes the MSBuild rules (imported by DX11Proj.vcxproj) that compile exactly the variants in compiledShaderVariants, each with its feature defines, to Shaders/cso/<variant name>.cso.  Rerun when a family or a compiled variant is added - the family files are not compiled on their own.
+//
+// Usage: ShaderPermutations [hlsl directory] [targets file]   (Shaders/hlsl and Shaders/ShaderPermutations.targets by default, run from the repository root)
+
+#include <ShaderPermutation.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <exception>
+
+using namespace std;
+
+
+static const char *shaderTypeNames[] = { "Vertex", "Pixel" };
+
+
+int main(int argc, char **argv) {
+
+	string hlslDirectory = argc > 1 ? argv[1] : "Shaders/hlsl";
+	string targetsFilename = argc > 2 ? argv[2] : "Shaders/ShaderPermutations.targets";
+	const size_t numCompiled = sizeof(compiledShaderVariants) / sizeof(ShaderVariant);
+
+	// A family file that declares other axes than its family would be compiled with the wrong defines
+	for (uint32_t family = 0; family < NumShaderFamilies; ++family) {
+
+		string filename = hlslDirectory + "/" + shaderFamilies[family].name + ".hlsl";
+		ifstream file(filename, ios::binary);
+
+		if (!file) {
+
+			cout << "ShaderPermutations: cannot read " << filename << endl;
+			return 1;
+		}
+
+		stringstream source;
+		source << file.rdbuf();
+
+		try
+		{
+			if (parseShaderAxes(source.str()) != shaderFamilies[family].axes) {
+
+				cout << "ShaderPermutations: " << filename << " declares other permutation axes than its family in ShaderPermutation.h" << endl;
+				return 1;
+			}
+		}
+		catch (exception& e)
+		{
+			cout << "ShaderPermutations: " << filename << ": " << e.what() << endl;
+			return 1;
+		}
+	}
+
+	// Paths are relative to the project directory (backslashes as in the project file)
+	string inputs, outputs;
+
+	for (uint32_t family = 0; family < NumShaderFamilies; ++family)
+		inputs += string(family ? ";" : "") + "Shaders\\hlsl\\" + shaderFamilies[family].name + ".hlsl";
+
+	for (size_t i = 0; i < numCompiled; ++i)
+		outputs += string(i ? ";" : "") + "$(ProjectDir)Shaders\\cso\\" + getShaderVariantName(compiledShaderVariants[i]) + ".cso";
+
+	ostringstream targets;
+
+	targets << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\r\n";
+	targets << "<!-- Generated by Tools/ShaderPermutations from compiledShaderVariants in Source/ShaderPermutation.h - do not edit -->\r\n";
+	targets << "<Project xmlns=\"http://schemas.microsoft.com/developer/msbuild/2003\">\r\n";
+	targets << "  <Target Name=\"CompileShaderPermutations\" BeforeTargets=\"ClCompile\" Inputs=\"" << inputs << "\" Outputs=\"" << outputs << "\">\r\n";
+
+	for (size_t i = 0; i < numCompiled; ++i) {
+
+		const ShaderVariant& variant = compiledShaderVariants[i];
+		const ShaderFamily& family = shaderFamilies[variant.family];
+
+		targets << "    <FxCompile Source=\"Shaders\\hlsl\\" << family.name << ".hlsl\" ShaderType=\"" << shaderTypeNames[family.type] << "\" ShaderModel=\"5.0\" EntryPointName=\"main\" PreprocessorDefinitions=\"" << getShaderVariantDefines(variant) << "\" ObjectFileOutput=\"$(ProjectDir)Shaders\\cso\\" << getShaderVariantName(variant) << ".cso\" />\r\n";
+	}
+
+	targets << "  </Target>\r\n";
+	targets << "</Project>\r\n";
+
+	ofstream file(targetsFilename, ios::binary);
+
+	if (!file || !(file << targets.str())) {
+
+		cout << "ShaderPermutations: cannot write " << targetsFilename << endl;
+		return 1;
+	}
+
+	cout << "ShaderPermutations: " << numCompiled << " variants of " << NumShaderFamilies << " shader families written to " << targetsFilename << endl;
+	return 0;
+}